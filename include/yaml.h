@@ -169,7 +169,10 @@ typedef enum yaml_error_type_e {
     YAML_SERIALIZER_ERROR,
 
     /* Cannot resolve an implicit YAML node tag. */
-    YAML_RESOLVER_ERROR
+    YAML_RESOLVER_ERROR,
+
+    /* Cannot compile a path selector. */
+    YAML_SELECTOR_ERROR
 } yaml_error_type_t;
 
 /*
@@ -263,6 +266,17 @@ typedef struct yaml_error_s {
             const char *problem;
         } resolving;
 
+        /*
+         * A problem occured while compiling a path selector (relevant for
+         * `YAML_SELECTOR_ERROR`).
+         */
+        struct {
+            /* The problem description. */
+            const char *problem;
+            /* The position in the path, in bytes. */
+            size_t offset;
+        } selecting;
+
     } data;
 
 } yaml_error_t;
@@ -277,8 +291,8 @@ typedef struct yaml_error_s {
  *
  * Arguments:
  *
- * - `error`: an error object obtained using `yaml_parser_get_error()` or
- *   `yaml_emitter_get_error()`.
+ * - `error`: an error object obtained using `yaml_parser_get_error()`,
+ *   `yaml_emitter_get_error()` or `yaml_selector_get_error()`.
  *
  * - `buffer`: a pointer to a character buffer to be filled with a generated
  *   error message.
@@ -295,6 +309,40 @@ typedef struct yaml_error_s {
 YAML_DECLARE(int)
 yaml_error_message(yaml_error_t *error, char *buffer, size_t capacity);
 
+/*****************************************************************************
+ * Memory Allocation
+ *****************************************************************************/
+
+/*
+ * The memory allocator.
+ *
+ * An allocator is a set of handlers that the parser uses to allocate the
+ * content of the documents it produces: the node list, the anchors, the tags,
+ * the scalar values, and the lists of sequence items and mapping pairs.  A
+ * document remembers the allocator that was used to construct it, so
+ * `yaml_document_clear()` and `yaml_document_delete()` return the memory to
+ * the same allocator.
+ *
+ * An allocator with all the handlers set to `NULL` is the standard allocator
+ * based on `malloc()`, `realloc()` and `free()`.
+ */
+
+typedef struct yaml_allocator_s {
+
+    /* Allocate a block of `size` bytes; return `NULL` on failure. */
+    void *(*allocate)(void *data, size_t size);
+
+    /* Resize a block allocated by the allocator; return `NULL` on failure. */
+    void *(*reallocate)(void *data, void *ptr, size_t size);
+
+    /* Free a block allocated by the allocator. */
+    void (*deallocate)(void *data, void *ptr);
+
+    /* The application data to be passed to the handlers. */
+    void *data;
+
+} yaml_allocator_t;
+
 /*****************************************************************************
  * Basic Types
  *****************************************************************************/
@@ -456,6 +504,29 @@ typedef enum yaml_mapping_style_e {
     YAML_FLOW_MAPPING_STYLE
 } yaml_mapping_style_t;
 
+/*
+ * Collection hints.
+ *
+ * The emitter picks the style of a collection when it meets the collection
+ * start, but an empty collection could only be written in the flow style.
+ * Unless told otherwise, the emitter waits for the next event to see if the
+ * collection is empty.  A SEQUENCE-START or MAPPING-START event may carry a
+ * hint, so that the event is written out as soon as it comes.  The parser
+ * sets the hint for block collections, which are never empty.  If a
+ * collection hinted as non-empty turns out to be empty (e.g., a filter dropped
+ * its items), the emitter writes it as an empty flow collection.
+ */
+
+typedef enum yaml_collection_hint_e {
+    /* The collection may be empty. */
+    YAML_ANY_COLLECTION_HINT,
+
+    /* The collection is empty. */
+    YAML_EMPTY_COLLECTION_HINT,
+    /* The collection has at least one item or pair. */
+    YAML_NONEMPTY_COLLECTION_HINT
+} yaml_collection_hint_t;
+
 /*****************************************************************************
  * Tokens
  *****************************************************************************/
@@ -630,6 +701,8 @@ typedef struct yaml_token_s {
             size_t length;
             /* The scalar style. */
             yaml_scalar_style_t style;
+            /* Set if the value points into the input buffer (not owned). */
+            int is_borrowed;
         } scalar;
 
     } data;
@@ -842,6 +915,8 @@ typedef struct yaml_event_s {
             int is_quoted_nonspecific;
             /* The scalar style. */
             yaml_scalar_style_t style;
+            /* Set if the value points into the input buffer (not owned). */
+            int is_borrowed;
         } scalar;
 
         /* The sequence parameters (for `YAML_SEQUENCE_START_EVENT`). */
@@ -854,6 +929,8 @@ typedef struct yaml_event_s {
             int is_nonspecific;
             /* The sequence style. */
             yaml_sequence_style_t style;
+            /* Set if the emptiness of the sequence is known. */
+            yaml_collection_hint_t hint;
         } sequence_start;
 
         /* The mapping parameters (for `YAML_MAPPING_START_EVENT`). */
@@ -866,6 +943,8 @@ typedef struct yaml_event_s {
             int is_nonspecific;
             /* The mapping style. */
             yaml_mapping_style_t style;
+            /* Set if the emptiness of the mapping is known. */
+            yaml_collection_hint_t hint;
         } mapping_start;
 
     } data;
@@ -1310,6 +1389,44 @@ typedef enum yaml_node_type_e {
     YAML_MAPPING_NODE
 } yaml_node_type_t;
 
+/*
+ * Scalar kinds.
+ *
+ * The standard resolver classifies a plain scalar value as a null, a boolean,
+ * an integer, a float, or a string.  The kind and the converted value are
+ * cached in the node, so that the functions `yaml_document_get_*_node()` do
+ * not need to parse the value again.
+ */
+
+typedef enum yaml_scalar_kind_e {
+    /* The value is not classified yet. */
+    YAML_NO_SCALAR_KIND,
+
+    /* A `!!str` value. */
+    YAML_STR_SCALAR_KIND,
+    /* A `!!null` value. */
+    YAML_NULL_SCALAR_KIND,
+    /* A `!!bool` value. */
+    YAML_BOOL_SCALAR_KIND,
+    /* An `!!int` value. */
+    YAML_INT_SCALAR_KIND,
+    /* A `!!float` value. */
+    YAML_FLOAT_SCALAR_KIND
+} yaml_scalar_kind_t;
+
+/*
+ * A scalar value converted according to its kind.
+ */
+
+typedef union yaml_scalar_value_u {
+    /* The value of a `!!bool` scalar. */
+    int boolean;
+    /* The value of an `!!int` scalar. */
+    long integer;
+    /* The value of a `!!float` scalar. */
+    double real;
+} yaml_scalar_value_t;
+
 /*
  * Arc types.
  *
@@ -1413,9 +1530,15 @@ typedef struct yaml_node_s {
     /* The node type. */
     yaml_node_type_t type;
 
-    /* The node anchor or `NULL`. */
+    /*
+     * The node anchor or `NULL`.  Nodes share equal anchors and tags, the
+     * strings belong to the document.
+     */
     yaml_char_t *anchor;
-    /* The node tag. */
+    /*
+     * The node tag.  A standard tag always points to the same static string,
+     * so nodes with the same standard tag have equal tag pointers.
+     */
     yaml_char_t *tag;
 
     /* The node data. */
@@ -1429,6 +1552,10 @@ typedef struct yaml_node_s {
             size_t length;
             /* The scalar style. */
             yaml_scalar_style_t style;
+            /* The kind of the value if it is classified (used internally). */
+            yaml_scalar_kind_t kind;
+            /* The converted value (used internally). */
+            yaml_scalar_value_t converted;
         } scalar;
 
         /* The sequence parameters (for `YAML_SEQUENCE_NODE`). */
@@ -1504,6 +1631,10 @@ typedef struct yaml_incomplete_node_s {
             size_t length;
             /* Set if the scalar is plain. */
             int is_plain;
+            /* The kind of the value set by the standard resolver. */
+            yaml_scalar_kind_t kind;
+            /* The value converted by the standard resolver. */
+            yaml_scalar_value_t converted;
         } scalar;
 
     } data;
@@ -1534,7 +1665,10 @@ typedef struct yaml_document_s {
     /* The document type. */
     yaml_document_type_t type;
 
-    /* The document nodes (for internal use only). */
+    /*
+     * The document nodes (for internal use only).  For a compact document,
+     * the list is `NULL` and only the length is set.
+     */
     struct {
         /* The pointer to the beginning of the list. */
         yaml_node_t *list;
@@ -1567,6 +1701,44 @@ typedef struct yaml_document_s {
     /** The end of the document. */
     yaml_mark_t end_mark;
 
+    /*
+     * The number of nodes the document would have if all aliases were
+     * replaced with copies of the anchored nodes (set by the loader and kept
+     * in binary images).
+     */
+    size_t expanded_nodes;
+    /* The depth of the node tree with all aliases expanded (same as above). */
+    size_t expanded_depth;
+
+    /*
+     * The table of the node tags and anchors (for internal use only).  It is
+     * an open addressing hash table of distinct strings shared by the nodes,
+     * `NULL` marks an empty slot.  The capacity is a power of 2.
+     */
+    struct {
+        yaml_char_t **list;
+        size_t length;
+        size_t capacity;
+    } strings;
+
+    /* The allocator of the document content (for internal use only). */
+    yaml_allocator_t allocator;
+
+    /* The memory arena or `NULL` (for internal use only). */
+    void *arena;
+
+    /* The compact node storage or `NULL` (for internal use only). */
+    void *compact;
+
+    /* The hash index of the mapping keys or `NULL` (for internal use only). */
+    void *key_index;
+
+    /* The node reference counts or `NULL` (for internal use only). */
+    void *references;
+
+    /* Set if the document is frozen (see `yaml_document_freeze()`). */
+    int is_frozen;
+
 } yaml_document_t;
 
 /*
@@ -1595,6 +1767,22 @@ yaml_document_new(void);
 YAML_DECLARE(void)
 yaml_document_delete(yaml_document_t *document);
 
+/*
+ * Deallocate a list of documents and free the associated data.
+ *
+ * A document list must be previously produced with
+ * `yaml_parser_parse_all_documents()`.
+ *
+ * Arguments:
+ *
+ * - `documents`: a list of documents to be deallocated or `NULL`.
+ *
+ * - `count`: the number of documents in the list.
+ */
+
+YAML_DECLARE(void)
+yaml_document_list_delete(yaml_document_t *documents, size_t count);
+
 /*
  * Duplicate a document object.
  *
@@ -1636,6 +1824,60 @@ yaml_document_duplicate(yaml_document_t *document, yaml_document_t *model);
 YAML_DECLARE(void)
 yaml_document_clear(yaml_document_t *document);
 
+/*
+ * Check if the document nodes are stored in the compact layout.
+ *
+ * A compact document is produced by the parser in the compact mode (see
+ * `yaml_parser_set_compact()`) or loaded from a binary image (see
+ * `yaml_document_load_binary()`).  It does not have `yaml_node_t` objects:
+ * `yaml_document_get_node()` returns `NULL` for it and `nodes.length` is the
+ * only valid field of `nodes`.  The nodes are read with the functions
+ * `yaml_document_get_scalar()`, `yaml_document_get_sequence()`,
+ * `yaml_document_get_mapping()` and `yaml_document_get_*_node()`.  A compact
+ * document cannot be modified or duplicated.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * Returns: `1` if the document is compact, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_document_is_compact(yaml_document_t *document);
+
+/*
+ * Freeze the document for concurrent readers.
+ *
+ * Some reading functions fill caches in the document on the first use: the
+ * kinds and the converted values of the scalars for
+ * `yaml_document_get_*_node()` and the key index for
+ * `yaml_document_find_mapping_value()`.  This function fills them all at once
+ * and marks the document as immutable.  After the function succeeds, the
+ * functions `yaml_document_get_*()`, `yaml_document_find_mapping_value()`,
+ * `yaml_document_is_compact()` and `yaml_selector_select()` do not modify the
+ * document, and they could be called for it from any number of threads at the
+ * same time, each thread with its own selector objects.  The threads must
+ * see the document after it is frozen, for instance, by getting it after
+ * `yaml_document_freeze()` returns through a thread creation, a mutex, or a
+ * shared document handle.
+ *
+ * A frozen document cannot be modified with `yaml_document_add_*()` or
+ * `yaml_document_append_*()`.  It could be cleared, duplicated or emitted
+ * when no readers are left.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory for the key index.  In this case, the document is not
+ * frozen.
+ */
+
+YAML_DECLARE(int)
+yaml_document_freeze(yaml_document_t *document);
+
 /*
  * Create a YAML document.
  *
@@ -1705,12 +1947,123 @@ yaml_document_create(yaml_document_t *document,
  *   which is interpeted as the number (<total number of nodes> - `node_id`).
  *
  * Returns: a pointer to the node object or `NULL` if `node_id` is out of
- * range.
+ * range or the document is compact.
  */
 
 YAML_DECLARE(yaml_node_t *)
 yaml_document_get_node(yaml_document_t *document, int node_id);
 
+/*
+ * Get the tag and the value of a SCALAR node.
+ *
+ * Unlike `yaml_document_get_str_node()`, this function accepts a scalar with
+ * any tag.  It works with compact documents as well as with regular ones.  The
+ * produced strings are valid until the document is modified.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * - `node_id`: the node id; could be negative.
+ *
+ * - `tag`: a pointer to save the node tag or `NULL`.
+ *
+ * - `value`: a pointer to save the node value or `NULL`.  The value is
+ *   NUL-terminated, but it could contain NUL characters as well.
+ *
+ * - `length`: a pointer to save the length of the value or `NULL`.
+ *
+ * Returns: `1` if the node is a scalar, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_scalar(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_char_t **value, size_t *length);
+
+/*
+ * Get the tag and the items of a SEQUENCE node.
+ *
+ * Unlike `yaml_document_get_seq_node()`, this function accepts a sequence
+ * with any tag.  It works with compact documents as well as with regular ones.
+ * The produced list is valid until the document is modified.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * - `node_id`: the node id; could be negative.
+ *
+ * - `tag`: a pointer to save the node tag or `NULL`.
+ *
+ * - `items`: a pointer to save the list of sequence items or `NULL`.
+ *
+ * - `length`: a pointer to save the length of the sequence or `NULL`.
+ *
+ * Returns: `1` if the node is a sequence, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_sequence(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_node_item_t **items, size_t *length);
+
+/*
+ * Get the tag and the pairs of a MAPPING node.
+ *
+ * Unlike `yaml_document_get_map_node()`, this function accepts a mapping with
+ * any tag.  It works with compact documents as well as with regular ones.  The
+ * produced list is valid until the document is modified.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * - `node_id`: the node id; could be negative.
+ *
+ * - `tag`: a pointer to save the node tag or `NULL`.
+ *
+ * - `pairs`: a pointer to save the list of mapping pairs or `NULL`.
+ *
+ * - `length`: a pointer to save the length of the mapping or `NULL`.
+ *
+ * Returns: `1` if the node is a mapping, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_mapping(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_node_pair_t **pairs, size_t *length);
+
+/*
+ * Find the value of a mapping pair by the content of its SCALAR key.
+ *
+ * The first call builds a hash index of the scalar keys of all mappings of the
+ * document, so that each lookup takes a constant time; the documents loaded
+ * with `yaml_parser_set_unique_keys()` come with the index already built.  The
+ * index is dropped by `yaml_document_append_mapping_pair()` and built again
+ * on the next lookup.  If there is not enough memory for the index, the pairs
+ * are searched one by one.  The keys are compared by value only, whatever
+ * their tags are; if several keys have the same value, the first one is
+ * found.  The function works with compact documents as well as with regular
+ * ones.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * - `node_id`: the mapping node id; could be negative.
+ *
+ * - `key`: the key value.
+ *
+ * - `length`: the length of the key value.
+ *
+ * - `value_id`: a pointer to save the value node id or `NULL`.
+ *
+ * Returns: `1` if the node is a mapping with the given key, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_document_find_mapping_value(yaml_document_t *document, int node_id,
+        const yaml_char_t *key, size_t length, int *value_id);
+
 /*
  * Create a SCALAR node and attach it to the document.
  *
@@ -2250,6 +2603,141 @@ yaml_document_add_seq_node(yaml_document_t *document, int *node_id);
 YAML_DECLARE(int)
 yaml_document_add_map_node(yaml_document_t *document, int *node_id);
 
+/*
+ * A shared document handle.
+ *
+ * A shared document is a frozen document (see `yaml_document_freeze()`) with
+ * a reference count, so that the readers in different threads could keep the
+ * document while it is replaced with a new one.  The document is cleared when
+ * the last reference is released.  The reference count is updated atomically.
+ */
+
+typedef struct yaml_shared_document_s yaml_shared_document_t;
+
+/*
+ * Freeze a document and move it to a new shared document handle.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.  The content of the document is moved to
+ *   the handle, so that the document becomes empty.
+ *
+ * Returns: a new handle with one reference or `NULL` on error.  The function
+ * may fail if it cannot allocate memory for the handle or for freezing the
+ * document.  In this case, the document is left as it is.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_shared_document_new(yaml_document_t *document);
+
+/*
+ * Get the document of a shared document handle.
+ *
+ * Arguments:
+ *
+ * - `shared`: a shared document handle.
+ *
+ * Returns: the frozen document.  The document is valid until the reference is
+ * released.
+ */
+
+YAML_DECLARE(yaml_document_t *)
+yaml_shared_document_get(yaml_shared_document_t *shared);
+
+/*
+ * Add a reference to a shared document.
+ *
+ * Arguments:
+ *
+ * - `shared`: a shared document handle the caller has a reference to.
+ *
+ * Returns: the same handle.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_shared_document_acquire(yaml_shared_document_t *shared);
+
+/*
+ * Release a reference to a shared document.
+ *
+ * The document is cleared and the handle is deallocated with the last
+ * reference.
+ *
+ * Arguments:
+ *
+ * - `shared`: a shared document handle or `NULL`.
+ */
+
+YAML_DECLARE(void)
+yaml_shared_document_release(yaml_shared_document_t *shared);
+
+/*
+ * A document slot.
+ *
+ * A slot keeps the current version of a shared document, for instance, the
+ * configuration of an application.  Readers take a reference to the current
+ * document with `yaml_document_slot_acquire()` and release it when they are
+ * done; a writer installs a new version with `yaml_document_slot_swap()`
+ * without waiting for the readers.  The slot operations are serialized with a
+ * mutex, which is held only to copy the handle pointer.  If LibYAML is built
+ * without POSIX threads, a slot must not be used concurrently.
+ */
+
+typedef struct yaml_document_slot_s yaml_document_slot_t;
+
+/*
+ * Allocate a new empty document slot.
+ *
+ * Returns: a new slot object or `NULL` on error.  The function may fail if it
+ * cannot allocate memory for the object.
+ */
+
+YAML_DECLARE(yaml_document_slot_t *)
+yaml_document_slot_new(void);
+
+/*
+ * Deallocate a document slot and release its document.
+ *
+ * Arguments:
+ *
+ * - `slot`: a document slot.
+ */
+
+YAML_DECLARE(void)
+yaml_document_slot_delete(yaml_document_slot_t *slot);
+
+/*
+ * Get a reference to the current document of a slot.
+ *
+ * Arguments:
+ *
+ * - `slot`: a document slot.
+ *
+ * Returns: the current document handle with a new reference, which must be
+ * released with `yaml_shared_document_release()`, or `NULL` if the slot is
+ * empty.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_document_slot_acquire(yaml_document_slot_t *slot);
+
+/*
+ * Replace the document of a slot.
+ *
+ * Arguments:
+ *
+ * - `slot`: a document slot.
+ *
+ * - `shared`: the new document handle or `NULL`.  The slot takes the
+ *   reference of the caller.  The reference to the previous document is
+ *   released; the readers that have acquired it keep it until they release
+ *   it.
+ */
+
+YAML_DECLARE(void)
+yaml_document_slot_swap(yaml_document_slot_t *slot,
+        yaml_shared_document_t *shared);
+
 /*****************************************************************************
  * Callback Definitions
  *****************************************************************************/
@@ -2309,6 +2797,64 @@ typedef int yaml_reader_t(void *data, unsigned char *buffer, size_t capacity,
 typedef int yaml_writer_t(void *data, const unsigned char *buffer,
         size_t length);
 
+/*
+ * A chunk of bytes passed to a vector write handler.
+ */
+
+typedef struct yaml_iovec_s {
+
+    /* The chunk bytes. */
+    const unsigned char *buffer;
+
+    /* The number of bytes in the chunk. */
+    size_t length;
+
+} yaml_iovec_t;
+
+/*
+ * The prototype of a vector write handler.
+ *
+ * The vector writer is called instead of the write handler when the emitter
+ * needs to flush the accumulated bytes.  The bytes come as a list of chunks
+ * to be written to the output stream one after another, like the arguments of
+ * `writev()`.  Besides the emitter buffer, a chunk may point directly to a
+ * long run of characters of a scalar value, which is not copied to the emitter
+ * buffer at all.
+ *
+ * Arguments:
+ *
+ * - `data`: a pointer to an application data specified with
+ *   `yaml_emitter_set_vector_writer()`.
+ *
+ * - `vectors`: a pointer to the list of chunks.  The chunks are valid only
+ *   until the writer returns.
+ *
+ * - `count`: the number of chunks.
+ *
+ * Returns: on success, the writer should return `1`.  If the writer fails for
+ * any reason, it should return `0`.
+ */
+
+typedef int yaml_vector_writer_t(void *data, const yaml_iovec_t *vectors,
+        size_t count);
+
+/*
+ * The prototype of an event recycler.
+ *
+ * The recycler is called when the emitter is done with an event passed to
+ * `yaml_emitter_emit_event()`.
+ *
+ * Arguments:
+ *
+ * - `data`: a pointer to an application data specified with
+ *   `yaml_emitter_set_recycler()`.
+ *
+ * - `event`: the event to release.  The recycler must clear the event, for
+ *   instance, with `yaml_event_clear()` or `yaml_parser_recycle_event()`.
+ */
+
+typedef void yaml_recycler_t(void *data, yaml_event_t *event);
+
 /**
  * The prototype of a nonspecific tag resolver.
  *
@@ -2336,18 +2882,153 @@ typedef int yaml_resolver_t(void *data, yaml_incomplete_node_t *node,
         const yaml_char_t **tag);
 
 /*****************************************************************************
- * Parser Definitions
+ * Binary Document Images
  *****************************************************************************/
 
 /*
- * An opaque definition of the parser object.
+ * Save a document as a binary image.
  *
- * A parser object is used to parse an input YAML stream producing a sequence
- * of YAML tokens, events or documents.
- */
-
+ * A binary image keeps the document nodes in the compact layout (see
+ * `yaml_document_is_compact()`): the node types, tags and content, the
+ * distinct tags, the scalar values, the sequence items and the mapping pairs
+ * are stored as flat arrays that refer to each other by offsets.  An image
+ * could be loaded back with `yaml_document_load_binary()` without parsing
+ * and without copying its content.  The node styles, anchors and marks are
+ * not saved.
+ *
+ * The image carries a hash of the source bytes, which are normally the YAML
+ * text the document was loaded from, so that a stale image could be detected
+ * when the text changes.
+ *
+ * The image format depends on the byte order and the word size of the
+ * platform; an image written on a different platform or by a different
+ * version of the format is rejected when loaded.
+ *
+ * Arguments:
+ *
+ * - `document`: a document object.
+ *
+ * - `source`: the source bytes or `NULL`.
+ *
+ * - `source_length`: the number of the source bytes.
+ *
+ * - `writer`: a write handler for the image bytes.
+ *
+ * - `data`: any application data for passing to the write handler.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory or if the write handler fails.
+ */
+
+YAML_DECLARE(int)
+yaml_document_save_binary(yaml_document_t *document,
+        const unsigned char *source, size_t source_length,
+        yaml_writer_t *writer, void *data);
+
+/*
+ * Load a document from a binary image.
+ *
+ * The document is compact and its nodes are read in place: the node content
+ * points into the image and only a few small structures are allocated.  The
+ * image is not modified, so it could be a read-only mapping of an image file,
+ * and it must stay valid until the document is cleared.  The image must be
+ * aligned to the size of `size_t`, which holds for memory returned by
+ * `malloc()` or `mmap()`.
+ *
+ * The image is checked before it is used: the function fails on a truncated
+ * or a malformed image, on an image of a different format version or
+ * platform, or, if `source` is not `NULL`, on an image saved from different
+ * source bytes.  The check reads the whole image once.
+ *
+ * Arguments:
+ *
+ * - `document`: an empty document object.
+ *
+ * - `image`: a pointer to the image.
+ *
+ * - `size`: the size of the image.
+ *
+ * - `source`: the current source bytes or `NULL` to skip the staleness check.
+ *
+ * - `source_length`: the number of the source bytes.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if the image
+ * is invalid or stale or if it cannot allocate memory.
+ */
+
+YAML_DECLARE(int)
+yaml_document_load_binary(yaml_document_t *document,
+        const unsigned char *image, size_t size,
+        const unsigned char *source, size_t source_length);
+
+/*****************************************************************************
+ * Parser Definitions
+ *****************************************************************************/
+
+/*
+ * An opaque definition of the parser object.
+ *
+ * A parser object is used to parse an input YAML stream producing a sequence
+ * of YAML tokens, events or documents.
+ */
+
 typedef struct yaml_parser_s yaml_parser_t;
 
+/*
+ * The parser statistics.
+ *
+ * The statistics are collected only if LibYAML is configured with
+ * `--enable-stats`; otherwise the counting code is compiled out and all the
+ * fields stay `0`.  The stage timers are kept with `--enable-stats=timers`
+ * only.  The timers count the ticks of the processor time-stamp counter if
+ * the compiler provides it, or `clock()` ticks otherwise.  The time of a
+ * stage includes the time of the stages it calls: the loader time includes
+ * the parser time, which includes the scanner time, which includes the
+ * reader time.
+ */
+
+typedef struct yaml_parser_stats_s {
+
+    /* The number of read handler calls. */
+    size_t reader_calls;
+    /* The number of bytes returned by the read handler or fed. */
+    size_t bytes_read;
+    /* The number of input bytes decoded. */
+    size_t bytes_decoded;
+
+    /* The number of tokens produced. */
+    size_t tokens;
+    /* The largest number of tokens in the queue. */
+    size_t max_queued_tokens;
+    /* The number of potential simple keys checked for staleness. */
+    size_t simple_key_checks;
+
+    /* The number of events produced. */
+    size_t events;
+
+    /* The number of documents loaded. */
+    size_t documents;
+    /* The number of nodes loaded. */
+    size_t nodes;
+
+    /*
+     * The number and the total size of the string buffers allocated rather
+     * than reused from the parser pool.
+     */
+    size_t allocations;
+    size_t allocated_bytes;
+
+    /* The time spent in the read handler. */
+    double reader_ticks;
+    /* The time spent in the scanner. */
+    double scanner_ticks;
+    /* The time spent in the parser. */
+    double parser_ticks;
+    /* The time spent in the loader. */
+    double loader_ticks;
+
+} yaml_parser_stats_t;
+
 /*
  * Allocate a new parser object.
  *
@@ -2412,6 +3093,24 @@ yaml_parser_reset(yaml_parser_t *parser);
 YAML_DECLARE(yaml_error_t *)
 yaml_parser_get_error(yaml_parser_t *parser);
 
+/*
+ * Get the parser statistics.
+ *
+ * The statistics are accumulated since the parser is created or reset (see
+ * `yaml_parser_stats_t`).
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * Returns: a pointer to the statistics.  The returned pointer is only valid
+ * until the parser object is not modified or deleted.  However the statistics
+ * object could be safely copied.
+ */
+
+YAML_DECLARE(const yaml_parser_stats_t *)
+yaml_parser_get_stats(yaml_parser_t *parser);
+
 /*
  * Set the parser to read the input stream from a character buffer.
  *
@@ -2443,6 +3142,29 @@ yaml_parser_set_string_reader(yaml_parser_t *parser,
 YAML_DECLARE(void)
 yaml_parser_set_file_reader(yaml_parser_t *parser, FILE *file);
 
+/*
+ * Set the parser to read the input stream from a memory-mapped file.
+ *
+ * A regular file is mapped into memory and read in place as if it were set
+ * with `yaml_parser_set_string_reader()`, so a UTF-8 file is not copied to the
+ * parser buffers and the zero-copy mode could be enabled.  The mapping is
+ * released when the parser object is cleared or deleted.  If the file cannot
+ * be mapped (for instance, if it is a pipe or a socket), it is read with
+ * `read()` instead.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `fd`: a file descriptor open for reading.  The descriptor need not stay
+ *   open once the file is mapped; otherwise it must be valid until the parser
+ *   object is cleared or deleted.  The file must not be truncated while it is
+ *   mapped.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_mmap_reader(yaml_parser_t *parser, int fd);
+
 /*
  * Set an input stream reader for a parser.
  *
@@ -2459,6 +3181,58 @@ YAML_DECLARE(void)
 yaml_parser_set_reader(yaml_parser_t *parser,
         yaml_reader_t *reader, void *data);
 
+/*
+ * Feed a part of the input stream to a parser.
+ *
+ * This function switches the parser to the push mode, in which the input is
+ * not read with a read handler, but given to the parser by the application as
+ * it arrives.  The parser copies the given bytes, so the buffer may be reused
+ * once the function returns.  An application must not set a reader for the
+ * parser in the push mode.
+ *
+ * In the push mode, the functions `yaml_parser_parse_token()` and
+ * `yaml_parser_parse_event()` succeed producing an empty object when they
+ * need more input than it is fed so far; the application could check it with
+ * `yaml_parser_is_input_needed()`, feed more bytes and call the function
+ * again.  An event is produced once the input containing the event and the
+ * token that follows it is fed, so the problem position of a scanner error
+ * may differ slightly from the one reported with a reader.  The functions `yaml_parser_parse_document()` and
+ * `yaml_parser_parse_single_document()` require the whole input to be fed.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `buffer`: a pointer to the next part of the input stream.
+ *
+ * - `length`: the length of the part in bytes.
+ *
+ * - `is_final`: `1` if the part is the last one, `0` otherwise.  No input
+ *   could be fed after the last part.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory for the input buffer.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_feed(yaml_parser_t *parser,
+        const unsigned char *buffer, size_t length, int is_final);
+
+/*
+ * Check if a parser in the push mode waits for more input.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * Returns: `1` if the last call of `yaml_parser_parse_token()`,
+ * `yaml_parser_parse_event()` or `yaml_parser_skip_node()` stopped because the
+ * input fed so far is not enough, `0` otherwise.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_is_input_needed(yaml_parser_t *parser);
+
 /*
  * Set the standard nonspecific tag resolver for a parser.
  *
@@ -2507,6 +3281,244 @@ yaml_parser_set_resolver(yaml_parser_t *parser,
 YAML_DECLARE(void)
 yaml_parser_set_encoding(yaml_parser_t *parser, yaml_encoding_t encoding);
 
+/*
+ * Set the memory allocator for the produced documents.
+ *
+ * The allocator is used to allocate the nodes and the node content of the
+ * documents produced by `yaml_parser_parse_document()` and
+ * `yaml_parser_parse_single_document()`.  The internal parser buffers are
+ * always allocated with the standard allocator.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `allocator`: the allocator handlers or `NULL` to restore the standard
+ *   allocator.  The handlers are copied; the application data must be valid
+ *   until all the documents produced by the parser are deleted.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_allocator(yaml_parser_t *parser,
+        const yaml_allocator_t *allocator);
+
+/*
+ * Set if the produced documents are allocated in a memory arena.
+ *
+ * In the arena mode, each document produced by `yaml_parser_parse_document()`
+ * or `yaml_parser_parse_single_document()` keeps all its nodes and strings in
+ * a few large blocks obtained from the parser allocator.  The blocks are
+ * released at once when the document is cleared or deleted.  The arena mode
+ * trades some memory for speed: the space of a resized list is not reused
+ * until the document is deleted.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `is_arena`: `1` to enable the arena mode, `0` to disable it.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_arena(yaml_parser_t *parser, int is_arena);
+
+/*
+ * Set if the parser may return scalar values pointing into the input buffer.
+ *
+ * In the zero-copy mode, the value of a SCALAR token or event that is
+ * represented verbatim in the input stream (that is, a plain or a quoted scalar
+ * occupying a single line and containing no escape sequences) is not copied.
+ * Instead, the `value` field points into the buffer passed to
+ * `yaml_parser_set_string_reader()` (or into the file mapped by
+ * `yaml_parser_set_mmap_reader()`) and the `is_borrowed` flag is set.  A
+ * borrowed value is not NUL-terminated and is only valid while the input
+ * buffer is valid; it is not freed by `yaml_token_clear()` or
+ * `yaml_event_clear()`.  Scalars that need to be unescaped or folded are still
+ * allocated as usual.  The documents produced by the parser always have their
+ * own copies of the scalar values.
+ *
+ * The zero-copy mode is only effective for UTF-8 input streams; it is ignored
+ * for UTF-16 streams.  The function must be called after
+ * `yaml_parser_set_string_reader()` or `yaml_parser_set_mmap_reader()`; it is
+ * ignored if the file passed to the latter could not be mapped.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `is_zero_copy`: `1` to enable the zero-copy mode, `0` to disable it.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_zero_copy(yaml_parser_t *parser, int is_zero_copy);
+
+/*
+ * Set if the parser produces compact documents.
+ *
+ * In the compact mode, the documents produced by
+ * `yaml_parser_parse_document()` and its relatives store their nodes in a few
+ * parallel arrays instead of `yaml_node_t` objects: the node types, the node
+ * tag ids and the content offsets and lengths.  All scalar values of a
+ * document share one buffer, and the items of all sequences and the pairs of
+ * all mappings share one array each.  The node anchors, styles and marks are
+ * not kept.  A compact node takes a small fraction of the memory of a regular
+ * one and the nodes are traversed in a cache-friendly order.  See
+ * `yaml_document_is_compact()` for the ways to read a compact document.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `is_compact`: `1` to enable the compact mode, `0` to disable it.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_compact(yaml_parser_t *parser, int is_compact);
+
+/*
+ * Set if the parser keeps the full node marks.
+ *
+ * The mark tracking is enabled by default.  When it is disabled, the documents
+ * produced by `yaml_parser_parse_document()` and its relatives get node marks
+ * that only keep the character offsets: the `line` and `column` fields are
+ * left zero, and the parallel loader does not adjust them.  The scanner still
+ * uses the line and column positions to find the indentation and the simple
+ * keys, so the marks of tokens, events, documents and errors are not
+ * affected.  Compact documents do not keep the node marks at all.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `is_tracking`: `1` to enable the mark tracking, `0` to disable it.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_mark_tracking(yaml_parser_t *parser, int is_tracking);
+
+/*
+ * Set if the parser rejects duplicate mapping keys.
+ *
+ * In this mode, the parser indexes the scalar keys of each mapping while the
+ * document is being composed and fails with a composer error when a key has
+ * the same value and the same tag as an earlier key of the same mapping.  The
+ * produced documents keep the index for `yaml_document_find_mapping_value()`.
+ * Keys that are sequences or mappings are not checked.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `is_unique`: `1` to reject duplicate keys, `0` to accept them.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_unique_keys(yaml_parser_t *parser, int is_unique);
+
+/*
+ * Set the limits for the documents with all aliases expanded.
+ *
+ * An alias shares the anchored node, so a small document could describe a huge
+ * tree once aliases are expanded (the "billion laughs" attack).  The loader
+ * computes the expanded size of every node it composes and reports the
+ * expansion of the whole document in the `expanded_nodes` and
+ * `expanded_depth` document fields.  If a limit is set and exceeded,
+ * `yaml_parser_parse_document()` fails with a composer error before the
+ * document is returned to the application.
+ *
+ * The counts are computed in constant time per node, so the limits are cheap
+ * enough to be always enabled for untrusted input.  An alias referring to a
+ * node that is not yet composed (a recursive alias) is counted as a single node.
+ * By default, there are no limits.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `max_nodes`: the maximum number of nodes in an expanded document or `0`
+ *   for no limit.
+ *
+ * - `max_depth`: the maximum depth of an expanded document or `0` for no
+ *   limit.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_expansion_limits(yaml_parser_t *parser,
+        size_t max_nodes, size_t max_depth);
+
+/*
+ * Set the size of the input buffers.
+ *
+ * By default, the parser requests the input from the read handler in blocks
+ * of 16384 bytes.  A larger block means fewer calls of the read handler, a
+ * smaller block saves memory.  If `max_size` is greater than `size`, the
+ * block is doubled each time the read handler fills it completely until it
+ * reaches `max_size`.  An input string or a memory-mapped file is checked in
+ * blocks of the same size.  The buffers keep their size when the parser is
+ * cleared.
+ *
+ * The function must be called before the parser reads any input.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `size`: the initial size of the input block in bytes; values less than
+ *   `64` mean `64`.
+ *
+ * - `max_size`: the maximum size of the input block in bytes or `0` if the
+ *   block size is fixed.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory for the buffers.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_set_buffer_size(yaml_parser_t *parser,
+        size_t size, size_t max_size);
+
+/*
+ * The use of the JSON scanner.
+ *
+ * The JSON scanner is a fast path of the scanner for flow collections written
+ * in strict JSON.  It handles the JSON indicators, strings, numbers and the
+ * `true`, `false` and `null` literals without the checks needed for the other
+ * YAML constructs and produces exactly the same tokens as the general scanner.
+ * At the first construct that is not JSON (a plain scalar, a comment, a single
+ * quoted scalar, a multi-line string, an escape sequence that JSON does not
+ * have, etc.), the JSON scanner is turned off for the rest of the stream and
+ * the general scanner takes over.  The outside of flow collections is always
+ * scanned by the general scanner.
+ */
+
+typedef enum yaml_json_mode_e {
+    /* Use the JSON scanner if the stream starts with '[' or '{' (default). */
+    YAML_AUTO_JSON_MODE,
+    /* Never use the JSON scanner. */
+    YAML_NEVER_JSON_MODE,
+    /* Use the JSON scanner for all flow collections of the stream. */
+    YAML_ALWAYS_JSON_MODE
+} yaml_json_mode_t;
+
+/*
+ * Set the use of the JSON scanner.
+ *
+ * By default, the parser detects JSON input by its first token and uses the
+ * JSON scanner for it (see `yaml_json_mode_t`).  The produced tokens, events
+ * and documents do not depend on the mode; only the scanning speed does.
+ *
+ * The function must be called before the parser reads any input.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `mode`: the JSON scanner mode.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_json_mode(yaml_parser_t *parser, yaml_json_mode_t mode);
+
 /*
  * Parse the input stream and produce the next token.
  *
@@ -2531,7 +3543,8 @@ yaml_parser_set_encoding(yaml_parser_t *parser, yaml_encoding_t encoding);
  *
  * Returns: `1` on success, `0` on error.  If the function succeeds and the
  * stream end is not reached, the token data is saved to the given token
- * object.  If the function fails, the error details could be obtained with
+ * object, unless the parser in the push mode needs more input.  If the
+ * function fails, the error details could be obtained with
  * `yaml_parser_get_error()`.  In case of error, the parser is non-functional
  * until it is cleared.
  */
@@ -2539,6 +3552,22 @@ yaml_parser_set_encoding(yaml_parser_t *parser, yaml_encoding_t encoding);
 YAML_DECLARE(int)
 yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token);
 
+/*
+ * Clear a token and return its storage to the parser.
+ *
+ * The same as `yaml_parser_recycle_event()`, but for tokens.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `token`: a token produced by `yaml_parser_parse_token()` of any parser or
+ *   initialized with `yaml_token_duplicate()`.  The token becomes empty.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_recycle_token(yaml_parser_t *parser, yaml_token_t *token);
+
 /*
  * Parse the input stream and produce the next parsing event.
  *
@@ -2570,7 +3599,8 @@ yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token);
  *
  * Returns: `1` on success, `0` on error.  If the function succeeds and the
  * stream end is not reached, the event data is saved to the given event
- * object.  If the function fails, the error details could be obtained with
+ * object, unless the parser in the push mode needs more input.  If the
+ * function fails, the error details could be obtained with
  * `yaml_parser_get_error()`.  In case of error, the parser is non-functional
  * until it is cleared.
  */
@@ -2578,6 +3608,68 @@ yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token);
 YAML_DECLARE(int)
 yaml_parser_parse_event(yaml_parser_t *parser, yaml_event_t *event);
 
+/*
+ * Skip the next node of the input stream with all its descendants.
+ *
+ * The function consumes the events `yaml_parser_parse_event()` would produce
+ * for the next node, but the parser drops the scalar values, anchors and tags
+ * of the skipped node as soon as they are scanned rather than passing them to
+ * the events, and does not resolve the skipped tags, so that skipping a node
+ * costs about as much as scanning it and allocates nothing once the parser
+ * pool is filled.  For instance, an application may
+ * call this function after a mapping key to skip the value it is not
+ * interested in.
+ *
+ * If the next event does not start a node, say, it ends a collection, nothing
+ * is skipped and the event is produced by the next call of
+ * `yaml_parser_parse_event()`.
+ *
+ * In the push mode, the function may stop in the middle of the node when more
+ * input is needed (see `yaml_parser_is_input_needed()`).  In this case, the
+ * application should feed more input and call the function again to skip the
+ * rest of the node.
+ *
+ * An application must not alternate calls of this function with calls of
+ * `yaml_parser_parse_token()`, `yaml_parser_parse_document()` and
+ * `yaml_parser_parse_single_document()` on the same parser object.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_parser_get_error()`.  In case of error,
+ * the parser is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_skip_node(yaml_parser_t *parser);
+
+/*
+ * Clear an event and return its storage to the parser.
+ *
+ * The alias, scalar and collection start events keep their anchors, tags and
+ * values in string buffers of a few fixed capacities.  Instead of freeing the
+ * buffers, this function keeps them in the parser pool, so that the parser
+ * reuses them for the next events.  A streaming application that passes every
+ * event back to the parser, directly or through the emitter recycler (see
+ * `yaml_emitter_set_parser_recycler()`), makes no memory allocations per event
+ * once the pool is filled.  The pool is released when the parser is deleted.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `event`: an event produced by `yaml_parser_parse_event()` of any parser
+ *   or initialized with `yaml_event_duplicate()` or one of the functions
+ *   `yaml_event_create_*()`.  An event with strings allocated by the
+ *   application must be cleared with `yaml_event_clear()` instead.  The event
+ *   becomes empty.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_recycle_event(yaml_parser_t *parser, yaml_event_t *event);
+
 /*
  * Parse the input stream and produce the next YAML document.
  *
@@ -2645,6 +3737,51 @@ YAML_DECLARE(int)
 yaml_parser_parse_single_document(yaml_parser_t *parser,
         yaml_document_t *document);
 
+/*
+ * Parse the input stream and produce all YAML documents it contains.
+ *
+ * If the parser input is a string set with `yaml_parser_set_string_reader()`
+ * and `threads` is greater than `1`, the function splits the string on the
+ * document start indicators `---` found at the beginning of a line and loads
+ * the parts simultaneously on up to `threads` threads, each using its own
+ * parser object.  The parser settings (the allocator, the arena and the
+ * zero-copy modes, the tag resolver and the expansion limits) are shared by
+ * all threads, so the allocator and resolver handlers must be thread-safe.
+ * The produced documents and their marks are the same as if the stream were
+ * loaded with `yaml_parser_parse_document()`: if any part fails to load, the
+ * whole stream is loaded again on the calling thread to report the error.
+ * Otherwise, or if the library is built without thread support, the documents
+ * are loaded one by one.
+ *
+ * The function must be called before any other parsing function is applied
+ * to the parser object.  An application must not call any of the functions
+ * `yaml_parser_parse_token()`, `yaml_parser_parse_event()`,
+ * `yaml_parser_parse_document()` and `yaml_parser_parse_single_document()` on
+ * the same parser object after this function.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `documents`: a pointer to save the list of the produced documents to.  An
+ *   application is responsible for deleting the list with
+ *   `yaml_document_list_delete()`.
+ *
+ * - `count`: a pointer to save the number of the produced documents to.
+ *
+ * - `threads`: the maximum number of threads to use.
+ *
+ * Returns: `1` on success, `0` on error.  If the function succeeds, the
+ * documents are saved to the list in the stream order.  If the function fails,
+ * no documents are produced and the error details could be obtained with
+ * `yaml_parser_get_error()`.  In case of error, the parser is non-functional
+ * until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_parse_all_documents(yaml_parser_t *parser,
+        yaml_document_t **documents, size_t *count, int threads);
+
 /*****************************************************************************
  * Emitter Definitions
  *****************************************************************************/
@@ -2659,9 +3796,36 @@ yaml_parser_parse_single_document(yaml_parser_t *parser,
 typedef struct yaml_emitter_s yaml_emitter_t;
 
 /*
- * Allocate a new emitter object.
+ * The emitter statistics.
  *
- * An allocated emitter object should be deleted with `yaml_emitter_delete()`.
+ * The statistics are collected under the same conditions as the parser
+ * statistics (see `yaml_parser_stats_t`).  The emitter time includes the
+ * writer time.
+ */
+
+typedef struct yaml_emitter_stats_s {
+
+    /* The number of events accepted. */
+    size_t events;
+    /* The largest number of events in the queue. */
+    size_t max_queued_events;
+
+    /* The number of write handler calls. */
+    size_t writer_calls;
+    /* The number of bytes written. */
+    size_t bytes_written;
+
+    /* The time spent in the emitter. */
+    double emitter_ticks;
+    /* The time spent in flushing the output, including the write handler. */
+    double writer_ticks;
+
+} yaml_emitter_stats_t;
+
+/*
+ * Allocate a new emitter object.
+ *
+ * An allocated emitter object should be deleted with `yaml_emitter_delete()`.
  *
  * Returns: a new emitter or `NULL` on error.  The function mail fail if it
  * cannot allocate memory for internal buffers.
@@ -2722,6 +3886,24 @@ yaml_emitter_reset(yaml_emitter_t *emitter);
 YAML_DECLARE(yaml_error_t *)
 yaml_emitter_get_error(yaml_emitter_t *emitter);
 
+/*
+ * Get the emitter statistics.
+ *
+ * The statistics are accumulated since the emitter is created or reset (see
+ * `yaml_emitter_stats_t`).
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * Returns: a pointer to the statistics.  The returned pointer is only valid
+ * until the emitter object is not modified or deleted.  However the
+ * statistics object could be safely copied.
+ */
+
+YAML_DECLARE(const yaml_emitter_stats_t *)
+yaml_emitter_get_stats(yaml_emitter_t *emitter);
+
 /*
  * Set the emitter to dump the generated YAML stream into a string buffer.
  *
@@ -2756,6 +3938,25 @@ yaml_emitter_set_string_writer(yaml_emitter_t *emitter,
 YAML_DECLARE(void)
 yaml_emitter_set_file_writer(yaml_emitter_t *emitter, FILE *file);
 
+/*
+ * Set the emitter to dump the generated YAML stream into a file descriptor.
+ *
+ * The output is written with `writev()`, so that long runs of scalar
+ * characters are passed to the file directly from the scalar values; see
+ * `yaml_emitter_set_vector_writer()`.  This is the preferred output for pipes
+ * and sockets.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `fd`: a file descriptor open for writing.  The descriptor must be valid
+ *   until the emitter object is cleared or deleted.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_fd_writer(yaml_emitter_t *emitter, int fd);
+
 /*
  * Set the output stream writer for an emitter.
  *
@@ -2772,6 +3973,67 @@ YAML_DECLARE(void)
 yaml_emitter_set_writer(yaml_emitter_t *emitter,
         yaml_writer_t *writer, void *data);
 
+/*
+ * Set the output stream vector writer for an emitter.
+ *
+ * With a vector writer and the UTF-8 output encoding, long runs of scalar
+ * characters that are written as is are passed to the writer by reference
+ * instead of being copied to the emitter buffer.  The emitter flushes the
+ * buffer before it releases an event referenced that way, so the writer may be
+ * called more often than once per buffer.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `writer`: a vector write handler.
+ *
+ * - `data`: application data for passing to the writer.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_vector_writer(yaml_emitter_t *emitter,
+        yaml_vector_writer_t *writer, void *data);
+
+/*
+ * Set the recycler of the emitted events.
+ *
+ * By default, the emitter clears the events with `yaml_event_clear()`.  The
+ * events queued when the emitter is reset or deleted are always cleared with
+ * `yaml_event_clear()`.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `recycler`: a recycle handler or `NULL` to restore the default.
+ *
+ * - `data`: application data for passing to the recycler.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_recycler(yaml_emitter_t *emitter,
+        yaml_recycler_t *recycler, void *data);
+
+/*
+ * Set the emitter to return the emitted events to a parser.
+ *
+ * The emitted events are released with `yaml_parser_recycle_event()`, so that
+ * a pipeline passing the events of the parser to the emitter reuses the same
+ * buffers for all the events.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `parser`: a parser object; it must not be deleted while the emitter
+ *   may release events.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_parser_recycler(yaml_emitter_t *emitter,
+        yaml_parser_t *parser);
+
 /*
  * Set the standard nonspecific tag resolver for an emitter.
  *
@@ -2819,6 +4081,28 @@ yaml_emitter_set_resolver(yaml_emitter_t *emitter,
 YAML_DECLARE(void)
 yaml_emitter_set_encoding(yaml_emitter_t *emitter, yaml_encoding_t encoding);
 
+/*
+ * Set the memory allocator for the emitter.
+ *
+ * The allocator is used for the data the emitter keeps while serializing the
+ * stream: the copies of the %TAG directives and the anchor table of a document
+ * passed to `yaml_emitter_emit_document()`.
+ * The internal emitter buffers are always allocated with the standard
+ * allocator.  The allocator must not be changed while a document is being
+ * emitted.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `allocator`: the allocator handlers or `NULL` to restore the standard
+ *   allocator.  The handlers are copied.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_allocator(yaml_emitter_t *emitter,
+        const yaml_allocator_t *allocator);
+
 /*
  * Specify if the emitter should use the "canonical" output format.
  *
@@ -2884,6 +4168,28 @@ yaml_emitter_set_width(yaml_emitter_t *emitter, int width);
 YAML_DECLARE(void)
 yaml_emitter_set_unicode(yaml_emitter_t *emitter, int is_unicode);
 
+/*
+ * Specify if the emitted documents have no shared nodes.
+ *
+ * Before emitting a document, `yaml_emitter_emit_document()` needs to know
+ * which nodes are referred to more than once, so that they get anchors.  The
+ * counts are kept by `yaml_document_append_*()` for a document built with
+ * them; for a document loaded by the parser, they are found with a pass over
+ * all the nodes.  If the documents are trees, as generated output often is,
+ * the pass could be skipped.  A shared node of a document emitted in this mode
+ * is written out in full wherever it is referred to, unless the counts are
+ * already known.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `is_tree`: `1` if the documents have no shared nodes; `0` otherwise.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_tree(yaml_emitter_t *emitter, int is_tree);
+
 /*
  * Set the preferred line break.
  *
@@ -2899,6 +4205,29 @@ yaml_emitter_set_unicode(yaml_emitter_t *emitter, int is_unicode);
 YAML_DECLARE(void)
 yaml_emitter_set_break(yaml_emitter_t *emitter, yaml_break_t line_break);
 
+/*
+ * Set the size of the output buffer.
+ *
+ * By default, the emitter accumulates up to 16384 bytes of the output before
+ * calling the write handler.  A larger buffer means fewer calls of the write
+ * handler, a smaller buffer saves memory.
+ *
+ * The function must be called before the emitter produces any output.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `size`: the size of the output buffer in bytes; values less than `64` mean
+ *   `64`.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory for the buffers.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_set_buffer_size(yaml_emitter_t *emitter, size_t size);
+
 /*
  * Emit an event to the output YAML stream.
  *
@@ -2923,7 +4252,8 @@ yaml_emitter_set_break(yaml_emitter_t *emitter, yaml_break_t line_break);
  *   either one of the functions `yaml_event_create_*()` or with
  *   `yaml_parser_parse_event()`.  The emitter takes the responsibility for the
  *   event data and clears the event, so that it becomes empty.  The event is
- *   cleared even if the function fails.
+ *   cleared even if the function fails.  The event data is released with the
+ *   recycler set with `yaml_emitter_set_recycler()` if any.
  *
  * Returns: `1` on success, `0` on error.  Note that the emitter may not
  * immediately dump the given event, so that the function could indicate
@@ -3039,6 +4369,202 @@ YAML_DECLARE(int)
 yaml_emitter_emit_single_document(yaml_emitter_t *emitter,
         yaml_document_t *document);
 
+/*
+ * Start a YAML document to be emitted node by node.
+ *
+ * The functions `yaml_emitter_start_document()`, `yaml_emitter_add_*()`,
+ * `yaml_emitter_start_sequence()`, `yaml_emitter_start_mapping()`,
+ * `yaml_emitter_end_*()` build a document in the emitter without a
+ * `yaml_document_t` object: each node is written out as soon as it is added,
+ * so the memory used does not depend on the size of the document.  The nodes
+ * are added in the document order: the root node after the document start,
+ * the items of a sequence between its start and its end, and the keys and the
+ * values of a mapping, in turn, between its start and its end.  A node that is
+ * referred to more than once is added the first time with an anchor and then
+ * by `yaml_emitter_add_alias()`.
+ *
+ * The given strings are copied if the emitter has to keep them, so they could
+ * be released as soon as the function returns.
+ *
+ * Before starting any documents, the function `yaml_emitter_start()` must be
+ * called.  An application must not alternate the calls of these functions
+ * with `yaml_emitter_emit_event()`, `yaml_emitter_emit_document()` and
+ * `yaml_emitter_emit_single_document()` on the same emitter object.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `version_directive`: the `%YAML` directive or `NULL`.
+ *
+ * - `tag_directives_list`: the list of `%TAG` directives or `NULL`.
+ *
+ * - `tag_directives_length`: the length of `tag_directives_list`.
+ *
+ * - `is_start_implicit`: `1` if the document start indicator `---` is
+ *   omitted; `0` otherwise.  This attribute is only a stylistic hint.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_document(yaml_emitter_t *emitter,
+        const yaml_version_directive_t *version_directive,
+        const yaml_tag_directive_t *tag_directives_list,
+        size_t tag_directives_length,
+        int is_start_implicit);
+
+/*
+ * Finish a YAML document started with `yaml_emitter_start_document()`.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `is_end_implicit`: `1` if the document end indicator `...` is omitted;
+ *   `0` otherwise.  This attribute is only a stylistic hint.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_end_document(yaml_emitter_t *emitter, int is_end_implicit);
+
+/*
+ * Add a SCALAR node to the document being emitted.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `anchor_id`: a pointer to save the id of the node anchor or `NULL` if the
+ *   node is not referred to again.  The id could be passed to
+ *   `yaml_emitter_add_alias()` until the document is finished.
+ *
+ * - `tag`: the node tag or `NULL`.  The tag is omitted in the output if it is
+ *   `NULL` or `YAML_DEFAULT_SCALAR_TAG`.
+ *
+ * - `value`: the scalar value.
+ *
+ * - `length`: the length of the scalar value or `(size_t)-1` if `value` is
+ *   NUL-terminated.  The value need not be NUL-terminated if the length is
+ *   given.
+ *
+ * - `style`: the scalar style.  This attribute is only a stylistic hint.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_add_scalar(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, const yaml_char_t *value, size_t length,
+        yaml_scalar_style_t style);
+
+/*
+ * Add an alias to a node already added to the document being emitted.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `anchor_id`: the anchor id saved when the node was added.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_add_alias(yaml_emitter_t *emitter, int anchor_id);
+
+/*
+ * Start a SEQUENCE node in the document being emitted.
+ *
+ * The items are added next; the sequence is finished with
+ * `yaml_emitter_end_sequence()`.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `anchor_id`: a pointer to save the id of the node anchor or `NULL`.
+ *
+ * - `tag`: the node tag or `NULL`.  The tag is omitted in the output if it is
+ *   `NULL` or `YAML_DEFAULT_SEQUENCE_TAG`.
+ *
+ * - `style`: the sequence style.  This attribute is only a stylistic hint.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_sequence(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_sequence_style_t style);
+
+/*
+ * Finish the innermost SEQUENCE node of the document being emitted.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_end_sequence(yaml_emitter_t *emitter);
+
+/*
+ * Start a MAPPING node in the document being emitted.
+ *
+ * The keys and the values are added next; the mapping is finished with
+ * `yaml_emitter_end_mapping()`.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * - `anchor_id`: a pointer to save the id of the node anchor or `NULL`.
+ *
+ * - `tag`: the node tag or `NULL`.  The tag is omitted in the output if it is
+ *   `NULL` or `YAML_DEFAULT_MAPPING_TAG`.
+ *
+ * - `style`: the mapping style.  This attribute is only a stylistic hint.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_mapping(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_mapping_style_t style);
+
+/*
+ * Finish the innermost MAPPING node of the document being emitted.
+ *
+ * Arguments:
+ *
+ * - `emitter`: an emitter object.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_emitter_get_error()`.  In case of
+ * error, the emitter is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_end_mapping(yaml_emitter_t *emitter);
+
 /*
  * Flush the accumulated characters.
  *
@@ -3058,6 +4584,166 @@ yaml_emitter_emit_single_document(yaml_emitter_t *emitter,
 YAML_DECLARE(int)
 yaml_emitter_flush(yaml_emitter_t *emitter);
 
+/*****************************************************************************
+ * Selector Definitions
+ *****************************************************************************/
+
+/*
+ * A selector is a compiled path expression that picks nodes of a document.
+ *
+ * A path is a sequence of steps applied to the root node:
+ *
+ * - `.key` or `["key"]` selects the value of the pair with the given scalar
+ *   key of a mapping;  the leading `.` could be omitted for the first step,
+ *   and the quotes allow keys containing `.`, `[` and `]`;
+ *
+ * - `[N]` selects the item `N` of a sequence (starting from zero);
+ *
+ * - `.*` or `[*]` selects all items of a sequence or all values of a mapping;
+ *
+ * - `..key`, `..*`, `..[N]` apply the step to all descendants of the node.
+ *
+ * For instance, `spec.containers[*].image` selects the images of all
+ * containers, and `..name` selects the values of all `name` keys.  An empty
+ * path, or `$`, selects the root node itself.  A path could have up to 31
+ * steps.
+ *
+ * A selector could be evaluated against a document multiple times with
+ * `yaml_selector_select()`, or used with `yaml_parser_parse_selection()` to
+ * load only the selected nodes.  A selector must not be used by several
+ * threads at the same time.
+ */
+
+typedef struct yaml_selector_s yaml_selector_t;
+
+/*
+ * Allocate a new selector object.
+ *
+ * An allocated selector object should be deleted with `yaml_selector_delete()`.
+ * The new selector selects the root node.
+ *
+ * Returns: a new selector or `NULL` on error.  The function may fail if it
+ * cannot allocate memory for internal buffers.
+ */
+
+YAML_DECLARE(yaml_selector_t *)
+yaml_selector_new(void);
+
+/*
+ * Deallocate a selector and free the internal selector data.
+ *
+ * Arguments:
+ *
+ * - `selector`: a selector object.
+ */
+
+YAML_DECLARE(void)
+yaml_selector_delete(yaml_selector_t *selector);
+
+/*
+ * Get the selector error.
+ *
+ * Use this function to get a detailed error information after failure of
+ * `yaml_selector_compile()` or `yaml_selector_select()`.
+ *
+ * Arguments:
+ *
+ * - `selector`: a selector object.
+ *
+ * Returns: a pointer to an error object.  The returned pointer is only valid
+ * until the selector object is not modified or deleted.  However the error
+ * object could be safely copied.
+ */
+
+YAML_DECLARE(yaml_error_t *)
+yaml_selector_get_error(yaml_selector_t *selector);
+
+/*
+ * Compile a path expression.
+ *
+ * The compiled path replaces the previous one.
+ *
+ * Arguments:
+ *
+ * - `selector`: a selector object.
+ *
+ * - `path`: a NUL-terminated path expression.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_selector_get_error()` and the selector
+ * selects nothing until a path is compiled successfully.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_compile(yaml_selector_t *selector, const char *path);
+
+/*
+ * Select the nodes of a document.
+ *
+ * The path is applied to the given node, so it could be the document root or
+ * any other node.  The selected nodes are produced in the document order; a
+ * node reachable in several ways is produced several times.  Mapping keys are
+ * found as `yaml_document_find_mapping_value()` does.  The selector reuses
+ * its internal buffers, so repeated evaluations do not allocate memory once
+ * the buffers are large enough.
+ *
+ * Arguments:
+ *
+ * - `selector`: a selector object.
+ *
+ * - `document`: a document object.
+ *
+ * - `node_id`: the node id to apply the path to; could be negative.
+ *
+ * - `node_ids`: a pointer to save the list of the selected node ids.  The list
+ *   belongs to the selector and is valid until the selector is used again.
+ *
+ * - `count`: a pointer to save the number of the selected nodes.
+ *
+ * Returns: `1` on success, `0` on error.  The function may fail if it cannot
+ * allocate memory for internal buffers.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_select(yaml_selector_t *selector, yaml_document_t *document,
+        int node_id, int **node_ids, size_t *count);
+
+/*
+ * Parse the next YAML document of the stream, loading only the selected nodes.
+ *
+ * The parser walks over the events of the document and skips the subtrees
+ * that contain no selected nodes without composing them.  The produced
+ * document has a `!!seq` root node; its items are the nodes selected by
+ * applying the path to the document root, in the document order.  The nodes
+ * with anchors are always composed, so that aliases to them are resolved;
+ * they are kept in the document even if they are not selected.  The tag
+ * resolver sees the selected nodes as items of the root sequence.  When the
+ * stream ends, the parser produces empty documents.
+ *
+ * An application must not alternate calls of this function with the functions
+ * `yaml_parser_parse_token()` and `yaml_parser_parse_event()` on the same
+ * parser object, but it may alternate it with `yaml_parser_parse_document()`.
+ *
+ * Arguments:
+ *
+ * - `parser`: a parser object.
+ *
+ * - `selector`: a selector object.
+ *
+ * - `document`: an empty document object to save the document produced by the
+ *   parser.  An application is responsible for clearing or deleting the
+ *   produced document.  If the parser fails or the stream end is reached, the
+ *   object is kept empty.
+ *
+ * Returns: `1` on success, `0` on error.  If the function fails, the error
+ * details could be obtained with `yaml_parser_get_error()`.  In case of error,
+ * the parser is non-functional until it is cleared.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_parse_selection(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_document_t *document);
+
 
 #ifdef __cplusplus
 }
@@ -9,6 +9,20 @@
 
 #include "yaml_private.h"
 
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
+#if HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 /*****************************************************************************
  * Version Information
  *****************************************************************************/
@@ -82,6 +96,463 @@ yaml_strdup(const yaml_char_t *str)
     return (yaml_char_t *)strdup((char *)str);
 }
 
+/*
+ * Compute the hash of a string.
+ */
+
+YAML_DECLARE(size_t)
+yaml_string_hash(const yaml_char_t *str, size_t length)
+{
+    size_t hash = 2166136261U;
+    size_t idx;
+
+    for (idx = 0; idx < length; idx ++) {
+        hash = (hash ^ str[idx]) * 16777619U;
+    }
+
+    return hash;
+}
+
+/*
+ * Allocate a dynamic memory block using the given allocator.
+ */
+
+YAML_DECLARE(void *)
+yaml_allocator_malloc(const yaml_allocator_t *allocator, size_t size)
+{
+    if (!allocator->allocate)
+        return yaml_malloc(size);
+
+    return allocator->allocate(allocator->data, size ? size : 1);
+}
+
+/*
+ * Reallocate a dynamic memory block using the given allocator.
+ */
+
+YAML_DECLARE(void *)
+yaml_allocator_realloc(const yaml_allocator_t *allocator,
+        void *ptr, size_t size)
+{
+    if (!allocator->reallocate)
+        return yaml_realloc(ptr, size);
+
+    return allocator->reallocate(allocator->data, ptr, size ? size : 1);
+}
+
+/*
+ * Free a dynamic memory block using the given allocator.
+ */
+
+YAML_DECLARE(void)
+yaml_allocator_free(const yaml_allocator_t *allocator, void *ptr)
+{
+    if (!ptr)
+        return;
+
+    if (!allocator->deallocate) {
+        yaml_free(ptr);
+        return;
+    }
+
+    allocator->deallocate(allocator->data, ptr);
+}
+
+/*
+ * Duplicate a string using the given allocator.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_allocator_strdup(const yaml_allocator_t *allocator,
+        const yaml_char_t *str)
+{
+    if (!str)
+        return NULL;
+
+    return yaml_allocator_strndup(allocator, str, strlen((char *)str));
+}
+
+/*
+ * Duplicate a string of the given length using the given allocator.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_allocator_strndup(const yaml_allocator_t *allocator,
+        const yaml_char_t *str, size_t length)
+{
+    yaml_char_t *copy = yaml_allocator_malloc(allocator, length+1);
+
+    if (!copy)
+        return NULL;
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+/*****************************************************************************
+ * Memory Arena
+ *****************************************************************************/
+
+/*
+ * Every block and every chunk starts at this boundary.
+ */
+
+#define ARENA_ALIGNMENT     16
+
+#define ARENA_ALIGN(size)                                                       \
+    (((size) + (ARENA_ALIGNMENT-1)) & ~(size_t)(ARENA_ALIGNMENT-1))
+
+/*
+ * The arena block header; the block data follows it.
+ */
+
+struct yaml_arena_block_s {
+    /* The next (older) block. */
+    yaml_arena_block_t *next;
+    /* The number of used bytes. */
+    size_t pointer;
+    /* The number of available bytes. */
+    size_t capacity;
+};
+
+#define ARENA_BLOCK_HEADER  ARENA_ALIGN(sizeof(yaml_arena_block_t))
+
+/*
+ * Each chunk is preceded by a header keeping the chunk size.
+ */
+
+#define ARENA_CHUNK_HEADER  ARENA_ALIGN(sizeof(size_t))
+
+#define ARENA_BLOCK_DATA(block)                                                 \
+    ((char *)(block) + ARENA_BLOCK_HEADER)
+
+#define ARENA_CHUNK_SIZE(ptr)                                                   \
+    (*(size_t *)((char *)(ptr) - ARENA_CHUNK_HEADER))
+
+/*
+ * Allocate a chunk from an arena.
+ */
+
+static void *
+yaml_arena_allocate(void *untyped_arena, size_t size)
+{
+    yaml_arena_t *arena = untyped_arena;
+    yaml_arena_block_t *block = arena->blocks;
+    size_t total = ARENA_CHUNK_HEADER + ARENA_ALIGN(size);
+    char *chunk;
+
+    if (!block || block->capacity - block->pointer < total)
+    {
+        size_t capacity = ARENA_BLOCK_CAPACITY;
+
+        if (capacity < total) {
+            capacity = total;
+        }
+
+        block = yaml_allocator_malloc(&arena->allocator,
+                ARENA_BLOCK_HEADER + capacity);
+        if (!block)
+            return NULL;
+
+        block->next = arena->blocks;
+        block->pointer = 0;
+        block->capacity = capacity;
+        arena->blocks = block;
+    }
+
+    chunk = ARENA_BLOCK_DATA(block) + block->pointer + ARENA_CHUNK_HEADER;
+    ARENA_CHUNK_SIZE(chunk) = size;
+    block->pointer += total;
+    arena->last = chunk;
+
+    return chunk;
+}
+
+/*
+ * Resize a chunk allocated from an arena.
+ *
+ * The last allocated chunk is extended in place if the current block has
+ * enough room, so growing the list that is being filled is cheap.
+ */
+
+static void *
+yaml_arena_reallocate(void *untyped_arena, void *ptr, size_t size)
+{
+    yaml_arena_t *arena = untyped_arena;
+    size_t old_size;
+    void *new_ptr;
+
+    if (!ptr)
+        return yaml_arena_allocate(arena, size);
+
+    old_size = ARENA_CHUNK_SIZE(ptr);
+
+    if (ptr == arena->last) {
+        yaml_arena_block_t *block = arena->blocks;
+        size_t offset = (char *)ptr - ARENA_BLOCK_DATA(block);
+        if (offset + ARENA_ALIGN(size) <= block->capacity) {
+            block->pointer = offset + ARENA_ALIGN(size);
+            ARENA_CHUNK_SIZE(ptr) = size;
+            return ptr;
+        }
+    }
+
+    if (size <= old_size)
+        return ptr;
+
+    new_ptr = yaml_arena_allocate(arena, size);
+    if (!new_ptr)
+        return NULL;
+
+    memcpy(new_ptr, ptr, old_size);
+
+    return new_ptr;
+}
+
+/*
+ * Free a chunk allocated from an arena.
+ *
+ * Only the last allocated chunk is actually returned to the arena.
+ */
+
+static void
+yaml_arena_deallocate(void *untyped_arena, void *ptr)
+{
+    yaml_arena_t *arena = untyped_arena;
+
+    if (ptr == arena->last) {
+        yaml_arena_block_t *block = arena->blocks;
+        block->pointer = (char *)ptr - ARENA_BLOCK_DATA(block)
+            - ARENA_CHUNK_HEADER;
+        arena->last = NULL;
+    }
+}
+
+/*
+ * Create an arena.
+ */
+
+YAML_DECLARE(yaml_arena_t *)
+yaml_arena_new(const yaml_allocator_t *allocator)
+{
+    yaml_arena_t *arena = yaml_allocator_malloc(allocator, sizeof(yaml_arena_t));
+
+    if (!arena)
+        return NULL;
+
+    memset(arena, 0, sizeof(yaml_arena_t));
+    arena->allocator = *allocator;
+
+    return arena;
+}
+
+/*
+ * Release an arena with all its blocks.
+ */
+
+YAML_DECLARE(void)
+yaml_arena_delete(yaml_arena_t *arena)
+{
+    yaml_allocator_t allocator = arena->allocator;
+
+    while (arena->blocks) {
+        yaml_arena_block_t *block = arena->blocks;
+        arena->blocks = block->next;
+        yaml_allocator_free(&allocator, block);
+    }
+
+    yaml_allocator_free(&allocator, arena);
+}
+
+/*
+ * Get the arena allocator handlers.
+ */
+
+YAML_DECLARE(void)
+yaml_arena_get_allocator(yaml_arena_t *arena, yaml_allocator_t *allocator)
+{
+    allocator->allocate = yaml_arena_allocate;
+    allocator->reallocate = yaml_arena_reallocate;
+    allocator->deallocate = yaml_arena_deallocate;
+    allocator->data = arena;
+}
+
+/*****************************************************************************
+ * String Buffer Pool
+ *****************************************************************************/
+
+/*
+ * Get the smallest class holding `size` octets or `POOL_CLASSES` if the size
+ * is too large for the pool.
+ */
+
+static int
+yaml_pool_class(size_t size)
+{
+    int idx = 0;
+
+    while (idx < POOL_CLASSES && (INITIAL_STRING_CAPACITY << idx) < size) {
+        idx ++;
+    }
+
+    return idx;
+}
+
+/*
+ * Allocate a buffer from a pool.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_malloc(yaml_pool_t *pool, size_t size, size_t *capacity)
+{
+    int idx = yaml_pool_class(size);
+    yaml_char_t *buffer;
+
+    if (idx < POOL_CLASSES) {
+        size = INITIAL_STRING_CAPACITY << idx;
+    }
+
+    if (pool && idx < POOL_CLASSES && pool->buffers[idx]) {
+        buffer = pool->buffers[idx];
+        pool->buffers[idx] = *(yaml_char_t **)buffer;
+        pool->counts[idx] --;
+    }
+    else {
+        buffer = yaml_malloc(size);
+        if (!buffer)
+            return NULL;
+#if YAML_STATS
+        if (pool) {
+            pool->allocations ++;
+            pool->allocated_bytes += size;
+        }
+#endif
+    }
+
+    memset(buffer, 0, size);
+
+    if (capacity) {
+        *capacity = size;
+    }
+
+    return buffer;
+}
+
+/*
+ * Copy a string into a pooled buffer.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_strndup(yaml_pool_t *pool, const yaml_char_t *str, size_t length)
+{
+    yaml_char_t *copy = yaml_pool_malloc(pool, length+1, NULL);
+
+    if (!copy)
+        return NULL;
+
+    memcpy(copy, str, length);
+
+    return copy;
+}
+
+/*
+ * Copy a NUL-terminated string into a pooled buffer.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_strdup(yaml_pool_t *pool, const yaml_char_t *str)
+{
+    return yaml_pool_strndup(pool, str, strlen((char *)str));
+}
+
+/*
+ * Return a buffer to a pool.
+ */
+
+YAML_DECLARE(void)
+yaml_pool_free(yaml_pool_t *pool, yaml_char_t *buffer, size_t size)
+{
+    int idx = yaml_pool_class(size);
+
+    if (!buffer)
+        return;
+
+    if (!pool || idx == POOL_CLASSES || pool->counts[idx] == POOL_CLASS_DEPTH) {
+        yaml_free(buffer);
+        return;
+    }
+
+    *(yaml_char_t **)buffer = pool->buffers[idx];
+    pool->buffers[idx] = buffer;
+    pool->counts[idx] ++;
+}
+
+/*
+ * Double the capacity of a pooled buffer.
+ */
+
+YAML_DECLARE(int)
+yaml_pool_extend(yaml_pool_t *pool, yaml_char_t **buffer, size_t *capacity)
+{
+    size_t new_capacity;
+    yaml_char_t *new_buffer = yaml_pool_malloc(pool, (*capacity)*2,
+            &new_capacity);
+
+    if (!new_buffer) return 0;
+
+    memcpy(new_buffer, *buffer, *capacity);
+    yaml_pool_free(pool, *buffer, *capacity);
+
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+
+    return 1;
+}
+
+/*
+ * Append an adjunct string to a pooled base string.
+ */
+
+YAML_DECLARE(int)
+yaml_pool_join(yaml_pool_t *pool,
+        yaml_char_t **base_buffer, size_t *base_pointer, size_t *base_capacity,
+        yaml_char_t *adj_buffer, size_t adj_pointer)
+{
+    if (!adj_pointer)
+        return 1;
+
+    while (*base_capacity - *base_pointer <= adj_pointer) {
+        if (!yaml_pool_extend(pool, base_buffer, base_capacity))
+            return 0;
+    }
+
+    memcpy(*base_buffer+*base_pointer, adj_buffer, adj_pointer);
+    *base_pointer += adj_pointer;
+
+    return 1;
+}
+
+/*
+ * Free the buffers of a pool.
+ */
+
+YAML_DECLARE(void)
+yaml_pool_clear(yaml_pool_t *pool)
+{
+    int idx;
+
+    for (idx = 0; idx < POOL_CLASSES; idx ++) {
+        while (pool->buffers[idx]) {
+            yaml_char_t *buffer = pool->buffers[idx];
+            pool->buffers[idx] = *(yaml_char_t **)buffer;
+            yaml_free(buffer);
+        }
+        pool->counts[idx] = 0;
+    }
+}
+
 /*****************************************************************************
  * Error Handling
  *****************************************************************************/
@@ -105,6 +576,7 @@ yaml_error_message(yaml_error_t *error, char *buffer, size_t capacity)
         "Emitter error",
         "Serializer error",
         "Resolver error",
+        "Selector error",
     };
     int length;
 
@@ -183,6 +655,13 @@ yaml_error_message(yaml_error_t *error, char *buffer, size_t capacity)
                     error->data.resolving.problem);
             break;
 
+        case YAML_SELECTOR_ERROR:
+            length = snprintf(buffer, capacity, "%s: %s at byte %d",
+                    prefixes[error->type],
+                    error->data.selecting.problem,
+                    (int)error->data.selecting.offset);
+            break;
+
         default:
             assert(0);  /* Should never happen. */
     }
@@ -254,11 +733,30 @@ yaml_stack_extend(void **list, size_t size, size_t *length, size_t *capacity)
 }
 
 /*
- * Extend or move a queue.
+ * Extend a stack using the given allocator.
  */
 
 YAML_DECLARE(int)
-yaml_queue_extend(void **list, size_t size,
+yaml_allocator_stack_extend(const yaml_allocator_t *allocator,
+        void **list, size_t size, size_t *length, size_t *capacity)
+{
+    void *new_list = yaml_allocator_realloc(allocator,
+            *list, (*capacity)*size*2);
+
+    if (!new_list) return 0;
+
+    *list = new_list;
+    *capacity *= 2;
+
+    return 1;
+}
+
+/*
+ * Extend or move a queue.
+ */
+
+YAML_DECLARE(int)
+yaml_queue_extend(void **list, size_t size,
         size_t *head, size_t *tail, size_t *capacity)
 {
     /* Check if we need to resize the queue. */
@@ -362,29 +860,30 @@ yaml_token_duplicate(yaml_token_t *token, const yaml_token_t *model)
 
         case YAML_ALIAS_TOKEN:
             if (!(token->data.alias.value =
-                        yaml_strdup(model->data.alias.value)))
+                        yaml_pool_strdup(NULL, model->data.alias.value)))
                 goto error;
             break;
 
         case YAML_ANCHOR_TOKEN:
             if (!(token->data.anchor.value =
-                        yaml_strdup(model->data.anchor.value)))
+                        yaml_pool_strdup(NULL, model->data.anchor.value)))
                 goto error;
             break;
 
         case YAML_TAG_TOKEN:
-            if (!(token->data.tag.handle = yaml_strdup(model->data.tag.handle)))
+            if (!(token->data.tag.handle =
+                        yaml_pool_strdup(NULL, model->data.tag.handle)))
                 goto error;
-            if (!(token->data.tag.suffix = yaml_strdup(model->data.tag.suffix)))
+            if (!(token->data.tag.suffix =
+                        yaml_pool_strdup(NULL, model->data.tag.suffix)))
                 goto error;
             break;
 
         case YAML_SCALAR_TOKEN:
             if (!(token->data.scalar.value =
-                        yaml_malloc(model->data.scalar.length+1)))
+                        yaml_pool_strndup(NULL, model->data.scalar.value,
+                            model->data.scalar.length)))
                 goto error;
-            memcpy(token->data.scalar.value, model->data.scalar.value,
-                    model->data.scalar.length+1);
             token->data.scalar.length = model->data.scalar.length;
             token->data.scalar.style = model->data.scalar.style;
             break;
@@ -431,7 +930,8 @@ yaml_token_clear(yaml_token_t *token)
             break;
 
         case YAML_SCALAR_TOKEN:
-            yaml_free(token->data.scalar.value);
+            if (!token->data.scalar.is_borrowed)
+                yaml_free(token->data.scalar.value);
             break;
 
         default:
@@ -539,24 +1039,23 @@ yaml_event_duplicate(yaml_event_t *event, const yaml_event_t *model)
 
         case YAML_ALIAS_EVENT:
             if (!(event->data.alias.anchor =
-                        yaml_strdup(model->data.alias.anchor)))
+                        yaml_pool_strdup(NULL, model->data.alias.anchor)))
                 goto error;
             break;
 
         case YAML_SCALAR_EVENT:
             if (model->data.scalar.anchor &&
                     !(event->data.scalar.anchor =
-                        yaml_strdup(model->data.scalar.anchor)))
+                        yaml_pool_strdup(NULL, model->data.scalar.anchor)))
                 goto error;
             if (model->data.scalar.tag &&
                     !(event->data.scalar.tag =
-                        yaml_strdup(model->data.scalar.tag)))
+                        yaml_pool_strdup(NULL, model->data.scalar.tag)))
                 goto error;
             if (!(event->data.scalar.value =
-                        yaml_malloc(model->data.scalar.length+1)))
+                        yaml_pool_strndup(NULL, model->data.scalar.value,
+                            model->data.scalar.length)))
                 goto error;
-            memcpy(event->data.scalar.value, model->data.scalar.value,
-                    model->data.scalar.length+1);
             event->data.scalar.length = model->data.scalar.length;
             event->data.scalar.is_plain_nonspecific =
                 model->data.scalar.is_plain_nonspecific;
@@ -568,31 +1067,37 @@ yaml_event_duplicate(yaml_event_t *event, const yaml_event_t *model)
         case YAML_SEQUENCE_START_EVENT:
             if (model->data.sequence_start.anchor &&
                     !(event->data.sequence_start.anchor =
-                        yaml_strdup(model->data.sequence_start.anchor)))
+                        yaml_pool_strdup(NULL,
+                            model->data.sequence_start.anchor)))
                 goto error;
             if (model->data.sequence_start.tag &&
                     !(event->data.sequence_start.tag =
-                        yaml_strdup(model->data.sequence_start.tag)))
+                        yaml_pool_strdup(NULL, model->data.sequence_start.tag)))
                 goto error;
             event->data.sequence_start.is_nonspecific =
                 model->data.sequence_start.is_nonspecific;
             event->data.sequence_start.style =
                 model->data.sequence_start.style;
+            event->data.sequence_start.hint =
+                model->data.sequence_start.hint;
             break;
 
         case YAML_MAPPING_START_EVENT:
             if (model->data.mapping_start.anchor &&
                     !(event->data.mapping_start.anchor =
-                        yaml_strdup(model->data.mapping_start.anchor)))
+                        yaml_pool_strdup(NULL,
+                            model->data.mapping_start.anchor)))
                 goto error;
             if (model->data.mapping_start.tag &&
                     !(event->data.mapping_start.tag =
-                        yaml_strdup(model->data.mapping_start.tag)))
+                        yaml_pool_strdup(NULL, model->data.mapping_start.tag)))
                 goto error;
             event->data.mapping_start.is_nonspecific =
                 model->data.mapping_start.is_nonspecific;
             event->data.mapping_start.style =
                 model->data.mapping_start.style;
+            event->data.mapping_start.hint =
+                model->data.mapping_start.hint;
             break;
 
         default:
@@ -640,7 +1145,8 @@ yaml_event_clear(yaml_event_t *event)
         case YAML_SCALAR_EVENT:
             yaml_free(event->data.scalar.anchor);
             yaml_free(event->data.scalar.tag);
-            yaml_free(event->data.scalar.value);
+            if (!event->data.scalar.is_borrowed)
+                yaml_free(event->data.scalar.value);
             break;
 
         case YAML_SEQUENCE_START_EVENT:
@@ -790,7 +1296,7 @@ yaml_event_create_alias(yaml_event_t *event, const yaml_char_t *anchor)
     assert(!event->type);   /* The event must be empty. */
     assert(anchor);     /* Non-NULL anchor is expected. */
 
-    anchor_copy = yaml_strdup(anchor);
+    anchor_copy = yaml_pool_strdup(NULL, anchor);
     if (!anchor_copy)
         return 0;
 
@@ -820,13 +1326,13 @@ yaml_event_create_scalar(yaml_event_t *event,
     assert(value);      /* Non-NULL anchor is expected. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_pool_strdup(NULL, anchor);
         if (!anchor_copy)
             goto error;
     }
 
     if (tag) {
-        tag_copy = yaml_strdup(tag);
+        tag_copy = yaml_pool_strdup(NULL, tag);
         if (!tag_copy)
             goto error;
     }
@@ -835,11 +1341,9 @@ yaml_event_create_scalar(yaml_event_t *event,
         length = strlen((char *)value);
     }
 
-    value_copy = yaml_malloc(length+1);
+    value_copy = yaml_pool_strndup(NULL, value, length);
     if (!value_copy)
         goto error;
-    memcpy(value_copy, value, length);
-    value_copy[length] = '\0';
 
     SCALAR_EVENT_INIT(*event, anchor_copy, tag_copy, value_copy, length,
             is_plain_nonspecific, is_quoted_nonspecific, style, mark, mark);
@@ -871,13 +1375,13 @@ yaml_event_create_sequence_start(yaml_event_t *event,
     assert(!event->type);   /* The event must be empty. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_pool_strdup(NULL, anchor);
         if (!anchor_copy)
             goto error;
     }
 
     if (tag) {
-        tag_copy = yaml_strdup(tag);
+        tag_copy = yaml_pool_strdup(NULL, tag);
         if (!tag_copy)
             goto error;
     }
@@ -928,13 +1432,13 @@ yaml_event_create_mapping_start(yaml_event_t *event,
     assert(!event->type);   /* The event must be empty. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_pool_strdup(NULL, anchor);
         if (!anchor_copy)
             goto error;
     }
 
     if (tag) {
-        tag_copy = yaml_strdup(tag);
+        tag_copy = yaml_pool_strdup(NULL, tag);
         if (!tag_copy)
             goto error;
     }
@@ -972,6 +1476,256 @@ yaml_event_create_mapping_end(yaml_event_t *event)
  * Document API
  *****************************************************************************/
 
+/*
+ * The standard tags.
+ */
+
+const yaml_char_t yaml_null_tag[] = "tag:yaml.org,2002:null";
+const yaml_char_t yaml_bool_tag[] = "tag:yaml.org,2002:bool";
+const yaml_char_t yaml_str_tag[] = "tag:yaml.org,2002:str";
+const yaml_char_t yaml_int_tag[] = "tag:yaml.org,2002:int";
+const yaml_char_t yaml_float_tag[] = "tag:yaml.org,2002:float";
+const yaml_char_t yaml_seq_tag[] = "tag:yaml.org,2002:seq";
+const yaml_char_t yaml_map_tag[] = "tag:yaml.org,2002:map";
+
+static const yaml_char_t *const yaml_standard_tags[] = {
+    yaml_null_tag, yaml_bool_tag, yaml_str_tag, yaml_int_tag, yaml_float_tag,
+    yaml_seq_tag, yaml_map_tag, NULL
+};
+
+/*
+ * The length of the common prefix of the standard tags.
+ */
+
+#define STANDARD_TAG_PREFIX_LENGTH  18
+
+/*
+ * Find the static copy of a standard tag or return `NULL`.
+ */
+
+static const yaml_char_t *
+yaml_find_standard_tag(const yaml_char_t *string, size_t length)
+{
+    const yaml_char_t *const *tag;
+
+    for (tag = yaml_standard_tags; *tag; tag ++) {
+        if (string == *tag)
+            return *tag;
+    }
+
+    if (length <= STANDARD_TAG_PREFIX_LENGTH
+            || memcmp(string, yaml_str_tag, STANDARD_TAG_PREFIX_LENGTH) != 0)
+        return NULL;
+
+    for (tag = yaml_standard_tags; *tag; tag ++) {
+        if (strncmp((const char *)*tag, (const char *)string, length) == 0
+                && !(*tag)[length])
+            return *tag;
+    }
+
+    return NULL;
+}
+
+/*
+ * Find the slot of a string in the document string table.  Return the slot
+ * containing the string or the empty slot where it should be put.
+ */
+
+static yaml_char_t **
+yaml_document_find_string(yaml_document_t *document,
+        const yaml_char_t *string, size_t length, size_t hash)
+{
+    size_t mask = document->strings.capacity-1;
+    size_t position = hash & mask;
+
+    while (1)
+    {
+        yaml_char_t **slot = document->strings.list + position;
+
+        if (!*slot)
+            return slot;
+
+        if (strncmp((char *)*slot, (char *)string, length) == 0
+                && !(*slot)[length])
+            return slot;
+
+        position = (position+1) & mask;
+    }
+}
+
+/*
+ * Double the capacity of the document string table and put the strings into
+ * it again.
+ */
+
+static int
+yaml_document_extend_strings(yaml_document_t *document)
+{
+    size_t capacity = document->strings.capacity
+        ? document->strings.capacity*2 : INITIAL_STACK_CAPACITY;
+    yaml_char_t **list = yaml_allocator_malloc(&document->allocator,
+            capacity*sizeof(yaml_char_t *));
+    yaml_char_t **old_list = document->strings.list;
+    size_t old_capacity = document->strings.capacity;
+    size_t idx;
+
+    if (!list)
+        return 0;
+
+    memset(list, 0, capacity*sizeof(yaml_char_t *));
+
+    document->strings.list = list;
+    document->strings.capacity = capacity;
+
+    for (idx = 0; idx < old_capacity; idx ++) {
+        yaml_char_t *string = old_list[idx];
+        size_t length;
+        if (!string)
+            continue;
+        length = strlen((char *)string);
+        *yaml_document_find_string(document, string, length,
+                yaml_string_hash(string, length)) = string;
+    }
+
+    yaml_allocator_free(&document->allocator, old_list);
+
+    return 1;
+}
+
+/*
+ * Find a string in the document string table or put it there.  If
+ * `string_ref` is set, the table takes the string from it instead of copying.
+ */
+
+static yaml_char_t *
+yaml_document_intern(yaml_document_t *document, const yaml_char_t *string,
+        size_t length, yaml_char_t **string_ref)
+{
+    const yaml_char_t *standard_tag = yaml_find_standard_tag(string, length);
+    yaml_char_t **slot;
+
+    if (standard_tag)
+        return (yaml_char_t *)standard_tag;
+
+    /* Keep the table at most half full. */
+
+    if ((document->strings.length+1)*2 > document->strings.capacity) {
+        if (!yaml_document_extend_strings(document))
+            return NULL;
+    }
+
+    slot = yaml_document_find_string(document, string, length,
+            yaml_string_hash(string, length));
+
+    if (*slot)
+        return *slot;
+
+    if (string_ref) {
+        *slot = *string_ref;
+        *string_ref = NULL;
+    }
+    else {
+        *slot = yaml_allocator_strndup(&document->allocator, string, length);
+        if (!*slot)
+            return NULL;
+    }
+
+    document->strings.length ++;
+
+    return *slot;
+}
+
+/*
+ * Get the shared copy of a tag or an anchor.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_document_intern_string(yaml_document_t *document,
+        const yaml_char_t *string, size_t length)
+{
+    assert(document);   /* Non-NULL document object is expected. */
+    assert(string);     /* Non-NULL string is expected. */
+
+    return yaml_document_intern(document, string, length, NULL);
+}
+
+/*
+ * Move a tag or an anchor into the document string table.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_document_adopt_string(yaml_document_t *document,
+        yaml_char_t **string_ref, size_t length)
+{
+    yaml_char_t *string;
+
+    assert(document);   /* Non-NULL document object is expected. */
+    assert(string_ref && *string_ref);  /* Non-NULL string is expected. */
+
+    string = yaml_document_intern(document, *string_ref, length,
+            IS_STANDARD_ALLOCATOR(document->allocator) ? string_ref : NULL);
+    if (!string)
+        return NULL;
+
+    yaml_free(*string_ref);
+    *string_ref = NULL;
+
+    return string;
+}
+
+/*
+ * Release the compact node storage.
+ */
+
+YAML_DECLARE(void)
+yaml_compact_nodes_delete(yaml_compact_nodes_t *nodes,
+        const yaml_allocator_t *allocator)
+{
+
+    ALLOCATOR_STACK_DEL(nodes, allocator, nodes->tags);
+
+    /* The columns of a binary image document belong to the image. */
+
+    if (!nodes->image) {
+        yaml_allocator_free(allocator, nodes->types);
+        yaml_allocator_free(allocator, nodes->tag_ids);
+        yaml_allocator_free(allocator, nodes->offsets);
+        yaml_allocator_free(allocator, nodes->lengths);
+        ALLOCATOR_STACK_DEL(nodes, allocator, nodes->values);
+        ALLOCATOR_STACK_DEL(nodes, allocator, nodes->items);
+        ALLOCATOR_STACK_DEL(nodes, allocator, nodes->pairs);
+    }
+
+    yaml_allocator_free(allocator, nodes);
+}
+
+/*
+ * Release the key index of a document.
+ */
+
+YAML_DECLARE(void)
+yaml_key_index_delete(yaml_key_index_t *index,
+        const yaml_allocator_t *allocator)
+{
+
+    ALLOCATOR_STACK_DEL(index, allocator, index->entries);
+    yaml_allocator_free(allocator, index->slots.list);
+    yaml_allocator_free(allocator, index);
+}
+
+/*
+ * Release the node reference counts.
+ */
+
+YAML_DECLARE(void)
+yaml_references_delete(yaml_references_t *references,
+        const yaml_allocator_t *allocator)
+{
+
+    ALLOCATOR_STACK_DEL(references, allocator, references->counts);
+    yaml_allocator_free(allocator, references);
+}
+
 /*
  * Allocate a document object.
  */
@@ -1002,6 +1756,23 @@ yaml_document_delete(yaml_document_t *document)
     yaml_free(document);
 }
 
+/*
+ * Deallocate a list of documents.
+ */
+
+YAML_DECLARE(void)
+yaml_document_list_delete(yaml_document_t *documents, size_t count)
+{
+    size_t idx;
+
+    assert(documents || !count);    /* Non-NULL document list is expected. */
+
+    for (idx = 0; idx < count; idx ++) {
+        yaml_document_clear(documents+idx);
+    }
+    yaml_free(documents);
+}
+
 /*
  * Duplicate a document object.
  */
@@ -1022,6 +1793,7 @@ yaml_document_duplicate(yaml_document_t *document, yaml_document_t *model)
     assert(document);   /* Non-NULL document object is expected. */
     assert(!document->type);    /* The document must be empty. */
     assert(model);      /* Non-NULL model object is expected. */
+    assert(!model->compact);    /* A compact document cannot be copied. */
 
     if (model->type != YAML_DOCUMENT)
         return 1;
@@ -1039,10 +1811,12 @@ yaml_document_duplicate(yaml_document_t *document, yaml_document_t *model)
         yaml_node_t *node = STACK_ITER(&self, model->nodes, idx);
         yaml_node_t copy;
         if (node->anchor) {
-            anchor = yaml_strdup(node->anchor);
+            anchor = yaml_document_intern_string(document, node->anchor,
+                    strlen((char *)node->anchor));
             if (!anchor) goto error;
         }
-        tag = yaml_strdup(node->tag);
+        tag = yaml_document_intern_string(document, node->tag,
+                strlen((char *)node->tag));
         if (!tag) goto error;
         switch (node->type)
         {
@@ -1056,6 +1830,8 @@ yaml_document_duplicate(yaml_document_t *document, yaml_document_t *model)
                 SCALAR_NODE_INIT(copy, anchor, tag, value,
                         node->data.scalar.length, node->data.scalar.style,
                         node->start_mark, node->end_mark);
+                copy.data.scalar.kind = node->data.scalar.kind;
+                copy.data.scalar.converted = node->data.scalar.converted;
                 break;
 
             case YAML_SEQUENCE_NODE:
@@ -1101,8 +1877,6 @@ yaml_document_duplicate(yaml_document_t *document, yaml_document_t *model)
     }
 
 error:
-    yaml_free(anchor);
-    yaml_free(tag);
     yaml_free(value);
     yaml_free(item_list);
     yaml_free(pair_list);
@@ -1119,48 +1893,86 @@ error:
 YAML_DECLARE(void)
 yaml_document_clear(yaml_document_t *document)
 {
-    struct {
-        yaml_error_type_t error;
-    } self;
-    yaml_tag_directive_t *tag_directive;
-
-    self.error = YAML_NO_ERROR;  /* Eliminate a compliler warning. */
+    yaml_allocator_t allocator;
+    size_t idx;
 
     assert(document);   /* Non-NULL document object is expected. */
 
     if (!document->type)
         return;
 
-    while (!STACK_EMPTY(&context, document->nodes)) {
-        yaml_node_t node = POP(&context, document->nodes);
-        yaml_free(node.tag);
+    /* The content of an arena document is released at once. */
+
+    if (document->arena) {
+        yaml_arena_delete(document->arena);
+        memset(document, 0, sizeof(yaml_document_t));
+        return;
+    }
+
+    allocator = document->allocator;
+
+    if (document->key_index) {
+        yaml_key_index_delete(document->key_index, &allocator);
+    }
+
+    if (document->references) {
+        yaml_references_delete(document->references, &allocator);
+    }
+
+    if (document->compact) {
+        yaml_compact_nodes_delete(document->compact, &allocator);
+        document->nodes.length = 0;
+    }
+
+    while (!STACK_EMPTY(document, document->nodes)) {
+        yaml_node_t node = POP(document, document->nodes);
         switch (node.type) {
             case YAML_SCALAR_NODE:
-                yaml_free(node.data.scalar.value);
+                yaml_allocator_free(&allocator, node.data.scalar.value);
                 break;
             case YAML_SEQUENCE_NODE:
-                STACK_DEL(&context, node.data.sequence.items);
+                ALLOCATOR_STACK_DEL(document, &allocator,
+                        node.data.sequence.items);
                 break;
             case YAML_MAPPING_NODE:
-                STACK_DEL(&context, node.data.mapping.pairs);
+                ALLOCATOR_STACK_DEL(document, &allocator,
+                        node.data.mapping.pairs);
                 break;
             default:
                 assert(0);  /* Should not happen. */
         }
     }
-    STACK_DEL(&self, document->nodes);
+    ALLOCATOR_STACK_DEL(document, &allocator, document->nodes);
 
-    yaml_free(document->version_directive);
-    while (!STACK_EMPTY(&self, document->tag_directives)) {
-        yaml_tag_directive_t tag_directive = POP(&self, document->tag_directives);
-        yaml_free(tag_directive.handle);
-        yaml_free(tag_directive.prefix);
+    for (idx = 0; idx < document->strings.capacity; idx ++) {
+        yaml_allocator_free(&allocator, document->strings.list[idx]);
     }
-    STACK_DEL(&self, document->tag_directives);
+    yaml_allocator_free(&allocator, document->strings.list);
+
+    yaml_allocator_free(&allocator, document->version_directive);
+    while (!STACK_EMPTY(document, document->tag_directives)) {
+        yaml_tag_directive_t tag_directive =
+            POP(document, document->tag_directives);
+        yaml_allocator_free(&allocator, tag_directive.handle);
+        yaml_allocator_free(&allocator, tag_directive.prefix);
+    }
+    ALLOCATOR_STACK_DEL(document, &allocator, document->tag_directives);
 
     memset(document, 0, sizeof(yaml_document_t));
 }
 
+/*
+ * Check if the document is compact.
+ */
+
+YAML_DECLARE(int)
+yaml_document_is_compact(yaml_document_t *document)
+{
+    assert(document);   /* Non-NULL document object is expected. */
+
+    return (document->compact != NULL);
+}
+
 /*
  * Create a document.
  */
@@ -1248,6 +2060,9 @@ yaml_document_get_node(yaml_document_t *document, int node_id)
     assert(document);   /* Non-NULL document object is expected. */
     assert(document->type); /* Initialized document is expected. */
 
+    if (document->compact)
+        return NULL;
+
     if (node_id < 0) {
         node_id += document->nodes.length;
     }
@@ -1279,29 +2094,33 @@ yaml_document_add_scalar(yaml_document_t *document, int *node_id,
 
     assert(document);   /* Non-NULL document object is expected. */
     assert(document->type); /* Initialized document is required. */
+    assert(!document->compact); /* A compact document cannot be modified. */
+    assert(!document->is_frozen);   /* A frozen document cannot be modified. */
     assert(tag);        /* Non-NULL tag is expected. */
     assert(value);      /* Non-NULL value is expected. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_document_intern_string(document, anchor,
+                strlen((char *)anchor));
         if (!anchor_copy) goto error;
     }
 
-    tag_copy = yaml_strdup(tag);
+    tag_copy = yaml_document_intern_string(document, tag, strlen((char *)tag));
     if (!tag_copy) goto error;
 
     if (length < 0) {
         length = strlen((char *)value);
     }
 
-    value_copy = yaml_malloc(length+1);
+    value_copy = yaml_allocator_malloc(&document->allocator, length+1);
     if (!value_copy) goto error;
     memcpy(value_copy, value, length);
     value_copy[length] = '\0';
 
     SCALAR_NODE_INIT(node, anchor_copy, tag_copy, value_copy, length,
             style, mark, mark);
-    if (!PUSH(&self, document->nodes, node)) goto error;
+    if (!ALLOCATOR_PUSH(&self, &document->allocator, document->nodes, node))
+        goto error;
 
     if (node_id) {
         *node_id = document->nodes.length-1;
@@ -1310,9 +2129,7 @@ yaml_document_add_scalar(yaml_document_t *document, int *node_id,
     return 1;
 
 error:
-    yaml_free(anchor_copy);
-    yaml_free(tag_copy);
-    yaml_free(value_copy);
+    yaml_allocator_free(&document->allocator, value_copy);
 
     return 0;
 }
@@ -1341,21 +2158,27 @@ yaml_document_add_sequence(yaml_document_t *document, int *node_id,
 
     assert(document);   /* Non-NULL document object is expected. */
     assert(document->type); /* Initialized document is required. */
+    assert(!document->compact); /* A compact document cannot be modified. */
+    assert(!document->is_frozen);   /* A frozen document cannot be modified. */
     assert(tag);        /* Non-NULL tag is expected. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_document_intern_string(document, anchor,
+                strlen((char *)anchor));
         if (!anchor_copy) goto error;
     }
 
-    tag_copy = yaml_strdup(tag);
+    tag_copy = yaml_document_intern_string(document, tag, strlen((char *)tag));
     if (!tag_copy) goto error;
 
-    if (!STACK_INIT(&self, items, INITIAL_STACK_CAPACITY)) goto error;
+    if (!ALLOCATOR_STACK_INIT(&self, &document->allocator,
+                items, INITIAL_STACK_CAPACITY))
+        goto error;
 
     SEQUENCE_NODE_INIT(node, anchor_copy, tag_copy,
             items.list, items.length, items.capacity, style, mark, mark);
-    if (!PUSH(&self, document->nodes, node)) goto error;
+    if (!ALLOCATOR_PUSH(&self, &document->allocator, document->nodes, node))
+        goto error;
 
     if (node_id) {
         *node_id = document->nodes.length-1;
@@ -1364,9 +2187,7 @@ yaml_document_add_sequence(yaml_document_t *document, int *node_id,
     return 1;
 
 error:
-    STACK_DEL(&self, items);
-    yaml_free(anchor_copy);
-    yaml_free(tag_copy);
+    ALLOCATOR_STACK_DEL(&self, &document->allocator, items);
 
     return 0;
 }
@@ -1395,21 +2216,27 @@ yaml_document_add_mapping(yaml_document_t *document, int *node_id,
 
     assert(document);   /* Non-NULL document object is expected. */
     assert(document->type); /* Initialized document is required. */
+    assert(!document->compact); /* A compact document cannot be modified. */
+    assert(!document->is_frozen);   /* A frozen document cannot be modified. */
     assert(tag);        /* Non-NULL tag is expected. */
 
     if (anchor) {
-        anchor_copy = yaml_strdup(anchor);
+        anchor_copy = yaml_document_intern_string(document, anchor,
+                strlen((char *)anchor));
         if (!anchor_copy) goto error;
     }
 
-    tag_copy = yaml_strdup(tag);
+    tag_copy = yaml_document_intern_string(document, tag, strlen((char *)tag));
     if (!tag_copy) goto error;
 
-    if (!STACK_INIT(&self, pairs, INITIAL_STACK_CAPACITY)) goto error;
+    if (!ALLOCATOR_STACK_INIT(&self, &document->allocator,
+                pairs, INITIAL_STACK_CAPACITY))
+        goto error;
 
     MAPPING_NODE_INIT(node, anchor_copy, tag_copy,
             pairs.list, pairs.length, pairs.capacity, style, mark, mark);
-    if (!PUSH(&self, document->nodes, node)) goto error;
+    if (!ALLOCATOR_PUSH(&self, &document->allocator, document->nodes, node))
+        goto error;
 
     if (node_id) {
         *node_id = document->nodes.length-1;
@@ -1418,13 +2245,140 @@ yaml_document_add_mapping(yaml_document_t *document, int *node_id,
     return 1;
 
 error:
-    STACK_DEL(&self, pairs);
-    yaml_free(anchor_copy);
-    yaml_free(tag_copy);
+    ALLOCATOR_STACK_DEL(&self, &document->allocator, pairs);
 
     return 0;
 }
 
+/*
+ * Count a reference to a node.
+ */
+
+static void
+yaml_document_count_reference(yaml_references_t *references, int node_id)
+{
+    unsigned char *count = references->counts.list + node_id;
+
+    if (*count < 2 && ++ *count == 2) {
+        references->shared ++;
+    }
+}
+
+/*
+ * Get the node reference counts, counting the references of all the nodes if
+ * the counts do not exist yet.  The counts of the nodes added since the last
+ * call are zero as no node could refer to them yet.
+ */
+
+YAML_DECLARE(yaml_references_t *)
+yaml_document_count_references(yaml_document_t *document)
+{
+    yaml_references_t *references = document->references;
+    yaml_compact_nodes_t *compact = document->compact;
+    size_t capacity;
+    size_t idx;
+
+    if (references && references->counts.capacity >= document->nodes.length) {
+        memset(references->counts.list + references->counts.length, 0,
+                document->nodes.length - references->counts.length);
+        references->counts.length = document->nodes.length;
+        return references;
+    }
+
+    if (!references) {
+        references = yaml_allocator_malloc(&document->allocator,
+                sizeof(yaml_references_t));
+        if (!references)
+            return NULL;
+        memset(references, 0, sizeof(yaml_references_t));
+    }
+
+    capacity = (references->counts.capacity ? references->counts.capacity
+            : INITIAL_STACK_CAPACITY);
+    while (capacity < document->nodes.length) {
+        capacity *= 2;
+    }
+
+    {
+        unsigned char *list = yaml_allocator_realloc(&document->allocator,
+                references->counts.list, capacity);
+        if (!list) {
+            if (!document->references) {
+                yaml_references_delete(references, &document->allocator);
+            }
+            return NULL;
+        }
+        references->counts.list = list;
+        references->counts.capacity = capacity;
+    }
+
+    memset(references->counts.list + references->counts.length, 0,
+            document->nodes.length - references->counts.length);
+    references->counts.length = document->nodes.length;
+
+    if (document->references)
+        return references;
+
+    document->references = references;
+
+    if (compact) {
+        for (idx = 0; idx < compact->items.length; idx ++) {
+            yaml_document_count_reference(references,
+                    compact->items.list[idx]);
+        }
+        for (idx = 0; idx < compact->pairs.length; idx ++) {
+            yaml_document_count_reference(references,
+                    compact->pairs.list[idx].key);
+            yaml_document_count_reference(references,
+                    compact->pairs.list[idx].value);
+        }
+        return references;
+    }
+
+    for (idx = 0; idx < document->nodes.length; idx ++)
+    {
+        yaml_node_t *node = document->nodes.list + idx;
+        size_t kdx;
+
+        if (node->type == YAML_SEQUENCE_NODE) {
+            for (kdx = 0; kdx < node->data.sequence.items.length; kdx ++) {
+                yaml_document_count_reference(references,
+                        node->data.sequence.items.list[kdx]);
+            }
+        }
+        else if (node->type == YAML_MAPPING_NODE) {
+            for (kdx = 0; kdx < node->data.mapping.pairs.length; kdx ++) {
+                yaml_document_count_reference(references,
+                        node->data.mapping.pairs.list[kdx].key);
+                yaml_document_count_reference(references,
+                        node->data.mapping.pairs.list[kdx].value);
+            }
+        }
+    }
+
+    return references;
+}
+
+/*
+ * Count a reference to a node being appended to a collection.
+ */
+
+static int
+yaml_document_reference_node(yaml_document_t *document, int node_id)
+{
+    struct {
+        yaml_error_t error;
+    } self;
+    yaml_references_t *references = yaml_document_count_references(document);
+
+    if (!references)
+        return MEMORY_ERROR_INIT(&self);
+
+    yaml_document_count_reference(references, node_id);
+
+    return 1;
+}
+
 /*
  * Append an item to a sequence node.
  */
@@ -1439,11 +2393,13 @@ yaml_document_append_sequence_item(yaml_document_t *document,
 
     assert(document);       /* Non-NULL document is required. */
     assert(document->type); /* Initialized document is expected. */
+    assert(!document->compact); /* A compact document cannot be modified. */
+    assert(!document->is_frozen);   /* A frozen document cannot be modified. */
 
-    if (sequence_id) {
+    if (sequence_id < 0) {
         sequence_id += document->nodes.length;
     }
-    if (item_id) {
+    if (item_id < 0) {
         item_id += document->nodes.length;
     }
 
@@ -1454,7 +2410,10 @@ yaml_document_append_sequence_item(yaml_document_t *document,
     assert(document->nodes.list[sequence_id].type == YAML_SEQUENCE_NODE);
                             /* A sequence node is expected. */
 
-    if (!PUSH(&self,
+    if (!yaml_document_reference_node(document, item_id))
+        return 0;
+
+    if (!ALLOCATOR_PUSH(&self, &document->allocator,
                 document->nodes.list[sequence_id].data.sequence.items, item_id))
         return 0;
 
@@ -1472,10 +2431,12 @@ yaml_document_append_mapping_pair(yaml_document_t *document,
     struct {
         yaml_error_t error;
     } self;
-    yaml_node_pair_t pair = { key_id, value_id };
+    yaml_node_pair_t pair;
 
     assert(document);       /* Non-NULL document is required. */
     assert(document->type); /* Initialized document is expected. */
+    assert(!document->compact); /* A compact document cannot be modified. */
+    assert(!document->is_frozen);   /* A frozen document cannot be modified. */
 
     if (mapping_id < 0) {
         mapping_id += document->nodes.length;
@@ -1496,219 +2457,296 @@ yaml_document_append_mapping_pair(yaml_document_t *document,
     assert(document->nodes.list[mapping_id].type == YAML_MAPPING_NODE);
                             /* A mapping node is expected. */
 
-    if (!PUSH(&self,
+    if (!yaml_document_reference_node(document, key_id)
+            || !yaml_document_reference_node(document, value_id))
+        return 0;
+
+    pair.key = key_id;
+    pair.value = value_id;
+
+    if (!ALLOCATOR_PUSH(&self, &document->allocator,
                 document->nodes.list[mapping_id].data.mapping.pairs, pair))
         return 0;
 
+    /* The key index is rebuilt on the next lookup. */
+
+    if (document->key_index) {
+        yaml_key_index_delete(document->key_index, &document->allocator);
+        document->key_index = NULL;
+    }
+
     return 1;
 }
 
 /*
- * Ensure that the node is a `!!null` SCALAR node.
+ * The spellings of the null, boolean and special float scalars grouped by
+ * length.  For a boolean, `value` is the boolean value; for a float, it is the
+ * sign of the infinity or `0` for NaN.
  */
 
-YAML_DECLARE(int)
-yaml_document_get_null_node(yaml_document_t *document, int node_id)
-{
-    yaml_node_t *node;
-    yaml_char_t *scalar;
-
-    assert(document);       /* Non-NULL document is required. */
-    assert(document->type); /* Initialized document is expected. */
+typedef struct yaml_scalar_keyword_s {
+    const char *spelling;
+    yaml_scalar_kind_t kind;
+    int value;
+} yaml_scalar_keyword_t;
+
+static const yaml_scalar_keyword_t yaml_scalar_keywords[] = {
+    /* 0 characters. */
+    { "", YAML_NULL_SCALAR_KIND, 0 },
+    /* 1 character. */
+    { "~", YAML_NULL_SCALAR_KIND, 0 },
+    /* 2 characters. */
+    { "no", YAML_BOOL_SCALAR_KIND, 0 },
+    { "No", YAML_BOOL_SCALAR_KIND, 0 },
+    { "NO", YAML_BOOL_SCALAR_KIND, 0 },
+    { "on", YAML_BOOL_SCALAR_KIND, 1 },
+    { "On", YAML_BOOL_SCALAR_KIND, 1 },
+    { "ON", YAML_BOOL_SCALAR_KIND, 1 },
+    /* 3 characters. */
+    { "yes", YAML_BOOL_SCALAR_KIND, 1 },
+    { "Yes", YAML_BOOL_SCALAR_KIND, 1 },
+    { "YES", YAML_BOOL_SCALAR_KIND, 1 },
+    { "off", YAML_BOOL_SCALAR_KIND, 0 },
+    { "Off", YAML_BOOL_SCALAR_KIND, 0 },
+    { "OFF", YAML_BOOL_SCALAR_KIND, 0 },
+    /* 4 characters. */
+    { "null", YAML_NULL_SCALAR_KIND, 0 },
+    { "Null", YAML_NULL_SCALAR_KIND, 0 },
+    { "NULL", YAML_NULL_SCALAR_KIND, 0 },
+    { "true", YAML_BOOL_SCALAR_KIND, 1 },
+    { "True", YAML_BOOL_SCALAR_KIND, 1 },
+    { "TRUE", YAML_BOOL_SCALAR_KIND, 1 },
+    { ".inf", YAML_FLOAT_SCALAR_KIND, 1 },
+    { ".Inf", YAML_FLOAT_SCALAR_KIND, 1 },
+    { ".INF", YAML_FLOAT_SCALAR_KIND, 1 },
+    { ".nan", YAML_FLOAT_SCALAR_KIND, 0 },
+    { ".NaN", YAML_FLOAT_SCALAR_KIND, 0 },
+    { ".NAN", YAML_FLOAT_SCALAR_KIND, 0 },
+    /* 5 characters. */
+    { "false", YAML_BOOL_SCALAR_KIND, 0 },
+    { "False", YAML_BOOL_SCALAR_KIND, 0 },
+    { "FALSE", YAML_BOOL_SCALAR_KIND, 0 },
+    { "+.inf", YAML_FLOAT_SCALAR_KIND, 1 },
+    { "+.Inf", YAML_FLOAT_SCALAR_KIND, 1 },
+    { "+.INF", YAML_FLOAT_SCALAR_KIND, 1 },
+    { "-.inf", YAML_FLOAT_SCALAR_KIND, -1 },
+    { "-.Inf", YAML_FLOAT_SCALAR_KIND, -1 },
+    { "-.INF", YAML_FLOAT_SCALAR_KIND, -1 }
+};
 
-    if (node_id < 0) {
-        node_id += document->nodes.length;
-    }
+/*
+ * The position of the keywords of each length in the table above.
+ */
 
-    assert(node_id >= 0 && node_id < document->nodes.length);
-                            /* Valid node id is required. */
+#define MAX_SCALAR_KEYWORD_LENGTH   5
 
-    node = document->nodes.list + node_id;
+static const size_t yaml_scalar_keyword_offsets[] = { 0, 1, 2, 8, 14, 26, 35 };
 
-    if (node->type != YAML_SCALAR_NODE)
-        return 0;
+/*
+ * Convert a value using `strtod()`.  Return 1 if the whole value is
+ * converted, 0 otherwise.
+ */
 
-    if (strcmp(node->tag, YAML_NULL_TAG))
-        return 0;
+static int
+yaml_convert_float(const yaml_char_t *value, size_t length, double *real)
+{
+    char buffer[128];
+    char *pointer;
+    char *tail;
+    int old_errno = errno, new_errno;
+    char decimal_point = *localeconv()->decimal_point;
 
-    if (node->data.scalar.length != strlen(node->data.scalar.value))
+    if (length >= sizeof(buffer))
         return 0;
 
-    scalar = node->data.scalar.value;
+    memcpy(buffer, value, length);
+    buffer[length] = '\0';
 
-    if (!strcmp(scalar, "") || !strcmp(scalar, "~") || !strcmp(scalar, "null")
-            || !strcmp(scalar, "Null") || !strcmp(scalar, "NULL"))
-        return 1;
+    /* Replace a locale-dependent decimal point with a dot. */
 
-    return 0;
+    for (pointer = buffer; *pointer; pointer++) {
+        if (*pointer == decimal_point) {
+            *pointer = '.';
+            break;
+        }
+    }
+
+    errno = 0;
+
+    *real = strtod(buffer, &tail);
+
+    new_errno = errno;
+    errno = old_errno;
+
+    return (!new_errno && !*tail);
 }
 
 /*
- * Ensure that the node is a `!!bool` SCALAR node.
+ * Classify a scalar value and convert it according to its kind.
+ *
+ * The keywords are looked up by the length and the first character.  The
+ * integers are recognized and converted in the same pass the way `strtol()`
+ * with the base 0 would do it.  Only the values that look like a number or
+ * like `inf` and `nan` are given to `strtod()`.
  */
 
-YAML_DECLARE(int)
-yaml_document_get_bool_node(yaml_document_t *document, int node_id, int *value)
+static yaml_scalar_kind_t
+yaml_classify_scalar(const yaml_char_t *value, size_t length,
+        yaml_scalar_value_t *converted)
 {
-    yaml_node_t *node;
-    yaml_char_t *scalar;
-
-    assert(document);       /* Non-NULL document is required. */
-    assert(document->type); /* Initialized document is expected. */
-
-    if (node_id < 0) {
-        node_id += document->nodes.length;
-    }
+    const yaml_char_t *pointer = value;
+    const yaml_char_t *end = value + length;
+    const yaml_char_t *start;
+    unsigned long integer = 0;
+    unsigned long limit = LONG_MAX;
+    int is_negative = 0;
+    int is_overflow = 0;
+    size_t idx;
 
-    assert(node_id >= 0 && node_id < document->nodes.length);
-                            /* Valid node id is required. */
+    /* A value containing NUL is a string. */
 
-    node = document->nodes.list + node_id;
+    if (memchr(value, '\0', length))
+        return YAML_STR_SCALAR_KIND;
 
-    if (node->type != YAML_SCALAR_NODE)
-        return 0;
+    /* Check the keywords of the same length. */
 
-    if (strcmp(node->tag, YAML_BOOL_TAG))
-        return 0;
+    if (length <= MAX_SCALAR_KEYWORD_LENGTH)
+    {
+        for (idx = yaml_scalar_keyword_offsets[length];
+                idx < yaml_scalar_keyword_offsets[length+1]; idx ++)
+        {
+            const yaml_scalar_keyword_t *keyword = yaml_scalar_keywords + idx;
 
-    if (node->data.scalar.length != strlen(node->data.scalar.value))
-        return 0;
+            if ((!length || keyword->spelling[0] == value[0])
+                    && !memcmp(keyword->spelling, value, length)) {
+                if (keyword->kind == YAML_BOOL_SCALAR_KIND) {
+                    converted->boolean = keyword->value;
+                }
+                else if (keyword->kind == YAML_FLOAT_SCALAR_KIND) {
+                    converted->real = (keyword->value > 0 ? 1.0/0.0 :
+                            keyword->value < 0 ? -1.0/0.0 : 0.0/0.0);
+                }
+                return keyword->kind;
+            }
+        }
+    }
 
-    scalar = node->data.scalar.value;
+    /* Skip the leading spaces and the sign. */
 
-    if (!strcmp(scalar, "yes") || !strcmp(scalar, "Yes") || !strcmp(scalar, "YES") ||
-            !strcmp(scalar, "true") || !strcmp(scalar, "True") || !strcmp(scalar, "TRUE") ||
-            !strcmp(scalar, "on") || !strcmp(scalar, "On") || !strcmp(scalar, "ON")) {
-        if (value) {
-            *value = 1;
-        }
-        return 1;
+    while (pointer < end && isspace(*pointer)) {
+        pointer ++;
     }
 
-    if (!strcmp(scalar, "no") || !strcmp(scalar, "No") || !strcmp(scalar, "NO") ||
-            !strcmp(scalar, "false") || !strcmp(scalar, "False") || !strcmp(scalar, "FALSE") ||
-            !strcmp(scalar, "off") || !strcmp(scalar, "Off") || !strcmp(scalar, "OFF")) {
-        if (value) {
-            *value = 0;
-        }
-        return 1;
+    if (pointer < end && (*pointer == '+' || *pointer == '-')) {
+        is_negative = (*pointer == '-');
+        pointer ++;
     }
 
-    return 0;
-}
+    if (is_negative) {
+        limit = (unsigned long)LONG_MAX + 1;
+    }
 
-/*
- * Ensure that the node is a `!!str` SCALAR node.
- */
+    start = pointer;
 
-YAML_DECLARE(int)
-yaml_document_get_str_node(yaml_document_t *document, int node_id,
-        char **value)
-{
-    yaml_node_t *node;
+    /* Check for a decimal, octal or hexadecimal integer. */
 
-    assert(document);       /* Non-NULL document is required. */
-    assert(document->type); /* Initialized document is expected. */
+    if (pointer < end && *pointer >= '0' && *pointer <= '9')
+    {
+        unsigned int base = 10;
+
+        if (*pointer == '0') {
+            base = 8;
+            if (end - pointer > 2 && (pointer[1] == 'x' || pointer[1] == 'X')
+                    && isxdigit(pointer[2])) {
+                base = 16;
+                pointer += 2;
+            }
+        }
 
-    if (node_id < 0) {
-        node_id += document->nodes.length;
-    }
+        for (; pointer < end; pointer ++)
+        {
+            unsigned int digit;
 
-    assert(node_id >= 0 && node_id < document->nodes.length);
-                            /* Valid node id is required. */
+            if (*pointer >= '0' && *pointer <= '9') {
+                digit = *pointer - '0';
+            }
+            else if (*pointer >= 'a' && *pointer <= 'f') {
+                digit = *pointer - 'a' + 10;
+            }
+            else if (*pointer >= 'A' && *pointer <= 'F') {
+                digit = *pointer - 'A' + 10;
+            }
+            else break;
 
-    node = document->nodes.list + node_id;
+            if (digit >= base)
+                break;
 
-    if (node->type != YAML_SCALAR_NODE)
-        return 0;
+            if (integer > (limit - digit) / base) {
+                is_overflow = 1;
+            }
+            else {
+                integer = integer * base + digit;
+            }
+        }
 
-    if (strcmp(node->tag, YAML_STR_TAG))
-        return 0;
+        if (pointer == end && !is_overflow) {
+            converted->integer = (is_negative && integer ?
+                    -(long)(integer - 1) - 1 : (long)integer);
+            return YAML_INT_SCALAR_KIND;
+        }
+    }
 
-    if (node->data.scalar.length != strlen(node->data.scalar.value))
-        return 0;
+    /* Check for a float. */
 
-    if (value) {
-        *value = node->data.scalar.value;
+    if (start < end && ((*start >= '0' && *start <= '9') || *start == '.'
+                || *start == 'i' || *start == 'I'
+                || *start == 'n' || *start == 'N')) {
+        if (yaml_convert_float(value, length, &converted->real))
+            return YAML_FLOAT_SCALAR_KIND;
     }
 
-    return 1;
+    return YAML_STR_SCALAR_KIND;
 }
 
 /*
- * Ensure that the node is an `!!int` SCALAR node.
+ * Get the kind of a scalar node.  A regular node caches the kind and the
+ * converted value, a compact node is classified on every call.
  */
 
-YAML_DECLARE(int)
-yaml_document_get_int_node(yaml_document_t *document, int node_id,
-        long *value)
+static yaml_scalar_kind_t
+yaml_document_classify_node(yaml_document_t *document, int node_id,
+        yaml_scalar_value_t *converted)
 {
+    yaml_compact_nodes_t *compact = document->compact;
     yaml_node_t *node;
-    yaml_char_t *scalar;
-    char *tail;
-    long integer;
-    int old_errno = errno, new_errno;
-
-    assert(document);       /* Non-NULL document is required. */
-    assert(document->type); /* Initialized document is expected. */
-
-    if (node_id < 0) {
-        node_id += document->nodes.length;
-    }
 
-    assert(node_id >= 0 && node_id < document->nodes.length);
-                            /* Valid node id is required. */
+    if (compact)
+        return yaml_classify_scalar(
+                compact->values.list + compact->offsets[node_id],
+                compact->lengths[node_id], converted);
 
     node = document->nodes.list + node_id;
 
-    if (node->type != YAML_SCALAR_NODE)
-        return 0;
-
-    if (strcmp(node->tag, YAML_INT_TAG))
-        return 0;
-
-    if (node->data.scalar.length != strlen(node->data.scalar.value))
-        return 0;
-
-    if (!node->data.scalar.length)
-        return 0;
-
-    scalar = node->data.scalar.value;
-
-    errno = 0;
-
-    integer = strtol((char *)scalar, &tail, 0);
-
-    new_errno = errno;
-    errno = old_errno;
-
-    if (new_errno || *tail) {
-        return 0;
+    if (!node->data.scalar.kind) {
+        node->data.scalar.kind = yaml_classify_scalar(node->data.scalar.value,
+                node->data.scalar.length, &node->data.scalar.converted);
     }
 
-    if (value) {
-        *value = integer;
-    }
+    *converted = node->data.scalar.converted;
 
-    return 1;
+    return node->data.scalar.kind;
 }
 
 /*
- * Ensure that the node is a `!!float` SCALAR node.
+ * Get the tag and the value of a SCALAR node.
  */
 
 YAML_DECLARE(int)
-yaml_document_get_float_node(yaml_document_t *document, int node_id,
-        double *value)
+yaml_document_get_scalar(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_char_t **value, size_t *length)
 {
+    yaml_compact_nodes_t *compact;
     yaml_node_t *node;
-    yaml_char_t *scalar;
-    char buffer[128];
-    char *pointer;
-    char *tail;
-    double real;
-    int old_errno = errno, new_errno;
-    char decimal_point = localeconv()->decimal_point[0];
 
     assert(document);       /* Non-NULL document is required. */
     assert(document->type); /* Initialized document is expected. */
@@ -1720,92 +2758,55 @@ yaml_document_get_float_node(yaml_document_t *document, int node_id,
     assert(node_id >= 0 && node_id < document->nodes.length);
                             /* Valid node id is required. */
 
-    node = document->nodes.list + node_id;
-
-    if (node->type != YAML_SCALAR_NODE)
-        return 0;
-
-    if (strcmp(node->tag, YAML_FLOAT_TAG) && strcmp(node->tag, YAML_INT_TAG))
-        return 0;
-
-    if (node->data.scalar.length != strlen(node->data.scalar.value))
-        return 0;
-
-    if (!node->data.scalar.length)
-        return 0;
-
-    scalar = node->data.scalar.value;
+    compact = document->compact;
 
-    if (!strcmp(scalar, ".nan") || !strcmp(scalar, ".NaN") || !strcmp(scalar, ".NAN")) {
-        if (value) {
-            *value = 0.0/0.0;
+    if (compact) {
+        if (compact->types[node_id] != YAML_SCALAR_NODE)
+            return 0;
+        if (tag) {
+            *tag = compact->tags.list[compact->tag_ids[node_id]];
         }
-        return 1;
-    }
-
-    if (!strcmp(scalar, ".inf") || !strcmp(scalar, ".Inf") || !strcmp(scalar, ".INF") ||
-            !strcmp(scalar, "+.inf") || !strcmp(scalar, "+.Inf") || !strcmp(scalar, "+.INF")) {
         if (value) {
-            *value = 1.0/0.0;
+            *value = compact->values.list + compact->offsets[node_id];
         }
-        return 1;
-    }
-
-    if (!strcmp(scalar, "-.inf") || !strcmp(scalar, "-.Inf") || !strcmp(scalar, "-.INF")) {
-        if (value) {
-            *value = -1.0/0.0;
+        if (length) {
+            *length = compact->lengths[node_id];
         }
         return 1;
     }
 
-    if (strlen(scalar) >= sizeof(buffer))
-        return 0;
-
-    strcpy(buffer, (const char *)scalar);
-
-    /* Replace a locale-dependent decimal point with a dot. */
-
-    for (pointer = buffer; *pointer; pointer++) {
-        if (*pointer == decimal_point) {
-            *pointer = '.';
-            break;
-        }
-    }
-
-    errno = 0;
-
-    real = strtod(buffer, &tail);
-
-    new_errno = errno;
-    errno = old_errno;
+    node = document->nodes.list + node_id;
 
-    if (new_errno || *tail) {
+    if (node->type != YAML_SCALAR_NODE)
         return 0;
-    }
 
+    if (tag) {
+        *tag = node->tag;
+    }
     if (value) {
-        *value = real;
+        *value = node->data.scalar.value;
+    }
+    if (length) {
+        *length = node->data.scalar.length;
     }
 
     return 1;
 }
 
 /*
- * Ensure that the node is a `!!seq` SEQUENCE node.
+ * Get the tag and the items of a SEQUENCE node.
  */
 
 YAML_DECLARE(int)
-yaml_document_get_seq_node(yaml_document_t *document, int node_id,
-        yaml_node_item_t **items, size_t *length)
+yaml_document_get_sequence(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_node_item_t **items, size_t *length)
 {
+    yaml_compact_nodes_t *compact;
     yaml_node_t *node;
 
     assert(document);       /* Non-NULL document is required. */
     assert(document->type); /* Initialized document is expected. */
 
-    assert((items && length) || (!items && !length));
-                /* items and length must be equal to NULL simultaneously. */
-
     if (node_id < 0) {
         node_id += document->nodes.length;
     }
@@ -1813,16 +2814,35 @@ yaml_document_get_seq_node(yaml_document_t *document, int node_id,
     assert(node_id >= 0 && node_id < document->nodes.length);
                             /* Valid node id is required. */
 
+    compact = document->compact;
+
+    if (compact) {
+        if (compact->types[node_id] != YAML_SEQUENCE_NODE)
+            return 0;
+        if (tag) {
+            *tag = compact->tags.list[compact->tag_ids[node_id]];
+        }
+        if (items) {
+            *items = compact->items.list + compact->offsets[node_id];
+        }
+        if (length) {
+            *length = compact->lengths[node_id];
+        }
+        return 1;
+    }
+
     node = document->nodes.list + node_id;
 
     if (node->type != YAML_SEQUENCE_NODE)
         return 0;
 
-    if (strcmp(node->tag, YAML_SEQ_TAG))
-        return 0;
-
-    if (items && length) {
+    if (tag) {
+        *tag = node->tag;
+    }
+    if (items) {
         *items = node->data.sequence.items.list;
+    }
+    if (length) {
         *length = node->data.sequence.items.length;
     }
 
@@ -1830,21 +2850,19 @@ yaml_document_get_seq_node(yaml_document_t *document, int node_id,
 }
 
 /*
- * Ensure that the node is a `!!map` MAPPING node.
+ * Get the tag and the pairs of a MAPPING node.
  */
 
 YAML_DECLARE(int)
-yaml_document_get_map_node(yaml_document_t *document, int node_id,
-        yaml_node_pair_t **pairs, size_t *length)
+yaml_document_get_mapping(yaml_document_t *document, int node_id,
+        yaml_char_t **tag, yaml_node_pair_t **pairs, size_t *length)
 {
+    yaml_compact_nodes_t *compact;
     yaml_node_t *node;
 
     assert(document);       /* Non-NULL document is required. */
     assert(document->type); /* Initialized document is expected. */
 
-    assert((pairs && length) || (!pairs && !length));
-                /* pairs and length must be equal to NULL simultaneously. */
-
     if (node_id < 0) {
         node_id += document->nodes.length;
     }
@@ -1852,16 +2870,35 @@ yaml_document_get_map_node(yaml_document_t *document, int node_id,
     assert(node_id >= 0 && node_id < document->nodes.length);
                             /* Valid node id is required. */
 
+    compact = document->compact;
+
+    if (compact) {
+        if (compact->types[node_id] != YAML_MAPPING_NODE)
+            return 0;
+        if (tag) {
+            *tag = compact->tags.list[compact->tag_ids[node_id]];
+        }
+        if (pairs) {
+            *pairs = compact->pairs.list + compact->offsets[node_id];
+        }
+        if (length) {
+            *length = compact->lengths[node_id];
+        }
+        return 1;
+    }
+
     node = document->nodes.list + node_id;
 
     if (node->type != YAML_MAPPING_NODE)
         return 0;
 
-    if (strcmp(node->tag, YAML_MAP_TAG))
-        return 0;
-
-    if (pairs && length) {
+    if (tag) {
+        *tag = node->tag;
+    }
+    if (pairs) {
         *pairs = node->data.mapping.pairs.list;
+    }
+    if (length) {
         *length = node->data.mapping.pairs.length;
     }
 
@@ -1869,541 +2906,1791 @@ yaml_document_get_map_node(yaml_document_t *document, int node_id,
 }
 
 /*
- * Add a `!!null` SCALAR node.
+ * Compute the key index hash of a scalar key of a mapping.
  */
 
-YAML_DECLARE(int)
-yaml_document_add_null_node(yaml_document_t *document, int *node_id)
+static size_t
+yaml_key_hash(int mapping_id, const yaml_char_t *value, size_t length)
 {
-    return yaml_document_add_scalar(document, node_id, NULL,
-            YAML_NULL_TAG, "null", -1, YAML_ANY_SCALAR_STYLE);
+    return yaml_string_hash(value, length)
+        ^ ((size_t)mapping_id * 2654435761U);
 }
 
 /*
- * Add a `!!bool` SCALAR node.
+ * Find the key index slot of a mapping key.  Return the slot referring to the
+ * first entry of the mapping with the same key value and, unless `tag` is
+ * `NULL`, the same key tag, or the empty slot where it should be put.
  */
 
-YAML_DECLARE(int)
-yaml_document_add_bool_node(yaml_document_t *document, int *node_id,
-        int value)
+static int *
+yaml_document_find_key(yaml_document_t *document, int mapping_id,
+        const yaml_char_t *tag, const yaml_char_t *value, size_t length,
+        size_t hash)
 {
-    return yaml_document_add_scalar(document, node_id, NULL, YAML_BOOL_TAG,
-            (value ? "true" : "false"), -1, YAML_ANY_SCALAR_STYLE);
+    yaml_key_index_t *index = document->key_index;
+    size_t mask = index->slots.capacity-1;
+    size_t position = hash & mask;
+
+    while (1)
+    {
+        int *slot = index->slots.list + position;
+        yaml_key_entry_t *entry;
+        yaml_char_t *key_tag;
+        yaml_char_t *key_value;
+        size_t key_length;
+
+        if (*slot < 0)
+            return slot;
+
+        entry = index->entries.list + *slot;
+
+        if (entry->hash == hash && entry->mapping_id == mapping_id
+                && yaml_document_get_scalar(document, entry->key_id,
+                    &key_tag, &key_value, &key_length)
+                && key_length == length
+                && memcmp(key_value, value, length) == 0
+                && (!tag || key_tag == tag))
+            return slot;
+
+        position = (position+1) & mask;
+    }
 }
 
 /*
- * Add a `!!str` SCALAR node.
+ * Create an empty key index with the room for `count` entries.
  */
 
-YAML_DECLARE(int)
-yaml_document_add_str_node(yaml_document_t *document, int *node_id,
-        const char *value)
+static int
+yaml_document_create_key_index(yaml_document_t *document, size_t count)
 {
-    return yaml_document_add_scalar(document, node_id, NULL, YAML_STR_TAG,
-            (const yaml_char_t *) value, -1, YAML_ANY_SCALAR_STYLE);
-}
-
-/*
- * Add an `!!int` SCALAR node.
- */
+    struct {
+        yaml_error_t error;
+    } self;
+    yaml_key_index_t *index;
+    size_t capacity = INITIAL_STACK_CAPACITY;
 
-YAML_DECLARE(int)
-yaml_document_add_int_node(yaml_document_t *document, int *node_id,
-        long value)
-{
-    char buffer[128];   /* 128 bytes should be enough for everybody. */
-    int length;
+    while (capacity < count*2) {
+        capacity *= 2;
+    }
 
-    length = snprintf(buffer, sizeof(buffer), "%ld", value);
-    if (length < 0 || length >= sizeof(buffer)) return 0;
+    index = yaml_allocator_malloc(&document->allocator,
+            sizeof(yaml_key_index_t));
+    if (!index)
+        return 0;
 
-    return yaml_document_add_scalar(document, node_id, NULL, YAML_INT_TAG,
-            (const yaml_char_t *) buffer, -1, YAML_ANY_SCALAR_STYLE);
+    memset(index, 0, sizeof(yaml_key_index_t));
+
+    if (!ALLOCATOR_STACK_INIT(&self, &document->allocator, index->entries,
+                (count > INITIAL_STACK_CAPACITY
+                 ? count : INITIAL_STACK_CAPACITY)))
+        goto error;
+
+    index->slots.list = yaml_allocator_malloc(&document->allocator,
+            capacity*sizeof(int));
+    if (!index->slots.list)
+        goto error;
+
+    memset(index->slots.list, 0xFF, capacity*sizeof(int));
+    index->slots.capacity = capacity;
+
+    document->key_index = index;
+
+    return 1;
+
+error:
+
+    yaml_key_index_delete(index, &document->allocator);
+
+    return 0;
 }
 
 /*
- * Add a `!!float` SCALAR node.
+ * Double the capacity of the key index table and put the entries into it
+ * again.  The entries are distinct, so each of them takes the first empty slot.
  */
 
-YAML_DECLARE(int)
-yaml_document_add_float_node(yaml_document_t *document, int *node_id,
-        double value)
+static int
+yaml_document_extend_key_index(yaml_document_t *document)
 {
-    char buffer[128];   /* 128 bytes should be enough for everybody. */
-    char *pointer;
-    int length;
-    char decimal_point = *localeconv()->decimal_point;
-
-    length = snprintf(buffer, sizeof(buffer), "%.12g", value);
-        /* .12 is a reasonable precision; it is used by str(float) in Python. */
-    if (length < 0 || length >= sizeof(buffer)-3) return 0;
-
-    /* Replace a locale-dependent decimal point with a dot. */
+    yaml_key_index_t *index = document->key_index;
+    size_t capacity = index->slots.capacity*2;
+    size_t mask = capacity-1;
+    int *list = yaml_allocator_malloc(&document->allocator,
+            capacity*sizeof(int));
+    int idx;
 
-    for (pointer = buffer; *pointer; pointer++) {
-        if (*pointer == decimal_point) {
-            *pointer = '.';
-            break;
-        }
-    }
+    if (!list)
+        return 0;
 
-    /* Check if the formatted number contains a decimal dot. */
+    memset(list, 0xFF, capacity*sizeof(int));
 
-    for (pointer = buffer; *pointer; pointer++) {
-        if (*pointer != '+' && *pointer != '-' && !isdigit(*pointer)) {
-            break;
+    for (idx = 0; idx < index->entries.length; idx ++) {
+        size_t position = index->entries.list[idx].hash & mask;
+        while (list[position] >= 0) {
+            position = (position+1) & mask;
         }
+        list[position] = idx;
     }
 
-    /* Add .0 at the end of the buffer if needed. */
-
-    if (!*pointer) {
-        *(pointer++) = '.';
-        *(pointer++) = '0';
-        *(pointer++) = '\0';
-    }
+    yaml_allocator_free(&document->allocator, index->slots.list);
+    index->slots.list = list;
+    index->slots.capacity = capacity;
 
-    return yaml_document_add_scalar(document, node_id, NULL, YAML_FLOAT_TAG,
-            (const yaml_char_t *) buffer, -1, YAML_ANY_SCALAR_STYLE);
+    return 1;
 }
 
 /*
- * Add a `!!seq` SEQUENCE node.
+ * Add a mapping pair to the key index of a document.
  */
 
 YAML_DECLARE(int)
-yaml_document_add_seq_node(yaml_document_t *document, int *node_id)
+yaml_document_index_key(yaml_document_t *document, int mapping_id,
+        yaml_node_pair_t pair, int *is_duplicate)
 {
-    return yaml_document_add_sequence(document, node_id, NULL,
-            YAML_SEQ_TAG, YAML_ANY_SEQUENCE_STYLE);
-}
+    struct {
+        yaml_error_t error;
+    } self;
+    yaml_key_index_t *index;
+    yaml_key_entry_t entry;
+    yaml_char_t *tag;
+    yaml_char_t *value;
+    size_t length;
+    int *slot;
 
-/*
- * Add a `!!map` MAPPING node.
- */
+    assert(document);       /* Non-NULL document is required. */
+    assert(is_duplicate);   /* Non-NULL is_duplicate is required. */
 
-YAML_DECLARE(int)
-yaml_document_add_map_node(yaml_document_t *document, int *node_id)
-{
-    return yaml_document_add_mapping(document, node_id, NULL,
-            YAML_MAP_TAG, YAML_ANY_MAPPING_STYLE);
-}
+    *is_duplicate = 0;
 
-/*****************************************************************************
- * Standard Handlers
- *****************************************************************************/
+    if (!yaml_document_get_scalar(document, pair.key, &tag, &value, &length))
+        return 1;
 
-/*
- * Standard string read handler.
- */
+    if (!document->key_index
+            && !yaml_document_create_key_index(document, 0))
+        return 0;
 
-static int
-yaml_string_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
-        size_t *length)
-{
-    yaml_standard_reader_data_t *data = untyped_data;
+    index = document->key_index;
 
-    if (data->string.pointer == data->string.length) {
-        *length = 0;
-        return 1;
-    }
+    /* Keep the hash table at most half full. */
 
-    if (capacity > (size_t)(data->string.length - data->string.pointer)) {
-        capacity = data->string.length - data->string.pointer;
+    if ((index->entries.length+1)*2 > index->slots.capacity) {
+        if (!yaml_document_extend_key_index(document))
+            return 0;
     }
 
-    memcpy(buffer, data->string.buffer + data->string.pointer, capacity);
-    data->string.pointer += capacity;
-    *length = capacity;
-    return 1;
-}
+    entry.hash = yaml_key_hash(mapping_id, value, length);
+    entry.mapping_id = mapping_id;
+    entry.key_id = pair.key;
+    entry.value_id = pair.value;
 
-/*
- * Standard file read handler.
- */
+    slot = yaml_document_find_key(document, mapping_id, tag, value, length,
+            entry.hash);
 
-static int
-yaml_file_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
-        size_t *length)
-{
-    yaml_standard_reader_data_t *data = untyped_data;
+    if (*slot >= 0) {
+        *is_duplicate = 1;
+        return 1;
+    }
 
-    *length = fread(buffer, 1, capacity, data->file);
-    return !ferror(data->file);
+    if (!ALLOCATOR_PUSH(&self, &document->allocator, index->entries, entry))
+        return 0;
+
+    *slot = index->entries.length-1;
+
+    return 1;
 }
 
 /*
- * String write handler.
+ * Index the scalar keys of all mappings of a document.
  */
 
 static int
-yaml_string_writer(void *untyped_data, const unsigned char *buffer, size_t length)
+yaml_document_build_key_index(yaml_document_t *document)
 {
-    yaml_standard_writer_data_t *data = untyped_data;
-    int result = 1;
-
-    if (data->string.capacity - data->string.pointer < length) {
-        length = data->string.capacity - data->string.pointer;
-        result = 0;
+    yaml_node_pair_t *pairs;
+    size_t length;
+    size_t count = 0;
+    size_t idx;
+    int node_id;
+    int is_duplicate;
+
+    for (node_id = 0; node_id < document->nodes.length; node_id ++) {
+        if (yaml_document_get_mapping(document, node_id, NULL, NULL, &length)) {
+            count += length;
+        }
     }
 
-    memcpy(data->string.buffer + data->string.pointer, buffer, length);
-    data->string.pointer += length;
-    *data->length += length;
+    if (!yaml_document_create_key_index(document, count))
+        return 0;
 
-    return result;
+    for (node_id = 0; node_id < document->nodes.length; node_id ++) {
+        if (!yaml_document_get_mapping(document, node_id, NULL,
+                    &pairs, &length))
+            continue;
+        for (idx = 0; idx < length; idx ++) {
+            if (!yaml_document_index_key(document, node_id, pairs[idx],
+                        &is_duplicate)) {
+                yaml_key_index_delete(document->key_index,
+                        &document->allocator);
+                document->key_index = NULL;
+                return 0;
+            }
+        }
+    }
+
+    return 1;
 }
 
 /*
- * File write handler.
+ * Find the value of a mapping pair by its scalar key.
  */
 
-static int
-yaml_file_writer(void *untyped_data, const unsigned char *buffer, size_t length)
+YAML_DECLARE(int)
+yaml_document_find_mapping_value(yaml_document_t *document, int node_id,
+        const yaml_char_t *key, size_t length, int *value_id)
 {
-    yaml_standard_writer_data_t *data = untyped_data;
+    yaml_key_index_t *index;
+    yaml_node_pair_t *pairs;
+    size_t count;
+    size_t idx;
+    int *slot;
 
-    return (fwrite(buffer, 1, length, data->file) == length);
-}
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+    assert(key || !length); /* Non-NULL key is required. */
 
-/*
- * Standard resolve handler.
- *
- * The standard resolve handler recognizes the following scalars:
- *
- * - `!!null`: `~|null|Null|NULL|<empty string>`.
- *
- * - `!!bool`: `yes|Yes|YES|no|No|NO|true|True|TRUE|false|False|FALSE|
- *              on|On|ON|off|Off|OFF`
- *
- * - `!!int`: any string that is successfully converted using `strtol()`.
- *
- * - `!!float`: `[+-]?(.inf|.Inf|.INF)|.nan|.NaN|.NAN` or any string
- *   successfully converted using `strtod()`.
- */
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
 
-static int
-yaml_standard_resolver(void *untyped_data, yaml_incomplete_node_t *node,
-        const yaml_char_t **tag)
-{
-    if (node->type == YAML_SCALAR_NODE && node->data.scalar.is_plain)
-    {
-        yaml_char_t *value = node->data.scalar.value;
-        char buffer[128];
-        char *pointer;
-        char *tail;
-        int old_errno, new_errno;
-        char decimal_point = *(localeconv()->decimal_point);
-
-        if (strlen(value) != node->data.scalar.length) {
-            *tag = YAML_STR_TAG;
-            return 1;
-        }
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
 
-        if (!strcmp(value, "") || !strcmp(value, "~") ||
-                !strcmp(value, "null") || !strcmp(value, "Null") || !strcmp(value, "NULL")) {
-            *tag = YAML_NULL_TAG;
-            return 1;
-        }
+    if (!yaml_document_get_mapping(document, node_id, NULL, &pairs, &count))
+        return 0;
 
-        if (!strcmp(value, "yes") || !strcmp(value, "Yes") || !strcmp(value, "YES") ||
-                !strcmp(value, "no") || !strcmp(value, "No") || !strcmp(value, "NO") ||
-                !strcmp(value, "true") || !strcmp(value, "True") || !strcmp(value, "TRUE") ||
-                !strcmp(value, "false") || !strcmp(value, "False") || !strcmp(value, "FALSE") ||
-                !strcmp(value, "on") || !strcmp(value, "On") || !strcmp(value, "ON") ||
-                !strcmp(value, "off") || !strcmp(value, "Off") || !strcmp(value, "OFF")) {
-            *tag = YAML_BOOL_TAG;
-            return 1;
-        }
+    /* Without memory for the index, fall back to a linear search. */
 
-        if (!strcmp(value, ".inf") || !strcmp(value, ".Inf") || !strcmp(value, ".INF") ||
-                !strcmp(value, "+.inf") || !strcmp(value, "+.Inf") || !strcmp(value, "+.INF") ||
-                !strcmp(value, "-.inf") || !strcmp(value, "-.Inf") || !strcmp(value, "-.INF") ||
-                !strcmp(value, ".nan") || !strcmp(value, ".NaN") || !strcmp(value, ".NAN")) {
-            *tag = YAML_FLOAT_TAG;
-            return 1;
+    if (!document->key_index && !yaml_document_build_key_index(document))
+    {
+        for (idx = 0; idx < count; idx ++) {
+            yaml_char_t *value;
+            size_t value_length;
+            if (yaml_document_get_scalar(document, pairs[idx].key, NULL,
+                        &value, &value_length)
+                    && value_length == length
+                    && memcmp(value, key, length) == 0) {
+                if (value_id) {
+                    *value_id = pairs[idx].value;
+                }
+                return 1;
+            }
         }
+        return 0;
+    }
 
-        old_errno = errno;
-        errno = 0;
+    index = document->key_index;
 
-        strtol((const char *)value, &tail, 0);
+    slot = yaml_document_find_key(document, node_id, NULL, key, length,
+            yaml_key_hash(node_id, key, length));
 
-        new_errno = errno;
-        errno = old_errno;
+    if (*slot < 0)
+        return 0;
 
-        if (!new_errno && !*tail) {
-            *tag = YAML_INT_TAG;
-            return 1;
-        }
+    if (value_id) {
+        *value_id = index->entries.list[*slot].value_id;
+    }
 
-        if (strlen(value) < sizeof(buffer))
-        {
-            strcpy(buffer, (const char *)value);
+    return 1;
+}
 
-            /* Replace a locale-dependent decimal point with a dot. */
+/*
+ * Fill the lazy caches of a document and mark it as immutable.
+ */
 
-            for (pointer = buffer; *pointer; pointer++) {
-                if (*pointer == decimal_point) {
-                    *pointer = '.';
-                    break;
-                }
-            }
+YAML_DECLARE(int)
+yaml_document_freeze(yaml_document_t *document)
+{
+    size_t idx;
 
-            old_errno = errno;
-            errno = 0;
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
 
-            strtod(buffer, &tail);
+    if (document->is_frozen)
+        return 1;
 
-            new_errno = errno;
-            errno = old_errno;
+    /* A compact node does not cache its kind. */
 
-            if (!new_errno && !*tail) {
-                *tag = YAML_FLOAT_TAG;
-                return 1;
+    if (!document->compact) {
+        for (idx = 0; idx < document->nodes.length; idx ++) {
+            yaml_node_t *node = document->nodes.list + idx;
+            if (node->type == YAML_SCALAR_NODE && !node->data.scalar.kind) {
+                node->data.scalar.kind = yaml_classify_scalar(
+                        node->data.scalar.value, node->data.scalar.length,
+                        &node->data.scalar.converted);
             }
         }
     }
 
-    switch (node->type)
-    {
-        case YAML_SCALAR_NODE:
-            *tag = YAML_STR_TAG;
-            break;
-        case YAML_SEQUENCE_NODE:
-            *tag = YAML_SEQ_TAG;
-            break;
-        case YAML_MAPPING_NODE:
-            *tag = YAML_MAP_TAG;
-            break;
-        default:
-            assert(0);      /* Should never happen. */
-    }
+    if (!document->key_index && !yaml_document_build_key_index(document))
+        return 0;
+
+    document->is_frozen = 1;
 
     return 1;
 }
 
-
-/*****************************************************************************
- * Parser API
- *****************************************************************************/
-
 /*
- * Allocate a new parser object.
+ * Ensure that the node is a `!!null` SCALAR node.
  */
 
-YAML_DECLARE(yaml_parser_t *)
-yaml_parser_new(void)
+YAML_DECLARE(int)
+yaml_document_get_null_node(yaml_document_t *document, int node_id)
 {
-    yaml_parser_t *parser = yaml_malloc(sizeof(yaml_parser_t));
+    yaml_char_t *tag;
+    yaml_scalar_value_t converted;
 
-    if (!parser)
-        return NULL;
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
 
-    memset(parser, 0, sizeof(yaml_parser_t));
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
 
-    if (!IOSTRING_INIT(parser, parser->raw_input, RAW_INPUT_BUFFER_CAPACITY))
-        goto error;
-    if (!IOSTRING_INIT(parser, parser->input, INPUT_BUFFER_CAPACITY))
-        goto error;
-    if (!QUEUE_INIT(parser, parser->tokens, INITIAL_QUEUE_CAPACITY))
-        goto error;
-    if (!STACK_INIT(parser, parser->indents, INITIAL_STACK_CAPACITY))
-        goto error;
-    if (!STACK_INIT(parser, parser->simple_keys, INITIAL_STACK_CAPACITY))
-        goto error;
-    if (!STACK_INIT(parser, parser->states, INITIAL_STACK_CAPACITY))
-        goto error;
-    if (!STACK_INIT(parser, parser->marks, INITIAL_STACK_CAPACITY))
-        goto error;
-    if (!STACK_INIT(parser, parser->tag_directives, INITIAL_STACK_CAPACITY))
-        goto error;
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
 
-    return parser;
+    if (!yaml_document_get_scalar(document, node_id, &tag, NULL, NULL))
+        return 0;
 
-error:
+    if (tag != yaml_null_tag)
+        return 0;
+
+    return (yaml_document_classify_node(document, node_id, &converted)
+            == YAML_NULL_SCALAR_KIND);
+}
+
+/*
+ * Ensure that the node is a `!!bool` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_bool_node(yaml_document_t *document, int node_id, int *value)
+{
+    yaml_char_t *tag;
+    yaml_scalar_value_t converted;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_scalar(document, node_id, &tag, NULL, NULL))
+        return 0;
+
+    if (tag != yaml_bool_tag)
+        return 0;
+
+    if (yaml_document_classify_node(document, node_id, &converted)
+            != YAML_BOOL_SCALAR_KIND)
+        return 0;
+
+    if (value) {
+        *value = converted.boolean;
+    }
+
+    return 1;
+}
+
+/*
+ * Ensure that the node is a `!!str` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_str_node(yaml_document_t *document, int node_id,
+        char **value)
+{
+    yaml_char_t *tag;
+    yaml_char_t *string;
+    size_t length;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_scalar(document, node_id, &tag, &string, &length))
+        return 0;
+
+    if (tag != yaml_str_tag)
+        return 0;
+
+    if (length != strlen((char *)string))
+        return 0;
+
+    if (value) {
+        *value = (char *)string;
+    }
+
+    return 1;
+}
+
+/*
+ * Ensure that the node is an `!!int` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_int_node(yaml_document_t *document, int node_id,
+        long *value)
+{
+    yaml_char_t *tag;
+    yaml_scalar_value_t converted;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_scalar(document, node_id, &tag, NULL, NULL))
+        return 0;
+
+    if (tag != yaml_int_tag)
+        return 0;
+
+    if (yaml_document_classify_node(document, node_id, &converted)
+            != YAML_INT_SCALAR_KIND)
+        return 0;
+
+    if (value) {
+        *value = converted.integer;
+    }
+
+    return 1;
+}
+
+/*
+ * Ensure that the node is a `!!float` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_float_node(yaml_document_t *document, int node_id,
+        double *value)
+{
+    yaml_char_t *tag;
+    yaml_char_t *string;
+    size_t length;
+    yaml_scalar_value_t converted;
+    double real;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_scalar(document, node_id, &tag, &string, &length))
+        return 0;
+
+    if (tag != yaml_float_tag && tag != yaml_int_tag)
+        return 0;
+
+    switch (yaml_document_classify_node(document, node_id, &converted))
+    {
+        case YAML_FLOAT_SCALAR_KIND:
+            real = converted.real;
+            break;
+
+        /* An integer is converted again as `010` is octal only for `!!int`. */
+
+        case YAML_INT_SCALAR_KIND:
+            if (!yaml_convert_float(string, length, &real))
+                return 0;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (value) {
+        *value = real;
+    }
+
+    return 1;
+}
+
+/*
+ * Ensure that the node is a `!!seq` SEQUENCE node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_seq_node(yaml_document_t *document, int node_id,
+        yaml_node_item_t **items, size_t *length)
+{
+    yaml_char_t *tag;
+    yaml_node_item_t *list;
+    size_t count;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    assert((items && length) || (!items && !length));
+                /* items and length must be equal to NULL simultaneously. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_sequence(document, node_id, &tag, &list, &count))
+        return 0;
+
+    if (tag != yaml_seq_tag)
+        return 0;
+
+    if (items && length) {
+        *items = list;
+        *length = count;
+    }
+
+    return 1;
+}
+
+/*
+ * Ensure that the node is a `!!map` MAPPING node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_get_map_node(yaml_document_t *document, int node_id,
+        yaml_node_pair_t **pairs, size_t *length)
+{
+    yaml_char_t *tag;
+    yaml_node_pair_t *list;
+    size_t count;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    assert((pairs && length) || (!pairs && !length));
+                /* pairs and length must be equal to NULL simultaneously. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    if (!yaml_document_get_mapping(document, node_id, &tag, &list, &count))
+        return 0;
+
+    if (tag != yaml_map_tag)
+        return 0;
+
+    if (pairs && length) {
+        *pairs = list;
+        *length = count;
+    }
+
+    return 1;
+}
+
+/*
+ * Add a `!!null` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_null_node(yaml_document_t *document, int *node_id)
+{
+    return yaml_document_add_scalar(document, node_id, NULL,
+            yaml_null_tag, (const yaml_char_t *)"null", -1,
+            YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * Add a `!!bool` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_bool_node(yaml_document_t *document, int *node_id,
+        int value)
+{
+    return yaml_document_add_scalar(document, node_id, NULL, yaml_bool_tag,
+            (const yaml_char_t *)(value ? "true" : "false"), -1,
+            YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * Add a `!!str` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_str_node(yaml_document_t *document, int *node_id,
+        const char *value)
+{
+    return yaml_document_add_scalar(document, node_id, NULL, yaml_str_tag,
+            (const yaml_char_t *) value, -1, YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * Add an `!!int` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_int_node(yaml_document_t *document, int *node_id,
+        long value)
+{
+    char buffer[128];   /* 128 bytes should be enough for everybody. */
+    int length;
+
+    length = snprintf(buffer, sizeof(buffer), "%ld", value);
+    if (length < 0 || length >= sizeof(buffer)) return 0;
+
+    return yaml_document_add_scalar(document, node_id, NULL, yaml_int_tag,
+            (const yaml_char_t *) buffer, -1, YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * Add a `!!float` SCALAR node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_float_node(yaml_document_t *document, int *node_id,
+        double value)
+{
+    char buffer[128];   /* 128 bytes should be enough for everybody. */
+    char *pointer;
+    int length;
+    char decimal_point = *localeconv()->decimal_point;
+
+    length = snprintf(buffer, sizeof(buffer), "%.12g", value);
+        /* .12 is a reasonable precision; it is used by str(float) in Python. */
+    if (length < 0 || length >= sizeof(buffer)-3) return 0;
+
+    /* Replace a locale-dependent decimal point with a dot. */
+
+    for (pointer = buffer; *pointer; pointer++) {
+        if (*pointer == decimal_point) {
+            *pointer = '.';
+            break;
+        }
+    }
+
+    /* Check if the formatted number contains a decimal dot. */
+
+    for (pointer = buffer; *pointer; pointer++) {
+        if (*pointer != '+' && *pointer != '-' && !isdigit(*pointer)) {
+            break;
+        }
+    }
+
+    /* Add .0 at the end of the buffer if needed. */
+
+    if (!*pointer) {
+        *(pointer++) = '.';
+        *(pointer++) = '0';
+        *(pointer++) = '\0';
+    }
+
+    return yaml_document_add_scalar(document, node_id, NULL, yaml_float_tag,
+            (const yaml_char_t *) buffer, -1, YAML_ANY_SCALAR_STYLE);
+}
+
+/*
+ * Add a `!!seq` SEQUENCE node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_seq_node(yaml_document_t *document, int *node_id)
+{
+    return yaml_document_add_sequence(document, node_id, NULL,
+            yaml_seq_tag, YAML_ANY_SEQUENCE_STYLE);
+}
+
+/*
+ * Add a `!!map` MAPPING node.
+ */
+
+YAML_DECLARE(int)
+yaml_document_add_map_node(yaml_document_t *document, int *node_id)
+{
+    return yaml_document_add_mapping(document, node_id, NULL,
+            yaml_map_tag, YAML_ANY_MAPPING_STYLE);
+}
+
+/*****************************************************************************
+ * Standard Handlers
+ *****************************************************************************/
+
+/*
+ * Create a shared document handle.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_shared_document_new(yaml_document_t *document)
+{
+    yaml_shared_document_t *shared;
+
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+
+    shared = yaml_malloc(sizeof(yaml_shared_document_t));
+    if (!shared)
+        return NULL;
+
+    if (!yaml_document_freeze(document)) {
+        yaml_free(shared);
+        return NULL;
+    }
+
+    shared->document = *document;
+    shared->count = 1;
+
+    memset(document, 0, sizeof(yaml_document_t));
+
+    return shared;
+}
+
+/*
+ * Get the document of a shared document handle.
+ */
+
+YAML_DECLARE(yaml_document_t *)
+yaml_shared_document_get(yaml_shared_document_t *shared)
+{
+    assert(shared);     /* Non-NULL shared document is required. */
+
+    return &shared->document;
+}
+
+/*
+ * Add a reference to a shared document.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_shared_document_acquire(yaml_shared_document_t *shared)
+{
+    assert(shared);     /* Non-NULL shared document is required. */
+
+    ATOMIC_INCREMENT(shared->count);
+
+    return shared;
+}
+
+/*
+ * Release a reference to a shared document.
+ */
+
+YAML_DECLARE(void)
+yaml_shared_document_release(yaml_shared_document_t *shared)
+{
+    if (!shared)
+        return;
+
+    if (ATOMIC_DECREMENT(shared->count) > 0)
+        return;
+
+    yaml_document_clear(&shared->document);
+    yaml_free(shared);
+}
+
+/*
+ * Create a document slot.
+ */
+
+YAML_DECLARE(yaml_document_slot_t *)
+yaml_document_slot_new(void)
+{
+    yaml_document_slot_t *slot = yaml_malloc(sizeof(yaml_document_slot_t));
+
+    if (!slot)
+        return NULL;
+
+    memset(slot, 0, sizeof(yaml_document_slot_t));
+
+#if HAVE_PTHREAD_H
+    if (pthread_mutex_init(&slot->mutex, NULL)) {
+        yaml_free(slot);
+        return NULL;
+    }
+#endif
+
+    return slot;
+}
+
+/*
+ * Destroy a document slot.
+ */
+
+YAML_DECLARE(void)
+yaml_document_slot_delete(yaml_document_slot_t *slot)
+{
+    assert(slot);       /* Non-NULL slot object is expected. */
+
+    yaml_shared_document_release(slot->shared);
+
+#if HAVE_PTHREAD_H
+    pthread_mutex_destroy(&slot->mutex);
+#endif
+
+    yaml_free(slot);
+}
+
+/*
+ * Get a reference to the current document of a slot.
+ */
+
+YAML_DECLARE(yaml_shared_document_t *)
+yaml_document_slot_acquire(yaml_document_slot_t *slot)
+{
+    yaml_shared_document_t *shared;
+
+    assert(slot);       /* Non-NULL slot object is expected. */
+
+#if HAVE_PTHREAD_H
+    pthread_mutex_lock(&slot->mutex);
+#endif
+
+    shared = slot->shared;
+    if (shared) {
+        yaml_shared_document_acquire(shared);
+    }
+
+#if HAVE_PTHREAD_H
+    pthread_mutex_unlock(&slot->mutex);
+#endif
+
+    return shared;
+}
+
+/*
+ * Replace the document of a slot; the previous document is released outside
+ * of the lock.
+ */
+
+YAML_DECLARE(void)
+yaml_document_slot_swap(yaml_document_slot_t *slot,
+        yaml_shared_document_t *shared)
+{
+    yaml_shared_document_t *previous;
+
+    assert(slot);       /* Non-NULL slot object is expected. */
+
+#if HAVE_PTHREAD_H
+    pthread_mutex_lock(&slot->mutex);
+#endif
+
+    previous = slot->shared;
+    slot->shared = shared;
+
+#if HAVE_PTHREAD_H
+    pthread_mutex_unlock(&slot->mutex);
+#endif
+
+    yaml_shared_document_release(previous);
+}
+
+/*
+ * Standard string read handler.
+ */
+
+static int
+yaml_string_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
+        size_t *length)
+{
+    yaml_standard_reader_data_t *data = untyped_data;
+
+    if (data->string.pointer == data->string.length) {
+        *length = 0;
+        return 1;
+    }
+
+    if (capacity > (size_t)(data->string.length - data->string.pointer)) {
+        capacity = data->string.length - data->string.pointer;
+    }
+
+    memcpy(buffer, data->string.buffer + data->string.pointer, capacity);
+    data->string.pointer += capacity;
+    *length = capacity;
+    return 1;
+}
+
+/*
+ * Standard file read handler.
+ */
+
+static int
+yaml_file_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
+        size_t *length)
+{
+    yaml_standard_reader_data_t *data = untyped_data;
+
+    *length = fread(buffer, 1, capacity, data->file);
+    return !ferror(data->file);
+}
+
+/*
+ * File descriptor read handler.
+ */
+
+static int
+yaml_fd_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
+        size_t *length)
+{
+    yaml_standard_reader_data_t *data = untyped_data;
+#if HAVE_UNISTD_H
+    ssize_t result;
+
+    do {
+        result = read(data->fd, buffer, capacity);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        *length = 0;
+        return 0;
+    }
+
+    *length = result;
+    return 1;
+#else
+    *length = 0;
+    return 0;
+#endif
+}
+
+/*
+ * Push mode read handler.  The fed input is put into the raw buffer directly,
+ * so the handler is never called.
+ */
+
+static int
+yaml_push_reader(void *untyped_data, unsigned char *buffer, size_t capacity,
+        size_t *length)
+{
+    assert(0);      /* Impossible. */
+
+    *length = 0;
+    return 0;
+}
+
+/*
+ * Release the mapped input file.
+ */
+
+static void
+yaml_parser_unmap_input(yaml_parser_t *parser)
+{
+#if HAVE_MMAP
+    if (parser->standard_reader_data.mapping) {
+        munmap(parser->standard_reader_data.mapping,
+                parser->standard_reader_data.mapping_length);
+        parser->standard_reader_data.mapping = NULL;
+        parser->standard_reader_data.mapping_length = 0;
+    }
+#endif
+}
+
+/*
+ * String write handler.
+ */
+
+static int
+yaml_string_writer(void *untyped_data, const unsigned char *buffer, size_t length)
+{
+    yaml_standard_writer_data_t *data = untyped_data;
+    int result = 1;
+
+    if (data->string.capacity - data->string.pointer < length) {
+        length = data->string.capacity - data->string.pointer;
+        result = 0;
+    }
+
+    memcpy(data->string.buffer + data->string.pointer, buffer, length);
+    data->string.pointer += length;
+    *data->length += length;
+
+    return result;
+}
+
+/*
+ * File write handler.
+ */
+
+static int
+yaml_file_writer(void *untyped_data, const unsigned char *buffer, size_t length)
+{
+    yaml_standard_writer_data_t *data = untyped_data;
+
+    return (fwrite(buffer, 1, length, data->file) == length);
+}
+
+/*
+ * File descriptor vector write handler.
+ */
+
+static int
+yaml_fd_writer(void *untyped_data, const yaml_iovec_t *vectors, size_t count)
+{
+    yaml_standard_writer_data_t *data = untyped_data;
+#if HAVE_SYS_UIO_H
+    struct iovec iov[64];
+
+    while (count)
+    {
+        size_t iov_count = (count < 64 ? count : 64);
+        size_t idx = 0;
+        size_t kdx;
+
+        for (kdx = 0; kdx < iov_count; kdx ++) {
+            iov[kdx].iov_base = (void *)vectors[kdx].buffer;
+            iov[kdx].iov_len = vectors[kdx].length;
+        }
+
+        while (idx < iov_count)
+        {
+            ssize_t result;
+
+            do {
+                result = writev(data->fd, iov+idx, iov_count-idx);
+            } while (result < 0 && errno == EINTR);
+
+            if (result < 0)
+                return 0;
+
+            while (idx < iov_count && (size_t)result >= iov[idx].iov_len) {
+                result -= iov[idx].iov_len;
+                idx ++;
+            }
+            if (idx < iov_count) {
+                iov[idx].iov_base = (char *)iov[idx].iov_base + result;
+                iov[idx].iov_len -= result;
+            }
+        }
+
+        vectors += iov_count;
+        count -= iov_count;
+    }
+
+    return 1;
+#elif HAVE_UNISTD_H
+    size_t idx;
+
+    for (idx = 0; idx < count; idx ++)
+    {
+        const unsigned char *buffer = vectors[idx].buffer;
+        size_t length = vectors[idx].length;
+
+        while (length)
+        {
+            ssize_t result;
+
+            do {
+                result = write(data->fd, buffer, length);
+            } while (result < 0 && errno == EINTR);
+
+            if (result < 0)
+                return 0;
+
+            buffer += result;
+            length -= result;
+        }
+    }
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Parser event recycler.
+ */
+
+static void
+yaml_parser_recycler(void *untyped_data, yaml_event_t *event)
+{
+    yaml_parser_t *parser = untyped_data;
+
+    yaml_parser_recycle_event(parser, event);
+}
+
+/*
+ * Standard resolve handler.
+ *
+ * The standard resolve handler recognizes the following scalars:
+ *
+ * - `!!null`: `~|null|Null|NULL|<empty string>`.
+ *
+ * - `!!bool`: `yes|Yes|YES|no|No|NO|true|True|TRUE|false|False|FALSE|
+ *              on|On|ON|off|Off|OFF`
+ *
+ * - `!!int`: any string that is successfully converted using `strtol()`.
+ *
+ * - `!!float`: `[+-]?(.inf|.Inf|.INF)|.nan|.NaN|.NAN` or any string
+ *   successfully converted using `strtod()`.
+ *
+ * The kind and the converted value of a plain scalar are left in the node for
+ * the loader to cache them.
+ */
+
+static int
+yaml_standard_resolver(void *untyped_data, yaml_incomplete_node_t *node,
+        const yaml_char_t **tag)
+{
+    if (node->type == YAML_SCALAR_NODE && node->data.scalar.is_plain)
+    {
+        node->data.scalar.kind = yaml_classify_scalar(node->data.scalar.value,
+                node->data.scalar.length, &node->data.scalar.converted);
+
+        switch (node->data.scalar.kind)
+        {
+            case YAML_NULL_SCALAR_KIND:
+                *tag = yaml_null_tag;
+                return 1;
+            case YAML_BOOL_SCALAR_KIND:
+                *tag = yaml_bool_tag;
+                return 1;
+            case YAML_INT_SCALAR_KIND:
+                *tag = yaml_int_tag;
+                return 1;
+            case YAML_FLOAT_SCALAR_KIND:
+                *tag = yaml_float_tag;
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    switch (node->type)
+    {
+        case YAML_SCALAR_NODE:
+            *tag = yaml_str_tag;
+            break;
+        case YAML_SEQUENCE_NODE:
+            *tag = yaml_seq_tag;
+            break;
+        case YAML_MAPPING_NODE:
+            *tag = yaml_map_tag;
+            break;
+        default:
+            assert(0);      /* Should never happen. */
+    }
+
+    return 1;
+}
+
+
+/*****************************************************************************
+ * Parser API
+ *****************************************************************************/
+
+/*
+ * Allocate a new parser object.
+ */
+
+YAML_DECLARE(yaml_parser_t *)
+yaml_parser_new(void)
+{
+    yaml_parser_t *parser = yaml_malloc(sizeof(yaml_parser_t));
+
+    if (!parser)
+        return NULL;
+
+    memset(parser, 0, sizeof(yaml_parser_t));
+
+    if (!IOSTRING_INIT(parser, parser->raw_input, RAW_INPUT_BUFFER_CAPACITY))
+        goto error;
+    if (!IOSTRING_INIT(parser, parser->input, INPUT_BUFFER_CAPACITY))
+        goto error;
+    if (!QUEUE_INIT(parser, parser->tokens, INITIAL_QUEUE_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->indents, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->simple_keys, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->states, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->marks, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->tag_directives, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->aliases, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->expansions, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->path, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->pending_items, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(parser, parser->pending_pairs, INITIAL_STACK_CAPACITY))
+        goto error;
+
+    return parser;
+
+error:
     yaml_parser_delete(parser);
 
-    return NULL;
+    return NULL;
+}
+
+/*
+ * Deallocate a parser object.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_delete(yaml_parser_t *parser)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+
+    IOSTRING_DEL(parser, parser->raw_input);
+    if (parser->saved_input.buffer) {
+        IOSTRING_DEL(parser, parser->saved_input);
+    }
+    else {
+        IOSTRING_DEL(parser, parser->input);
+    }
+    while (!QUEUE_EMPTY(parser, parser->tokens)) {
+        yaml_token_clear(&DEQUEUE(parser, parser->tokens));
+    }
+    QUEUE_DEL(parser, parser->tokens);
+    STACK_DEL(parser, parser->indents);
+    STACK_DEL(parser, parser->simple_keys);
+    yaml_pool_clear(&parser->pool);
+    QUEUE_DEL(parser, parser->checkpoint.tokens);
+    STACK_DEL(parser, parser->checkpoint.indents);
+    STACK_DEL(parser, parser->checkpoint.simple_keys);
+    STACK_DEL(parser, parser->states);
+    STACK_DEL(parser, parser->marks);
+    while (!STACK_EMPTY(parser, parser->tag_directives)) {
+        yaml_tag_directive_t tag_directive = POP(parser, parser->tag_directives);
+        yaml_free(tag_directive.handle);
+        yaml_free(tag_directive.prefix);
+    }
+    STACK_DEL(parser, parser->tag_directives);
+    yaml_event_clear(&parser->pending_event);
+    STACK_DEL(parser, parser->aliases);
+    yaml_free(parser->alias_index.list);
+    STACK_DEL(parser, parser->expansions);
+    STACK_DEL(parser, parser->path);
+    yaml_free(parser->tag_index.list);
+    STACK_DEL(parser, parser->pending_items);
+    STACK_DEL(parser, parser->pending_pairs);
+    yaml_parser_unmap_input(parser);
+
+    memset(parser, 0, sizeof(yaml_parser_t));
+
+    yaml_free(parser);
+}
+
+/*
+ * Reset a parser object.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_reset(yaml_parser_t *parser)
+{
+    yaml_parser_t copy = *parser;
+
+    assert(parser); /* Non-NULL parser object expected. */
+
+    while (!QUEUE_EMPTY(parser, parser->tokens)) {
+        yaml_token_clear(&DEQUEUE(parser, parser->tokens));
+    }
+    while (!STACK_EMPTY(parser, parser->tag_directives)) {
+        yaml_tag_directive_t tag_directive = POP(parser, parser->tag_directives);
+        yaml_free(tag_directive.handle);
+        yaml_free(tag_directive.prefix);
+    }
+    yaml_event_clear(&parser->pending_event);
+    yaml_parser_unmap_input(parser);
+
+    memset(parser, 0, sizeof(yaml_parser_t));
+
+    IOSTRING_SET(parser, parser->raw_input,
+            copy.raw_input.buffer, copy.raw_input.capacity);
+    if (copy.saved_input.buffer) {
+        IOSTRING_SET(parser, parser->input,
+                copy.saved_input.buffer, copy.saved_input.capacity);
+    }
+    else {
+        IOSTRING_SET(parser, parser->input,
+                copy.input.buffer, copy.input.capacity);
+    }
+    QUEUE_SET(parser, parser->tokens,
+            copy.tokens.list, copy.tokens.capacity);
+    STACK_SET(parser, parser->indents,
+            copy.indents.list, copy.indents.capacity);
+    STACK_SET(parser, parser->simple_keys,
+            copy.simple_keys.list, copy.simple_keys.capacity);
+    parser->pool = copy.pool;
+#if YAML_STATS
+    parser->pool.allocations = 0;
+    parser->pool.allocated_bytes = 0;
+#endif
+    QUEUE_SET(parser, parser->checkpoint.tokens,
+            copy.checkpoint.tokens.list, copy.checkpoint.tokens.capacity);
+    STACK_SET(parser, parser->checkpoint.indents,
+            copy.checkpoint.indents.list, copy.checkpoint.indents.capacity);
+    STACK_SET(parser, parser->checkpoint.simple_keys,
+            copy.checkpoint.simple_keys.list,
+            copy.checkpoint.simple_keys.capacity);
+    STACK_SET(parser, parser->states,
+            copy.states.list, copy.states.capacity);
+    STACK_SET(parser, parser->marks,
+            copy.marks.list, copy.marks.capacity);
+    STACK_SET(parse, parser->tag_directives,
+            copy.tag_directives.list, copy.tag_directives.capacity);
+    STACK_SET(parser, parser->aliases,
+            copy.aliases.list, copy.aliases.capacity);
+    if (copy.alias_index.list) {
+        memset(copy.alias_index.list, 0xFF,
+                copy.alias_index.capacity*sizeof(int));
+    }
+    parser->alias_index.list = copy.alias_index.list;
+    parser->alias_index.capacity = copy.alias_index.capacity;
+    STACK_SET(parser, parser->expansions,
+            copy.expansions.list, copy.expansions.capacity);
+    STACK_SET(parser, parser->path,
+            copy.path.list, copy.path.capacity);
+    if (copy.tag_index.list) {
+        memset(copy.tag_index.list, 0xFF,
+                copy.tag_index.capacity*sizeof(int));
+    }
+    parser->tag_index.list = copy.tag_index.list;
+    parser->tag_index.capacity = copy.tag_index.capacity;
+    STACK_SET(parser, parser->pending_items,
+            copy.pending_items.list, copy.pending_items.capacity);
+    STACK_SET(parser, parser->pending_pairs,
+            copy.pending_pairs.list, copy.pending_pairs.capacity);
+}
+
+/*
+ * Get the current parser error.
+ */
+
+YAML_DECLARE(yaml_error_t *)
+yaml_parser_get_error(yaml_parser_t *parser)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+
+    return &(parser->error);
+}
+
+/*
+ * Get the parser statistics.
+ */
+
+YAML_DECLARE(const yaml_parser_stats_t *)
+yaml_parser_get_stats(yaml_parser_t *parser)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+
+#if YAML_STATS
+    /* Copy the counters the parser keeps anyway. */
+
+    parser->stats.bytes_decoded = parser->offset;
+    parser->stats.tokens = parser->tokens_parsed;
+    parser->stats.allocations = parser->pool.allocations;
+    parser->stats.allocated_bytes = parser->pool.allocated_bytes;
+#endif
+
+    return &(parser->stats);
+}
+
+/*
+ * Set a string input.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_string_reader(yaml_parser_t *parser,
+        const unsigned char *buffer, size_t length)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->reader);    /* You can set the input handler only once. */
+    assert(buffer); /* Non-NULL input string expected. */
+
+    parser->reader = yaml_string_reader;
+    parser->reader_data = &(parser->standard_reader_data);
+    parser->is_in_place = 1;
+
+    parser->standard_reader_data.string.buffer = buffer;
+    parser->standard_reader_data.string.pointer = 0;
+    parser->standard_reader_data.string.length = length;
+}
+
+/*
+ * Set a file input.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_file_reader(yaml_parser_t *parser, FILE *file)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->reader);    /* You can set the input handler only once. */
+    assert(file);   /* Non-NULL file object expected. */
+
+    parser->reader = yaml_file_reader;
+    parser->reader_data = &(parser->standard_reader_data);
+
+    parser->standard_reader_data.file = file;
+}
+
+/*
+ * Set a memory-mapped file input.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_mmap_reader(yaml_parser_t *parser, int fd)
+{
+#if HAVE_MMAP
+    struct stat st;
+#endif
+
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->reader);    /* You can set the input handler only once. */
+    assert(fd >= 0);    /* Valid file descriptor expected. */
+
+#if HAVE_MMAP
+
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode)
+            && st.st_size >= 0 && (off_t)(size_t)st.st_size == st.st_size)
+    {
+        void *mapping;
+
+        /* An empty file cannot be mapped, but there is nothing to read. */
+
+        if (!st.st_size) {
+            yaml_parser_set_string_reader(parser,
+                    (const unsigned char *)"", 0);
+            return;
+        }
+
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+#ifdef MADV_SEQUENTIAL
+            madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+#endif
+            yaml_parser_set_string_reader(parser,
+                    (const unsigned char *)mapping, st.st_size);
+            parser->standard_reader_data.mapping = mapping;
+            parser->standard_reader_data.mapping_length = st.st_size;
+            return;
+        }
+    }
+
+#endif
+
+    parser->reader = yaml_fd_reader;
+    parser->reader_data = &(parser->standard_reader_data);
+
+    parser->standard_reader_data.fd = fd;
+}
+
+/*
+ * Set a generic input.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_reader(yaml_parser_t *parser,
+        yaml_reader_t *reader, void *data)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->reader);    /* You can set the input handler only once. */
+    assert(reader); /* Non-NULL read handler expected. */
+
+    parser->reader = reader;
+    parser->reader_data = data;
+}
+
+/*
+ * Feed a part of the input.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_feed(yaml_parser_t *parser,
+        const unsigned char *buffer, size_t length, int is_final)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->reader || parser->reader == yaml_push_reader);
+                    /* You can either set the input handler or feed input. */
+    assert(!parser->is_final);  /* No input could be fed after the last part. */
+    assert(buffer || !length);  /* Non-NULL input expected. */
+
+    parser->reader = yaml_push_reader;
+    parser->reader_data = NULL;
+    parser->is_push = 1;
+
+    /* Move the remaining bytes in the raw buffer to the beginning. */
+
+    if (parser->raw_input.pointer > 0) {
+        memmove(parser->raw_input.buffer,
+                parser->raw_input.buffer + parser->raw_input.pointer,
+                parser->raw_input.length - parser->raw_input.pointer);
+        parser->raw_input.length -= parser->raw_input.pointer;
+        parser->raw_input.pointer = 0;
+    }
+
+    /* Extend the raw buffer to hold the new bytes. */
+
+    if (length > parser->raw_input.capacity - parser->raw_input.length)
+    {
+        size_t capacity = parser->raw_input.capacity;
+        unsigned char *raw_buffer;
+
+        if (length > ((size_t)-1)/2 - parser->raw_input.length)
+            return MEMORY_ERROR_INIT(parser);
+
+        while (capacity < parser->raw_input.length + length) {
+            capacity *= 2;
+        }
+
+        raw_buffer = yaml_realloc(parser->raw_input.buffer, capacity);
+        if (!raw_buffer)
+            return MEMORY_ERROR_INIT(parser);
+        parser->raw_input.buffer = raw_buffer;
+        parser->raw_input.capacity = capacity;
+    }
+
+    if (length) {
+        memcpy(parser->raw_input.buffer + parser->raw_input.length,
+                buffer, length);
+        parser->raw_input.length += length;
+        parser->is_fed = 1;
+        STATS_COUNT(parser, bytes_read, length);
+    }
+
+    parser->is_final = (is_final != 0);
+
+    return 1;
+}
+
+/*
+ * Check if the parser waits for more input.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_is_input_needed(yaml_parser_t *parser)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+
+    return parser->is_input_needed;
+}
+
+/*
+ * Set a standard tag resolver.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_standard_resolver(yaml_parser_t *parser)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->resolver);  /* You can set the tag resolver only once. */
+
+    parser->resolver = yaml_standard_resolver;
+    parser->resolver_data = NULL;
+}
+
+/*
+ * Set a generic tag resolver.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_set_resolver(yaml_parser_t *parser,
+        yaml_resolver_t *resolver, void *data)
+{
+    assert(parser);     /* Non-NULL parser object expected. */
+    assert(!parser->resolver);  /* You can set the tag resolver only once. */
+    assert(resolver);   /* Non-NULL resolver is expected. */
+
+    parser->resolver = resolver;
+    parser->resolver_data = data;
 }
 
 /*
- * Deallocate a parser object.
+ * Set the source encoding.
  */
 
 YAML_DECLARE(void)
-yaml_parser_delete(yaml_parser_t *parser)
+yaml_parser_set_encoding(yaml_parser_t *parser, yaml_encoding_t encoding)
 {
     assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->encoding);  /* Encoding is already set or detected. */
 
-    IOSTRING_DEL(parser, parser->raw_input);
-    IOSTRING_DEL(parser, parser->input);
-    while (!QUEUE_EMPTY(parser, parser->tokens)) {
-        yaml_token_destroy(&DEQUEUE(parser, parser->tokens));
-    }
-    QUEUE_DEL(parser, parser->tokens);
-    STACK_DEL(parser, parser->indents);
-    STACK_DEL(parser, parser->simple_keys);
-    STACK_DEL(parser, parser->states);
-    STACK_DEL(parser, parser->marks);
-    while (!STACK_EMPTY(parser, parser->tag_directives)) {
-        yaml_tag_directive_t tag_directive = POP(parser, parser->tag_directives);
-        yaml_free(tag_directive.handle);
-        yaml_free(tag_directive.prefix);
-    }
-    STACK_DEL(parser, parser->tag_directives);
-
-    memset(parser, 0, sizeof(yaml_parser_t));
-
-    yaml_free(parser);
+    parser->encoding = encoding;
 }
 
 /*
- * Reset a parser object.
+ * Set the document allocator.
  */
 
 YAML_DECLARE(void)
-yaml_parser_reset(yaml_parser_t *parser)
+yaml_parser_set_allocator(yaml_parser_t *parser,
+        const yaml_allocator_t *allocator)
 {
-    yaml_parser_t copy = *parser;
-
     assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->document);  /* No document could be in progress. */
 
-    while (!QUEUE_EMPTY(parser, parser->tokens)) {
-        yaml_token_destroy(&DEQUEUE(parser, parser->tokens));
+    if (allocator) {
+        parser->allocator = *allocator;
     }
-    while (!STACK_EMPTY(parser, parser->tag_directives)) {
-        yaml_tag_directive_t tag_directive = POP(parser, parser->tag_directives);
-        yaml_free(tag_directive.handle);
-        yaml_free(tag_directive.prefix);
+    else {
+        memset(&parser->allocator, 0, sizeof(yaml_allocator_t));
     }
+}
 
-    memset(parser, 0, sizeof(yaml_parser_t));
+/*
+ * Set the arena mode.
+ */
 
-    IOSTRING_SET(parser, parser->raw_input,
-            copy.raw_input.buffer, copy.raw_input.capacity);
-    IOSTRING_SET(parser, parser->input,
-            copy.input.buffer, copy.input.capacity);
-    QUEUE_SET(parser, parser->tokens,
-            copy.tokens.list, copy.tokens.capacity);
-    STACK_SET(parser, parser->indents,
-            copy.indents.list, copy.indents.capacity);
-    STACK_SET(parser, parser->simple_keys,
-            copy.simple_keys.list, copy.simple_keys.capacity);
-    STACK_SET(parser, parser->states,
-            copy.states.list, copy.states.capacity);
-    STACK_SET(parser, parser->marks,
-            copy.marks.list, copy.marks.capacity);
-    STACK_SET(parse, parser->tag_directives,
-            copy.tag_directives.list, copy.tag_directives.capacity);
+YAML_DECLARE(void)
+yaml_parser_set_arena(yaml_parser_t *parser, int is_arena)
+{
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->document);  /* No document could be in progress. */
+
+    parser->is_arena = (is_arena != 0);
 }
 
 /*
- * Get the current parser error.
+ * Set the zero-copy mode.
  */
 
-YAML_DECLARE(yaml_error_t *)
-yaml_parser_get_error(yaml_parser_t *parser)
+YAML_DECLARE(void)
+yaml_parser_set_zero_copy(yaml_parser_t *parser, int is_zero_copy)
 {
     assert(parser); /* Non-NULL parser object expected. */
+    assert(!is_zero_copy || parser->reader == yaml_string_reader
+            || parser->reader == yaml_fd_reader);
+                    /* The string or memory-mapped file reader expected. */
 
-    return &(parser->error);
+    parser->is_zero_copy = (is_zero_copy != 0
+            && parser->reader == yaml_string_reader);
 }
 
 /*
- * Set a string input.
+ * Set the compact mode.
  */
 
 YAML_DECLARE(void)
-yaml_parser_set_string_reader(yaml_parser_t *parser,
-        const unsigned char *buffer, size_t length)
+yaml_parser_set_compact(yaml_parser_t *parser, int is_compact)
 {
     assert(parser); /* Non-NULL parser object expected. */
-    assert(!parser->reader);    /* You can set the input handler only once. */
-    assert(buffer); /* Non-NULL input string expected. */
-
-    parser->reader = yaml_string_reader;
-    parser->reader_data = &(parser->standard_reader_data);
+    assert(!parser->document);  /* No document could be in progress. */
 
-    parser->standard_reader_data.string.buffer = buffer;
-    parser->standard_reader_data.string.pointer = 0;
-    parser->standard_reader_data.string.length = length;
+    parser->is_compact = (is_compact != 0);
 }
 
 /*
- * Set a file input.
+ * Set the mark tracking.
  */
 
 YAML_DECLARE(void)
-yaml_parser_set_file_reader(yaml_parser_t *parser, FILE *file)
+yaml_parser_set_mark_tracking(yaml_parser_t *parser, int is_tracking)
 {
     assert(parser); /* Non-NULL parser object expected. */
-    assert(!parser->reader);    /* You can set the input handler only once. */
-    assert(file);   /* Non-NULL file object expected. */
+    assert(!parser->document);  /* No document could be in progress. */
 
-    parser->reader = yaml_file_reader;
-    parser->reader_data = &(parser->standard_reader_data);
-
-    parser->standard_reader_data.file = file;
+    parser->is_markless = (is_tracking == 0);
 }
 
 /*
- * Set a generic input.
+ * Set the duplicate key checking.
  */
 
 YAML_DECLARE(void)
-yaml_parser_set_reader(yaml_parser_t *parser,
-        yaml_reader_t *reader, void *data)
+yaml_parser_set_unique_keys(yaml_parser_t *parser, int is_unique)
 {
     assert(parser); /* Non-NULL parser object expected. */
-    assert(!parser->reader);    /* You can set the input handler only once. */
-    assert(reader); /* Non-NULL read handler expected. */
+    assert(!parser->document);  /* No document could be in progress. */
 
-    parser->reader = reader;
-    parser->reader_data = data;
+    parser->is_unique_keys = (is_unique != 0);
 }
 
 /*
- * Set a standard tag resolver.
+ * Set the alias expansion limits.
  */
 
 YAML_DECLARE(void)
-yaml_parser_set_standard_resolver(yaml_parser_t *parser)
+yaml_parser_set_expansion_limits(yaml_parser_t *parser,
+        size_t max_nodes, size_t max_depth)
 {
     assert(parser); /* Non-NULL parser object expected. */
-    assert(!parser->resolver);  /* You can set the tag resolver only once. */
 
-    parser->resolver = yaml_standard_resolver;
-    parser->resolver_data = NULL;
+    parser->max_expanded_nodes = max_nodes;
+    parser->max_expanded_depth = max_depth;
 }
 
 /*
- * Set a generic tag resolver.
+ * Set the size of the input buffers.
  */
 
-YAML_DECLARE(void)
-yaml_parser_set_resolver(yaml_parser_t *parser,
-        yaml_resolver_t *resolver, void *data)
+YAML_DECLARE(int)
+yaml_parser_set_buffer_size(yaml_parser_t *parser,
+        size_t size, size_t max_size)
 {
-    assert(parser);     /* Non-NULL parser object expected. */
-    assert(!parser->resolver);  /* You can set the tag resolver only once. */
-    assert(resolver);   /* Non-NULL resolver is expected. */
+    assert(parser); /* Non-NULL parser object expected. */
+    assert(!parser->raw_input.length && !parser->input.length
+            && !parser->saved_input.buffer && !parser->is_eof);
+                    /* No input could be read yet. */
 
-    parser->resolver = resolver;
-    parser->resolver_data = data;
+    if (size < MIN_RAW_INPUT_BUFFER_CAPACITY) {
+        size = MIN_RAW_INPUT_BUFFER_CAPACITY;
+    }
+    if (max_size && max_size < size) {
+        max_size = size;
+    }
+    if (size > ((size_t)-1)/3 || max_size > ((size_t)-1)/3)
+        return MEMORY_ERROR_INIT(parser);
+
+    if (size != parser->raw_input.capacity)
+    {
+        IOSTRING_DEL(parser, parser->raw_input);
+        IOSTRING_DEL(parser, parser->input);
+
+        if (!IOSTRING_INIT(parser, parser->raw_input, size))
+            return 0;
+        if (!IOSTRING_INIT(parser, parser->input, size*3))
+            return 0;
+    }
+
+    parser->max_raw_input_capacity = max_size;
+
+    return 1;
 }
 
 /*
- * Set the source encoding.
+ * Set the use of the JSON scanner.
  */
 
 YAML_DECLARE(void)
-yaml_parser_set_encoding(yaml_parser_t *parser, yaml_encoding_t encoding)
+yaml_parser_set_json_mode(yaml_parser_t *parser, yaml_json_mode_t mode)
 {
     assert(parser); /* Non-NULL parser object expected. */
-    assert(!parser->encoding);  /* Encoding is already set or detected. */
+    assert(!parser->is_stream_start_produced);
+                    /* No input could be scanned yet. */
 
-    parser->encoding = encoding;
+    parser->json_mode = mode;
 }
 
 /*****************************************************************************
@@ -2435,6 +4722,8 @@ yaml_emitter_new(void)
         goto error;
     if (!STACK_INIT(emitter, emitter->tag_directives, INITIAL_STACK_CAPACITY))
         goto error;
+    if (!STACK_INIT(emitter, emitter->vectors, INITIAL_STACK_CAPACITY))
+        goto error;
 
     return emitter;
 
@@ -2457,17 +4746,19 @@ yaml_emitter_delete(yaml_emitter_t *emitter)
     IOSTRING_DEL(emitter, emitter->raw_output);
     STACK_DEL(emitter, emitter->states);
     while (!QUEUE_EMPTY(emitter, emitter->events)) {
-        yaml_event_destroy(&DEQUEUE(emitter, emitter->events));
+        yaml_event_clear(&DEQUEUE(emitter, emitter->events));
     }
     QUEUE_DEL(emitter, emitter->events);
     STACK_DEL(emitter, emitter->indents);
     while (!STACK_EMPTY(empty, emitter->tag_directives)) {
         yaml_tag_directive_t tag_directive = POP(emitter, emitter->tag_directives);
-        yaml_free(tag_directive.handle);
-        yaml_free(tag_directive.prefix);
+        yaml_allocator_free(&emitter->allocator, tag_directive.handle);
+        yaml_allocator_free(&emitter->allocator, tag_directive.prefix);
     }
     STACK_DEL(emitter, emitter->tag_directives);
-    yaml_free(emitter->anchors);
+    STACK_DEL(emitter, emitter->vectors);
+    yaml_allocator_free(&emitter->allocator, emitter->anchors);
+    yaml_allocator_free(&emitter->allocator, emitter->anchor_names);
 
     memset(emitter, 0, sizeof(yaml_emitter_t));
     yaml_free(emitter);
@@ -2485,12 +4776,12 @@ yaml_emitter_reset(yaml_emitter_t *emitter)
     assert(emitter);    /* Non-NULL emitter object expected. */
 
     while (!QUEUE_EMPTY(emitter, emitter->events)) {
-        yaml_event_destroy(&DEQUEUE(emitter, emitter->events));
+        yaml_event_clear(&DEQUEUE(emitter, emitter->events));
     }
     while (!STACK_EMPTY(empty, emitter->tag_directives)) {
         yaml_tag_directive_t tag_directive = POP(emitter, emitter->tag_directives);
-        yaml_free(tag_directive.handle);
-        yaml_free(tag_directive.prefix);
+        yaml_allocator_free(&emitter->allocator, tag_directive.handle);
+        yaml_allocator_free(&emitter->allocator, tag_directive.prefix);
     }
 
     memset(emitter, 0, sizeof(yaml_emitter_t));
@@ -2507,6 +4798,8 @@ yaml_emitter_reset(yaml_emitter_t *emitter)
             copy.indents.list, copy.indents.capacity);
     STACK_SET(emitter, emitter->tag_directives,
             copy.tag_directives.list, copy.tag_directives.capacity);
+    STACK_SET(emitter, emitter->vectors,
+            copy.vectors.list, copy.vectors.capacity);
 }
 
 /*
@@ -2521,6 +4814,24 @@ yaml_emitter_get_error(yaml_emitter_t *emitter)
     return &(emitter->error);
 }
 
+/*
+ * Get the emitter statistics.
+ */
+
+YAML_DECLARE(const yaml_emitter_stats_t *)
+yaml_emitter_get_stats(yaml_emitter_t *emitter)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+
+#if YAML_STATS
+    /* Copy the counter the emitter keeps anyway. */
+
+    emitter->stats.bytes_written = emitter->offset;
+#endif
+
+    return &(emitter->stats);
+}
+
 /*
  * Set a string output.
  */
@@ -2530,7 +4841,8 @@ yaml_emitter_set_string_writer(yaml_emitter_t *emitter,
         unsigned char *buffer, size_t capacity, size_t *length)
 {
     assert(emitter);    /* Non-NULL emitter object expected. */
-    assert(!emitter->writer);   /* You can set the output only once. */
+    assert(!emitter->writer && !emitter->vector_writer);
+                        /* You can set the output only once. */
     assert(buffer);     /* Non-NULL output string expected. */
 
     emitter->writer = yaml_string_writer;
@@ -2552,15 +4864,34 @@ YAML_DECLARE(void)
 yaml_emitter_set_file_writer(yaml_emitter_t *emitter, FILE *file)
 {
     assert(emitter);    /* Non-NULL emitter object expected. */
-    assert(!emitter->writer);   /* You can set the output only once. */
+    assert(!emitter->writer && !emitter->vector_writer);
+                        /* You can set the output only once. */
     assert(file);       /* Non-NULL file object expected. */
 
-    emitter->writer = yaml_string_writer;
+    emitter->writer = yaml_file_writer;
     emitter->writer_data = &(emitter->standard_writer_data);
 
     emitter->standard_writer_data.file = file;
 }
 
+/*
+ * Set a file descriptor output.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_fd_writer(yaml_emitter_t *emitter, int fd)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+    assert(!emitter->writer && !emitter->vector_writer);
+                        /* You can set the output only once. */
+    assert(fd >= 0);    /* Valid file descriptor expected. */
+
+    emitter->vector_writer = yaml_fd_writer;
+    emitter->vector_writer_data = &(emitter->standard_writer_data);
+
+    emitter->standard_writer_data.fd = fd;
+}
+
 /*
  * Set a generic output handler.
  */
@@ -2570,13 +4901,60 @@ yaml_emitter_set_writer(yaml_emitter_t *emitter,
         yaml_writer_t *writer, void *data)
 {
     assert(emitter);    /* Non-NULL emitter object expected. */
-    assert(!emitter->writer);   /* You can set the output only once. */
+    assert(!emitter->writer && !emitter->vector_writer);
+                        /* You can set the output only once. */
     assert(writer); /* Non-NULL handler object expected. */
 
     emitter->writer = writer;
     emitter->writer_data = data;
 }
 
+/*
+ * Set a generic vector output handler.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_vector_writer(yaml_emitter_t *emitter,
+        yaml_vector_writer_t *writer, void *data)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+    assert(!emitter->writer && !emitter->vector_writer);
+                        /* You can set the output only once. */
+    assert(writer); /* Non-NULL handler object expected. */
+
+    emitter->vector_writer = writer;
+    emitter->vector_writer_data = data;
+}
+
+/*
+ * Set an event recycler.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_recycler(yaml_emitter_t *emitter,
+        yaml_recycler_t *recycler, void *data)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+
+    emitter->recycler = recycler;
+    emitter->recycler_data = data;
+}
+
+/*
+ * Set the parser event recycler.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_parser_recycler(yaml_emitter_t *emitter,
+        yaml_parser_t *parser)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+    assert(parser);     /* Non-NULL parser object expected. */
+
+    emitter->recycler = yaml_parser_recycler;
+    emitter->recycler_data = parser;
+}
+
 /*
  * Set a standard tag resolver.
  */
@@ -2620,6 +4998,27 @@ yaml_emitter_set_encoding(yaml_emitter_t *emitter, yaml_encoding_t encoding)
     emitter->encoding = encoding;
 }
 
+/*
+ * Set the emitter allocator.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_allocator(yaml_emitter_t *emitter,
+        const yaml_allocator_t *allocator)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+    assert(!emitter->document); /* No document could be in progress. */
+    assert(STACK_EMPTY(emitter, emitter->tag_directives));
+                        /* The emitter must be between documents. */
+
+    if (allocator) {
+        emitter->allocator = *allocator;
+    }
+    else {
+        memset(&emitter->allocator, 0, sizeof(yaml_allocator_t));
+    }
+}
+
 /*
  * Set the canonical output style.
  */
@@ -2668,6 +5067,18 @@ yaml_emitter_set_unicode(yaml_emitter_t *emitter, int is_unicode)
     emitter->is_unicode = (is_unicode != 0);
 }
 
+/*
+ * Set if the emitted documents have no shared nodes.
+ */
+
+YAML_DECLARE(void)
+yaml_emitter_set_tree(yaml_emitter_t *emitter, int is_tree)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+
+    emitter->is_tree = (is_tree != 0);
+}
+
 /*
  * Set the preferred line break character.
  */
@@ -2680,3 +5091,97 @@ yaml_emitter_set_break(yaml_emitter_t *emitter, yaml_break_t line_break)
     emitter->line_break = line_break;
 }
 
+/*
+ * Set the size of the output buffer.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_set_buffer_size(yaml_emitter_t *emitter, size_t size)
+{
+    assert(emitter);    /* Non-NULL emitter object expected. */
+    assert(!emitter->output.pointer && !emitter->offset);
+                        /* No output could be produced yet. */
+
+    if (size < MIN_OUTPUT_BUFFER_CAPACITY) {
+        size = MIN_OUTPUT_BUFFER_CAPACITY;
+    }
+    if (size > (((size_t)-1)-2)/2)
+        return MEMORY_ERROR_INIT(emitter);
+
+    if (size != emitter->output.capacity)
+    {
+        IOSTRING_DEL(emitter, emitter->output);
+        IOSTRING_DEL(emitter, emitter->raw_output);
+
+        if (!IOSTRING_INIT(emitter, emitter->output, size))
+            return 0;
+        if (!IOSTRING_INIT(emitter, emitter->raw_output, size*2+2))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*****************************************************************************
+ * Selector API
+ *****************************************************************************/
+
+/*
+ * Allocate a selector object.
+ */
+
+YAML_DECLARE(yaml_selector_t *)
+yaml_selector_new(void)
+{
+    yaml_selector_t *selector = yaml_malloc(sizeof(yaml_selector_t));
+
+    if (!selector)
+        return NULL;
+
+    memset(selector, 0, sizeof(yaml_selector_t));
+    if (!STACK_INIT(selector, selector->steps, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(selector, selector->frames, INITIAL_STACK_CAPACITY))
+        goto error;
+    if (!STACK_INIT(selector, selector->matches, INITIAL_STACK_CAPACITY))
+        goto error;
+
+    selector->is_compiled = 1;
+
+    return selector;
+
+error:
+    yaml_selector_delete(selector);
+
+    return NULL;
+}
+
+/*
+ * Deallocate a selector object.
+ */
+
+YAML_DECLARE(void)
+yaml_selector_delete(yaml_selector_t *selector)
+{
+    assert(selector);   /* Non-NULL selector object expected. */
+
+    yaml_free(selector->path);
+    STACK_DEL(selector, selector->steps);
+    STACK_DEL(selector, selector->frames);
+    STACK_DEL(selector, selector->matches);
+
+    memset(selector, 0, sizeof(yaml_selector_t));
+    yaml_free(selector);
+}
+
+/*
+ * Get the current selector error.
+ */
+
+YAML_DECLARE(yaml_error_t *)
+yaml_selector_get_error(yaml_selector_t *selector)
+{
+    assert(selector);   /* Non-NULL selector object expected. */
+
+    return &(selector->error);
+}
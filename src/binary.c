@@ -0,0 +1,967 @@
+
+#include "yaml_private.h"
+
+/*
+ * The image signature and the format version.
+ */
+
+#define BINARY_IMAGE_MAGIC      "YAMLBIN\n"
+#define BINARY_IMAGE_FORMAT     2
+
+/*
+ * The byte order marker.
+ */
+
+#define BINARY_IMAGE_BYTE_ORDER 0x01020304U
+
+/*
+ * The alignment of the image and its sections.
+ */
+
+#define BINARY_IMAGE_ALIGNMENT  sizeof(size_t)
+
+/*
+ * The document flags.
+ */
+
+#define BINARY_IMAGE_VERSION_FLAG           1
+#define BINARY_IMAGE_START_IMPLICIT_FLAG    2
+#define BINARY_IMAGE_END_IMPLICIT_FLAG      4
+
+/*
+ * The tag offset of a node without a tag.
+ */
+
+#define BINARY_IMAGE_NO_TAG     ((size_t)-1)
+
+/*
+ * The size of the output buffer.
+ */
+
+#define BINARY_IMAGE_BUFFER_SIZE    16384
+
+/*
+ * The buffered image output.
+ */
+
+typedef struct yaml_binary_output_s {
+
+    /* The write handler. */
+    yaml_writer_t *writer;
+
+    /* The application data to be passed to the writer. */
+    void *data;
+
+    /* The number of bytes written so far. */
+    size_t offset;
+
+    /* The number of bytes in the buffer. */
+    size_t length;
+
+    /* The buffered bytes. */
+    unsigned char buffer[BINARY_IMAGE_BUFFER_SIZE];
+
+} yaml_binary_output_t;
+
+/*
+ * The distinct tags of a regular document being saved.
+ */
+
+typedef struct yaml_binary_tags_s {
+
+    /* The tags in the order of their ids. */
+    struct {
+        yaml_char_t **list;
+        size_t length;
+        size_t capacity;
+    } list;
+
+    /*
+     * An open addressing hash table of the tag ids plus one, `0` marks an
+     * empty slot.  The capacity is a power of 2.
+     */
+    struct {
+        int *list;
+        size_t length;
+        size_t capacity;
+    } index;
+
+} yaml_binary_tags_t;
+
+/*
+ * API functions.
+ */
+
+YAML_DECLARE(int)
+yaml_document_save_binary(yaml_document_t *document,
+        const unsigned char *source, size_t source_length,
+        yaml_writer_t *writer, void *data);
+
+YAML_DECLARE(int)
+yaml_document_load_binary(yaml_document_t *document,
+        const unsigned char *image, size_t size,
+        const unsigned char *source, size_t source_length);
+
+/*
+ * Layout.
+ */
+
+static int
+yaml_binary_layout(const yaml_binary_header_t *header, size_t *sections);
+
+/*
+ * Output.
+ */
+
+static int
+yaml_binary_write(yaml_binary_output_t *output,
+        const void *bytes, size_t length);
+
+static int
+yaml_binary_write_size(yaml_binary_output_t *output, size_t value);
+
+static int
+yaml_binary_pad(yaml_binary_output_t *output, size_t offset);
+
+static int
+yaml_binary_flush(yaml_binary_output_t *output);
+
+/*
+ * Saving.
+ */
+
+static int
+yaml_binary_collect_tags(yaml_document_t *document,
+        yaml_binary_tags_t *tags, int *tag_ids);
+
+static int
+yaml_binary_write_nodes(yaml_binary_output_t *output,
+        yaml_document_t *document, yaml_binary_section_t section);
+
+static int
+yaml_binary_write_tags(yaml_binary_output_t *output,
+        yaml_char_t **tags, size_t length, int is_offsets);
+
+/*
+ * Loading.
+ */
+
+static int
+yaml_binary_check_nodes(const yaml_binary_header_t *header,
+        const unsigned char *image, const size_t *sections);
+
+static int
+yaml_binary_check_strings(const unsigned char *strings, size_t size,
+        size_t count);
+
+/*
+ * Compute the section offsets of an image.  `sections` gets the offsets of
+ * all the sections up to `YAML_BINARY_END_SECTION`, which is the image size.
+ * This function fails if the image size does not fit in `size_t`.
+ */
+
+static int
+yaml_binary_layout(const yaml_binary_header_t *header, size_t *sections)
+{
+    size_t counts[YAML_BINARY_END_SECTION];
+    size_t widths[YAML_BINARY_END_SECTION];
+    size_t offset = sizeof(yaml_binary_header_t);
+    int section;
+
+    counts[YAML_BINARY_OFFSETS_SECTION] = header->nodes;
+    widths[YAML_BINARY_OFFSETS_SECTION] = sizeof(size_t);
+    counts[YAML_BINARY_LENGTHS_SECTION] = header->nodes;
+    widths[YAML_BINARY_LENGTHS_SECTION] = sizeof(size_t);
+    counts[YAML_BINARY_TAG_OFFSETS_SECTION] = header->tags;
+    widths[YAML_BINARY_TAG_OFFSETS_SECTION] = sizeof(size_t);
+    counts[YAML_BINARY_TAG_IDS_SECTION] = header->nodes;
+    widths[YAML_BINARY_TAG_IDS_SECTION] = sizeof(int);
+    counts[YAML_BINARY_ITEMS_SECTION] = header->items;
+    widths[YAML_BINARY_ITEMS_SECTION] = sizeof(yaml_node_item_t);
+    counts[YAML_BINARY_PAIRS_SECTION] = header->pairs;
+    widths[YAML_BINARY_PAIRS_SECTION] = sizeof(yaml_node_pair_t);
+    counts[YAML_BINARY_TYPES_SECTION] = header->nodes;
+    widths[YAML_BINARY_TYPES_SECTION] = 1;
+    counts[YAML_BINARY_VALUES_SECTION] = header->values;
+    widths[YAML_BINARY_VALUES_SECTION] = 1;
+    counts[YAML_BINARY_TAGS_SECTION] = header->tag_bytes;
+    widths[YAML_BINARY_TAGS_SECTION] = 1;
+    counts[YAML_BINARY_DIRECTIVES_SECTION] = header->directive_bytes;
+    widths[YAML_BINARY_DIRECTIVES_SECTION] = 1;
+
+    for (section = 0; section < YAML_BINARY_END_SECTION; section ++)
+    {
+        size_t padding = (BINARY_IMAGE_ALIGNMENT
+                - offset % BINARY_IMAGE_ALIGNMENT) % BINARY_IMAGE_ALIGNMENT;
+
+        if (offset > (size_t)-1 - padding)
+            return 0;
+        offset += padding;
+        sections[section] = offset;
+
+        if (counts[section] > ((size_t)-1 - offset) / widths[section])
+            return 0;
+        offset += counts[section] * widths[section];
+    }
+
+    sections[YAML_BINARY_END_SECTION] = offset;
+
+    return 1;
+}
+
+/*
+ * Append bytes to the image output.
+ */
+
+static int
+yaml_binary_write(yaml_binary_output_t *output,
+        const void *bytes, size_t length)
+{
+    output->offset += length;
+
+    if (output->length + length <= BINARY_IMAGE_BUFFER_SIZE) {
+        memcpy(output->buffer + output->length, bytes, length);
+        output->length += length;
+        return 1;
+    }
+
+    /* Long runs bypass the buffer. */
+
+    if (!yaml_binary_flush(output))
+        return 0;
+
+    if (length > BINARY_IMAGE_BUFFER_SIZE)
+        return output->writer(output->data,
+                (const unsigned char *)bytes, length);
+
+    memcpy(output->buffer, bytes, length);
+    output->length = length;
+
+    return 1;
+}
+
+/*
+ * Append a number to the image output.
+ */
+
+static int
+yaml_binary_write_size(yaml_binary_output_t *output, size_t value)
+{
+    return yaml_binary_write(output, &value, sizeof(size_t));
+}
+
+/*
+ * Append zero bytes to the image output up to the given offset.
+ */
+
+static int
+yaml_binary_pad(yaml_binary_output_t *output, size_t offset)
+{
+    static const unsigned char zeros[BINARY_IMAGE_ALIGNMENT];
+
+    assert(offset >= output->offset &&
+            offset - output->offset < BINARY_IMAGE_ALIGNMENT);
+                            /* The sections are written in order. */
+
+    return yaml_binary_write(output, zeros, offset - output->offset);
+}
+
+/*
+ * Pass the buffered bytes to the write handler.
+ */
+
+static int
+yaml_binary_flush(yaml_binary_output_t *output)
+{
+    if (!output->length)
+        return 1;
+
+    if (!output->writer(output->data, output->buffer, output->length))
+        return 0;
+
+    output->length = 0;
+
+    return 1;
+}
+
+/*
+ * Save a document as a binary image.
+ */
+
+YAML_DECLARE(int)
+yaml_document_save_binary(yaml_document_t *document,
+        const unsigned char *source, size_t source_length,
+        yaml_writer_t *writer, void *data)
+{
+    yaml_compact_nodes_t *compact;
+    yaml_binary_header_t header;
+    size_t sections[YAML_BINARY_END_SECTION+1];
+    yaml_binary_output_t *output = NULL;
+    yaml_binary_tags_t tags;
+    yaml_char_t **tag_list;
+    int *tag_ids = NULL;
+    size_t idx;
+    int section;
+
+    assert(document);       /* Non-NULL document object is expected. */
+    assert(document->type); /* Initialized document is expected. */
+    assert(source || !source_length);   /* Valid source is expected. */
+    assert(writer);         /* Non-NULL write handler is expected. */
+
+    memset(&tags, 0, sizeof(yaml_binary_tags_t));
+    memset(&header, 0, sizeof(yaml_binary_header_t));
+
+    memcpy(header.magic, BINARY_IMAGE_MAGIC, sizeof(header.magic));
+    header.format = BINARY_IMAGE_FORMAT;
+    header.byte_order = BINARY_IMAGE_BYTE_ORDER;
+    header.word_size = sizeof(size_t);
+    header.source_hash = yaml_string_hash(source, source_length);
+    header.nodes = document->nodes.length;
+    header.expanded_nodes = document->expanded_nodes;
+    header.expanded_depth = document->expanded_depth;
+
+    if (document->version_directive) {
+        header.flags |= BINARY_IMAGE_VERSION_FLAG;
+        header.major = document->version_directive->major;
+        header.minor = document->version_directive->minor;
+    }
+    if (document->is_start_implicit) {
+        header.flags |= BINARY_IMAGE_START_IMPLICIT_FLAG;
+    }
+    if (document->is_end_implicit) {
+        header.flags |= BINARY_IMAGE_END_IMPLICIT_FLAG;
+    }
+
+    header.tag_directives = document->tag_directives.length;
+    for (idx = 0; idx < document->tag_directives.length; idx ++) {
+        yaml_tag_directive_t *tag_directive = document->tag_directives.list+idx;
+        header.directive_bytes += strlen((char *)tag_directive->handle) + 1
+            + strlen((char *)tag_directive->prefix) + 1;
+    }
+
+    /* A compact document already has the image columns. */
+
+    compact = document->compact;
+
+    if (compact) {
+        tag_list = compact->tags.list;
+        header.tags = compact->tags.length;
+        header.values = compact->values.length;
+        header.items = compact->items.length;
+        header.pairs = compact->pairs.length;
+    }
+    else {
+        tag_ids = yaml_malloc(document->nodes.length*sizeof(int));
+        if (!tag_ids) goto error;
+        if (!yaml_binary_collect_tags(document, &tags, tag_ids))
+            goto error;
+        tag_list = tags.list.list;
+        header.tags = tags.list.length;
+        for (idx = 0; idx < document->nodes.length; idx ++) {
+            yaml_node_t *node = document->nodes.list + idx;
+            switch (node->type) {
+                case YAML_SCALAR_NODE:
+                    header.values += node->data.scalar.length + 1;
+                    break;
+                case YAML_SEQUENCE_NODE:
+                    header.items += node->data.sequence.items.length;
+                    break;
+                case YAML_MAPPING_NODE:
+                    header.pairs += node->data.mapping.pairs.length;
+                    break;
+                default:
+                    assert(0);  /* Should not happen. */
+            }
+        }
+    }
+
+    for (idx = 0; idx < header.tags; idx ++) {
+        if (tag_list[idx]) {
+            header.tag_bytes += strlen((char *)tag_list[idx]) + 1;
+        }
+    }
+
+    if (!yaml_binary_layout(&header, sections))
+        goto error;
+
+    header.size = sections[YAML_BINARY_END_SECTION];
+
+    output = yaml_malloc(sizeof(yaml_binary_output_t));
+    if (!output) goto error;
+
+    output->writer = writer;
+    output->data = data;
+    output->offset = 0;
+    output->length = 0;
+
+    if (!yaml_binary_write(output, &header, sizeof(yaml_binary_header_t)))
+        goto error;
+
+    for (section = 0; section < YAML_BINARY_END_SECTION; section ++)
+    {
+        if (!yaml_binary_pad(output, sections[section]))
+            goto error;
+
+        switch (section)
+        {
+            case YAML_BINARY_TAG_OFFSETS_SECTION:
+                if (!yaml_binary_write_tags(output, tag_list, header.tags, 1))
+                    goto error;
+                break;
+
+            case YAML_BINARY_TAGS_SECTION:
+                if (!yaml_binary_write_tags(output, tag_list, header.tags, 0))
+                    goto error;
+                break;
+
+            case YAML_BINARY_DIRECTIVES_SECTION:
+                for (idx = 0; idx < document->tag_directives.length; idx ++) {
+                    yaml_tag_directive_t *tag_directive =
+                        document->tag_directives.list + idx;
+                    if (!yaml_binary_write(output, tag_directive->handle,
+                                strlen((char *)tag_directive->handle) + 1)
+                            || !yaml_binary_write(output, tag_directive->prefix,
+                                strlen((char *)tag_directive->prefix) + 1))
+                        goto error;
+                }
+                break;
+
+            case YAML_BINARY_TAG_IDS_SECTION:
+                if (!compact) {
+                    if (!yaml_binary_write(output, tag_ids,
+                                header.nodes*sizeof(int)))
+                        goto error;
+                    break;
+                }
+
+                /* Fall through. */
+
+            default:
+                if (!yaml_binary_write_nodes(output, document,
+                            (yaml_binary_section_t)section))
+                    goto error;
+        }
+
+    }
+
+    assert(output->offset == header.size);
+                            /* The sections match the layout. */
+
+    if (!yaml_binary_flush(output))
+        goto error;
+
+    yaml_free(output);
+    yaml_free(tag_ids);
+    STACK_DEL(document, tags.list);
+    STACK_DEL(document, tags.index);
+
+    return 1;
+
+error:
+    yaml_free(output);
+    yaml_free(tag_ids);
+    STACK_DEL(document, tags.list);
+    STACK_DEL(document, tags.index);
+
+    return 0;
+}
+
+/*
+ * Assign the ids to the distinct tags of a regular document.
+ */
+
+static int
+yaml_binary_collect_tags(yaml_document_t *document,
+        yaml_binary_tags_t *tags, int *tag_ids)
+{
+    struct {
+        yaml_error_t error;
+    } self;
+    size_t idx;
+
+    if (!STACK_INIT(&self, tags->list, INITIAL_STACK_CAPACITY))
+        return 0;
+    if (!STACK_INIT(&self, tags->index, INITIAL_STACK_CAPACITY))
+        return 0;
+
+    memset(tags->index.list, 0, tags->index.capacity*sizeof(int));
+
+    for (idx = 0; idx < document->nodes.length; idx ++)
+    {
+        yaml_char_t *tag = document->nodes.list[idx].tag;
+        size_t length = tag ? strlen((char *)tag) : 0;
+        size_t mask = tags->index.capacity - 1;
+        size_t slot = yaml_string_hash(tag, length) & mask;
+
+        /* A missing tag takes the first slot that compares with `NULL`. */
+
+        while (tags->index.list[slot]) {
+            yaml_char_t *other = tags->list.list[tags->index.list[slot]-1];
+            if (tag ? (other && strcmp((char *)tag, (char *)other) == 0)
+                    : !other)
+                break;
+            slot = (slot+1) & mask;
+        }
+
+        if (tags->index.list[slot]) {
+            tag_ids[idx] = tags->index.list[slot] - 1;
+            continue;
+        }
+
+        if (!PUSH(&self, tags->list, tag))
+            return 0;
+        tag_ids[idx] = tags->list.length - 1;
+        tags->index.list[slot] = tags->list.length;
+        tags->index.length ++;
+
+        /* Keep the table at most half full. */
+
+        if (tags->index.length*2 > tags->index.capacity)
+        {
+            int *list = yaml_malloc(tags->index.capacity*2*sizeof(int));
+            size_t id;
+
+            if (!list)
+                return 0;
+
+            memset(list, 0, tags->index.capacity*2*sizeof(int));
+            yaml_free(tags->index.list);
+            tags->index.list = list;
+            tags->index.capacity *= 2;
+            mask = tags->index.capacity - 1;
+
+            for (id = 0; id < tags->list.length; id ++) {
+                yaml_char_t *other = tags->list.list[id];
+                slot = yaml_string_hash(other,
+                        other ? strlen((char *)other) : 0) & mask;
+                while (list[slot]) {
+                    slot = (slot+1) & mask;
+                }
+                list[slot] = id+1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Write a node column, the items or the pairs, or the values of a document.
+ */
+
+static int
+yaml_binary_write_nodes(yaml_binary_output_t *output,
+        yaml_document_t *document, yaml_binary_section_t section)
+{
+    yaml_compact_nodes_t *compact = document->compact;
+    size_t values = 0;
+    size_t items = 0;
+    size_t pairs = 0;
+    size_t idx;
+
+    if (compact)
+    {
+        size_t length = document->nodes.length;
+
+        switch (section)
+        {
+            case YAML_BINARY_OFFSETS_SECTION:
+                return yaml_binary_write(output, compact->offsets,
+                        length*sizeof(size_t));
+            case YAML_BINARY_LENGTHS_SECTION:
+                return yaml_binary_write(output, compact->lengths,
+                        length*sizeof(size_t));
+            case YAML_BINARY_TAG_IDS_SECTION:
+                return yaml_binary_write(output, compact->tag_ids,
+                        length*sizeof(int));
+            case YAML_BINARY_ITEMS_SECTION:
+                return yaml_binary_write(output, compact->items.list,
+                        compact->items.length*sizeof(yaml_node_item_t));
+            case YAML_BINARY_PAIRS_SECTION:
+                return yaml_binary_write(output, compact->pairs.list,
+                        compact->pairs.length*sizeof(yaml_node_pair_t));
+            case YAML_BINARY_TYPES_SECTION:
+                return yaml_binary_write(output, compact->types, length);
+            case YAML_BINARY_VALUES_SECTION:
+                return yaml_binary_write(output, compact->values.list,
+                        compact->values.length);
+            default:
+                assert(0);      /* Should not happen. */
+        }
+    }
+
+    for (idx = 0; idx < document->nodes.length; idx ++)
+    {
+        yaml_node_t *node = document->nodes.list + idx;
+        unsigned char type = node->type;
+        size_t offset;
+        size_t length;
+
+        switch (node->type) {
+            case YAML_SCALAR_NODE:
+                offset = values;
+                length = node->data.scalar.length;
+                values += length + 1;
+                break;
+            case YAML_SEQUENCE_NODE:
+                offset = items;
+                length = node->data.sequence.items.length;
+                items += length;
+                break;
+            case YAML_MAPPING_NODE:
+                offset = pairs;
+                length = node->data.mapping.pairs.length;
+                pairs += length;
+                break;
+            default:
+                assert(0);      /* Should not happen. */
+        }
+
+        switch (section)
+        {
+            case YAML_BINARY_OFFSETS_SECTION:
+                if (!yaml_binary_write_size(output, offset))
+                    return 0;
+                break;
+
+            case YAML_BINARY_LENGTHS_SECTION:
+                if (!yaml_binary_write_size(output, length))
+                    return 0;
+                break;
+
+            case YAML_BINARY_ITEMS_SECTION:
+                if (node->type == YAML_SEQUENCE_NODE
+                        && !yaml_binary_write(output,
+                            node->data.sequence.items.list,
+                            length*sizeof(yaml_node_item_t)))
+                    return 0;
+                break;
+
+            case YAML_BINARY_PAIRS_SECTION:
+                if (node->type == YAML_MAPPING_NODE
+                        && !yaml_binary_write(output,
+                            node->data.mapping.pairs.list,
+                            length*sizeof(yaml_node_pair_t)))
+                    return 0;
+                break;
+
+            case YAML_BINARY_TYPES_SECTION:
+                if (!yaml_binary_write(output, &type, 1))
+                    return 0;
+                break;
+
+            case YAML_BINARY_VALUES_SECTION:
+                if (node->type == YAML_SCALAR_NODE
+                        && !yaml_binary_write(output,
+                            node->data.scalar.value, length + 1))
+                    return 0;
+                break;
+
+            default:
+                assert(0);      /* Should not happen. */
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Write the tag offsets or the tag strings.
+ */
+
+static int
+yaml_binary_write_tags(yaml_binary_output_t *output,
+        yaml_char_t **tags, size_t length, int is_offsets)
+{
+    size_t offset = 0;
+    size_t idx;
+
+    for (idx = 0; idx < length; idx ++)
+    {
+        size_t tag_length;
+
+        if (!tags[idx]) {
+            if (is_offsets
+                    && !yaml_binary_write_size(output, BINARY_IMAGE_NO_TAG))
+                return 0;
+            continue;
+        }
+
+        tag_length = strlen((char *)tags[idx]) + 1;
+
+        if (!(is_offsets ? yaml_binary_write_size(output, offset)
+                    : yaml_binary_write(output, tags[idx], tag_length)))
+            return 0;
+
+        offset += tag_length;
+    }
+
+    return 1;
+}
+
+/*
+ * Load a document from a binary image.
+ */
+
+YAML_DECLARE(int)
+yaml_document_load_binary(yaml_document_t *document,
+        const unsigned char *image, size_t size,
+        const unsigned char *source, size_t source_length)
+{
+    struct {
+        yaml_error_t error;
+    } self;
+    yaml_mark_t mark = { 0, 0, 0 };
+    yaml_binary_header_t header;
+    size_t sections[YAML_BINARY_END_SECTION+1];
+    yaml_compact_nodes_t *compact = NULL;
+    yaml_version_directive_t *version_directive = NULL;
+    struct {
+        yaml_tag_directive_t *list;
+        size_t length;
+        size_t capacity;
+    } tag_directives = { NULL, 0, 0 };
+    const size_t *tag_offsets;
+    const unsigned char *strings;
+    size_t idx;
+
+    assert(document);           /* Non-NULL document object is expected. */
+    assert(!document->type);    /* The document must be empty. */
+    assert(image);              /* Non-NULL image is expected. */
+    assert(source || !source_length);   /* Valid source is expected. */
+
+    /* Check the header. */
+
+    if (size < sizeof(yaml_binary_header_t)
+            || (size_t)image % BINARY_IMAGE_ALIGNMENT)
+        return 0;
+
+    memcpy(&header, image, sizeof(yaml_binary_header_t));
+
+    if (memcmp(header.magic, BINARY_IMAGE_MAGIC, sizeof(header.magic))
+            || header.format != BINARY_IMAGE_FORMAT
+            || header.byte_order != BINARY_IMAGE_BYTE_ORDER
+            || header.word_size != sizeof(size_t)
+            || header.size != size
+            || header.nodes > INT_MAX || header.tags > INT_MAX)
+        return 0;
+
+    if (source && header.source_hash != yaml_string_hash(source, source_length))
+        return 0;
+
+    if (!yaml_binary_layout(&header, sections)
+            || sections[YAML_BINARY_END_SECTION] != size)
+        return 0;
+
+    /* Check the content, so that the readers could trust it. */
+
+    if (!yaml_binary_check_nodes(&header, image, sections))
+        return 0;
+
+    if (!yaml_binary_check_strings(image + sections[YAML_BINARY_TAGS_SECTION],
+                header.tag_bytes, 0)
+            || (!header.tag_directives && header.directive_bytes)
+            || !yaml_binary_check_strings(
+                image + sections[YAML_BINARY_DIRECTIVES_SECTION],
+                header.directive_bytes, header.tag_directives*2))
+        return 0;
+
+    tag_offsets = (const size_t *)(image
+            + sections[YAML_BINARY_TAG_OFFSETS_SECTION]);
+
+    for (idx = 0; idx < header.tags; idx ++) {
+        if (tag_offsets[idx] != BINARY_IMAGE_NO_TAG
+                && tag_offsets[idx] >= header.tag_bytes)
+            return 0;
+    }
+
+    /* Point the compact node storage into the image. */
+
+    compact = yaml_malloc(sizeof(yaml_compact_nodes_t));
+    if (!compact) goto error;
+
+    memset(compact, 0, sizeof(yaml_compact_nodes_t));
+
+    if (!STACK_INIT(&self, compact->tags,
+                (header.tags > INITIAL_STACK_CAPACITY
+                 ? header.tags : INITIAL_STACK_CAPACITY)))
+        goto error;
+
+    strings = image + sections[YAML_BINARY_TAGS_SECTION];
+    for (idx = 0; idx < header.tags; idx ++) {
+        compact->tags.list[idx] = (tag_offsets[idx] == BINARY_IMAGE_NO_TAG
+                ? NULL : (yaml_char_t *)(strings + tag_offsets[idx]));
+    }
+    compact->tags.length = header.tags;
+
+    compact->capacity = header.nodes;
+    compact->types = (unsigned char *)(image
+            + sections[YAML_BINARY_TYPES_SECTION]);
+    compact->tag_ids = (int *)(image
+            + sections[YAML_BINARY_TAG_IDS_SECTION]);
+    compact->offsets = (size_t *)(image
+            + sections[YAML_BINARY_OFFSETS_SECTION]);
+    compact->lengths = (size_t *)(image
+            + sections[YAML_BINARY_LENGTHS_SECTION]);
+    compact->values.list = (yaml_char_t *)(image
+            + sections[YAML_BINARY_VALUES_SECTION]);
+    compact->values.length = compact->values.capacity = header.values;
+    compact->items.list = (yaml_node_item_t *)(image
+            + sections[YAML_BINARY_ITEMS_SECTION]);
+    compact->items.length = compact->items.capacity = header.items;
+    compact->pairs.list = (yaml_node_pair_t *)(image
+            + sections[YAML_BINARY_PAIRS_SECTION]);
+    compact->pairs.length = compact->pairs.capacity = header.pairs;
+    compact->image = image;
+
+    /* Copy the directives. */
+
+    if (header.flags & BINARY_IMAGE_VERSION_FLAG) {
+        version_directive = yaml_malloc(sizeof(yaml_version_directive_t));
+        if (!version_directive) goto error;
+        version_directive->major = header.major;
+        version_directive->minor = header.minor;
+    }
+
+    if (header.tag_directives) {
+        if (!STACK_INIT(&self, tag_directives, header.tag_directives))
+            goto error;
+        strings = image + sections[YAML_BINARY_DIRECTIVES_SECTION];
+        for (idx = 0; idx < header.tag_directives; idx ++) {
+            yaml_tag_directive_t value;
+            value.handle = yaml_strdup(strings);
+            strings += strlen((char *)strings) + 1;
+            value.prefix = yaml_strdup(strings);
+            strings += strlen((char *)strings) + 1;
+            PUSH(&self, tag_directives, value);
+            if (!value.handle || !value.prefix)
+                goto error;
+        }
+    }
+
+    DOCUMENT_INIT(*document, NULL, header.nodes, 0,
+            version_directive, tag_directives.list,
+            tag_directives.length, tag_directives.capacity,
+            (header.flags & BINARY_IMAGE_START_IMPLICIT_FLAG) != 0,
+            (header.flags & BINARY_IMAGE_END_IMPLICIT_FLAG) != 0,
+            mark, mark);
+    document->expanded_nodes = header.expanded_nodes;
+    document->expanded_depth = header.expanded_depth;
+    document->compact = compact;
+
+    return 1;
+
+error:
+    if (compact) {
+        STACK_DEL(&self, compact->tags);
+        yaml_free(compact);
+    }
+
+    yaml_free(version_directive);
+
+    while (!STACK_EMPTY(&self, tag_directives)) {
+        yaml_tag_directive_t value = POP(&self, tag_directives);
+        yaml_free(value.handle);
+        yaml_free(value.prefix);
+    }
+    STACK_DEL(&self, tag_directives);
+
+    return 0;
+}
+
+/*
+ * Check that the node columns of an image refer only to the image content.
+ */
+
+static int
+yaml_binary_check_nodes(const yaml_binary_header_t *header,
+        const unsigned char *image, const size_t *sections)
+{
+    const unsigned char *types = image + sections[YAML_BINARY_TYPES_SECTION];
+    const int *tag_ids = (const int *)(image
+            + sections[YAML_BINARY_TAG_IDS_SECTION]);
+    const size_t *offsets = (const size_t *)(image
+            + sections[YAML_BINARY_OFFSETS_SECTION]);
+    const size_t *lengths = (const size_t *)(image
+            + sections[YAML_BINARY_LENGTHS_SECTION]);
+    const unsigned char *values = image
+        + sections[YAML_BINARY_VALUES_SECTION];
+    const yaml_node_item_t *items = (const yaml_node_item_t *)(image
+            + sections[YAML_BINARY_ITEMS_SECTION]);
+    const yaml_node_pair_t *pairs = (const yaml_node_pair_t *)(image
+            + sections[YAML_BINARY_PAIRS_SECTION]);
+    int nodes = (int)header->nodes;
+    size_t idx;
+
+    for (idx = 0; idx < header->nodes; idx ++)
+    {
+        size_t offset = offsets[idx];
+        size_t length = lengths[idx];
+
+        if (tag_ids[idx] < 0 || (size_t)tag_ids[idx] >= header->tags)
+            return 0;
+
+        switch (types[idx]) {
+            case YAML_SCALAR_NODE:
+                if (offset >= header->values
+                        || length >= header->values - offset
+                        || values[offset+length])
+                    return 0;
+                break;
+            case YAML_SEQUENCE_NODE:
+                if (offset > header->items
+                        || length > header->items - offset)
+                    return 0;
+                break;
+            case YAML_MAPPING_NODE:
+                if (offset > header->pairs
+                        || length > header->pairs - offset)
+                    return 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    for (idx = 0; idx < header->items; idx ++) {
+        if (items[idx] < 0 || items[idx] >= nodes)
+            return 0;
+    }
+
+    for (idx = 0; idx < header->pairs; idx ++) {
+        if (pairs[idx].key < 0 || pairs[idx].key >= nodes
+                || pairs[idx].value < 0 || pairs[idx].value >= nodes)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Check that a string section ends with NUL and, unless `count` is `0`,
+ * consists of exactly `count` strings.
+ */
+
+static int
+yaml_binary_check_strings(const unsigned char *strings, size_t size,
+        size_t count)
+{
+    size_t idx;
+
+    if (size && strings[size-1])
+        return 0;
+
+    if (!count)
+        return 1;
+
+    for (idx = 0; idx < size; idx ++) {
+        if (!strings[idx]) {
+            if (!count)
+                return 0;
+            count --;
+        }
+    }
+
+    return !count;
+}
+
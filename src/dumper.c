@@ -6,18 +6,57 @@
  */
 
 YAML_DECLARE(int)
-yaml_emitter_open(yaml_emitter_t *emitter);
+yaml_emitter_start(yaml_emitter_t *emitter);
 
 YAML_DECLARE(int)
-yaml_emitter_close(yaml_emitter_t *emitter);
+yaml_emitter_end(yaml_emitter_t *emitter);
 
 YAML_DECLARE(int)
-yaml_emitter_dump(yaml_emitter_t *emitter, yaml_document_t *document);
+yaml_emitter_emit_document(yaml_emitter_t *emitter, yaml_document_t *document);
+
+YAML_DECLARE(int)
+yaml_emitter_emit_single_document(yaml_emitter_t *emitter,
+        yaml_document_t *document);
+
+YAML_DECLARE(int)
+yaml_emitter_start_document(yaml_emitter_t *emitter,
+        const yaml_version_directive_t *version_directive,
+        const yaml_tag_directive_t *tag_directives_list,
+        size_t tag_directives_length,
+        int is_start_implicit);
+
+YAML_DECLARE(int)
+yaml_emitter_end_document(yaml_emitter_t *emitter, int is_end_implicit);
+
+YAML_DECLARE(int)
+yaml_emitter_add_scalar(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, const yaml_char_t *value, size_t length,
+        yaml_scalar_style_t style);
+
+YAML_DECLARE(int)
+yaml_emitter_add_alias(yaml_emitter_t *emitter, int anchor_id);
+
+YAML_DECLARE(int)
+yaml_emitter_start_sequence(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_sequence_style_t style);
+
+YAML_DECLARE(int)
+yaml_emitter_end_sequence(yaml_emitter_t *emitter);
+
+YAML_DECLARE(int)
+yaml_emitter_start_mapping(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_mapping_style_t style);
+
+YAML_DECLARE(int)
+yaml_emitter_end_mapping(yaml_emitter_t *emitter);
 
 /*
  * Clean up functions.
  */
 
+static void
+yaml_emitter_forget_event(void *data, yaml_event_t *event);
+
 static void
 yaml_emitter_delete_document_and_anchors(yaml_emitter_t *emitter);
 
@@ -25,41 +64,50 @@ yaml_emitter_delete_document_and_anchors(yaml_emitter_t *emitter);
  * Anchor functions.
  */
 
-static void
-yaml_emitter_anchor_node(yaml_emitter_t *emitter, int index);
+#define ANCHOR_TEMPLATE         "_%03d"
+#define ANCHOR_TEMPLATE_LENGTH  16
+
+static int
+yaml_emitter_anchor_document(yaml_emitter_t *emitter);
 
 static yaml_char_t *
 yaml_emitter_generate_anchor(yaml_emitter_t *emitter, int anchor_id);
 
+/*
+ * Builder functions.
+ */
+
+static int
+yaml_emitter_build_event(yaml_emitter_t *emitter, yaml_event_t *event);
 
 /*
  * Serialize functions.
  */
 
 static int
-yaml_emitter_dump_node(yaml_emitter_t *emitter, int index);
+yaml_emitter_dump_node(yaml_emitter_t *emitter, int node_id);
 
 static int
 yaml_emitter_dump_alias(yaml_emitter_t *emitter, yaml_char_t *anchor);
 
 static int
 yaml_emitter_dump_scalar(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor);
+        int node_id, yaml_char_t *anchor);
 
 static int
 yaml_emitter_dump_sequence(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor);
+        int node_id, yaml_char_t *anchor);
 
 static int
 yaml_emitter_dump_mapping(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor);
+        int node_id, yaml_char_t *anchor);
 
 /*
  * Issue a STREAM-START event.
  */
 
 YAML_DECLARE(int)
-yaml_emitter_open(yaml_emitter_t *emitter)
+yaml_emitter_start(yaml_emitter_t *emitter)
 {
     yaml_event_t event;
     yaml_mark_t mark = { 0, 0, 0 };
@@ -69,7 +117,7 @@ yaml_emitter_open(yaml_emitter_t *emitter)
 
     STREAM_START_EVENT_INIT(event, YAML_ANY_ENCODING, mark, mark);
 
-    if (!yaml_emitter_emit(emitter, &event)) {
+    if (!yaml_emitter_emit_event(emitter, &event)) {
         return 0;
     }
 
@@ -83,7 +131,7 @@ yaml_emitter_open(yaml_emitter_t *emitter)
  */
 
 YAML_DECLARE(int)
-yaml_emitter_close(yaml_emitter_t *emitter)
+yaml_emitter_end(yaml_emitter_t *emitter)
 {
     yaml_event_t event;
     yaml_mark_t mark = { 0, 0, 0 };
@@ -95,7 +143,7 @@ yaml_emitter_close(yaml_emitter_t *emitter)
 
     STREAM_END_EVENT_INIT(event, mark, mark);
 
-    if (!yaml_emitter_emit(emitter, &event)) {
+    if (!yaml_emitter_emit_event(emitter, &event)) {
         return 0;
     }
 
@@ -106,54 +154,53 @@ yaml_emitter_close(yaml_emitter_t *emitter)
 
 /*
  * Dump a YAML document.
+ *
+ * The events borrow the strings of the document, so they are released with
+ * a recycler that only clears them; the application recycler is restored
+ * when the document is dumped.
  */
 
 YAML_DECLARE(int)
-yaml_emitter_dump(yaml_emitter_t *emitter, yaml_document_t *document)
+yaml_emitter_emit_document(yaml_emitter_t *emitter, yaml_document_t *document)
 {
     yaml_event_t event;
     yaml_mark_t mark = { 0, 0, 0 };
+    yaml_recycler_t *recycler;
+    void *recycler_data;
 
     assert(emitter);            /* Non-NULL emitter object is required. */
-    assert(document);           /* Non-NULL emitter object is expected. */
+    assert(document);           /* Non-NULL document object is expected. */
+    assert(emitter->is_opened); /* Emitter should be opened. */
+    assert(!emitter->is_closed);    /* Emitter should not be closed yet. */
+    assert(document->type);     /* Initialized document is expected. */
 
     emitter->document = document;
 
-    if (!emitter->is_opened) {
-        if (!yaml_emitter_open(emitter)) goto error;
-    }
-
-    if (document->type == YAML_DOCUMENT)
-    {
-        assert(emitter->is_opened); /* Emitter should be opened. */
+    recycler = emitter->recycler;
+    recycler_data = emitter->recycler_data;
+    emitter->recycler = yaml_emitter_forget_event;
+    emitter->recycler_data = NULL;
 
-        if (STACK_EMPTY(emitter, emitter->nodes)) {
-            SERIALIZER_ERROR_INIT(emitter, "root node is not specified");
-            goto error;
-        }
+    if (!document->nodes.length) {
+        SERIALIZER_ERROR_INIT(emitter, "root node is not specified");
+        goto error;
+    }
 
-        emitter->anchors = yaml_malloc(sizeof(*(emitter->anchors))
-                * (document->nodes.length));
-        if (!emitter->anchors) goto error;
-        memset(emitter->anchors, 0, sizeof(*(emitter->anchors))
-                * (document->nodes.length));
+    if (!yaml_emitter_anchor_document(emitter)) goto error;
 
-        DOCUMENT_START_EVENT_INIT(event, document->version_directive,
-                document->tag_directives.list, document->tag_directives.length,
-                document->tag_directives.capacity,
-                document->start_implicit, mark, mark);
-        if (!yaml_emitter_emit(emitter, &event)) goto error;
+    DOCUMENT_START_EVENT_INIT(event, document->version_directive,
+            document->tag_directives.list, document->tag_directives.length,
+            document->tag_directives.capacity,
+            document->is_start_implicit, mark, mark);
+    if (!yaml_emitter_emit_event(emitter, &event)) goto error;
 
-        yaml_emitter_anchor_node(emitter, 0);
-        if (!yaml_emitter_dump_node(emitter, 0)) goto error;
+    if (!yaml_emitter_dump_node(emitter, 0)) goto error;
 
-        DOCUMENT_END_EVENT_INIT(event, document->end_implicit, mark, mark);
-        if (!yaml_emitter_emit(emitter, &event)) goto error;
-    }
+    DOCUMENT_END_EVENT_INIT(event, document->is_end_implicit, mark, mark);
+    if (!yaml_emitter_emit_event(emitter, &event)) goto error;
 
-    if (!document->type) {
-        if (!yaml_emitter_close(emitter)) goto error;
-    }
+    emitter->recycler = recycler;
+    emitter->recycler_data = recycler_data;
 
     yaml_emitter_delete_document_and_anchors(emitter);
 
@@ -161,102 +208,121 @@ yaml_emitter_dump(yaml_emitter_t *emitter, yaml_document_t *document)
 
 error:
 
+    /* The events left in the queue borrow the document strings too. */
+
+    while (!QUEUE_EMPTY(emitter, emitter->events)) {
+        yaml_emitter_forget_event(NULL, &DEQUEUE(emitter, emitter->events));
+    }
+
+    emitter->recycler = recycler;
+    emitter->recycler_data = recycler_data;
+
     yaml_emitter_delete_document_and_anchors(emitter);
 
     return 0;
 }
 
 /*
- * Clean up the emitter object after a document is dumped.
+ * Dump a YAML stream consisting of a single document.
  */
 
-static void
-yaml_emitter_delete_document_and_anchors(yaml_emitter_t *emitter)
+YAML_DECLARE(int)
+yaml_emitter_emit_single_document(yaml_emitter_t *emitter,
+        yaml_document_t *document)
 {
-    int index;
+    assert(emitter);            /* Non-NULL emitter object is required. */
+    assert(document);           /* Non-NULL document object is expected. */
 
-    if (!emitter->anchors) {
-        yaml_document_delete(emitter->document);
-        emitter->document = NULL;
-        return;
+    if (!yaml_emitter_start(emitter)) {
+        yaml_document_clear(document);
+        return 0;
     }
 
-    for (index = 0; emitter->document->nodes.start + index
-            < emitter->document->nodes.top; index ++) {
-        yaml_node_t node = emitter->document->nodes.start[index];
-        if (!emitter->anchors[index].serialized) {
-            yaml_free(node.tag);
-            if (node.type == YAML_SCALAR_NODE) {
-                yaml_free(node.data.scalar.value);
-            }
-        }
-        if (node.type == YAML_SEQUENCE_NODE) {
-            STACK_DEL(emitter, node.data.sequence.items);
-        }
-        if (node.type == YAML_MAPPING_NODE) {
-            STACK_DEL(emitter, node.data.mapping.pairs);
-        }
-    }
+    if (!yaml_emitter_emit_document(emitter, document))
+        return 0;
+
+    return yaml_emitter_end(emitter);
+}
+
+/*
+ * Release an event with borrowed strings.
+ */
+
+static void
+yaml_emitter_forget_event(void *data, yaml_event_t *event)
+{
+    memset(event, 0, sizeof(yaml_event_t));
+}
+
+/*
+ * Clean up the emitter object after a document is dumped.
+ */
 
-    STACK_DEL(emitter, emitter->document->nodes);
-    yaml_free(emitter->anchors);
+static void
+yaml_emitter_delete_document_and_anchors(yaml_emitter_t *emitter)
+{
+    yaml_allocator_free(&emitter->allocator, emitter->anchors);
+    yaml_allocator_free(&emitter->allocator, emitter->anchor_names);
 
+    yaml_document_clear(emitter->document);
+
+    emitter->references = NULL;
     emitter->anchors = NULL;
+    emitter->anchor_names = NULL;
     emitter->last_anchor_id = 0;
     emitter->document = NULL;
 }
 
 /*
- * Check the references of a node and assign the anchor id if needed.
+ * Find the shared nodes of the document.
+ *
+ * The reference counts are kept by the document (see
+ * `yaml_document_append_*()`) or counted with a single pass over the nodes;
+ * the pass is skipped for a tree.  If there are shared nodes, the anchor ids
+ * and the space for their names are allocated at once; an id is assigned when
+ * the node is emitted for the first time, so the anchors are numbered in the
+ * document order.
  */
 
-static void
-yaml_emitter_anchor_node(yaml_emitter_t *emitter, int index)
+static int
+yaml_emitter_anchor_document(yaml_emitter_t *emitter)
 {
-    yaml_node_t *node = emitter->document->nodes.start + index - 1;
-    yaml_node_item_t *item;
-    yaml_node_pair_t *pair;
-
-    emitter->anchors[index-1].references ++;
-
-    if (emitter->anchors[index-1].references == 1) {
-        switch (node->type) {
-            case YAML_SEQUENCE_NODE:
-                for (item = node->data.sequence.items.start;
-                        item < node->data.sequence.items.top; item ++) {
-                    yaml_emitter_anchor_node(emitter, *item);
-                }
-                break;
-            case YAML_MAPPING_NODE:
-                for (pair = node->data.mapping.pairs.start;
-                        pair < node->data.mapping.pairs.top; pair ++) {
-                    yaml_emitter_anchor_node(emitter, pair->key);
-                    yaml_emitter_anchor_node(emitter, pair->value);
-                }
-                break;
-            default:
-                break;
-        }
-    }
+    yaml_document_t *document = emitter->document;
+    yaml_references_t *references = NULL;
 
-    else if (emitter->anchors[index-1].references == 2) {
-        emitter->anchors[index-1].anchor = (++ emitter->last_anchor_id);
+    if (document->references || !emitter->is_tree) {
+        references = yaml_document_count_references(document);
+        if (!references)
+            return MEMORY_ERROR_INIT(emitter);
     }
+
+    if (!references || !references->shared)
+        return 1;
+
+    emitter->anchors = yaml_allocator_malloc(&emitter->allocator,
+            sizeof(*(emitter->anchors)) * document->nodes.length);
+    emitter->anchor_names = yaml_allocator_malloc(&emitter->allocator,
+            ANCHOR_TEMPLATE_LENGTH * references->shared);
+    if (!emitter->anchors || !emitter->anchor_names)
+        return MEMORY_ERROR_INIT(emitter);
+
+    memset(emitter->anchors, 0,
+            sizeof(*(emitter->anchors)) * document->nodes.length);
+
+    emitter->references = references;
+
+    return 1;
 }
 
 /*
  * Generate a textual representation for an anchor.
  */
 
-#define ANCHOR_TEMPLATE         "_%03d"
-#define ANCHOR_TEMPLATE_LENGTH  16
-
 static yaml_char_t *
 yaml_emitter_generate_anchor(yaml_emitter_t *emitter, int anchor_id)
 {
-    yaml_char_t *anchor = yaml_malloc(ANCHOR_TEMPLATE_LENGTH);
-
-    if (!anchor) return NULL;
+    yaml_char_t *anchor = emitter->anchor_names
+        + (anchor_id-1) * ANCHOR_TEMPLATE_LENGTH;
 
     sprintf((char *)anchor, ANCHOR_TEMPLATE, anchor_id);
 
@@ -268,34 +334,42 @@ yaml_emitter_generate_anchor(yaml_emitter_t *emitter, int anchor_id)
  */
 
 static int
-yaml_emitter_dump_node(yaml_emitter_t *emitter, int index)
+yaml_emitter_dump_node(yaml_emitter_t *emitter, int node_id)
 {
-    yaml_node_t *node = emitter->document->nodes.start + index - 1;
-    int anchor_id = emitter->anchors[index-1].anchor;
+    yaml_document_t *document = emitter->document;
+    yaml_node_t *node = yaml_document_get_node(document, node_id);
     yaml_char_t *anchor = NULL;
 
-    if (anchor_id) {
+    if (emitter->references && emitter->references->counts.list[node_id] > 1)
+    {
+        int anchor_id = emitter->anchors[node_id];
+
+        if (anchor_id) {
+            return yaml_emitter_dump_alias(emitter,
+                    emitter->anchor_names
+                    + (anchor_id-1) * ANCHOR_TEMPLATE_LENGTH);
+        }
+
+        anchor_id = (++ emitter->last_anchor_id);
+        emitter->anchors[node_id] = anchor_id;
         anchor = yaml_emitter_generate_anchor(emitter, anchor_id);
-        if (!anchor) return 0;
     }
 
-    if (emitter->anchors[index-1].serialized) {
-        return yaml_emitter_dump_alias(emitter, anchor);
-    }
+    /* A node of a compact document is recognized by its content. */
 
-    emitter->anchors[index-1].serialized = 1;
-
-    switch (node->type) {
-        case YAML_SCALAR_NODE:
-            return yaml_emitter_dump_scalar(emitter, node, anchor);
-        case YAML_SEQUENCE_NODE:
-            return yaml_emitter_dump_sequence(emitter, node, anchor);
-        case YAML_MAPPING_NODE:
-            return yaml_emitter_dump_mapping(emitter, node, anchor);
-        default:
-            assert(0);      /* Could not happen. */
-            break;
-    }
+    if (node ? node->type == YAML_SCALAR_NODE
+            : yaml_document_get_scalar(document, node_id, NULL, NULL, NULL))
+        return yaml_emitter_dump_scalar(emitter, node, node_id, anchor);
+
+    if (node ? node->type == YAML_SEQUENCE_NODE
+            : yaml_document_get_sequence(document, node_id, NULL, NULL, NULL))
+        return yaml_emitter_dump_sequence(emitter, node, node_id, anchor);
+
+    if (node ? node->type == YAML_MAPPING_NODE
+            : yaml_document_get_mapping(document, node_id, NULL, NULL, NULL))
+        return yaml_emitter_dump_mapping(emitter, node, node_id, anchor);
+
+    assert(0);      /* Could not happen. */
 
     return 0;       /* Could not happen. */
 }
@@ -312,7 +386,7 @@ yaml_emitter_dump_alias(yaml_emitter_t *emitter, yaml_char_t *anchor)
 
     ALIAS_EVENT_INIT(event, anchor, mark, mark);
 
-    return yaml_emitter_emit(emitter, &event);
+    return yaml_emitter_emit_event(emitter, &event);
 }
 
 /*
@@ -321,21 +395,28 @@ yaml_emitter_dump_alias(yaml_emitter_t *emitter, yaml_char_t *anchor)
 
 static int
 yaml_emitter_dump_scalar(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor)
+        int node_id, yaml_char_t *anchor)
 {
     yaml_event_t event;
     yaml_mark_t mark  = { 0, 0, 0 };
+    yaml_char_t *tag;
+    yaml_char_t *value;
+    size_t length;
+    int is_nonspecific;
+
+    yaml_document_get_scalar(emitter->document, node_id,
+            &tag, &value, &length);
 
-    int plain_implicit = (strcmp((char *)node->tag,
-                YAML_DEFAULT_SCALAR_TAG) == 0);
-    int quoted_implicit = (strcmp((char *)node->tag,
-                YAML_DEFAULT_SCALAR_TAG) == 0);
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_SCALAR_TAG) == 0);
 
-    SCALAR_EVENT_INIT(event, anchor, node->tag, node->data.scalar.value,
-            node->data.scalar.length, plain_implicit, quoted_implicit,
-            node->data.scalar.style, mark, mark);
+    SCALAR_EVENT_INIT(event, anchor, tag, value, length,
+            is_nonspecific, is_nonspecific,
+            (node ? node->data.scalar.style : YAML_ANY_SCALAR_STYLE),
+            mark, mark);
 
-    return yaml_emitter_emit(emitter, &event);
+    return yaml_emitter_emit_event(emitter, &event);
 }
 
 /*
@@ -344,26 +425,36 @@ yaml_emitter_dump_scalar(yaml_emitter_t *emitter, yaml_node_t *node,
 
 static int
 yaml_emitter_dump_sequence(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor)
+        int node_id, yaml_char_t *anchor)
 {
     yaml_event_t event;
     yaml_mark_t mark  = { 0, 0, 0 };
-
-    int implicit = (strcmp((char *)node->tag, YAML_DEFAULT_SEQUENCE_TAG) == 0);
-
-    yaml_node_item_t *item;
-
-    SEQUENCE_START_EVENT_INIT(event, anchor, node->tag, implicit,
-            node->data.sequence.style, mark, mark);
-    if (!yaml_emitter_emit(emitter, &event)) return 0;
-
-    for (item = node->data.sequence.items.start;
-            item < node->data.sequence.items.top; item ++) {
-        if (!yaml_emitter_dump_node(emitter, *item)) return 0;
+    yaml_char_t *tag;
+    yaml_node_item_t *items;
+    size_t length;
+    size_t idx;
+    int is_nonspecific;
+
+    yaml_document_get_sequence(emitter->document, node_id,
+            &tag, &items, &length);
+
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_SEQUENCE_TAG) == 0);
+
+    SEQUENCE_START_EVENT_INIT(event, anchor, tag, is_nonspecific,
+            (node ? node->data.sequence.style : YAML_ANY_SEQUENCE_STYLE),
+            mark, mark);
+    event.data.sequence_start.hint = (length ? YAML_NONEMPTY_COLLECTION_HINT
+            : YAML_EMPTY_COLLECTION_HINT);
+    if (!yaml_emitter_emit_event(emitter, &event)) return 0;
+
+    for (idx = 0; idx < length; idx ++) {
+        if (!yaml_emitter_dump_node(emitter, items[idx])) return 0;
     }
 
     SEQUENCE_END_EVENT_INIT(event, mark, mark);
-    if (!yaml_emitter_emit(emitter, &event)) return 0;
+    if (!yaml_emitter_emit_event(emitter, &event)) return 0;
 
     return 1;
 }
@@ -374,27 +465,308 @@ yaml_emitter_dump_sequence(yaml_emitter_t *emitter, yaml_node_t *node,
 
 static int
 yaml_emitter_dump_mapping(yaml_emitter_t *emitter, yaml_node_t *node,
-        yaml_char_t *anchor)
+        int node_id, yaml_char_t *anchor)
 {
     yaml_event_t event;
     yaml_mark_t mark  = { 0, 0, 0 };
+    yaml_char_t *tag;
+    yaml_node_pair_t *pairs;
+    size_t length;
+    size_t idx;
+    int is_nonspecific;
+
+    yaml_document_get_mapping(emitter->document, node_id,
+            &tag, &pairs, &length);
+
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_MAPPING_TAG) == 0);
+
+    MAPPING_START_EVENT_INIT(event, anchor, tag, is_nonspecific,
+            (node ? node->data.mapping.style : YAML_ANY_MAPPING_STYLE),
+            mark, mark);
+    event.data.mapping_start.hint = (length ? YAML_NONEMPTY_COLLECTION_HINT
+            : YAML_EMPTY_COLLECTION_HINT);
+    if (!yaml_emitter_emit_event(emitter, &event)) return 0;
+
+    for (idx = 0; idx < length; idx ++) {
+        if (!yaml_emitter_dump_node(emitter, pairs[idx].key)) return 0;
+        if (!yaml_emitter_dump_node(emitter, pairs[idx].value)) return 0;
+    }
+
+    MAPPING_END_EVENT_INIT(event, mark, mark);
+    if (!yaml_emitter_emit_event(emitter, &event)) return 0;
+
+    return 1;
+}
+
+/*
+ * Issue a DOCUMENT-START event for a document built node by node.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_document(yaml_emitter_t *emitter,
+        const yaml_version_directive_t *version_directive,
+        const yaml_tag_directive_t *tag_directives_list,
+        size_t tag_directives_length,
+        int is_start_implicit)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+    assert(emitter->is_opened); /* Emitter should be opened. */
+    assert(!emitter->is_closed);    /* Emitter should not be closed yet. */
+    assert(tag_directives_list || !tag_directives_length);
+                                /* Non-NULL tag directives are expected. */
+
+    emitter->last_anchor_id = 0;
+
+    DOCUMENT_START_EVENT_INIT(event,
+            (yaml_version_directive_t *)version_directive,
+            (yaml_tag_directive_t *)tag_directives_list,
+            tag_directives_length, tag_directives_length,
+            is_start_implicit, mark, mark);
+
+    return yaml_emitter_build_event(emitter, &event);
+}
+
+/*
+ * Issue a DOCUMENT-END event for a document built node by node.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_end_document(yaml_emitter_t *emitter, int is_end_implicit)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
 
-    int implicit = (strcmp((char *)node->tag, YAML_DEFAULT_MAPPING_TAG) == 0);
+    emitter->last_anchor_id = 0;
+
+    DOCUMENT_END_EVENT_INIT(event, is_end_implicit, mark, mark);
+
+    return yaml_emitter_build_event(emitter, &event);
+}
+
+/*
+ * Issue a SCALAR event for a node added to the document.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_add_scalar(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, const yaml_char_t *value, size_t length,
+        yaml_scalar_style_t style)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+    yaml_char_t anchor[ANCHOR_TEMPLATE_LENGTH];
+    int is_nonspecific;
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+    assert(value);              /* Non-NULL value is expected. */
+
+    if (length == (size_t)-1) {
+        length = strlen((char *)value);
+    }
+
+    if (anchor_id) {
+        sprintf((char *)anchor, ANCHOR_TEMPLATE, emitter->last_anchor_id+1);
+    }
+
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_SCALAR_TAG) == 0);
+
+    SCALAR_EVENT_INIT(event, (anchor_id ? anchor : NULL),
+            (yaml_char_t *)tag, (yaml_char_t *)value, length,
+            is_nonspecific, is_nonspecific, style, mark, mark);
+
+    if (!yaml_emitter_build_event(emitter, &event))
+        return 0;
+
+    if (anchor_id) {
+        *anchor_id = (++ emitter->last_anchor_id);
+    }
+
+    return 1;
+}
+
+/*
+ * Issue an ALIAS event for a node added to the document.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_add_alias(yaml_emitter_t *emitter, int anchor_id)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+    yaml_char_t anchor[ANCHOR_TEMPLATE_LENGTH];
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+    assert(anchor_id > 0 && anchor_id <= emitter->last_anchor_id);
+                                /* Valid anchor id is required. */
+
+    sprintf((char *)anchor, ANCHOR_TEMPLATE, anchor_id);
+
+    ALIAS_EVENT_INIT(event, anchor, mark, mark);
+
+    return yaml_emitter_build_event(emitter, &event);
+}
+
+/*
+ * Issue a SEQUENCE-START event for a node added to the document.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_sequence(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_sequence_style_t style)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+    yaml_char_t anchor[ANCHOR_TEMPLATE_LENGTH];
+    int is_nonspecific;
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+
+    if (anchor_id) {
+        sprintf((char *)anchor, ANCHOR_TEMPLATE, emitter->last_anchor_id+1);
+    }
+
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_SEQUENCE_TAG) == 0);
+
+    SEQUENCE_START_EVENT_INIT(event, (anchor_id ? anchor : NULL),
+            (yaml_char_t *)tag, is_nonspecific, style, mark, mark);
+
+    if (!yaml_emitter_build_event(emitter, &event))
+        return 0;
+
+    if (anchor_id) {
+        *anchor_id = (++ emitter->last_anchor_id);
+    }
 
-    yaml_node_pair_t *pair;
+    return 1;
+}
+
+/*
+ * Issue a SEQUENCE-END event.
+ */
 
-    MAPPING_START_EVENT_INIT(event, anchor, node->tag, implicit,
-            node->data.mapping.style, mark, mark);
-    if (!yaml_emitter_emit(emitter, &event)) return 0;
+YAML_DECLARE(int)
+yaml_emitter_end_sequence(yaml_emitter_t *emitter)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
 
-    for (pair = node->data.mapping.pairs.start;
-            pair < node->data.mapping.pairs.top; pair ++) {
-        if (!yaml_emitter_dump_node(emitter, pair->key)) return 0;
-        if (!yaml_emitter_dump_node(emitter, pair->value)) return 0;
+    assert(emitter);            /* Non-NULL emitter object is required. */
+
+    SEQUENCE_END_EVENT_INIT(event, mark, mark);
+
+    return yaml_emitter_build_event(emitter, &event);
+}
+
+/*
+ * Issue a MAPPING-START event for a node added to the document.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_start_mapping(yaml_emitter_t *emitter, int *anchor_id,
+        const yaml_char_t *tag, yaml_mapping_style_t style)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+    yaml_char_t anchor[ANCHOR_TEMPLATE_LENGTH];
+    int is_nonspecific;
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+
+    if (anchor_id) {
+        sprintf((char *)anchor, ANCHOR_TEMPLATE, emitter->last_anchor_id+1);
+    }
+
+    is_nonspecific = (!tag
+            || strcmp((char *)tag,
+                (const char *)YAML_DEFAULT_MAPPING_TAG) == 0);
+
+    MAPPING_START_EVENT_INIT(event, (anchor_id ? anchor : NULL),
+            (yaml_char_t *)tag, is_nonspecific, style, mark, mark);
+
+    if (!yaml_emitter_build_event(emitter, &event))
+        return 0;
+
+    if (anchor_id) {
+        *anchor_id = (++ emitter->last_anchor_id);
     }
 
+    return 1;
+}
+
+/*
+ * Issue a MAPPING-END event.
+ */
+
+YAML_DECLARE(int)
+yaml_emitter_end_mapping(yaml_emitter_t *emitter)
+{
+    yaml_event_t event;
+    yaml_mark_t mark = { 0, 0, 0 };
+
+    assert(emitter);            /* Non-NULL emitter object is required. */
+
     MAPPING_END_EVENT_INIT(event, mark, mark);
-    if (!yaml_emitter_emit(emitter, &event)) return 0;
+
+    return yaml_emitter_build_event(emitter, &event);
+}
+
+/*
+ * Emit an event that borrows the strings of the caller.
+ *
+ * The emitter may hold an event back to look ahead (see
+ * `yaml_emitter_need_more_events()`).  An event coming to the empty queue is
+ * passed as is and, if it is written out at once, released with a recycler
+ * that only clears it; if it is held back, it is replaced with a copy.  Any
+ * other event is copied first.  The copies are released as the events passed
+ * to `yaml_emitter_emit_event()`.
+ */
+
+static int
+yaml_emitter_build_event(yaml_emitter_t *emitter, yaml_event_t *event)
+{
+    yaml_recycler_t *recycler = emitter->recycler;
+    void *recycler_data = emitter->recycler_data;
+    yaml_event_t copy;
+    int result;
+
+    memset(&copy, 0, sizeof(yaml_event_t));
+
+    if (!QUEUE_EMPTY(emitter, emitter->events)) {
+        if (!yaml_event_duplicate(&copy, event))
+            return MEMORY_ERROR_INIT(emitter);
+        return yaml_emitter_emit_event(emitter, &copy);
+    }
+
+    emitter->recycler = yaml_emitter_forget_event;
+    emitter->recycler_data = NULL;
+
+    result = yaml_emitter_emit_event(emitter, event);
+
+    emitter->recycler = recycler;
+    emitter->recycler_data = recycler_data;
+
+    if (!result || QUEUE_EMPTY(emitter, emitter->events))
+        return result;
+
+    event = emitter->events.list + emitter->events.head;
+
+    if (!yaml_event_duplicate(&copy, event)) {
+        yaml_emitter_forget_event(NULL, &DEQUEUE(emitter, emitter->events));
+        return MEMORY_ERROR_INIT(emitter);
+    }
+
+    *event = copy;
 
     return 1;
 }
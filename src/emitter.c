@@ -1,6 +1,12 @@
 
 #include "yaml_private.h"
 
+#if defined(__SSE2__) || defined(_M_X64)                                        \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YAML_SPAN_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
  * Flush the buffer if needed.
  */
@@ -61,6 +67,23 @@
           emitter->line ++,                                                     \
           1)))
 
+/*
+ * Copy a run of `length` ASCII characters from a string into buffer.
+ */
+
+#define WRITE_SPAN(emitter, string, length)                                     \
+    yaml_emitter_write_span(emitter, &(string), (length))
+
+/*
+ * The characters that stop a run of safe scalar characters in addition to
+ * blanks, breaks, NUL, DEL and non-ASCII characters.
+ */
+
+#define ANALYSIS_SPAN_STOPS         ",?[]{}:"
+#define PLAIN_SPAN_STOPS            ""
+#define SINGLE_QUOTED_SPAN_STOPS    "'"
+#define DOUBLE_QUOTED_SPAN_STOPS    "\"\\"
+
 /*
  * API functions.
  */
@@ -75,6 +98,9 @@ yaml_emitter_emit_event(yaml_emitter_t *emitter, yaml_event_t *event);
 static int
 yaml_emitter_need_more_events(yaml_emitter_t *emitter);
 
+static void
+yaml_emitter_release_event(yaml_emitter_t *emitter, yaml_event_t *event);
+
 static int
 yaml_emitter_append_tag_directive(yaml_emitter_t *emitter,
         yaml_tag_directive_t value, int allow_duplicates);
@@ -182,6 +208,9 @@ yaml_emitter_process_scalar(yaml_emitter_t *emitter);
  * Analyzers.
  */
 
+static size_t
+yaml_emitter_scan_span(yaml_istring_t string, const char *stops);
+
 static int
 yaml_emitter_valid_utf8(yaml_emitter_t *emitter, yaml_istring_t string);
 
@@ -236,6 +265,10 @@ static int
 yaml_emitter_write_tag_content(yaml_emitter_t *emitter,
         const yaml_char_t *value, size_t length, int need_whitespace);
 
+static int
+yaml_emitter_write_span(yaml_emitter_t *emitter, yaml_istring_t *string,
+        size_t length);
+
 static int
 yaml_emitter_write_plain_scalar(yaml_emitter_t *emitter,
         const yaml_char_t *value, size_t length, int allow_breaks);
@@ -268,82 +301,90 @@ YAML_DECLARE(int)
 yaml_emitter_emit_event(yaml_emitter_t *emitter, yaml_event_t *event)
 {
     if (!ENQUEUE(emitter, emitter->events, *event)) {
-        yaml_event_destroy(event);
+        yaml_emitter_release_event(emitter, event);
         return 0;
     }
 
+    memset(event, 0, sizeof(yaml_event_t));
+
+    STATS_COUNT(emitter, events, 1);
+    STATS_PEAK(emitter, max_queued_events,
+            emitter->events.tail - emitter->events.head);
+    STATS_TIMER_START(emitter, emitter);
+
     while (!yaml_emitter_need_more_events(emitter)) {
         if (!yaml_emitter_analyze_event(emitter,
                     emitter->events.list + emitter->events.head))
-            return 0;
+            goto error;
         if (!yaml_emitter_state_machine(emitter,
                     emitter->events.list + emitter->events.head))
-            return 0;
-        yaml_event_destroy(&DEQUEUE(emitter, emitter->events));
+            goto error;
+        if (emitter->vectors.length && !yaml_emitter_flush(emitter))
+            goto error;
+        yaml_emitter_release_event(emitter,
+                &DEQUEUE(emitter, emitter->events));
     }
 
+    STATS_TIMER_STOP(emitter, emitter);
+
     return 1;
+
+error:
+
+    STATS_TIMER_STOP(emitter, emitter);
+
+    return 0;
+}
+
+/*
+ * Release an event the emitter is done with.
+ */
+
+static void
+yaml_emitter_release_event(yaml_emitter_t *emitter, yaml_event_t *event)
+{
+    if (emitter->recycler) {
+        emitter->recycler(emitter->recycler_data, event);
+    }
+    else {
+        yaml_event_clear(event);
+    }
 }
 
 /*
  * Check if we need to accumulate more events before emitting.
  *
- * We accumulate extra
- *  - 1 event for DOCUMENT-START
- *  - 2 events for SEQUENCE-START
- *  - 3 events for MAPPING-START
+ * The only look-ahead the emitter needs is one event after SEQUENCE-START or
+ * MAPPING-START to tell an empty collection (see
+ * `yaml_emitter_check_empty_sequence()` and
+ * `yaml_emitter_check_empty_mapping()`); a collection key is checked with the
+ * same event.  A collection with a hint is written out at once.
  */
 
 static int
 yaml_emitter_need_more_events(yaml_emitter_t *emitter)
 {
-    int level = 0;
-    int accumulate = 0;
-    size_t idx;
+    yaml_event_t *event;
 
     if (QUEUE_EMPTY(emitter, emitter->events))
         return 1;
 
-    switch (emitter->events.list[emitter->events.head].type) {
-        case YAML_DOCUMENT_START_EVENT:
-            accumulate = 1;
-            break;
+    event = emitter->events.list + emitter->events.head;
+
+    switch (event->type) {
         case YAML_SEQUENCE_START_EVENT:
-            accumulate = 2;
+            if (event->data.sequence_start.hint)
+                return 0;
             break;
         case YAML_MAPPING_START_EVENT:
-            accumulate = 3;
+            if (event->data.mapping_start.hint)
+                return 0;
             break;
         default:
             return 0;
     }
 
-    if (emitter->events.tail - emitter->events.head > accumulate)
-        return 0;
-
-    for (idx = emitter->events.head; idx < emitter->events.tail; idx ++) {
-        yaml_event_t *event = emitter->events.list+idx;
-        switch (event->type) {
-            case YAML_STREAM_START_EVENT:
-            case YAML_DOCUMENT_START_EVENT:
-            case YAML_SEQUENCE_START_EVENT:
-            case YAML_MAPPING_START_EVENT:
-                level += 1;
-                break;
-            case YAML_STREAM_END_EVENT:
-            case YAML_DOCUMENT_END_EVENT:
-            case YAML_SEQUENCE_END_EVENT:
-            case YAML_MAPPING_END_EVENT:
-                level -= 1;
-                break;
-            default:
-                break;
-        }
-        if (!level)
-            return 0;
-    }
-
-    return 1;
+    return (emitter->events.tail - emitter->events.head < 2);
 }
 
 /*
@@ -366,8 +407,8 @@ yaml_emitter_append_tag_directive(yaml_emitter_t *emitter,
         }
     }
 
-    copy.handle = yaml_strdup(value.handle);
-    copy.prefix = yaml_strdup(value.prefix);
+    copy.handle = yaml_allocator_strdup(&emitter->allocator, value.handle);
+    copy.prefix = yaml_allocator_strdup(&emitter->allocator, value.prefix);
     if (!copy.handle || !copy.prefix) {
         MEMORY_ERROR_INIT(emitter);
         goto error;
@@ -379,8 +420,8 @@ yaml_emitter_append_tag_directive(yaml_emitter_t *emitter,
     return 1;
 
 error:
-    yaml_free(copy.handle);
-    yaml_free(copy.prefix);
+    yaml_allocator_free(&emitter->allocator, copy.handle);
+    yaml_allocator_free(&emitter->allocator, copy.prefix);
     return 0;
 }
 
@@ -676,8 +717,8 @@ yaml_emitter_emit_document_end(yaml_emitter_t *emitter,
         while (!STACK_EMPTY(emitter, emitter->tag_directives)) {
             yaml_tag_directive_t tag_directive = POP(emitter,
                     emitter->tag_directives);
-            yaml_free(tag_directive.handle);
-            yaml_free(tag_directive.prefix);
+            yaml_allocator_free(&emitter->allocator, tag_directive.handle);
+            yaml_allocator_free(&emitter->allocator, tag_directive.prefix);
         }
 
         return 1;
@@ -841,6 +882,19 @@ yaml_emitter_emit_block_sequence_item(yaml_emitter_t *emitter,
 
     if (event->type == YAML_SEQUENCE_END_EVENT)
     {
+        /*
+         * The collection was hinted as non-empty, but it is empty after all
+         * (e.g., a filter dropped its items).  A block collection cannot be
+         * empty, so write an empty flow collection instead.
+         */
+
+        if (first) {
+            if (!yaml_emitter_write_indicator(emitter, "[", 1, 1, 0))
+                return 0;
+            if (!yaml_emitter_write_indicator(emitter, "]", 0, 0, 0))
+                return 0;
+        }
+
         emitter->indent = POP(emitter, emitter->indents);
         emitter->state = POP(emitter, emitter->states);
 
@@ -874,6 +928,19 @@ yaml_emitter_emit_block_mapping_key(yaml_emitter_t *emitter,
 
     if (event->type == YAML_MAPPING_END_EVENT)
     {
+        /*
+         * The collection was hinted as non-empty, but it is empty after all
+         * (e.g., a filter dropped its items).  A block collection cannot be
+         * empty, so write an empty flow collection instead.
+         */
+
+        if (first) {
+            if (!yaml_emitter_write_indicator(emitter, "{", 1, 1, 0))
+                return 0;
+            if (!yaml_emitter_write_indicator(emitter, "}", 0, 0, 0))
+                return 0;
+        }
+
         emitter->indent = POP(emitter, emitter->indents);
         emitter->state = POP(emitter, emitter->states);
 
@@ -1065,12 +1132,18 @@ yaml_emitter_check_empty_document(yaml_emitter_t *emitter)
 static int
 yaml_emitter_check_empty_sequence(yaml_emitter_t *emitter)
 {
+    yaml_event_t *event = emitter->events.list + emitter->events.head;
+
+    if (event->type != YAML_SEQUENCE_START_EVENT)
+        return 0;
+
+    if (event->data.sequence_start.hint)
+        return (event->data.sequence_start.hint == YAML_EMPTY_COLLECTION_HINT);
+
     if (emitter->events.tail - emitter->events.head < 2)
         return 0;
 
-    return (emitter->events.list[emitter->events.head].type
-                            == YAML_SEQUENCE_START_EVENT &&
-            emitter->events.list[emitter->events.head+1].type
+    return (emitter->events.list[emitter->events.head+1].type
                             == YAML_SEQUENCE_END_EVENT);
 }
 
@@ -1081,12 +1154,18 @@ yaml_emitter_check_empty_sequence(yaml_emitter_t *emitter)
 static int
 yaml_emitter_check_empty_mapping(yaml_emitter_t *emitter)
 {
+    yaml_event_t *event = emitter->events.list + emitter->events.head;
+
+    if (event->type != YAML_MAPPING_START_EVENT)
+        return 0;
+
+    if (event->data.mapping_start.hint)
+        return (event->data.mapping_start.hint == YAML_EMPTY_COLLECTION_HINT);
+
     if (emitter->events.tail - emitter->events.head < 2)
         return 0;
 
-    return (emitter->events.list[emitter->events.head].type
-                            == YAML_MAPPING_START_EVENT &&
-            emitter->events.list[emitter->events.head+1].type
+    return (emitter->events.list[emitter->events.head+1].type
                             == YAML_MAPPING_END_EVENT);
 }
 
@@ -1124,7 +1203,7 @@ yaml_emitter_check_simple_key(yaml_emitter_t *emitter)
             break;
 
         case YAML_MAPPING_START_EVENT:
-            if (!yaml_emitter_check_empty_sequence(emitter))
+            if (!yaml_emitter_check_empty_mapping(emitter))
                 return 0;
             length += emitter->anchor_data.anchor_length
                 + emitter->tag_data.handle_length
@@ -1310,6 +1389,77 @@ yaml_emitter_analyze_version_directive(yaml_emitter_t *emitter,
     return 1;
 }
 
+/*
+ * Find the length of the run of octets at the string pointer that could be
+ * written as is and need no further analysis: printable ASCII characters other
+ * than blanks and the given `stops` characters.  Any other character ends the
+ * run and is left to the character-by-character code.
+ *
+ * This is the emitter counterpart of `yaml_parser_scan_span` in 'scanner.c';
+ * unlike the scanner, the emitter has to stop at DEL (#x7F), which is not
+ * printable.
+ */
+
+static size_t
+yaml_emitter_scan_span(yaml_istring_t string, const char *stops)
+{
+    const yaml_char_t *octets = string.buffer + string.pointer;
+    size_t length = string.length - string.pointer;
+    size_t idx = 0;
+
+#ifdef YAML_SPAN_SSE2
+
+    __m128i stop_vectors[8];
+    size_t stops_length = strlen(stops);
+    size_t kdx;
+
+    assert(stops_length <= 8);  /* Not too many stop characters expected. */
+
+    for (kdx = 0; kdx < stops_length; kdx ++) {
+        stop_vectors[kdx] = _mm_set1_epi8(stops[kdx]);
+    }
+
+    while (idx + 16 <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(octets + idx));
+        __m128i matches = _mm_or_si128(
+                _mm_cmplt_epi8(chunk, _mm_set1_epi8('!')),
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\x7F')));
+        unsigned int mask;
+
+        for (kdx = 0; kdx < stops_length; kdx ++) {
+            matches = _mm_or_si128(matches,
+                    _mm_cmpeq_epi8(chunk, stop_vectors[kdx]));
+        }
+
+        mask = (unsigned int)_mm_movemask_epi8(matches);
+
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                idx ++;
+            }
+            return idx;
+        }
+
+        idx += 16;
+    }
+
+#endif
+
+    while (idx < length)
+    {
+        yaml_char_t octet = octets[idx];
+
+        if (octet <= ' ' || octet >= 0x7F || strchr(stops, octet))
+            break;
+
+        idx ++;
+    }
+
+    return idx;
+}
+
 /*
  * Verify that a string is a valid UTF-8 sequence.
  *
@@ -1327,6 +1477,10 @@ yaml_emitter_valid_utf8(yaml_emitter_t *emitter, yaml_istring_t string)
         size_t idx;
 
         octet = OCTET(string);
+        if (!(octet & 0x80)) {
+            string.pointer ++;
+            continue;
+        }
         width = (octet & 0x80) == 0x00 ? 1 :
                 (octet & 0xE0) == 0xC0 ? 2 :
                 (octet & 0xF0) == 0xE0 ? 3 :
@@ -1502,8 +1656,6 @@ yaml_emitter_analyze_scalar(yaml_emitter_t *emitter,
     int line_breaks = 0;
     int special_characters = 0;
 
-    int inline_spaces = 0;
-    int inline_breaks = 0;
     int leading_spaces = 0;
     int leading_breaks = 0;
     int trailing_spaces = 0;
@@ -1537,21 +1689,42 @@ yaml_emitter_analyze_scalar(yaml_emitter_t *emitter,
         return 1;
     }
 
-    if ((CHECK_AT(string, '-', 0)
-                && CHECK_AT(string, '-', 1)
-                && CHECK_AT(string, '-', 2))
-            || (CHECK_AT(string, '.', 0)
-                && CHECK_AT(string, '.', 1)
-                && CHECK_AT(string, '.', 2))) {
+    if (string.length >= 3
+            && ((CHECK_AT(string, '-', 0)
+                    && CHECK_AT(string, '-', 1)
+                    && CHECK_AT(string, '-', 2))
+                || (CHECK_AT(string, '.', 0)
+                    && CHECK_AT(string, '.', 1)
+                    && CHECK_AT(string, '.', 2)))) {
         block_indicators = 1;
         flow_indicators = 1;
     }
 
     preceeded_by_space = 1;
-    followed_by_space = IS_BLANKZ_AT(string, WIDTH(string));
+    followed_by_space = IS_END_AT(string, WIDTH(string))
+        || IS_BLANKZ_AT(string, WIDTH(string));
 
     while (string.pointer < string.length)
     {
+        /*
+         * Skip a run of ordinary characters following an ordinary character:
+         * they change neither the indicators nor the whitespace state.
+         */
+
+        if (string.pointer && !spaces && !breaks && !preceeded_by_space)
+        {
+            size_t span = yaml_emitter_scan_span(string, ANALYSIS_SPAN_STOPS);
+
+            if (span) {
+                string.pointer += span;
+                if (string.pointer < string.length) {
+                    followed_by_space = IS_END_AT(string, WIDTH(string))
+                        || IS_BLANKZ_AT(string, WIDTH(string));
+                }
+                continue;
+            }
+        }
+
         if (!string.pointer)
         {
             if (CHECK(string, '#') || CHECK(string, ',')
@@ -1647,12 +1820,6 @@ yaml_emitter_analyze_scalar(yaml_emitter_t *emitter,
                 else if (spaces && breaks) {
                     inline_breaks_spaces = 1;
                 }
-                else if (spaces) {
-                    inline_spaces = 1;
-                }
-                else if (breaks) {
-                    inline_breaks = 1;
-                }
             }
             spaces = breaks = mixed = leading = 0;
         }
@@ -1679,7 +1846,8 @@ yaml_emitter_analyze_scalar(yaml_emitter_t *emitter,
         preceeded_by_space = IS_BLANKZ(string);
         MOVE(string);
         if (string.pointer < string.length) {
-            followed_by_space = IS_BLANKZ_AT(string, WIDTH(string));
+            followed_by_space = IS_END_AT(string, WIDTH(string))
+                || IS_BLANKZ_AT(string, WIDTH(string));
         }
     }
 
@@ -1946,6 +2114,65 @@ yaml_emitter_write_tag_content(yaml_emitter_t *emitter,
     return 1;
 }
 
+/*
+ * Copy a run of ASCII characters into the buffer, flushing it as many times as
+ * needed.  The run must not contain line breaks.
+ *
+ * A long run is not copied if the chunks are passed to a vector writer; the
+ * run is added to the chunks by reference instead, and the buffer is flushed
+ * before the event holding the run is released.
+ */
+
+static int
+yaml_emitter_write_span(yaml_emitter_t *emitter, yaml_istring_t *string,
+        size_t length)
+{
+    if (emitter->vector_writer && emitter->encoding == YAML_UTF8_ENCODING
+            && length >= MIN_OUTPUT_REFERENCE_LENGTH)
+    {
+        yaml_iovec_t vector;
+
+        if (emitter->output.pointer > emitter->vectors_mark) {
+            vector.buffer = emitter->output.buffer + emitter->vectors_mark;
+            vector.length = emitter->output.pointer - emitter->vectors_mark;
+            if (!PUSH(emitter, emitter->vectors, vector))
+                return 0;
+        }
+
+        vector.buffer = string->buffer + string->pointer;
+        vector.length = length;
+        if (!PUSH(emitter, emitter->vectors, vector))
+            return 0;
+
+        emitter->vectors_mark = emitter->output.pointer;
+        string->pointer += length;
+        emitter->column += length;
+
+        return 1;
+    }
+
+    while (length)
+    {
+        size_t chunk;
+
+        if (!FLUSH(emitter)) return 0;
+
+        chunk = emitter->output.capacity - emitter->output.pointer;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(emitter->output.buffer + emitter->output.pointer,
+                string->buffer + string->pointer, chunk);
+        emitter->output.pointer += chunk;
+        string->pointer += chunk;
+        emitter->column += chunk;
+        length -= chunk;
+    }
+
+    return 1;
+}
+
 static int
 yaml_emitter_write_plain_scalar(yaml_emitter_t *emitter,
         const yaml_char_t *value, size_t length, int allow_breaks)
@@ -1953,6 +2180,7 @@ yaml_emitter_write_plain_scalar(yaml_emitter_t *emitter,
     yaml_istring_t string = ISTRING(value, length);
     int spaces = 0;
     int breaks = 0;
+    size_t span;
 
     if (!emitter->is_whitespace) {
         if (!PUT(emitter, ' ')) return 0;
@@ -1964,7 +2192,7 @@ yaml_emitter_write_plain_scalar(yaml_emitter_t *emitter,
         {
             if (allow_breaks && !spaces
                     && emitter->column > emitter->best_width
-                    && !IS_SPACE_AT(string, 1)) {
+                    && (IS_END_AT(string, 1) || !IS_SPACE_AT(string, 1))) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
                 MOVE(string);
             }
@@ -1987,7 +2215,13 @@ yaml_emitter_write_plain_scalar(yaml_emitter_t *emitter,
             if (breaks) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
             }
-            if (!WRITE(emitter, string)) return 0;
+            span = yaml_emitter_scan_span(string, PLAIN_SPAN_STOPS);
+            if (span) {
+                if (!WRITE_SPAN(emitter, string, span)) return 0;
+            }
+            else {
+                if (!WRITE(emitter, string)) return 0;
+            }
             emitter->is_indention = 0;
             spaces = 0;
             breaks = 0;
@@ -2007,6 +2241,7 @@ yaml_emitter_write_single_quoted_scalar(yaml_emitter_t *emitter,
     yaml_istring_t string = ISTRING(value, length);
     int spaces = 0;
     int breaks = 0;
+    size_t span;
 
     if (!yaml_emitter_write_indicator(emitter, "'", 1, 0, 0))
         return 0;
@@ -2018,7 +2253,7 @@ yaml_emitter_write_single_quoted_scalar(yaml_emitter_t *emitter,
             if (allow_breaks && !spaces
                     && emitter->column > emitter->best_width
                     && string.pointer > 0 && string.pointer < string.length
-                    && !IS_SPACE_AT(string, 1)) {
+                    && (IS_END_AT(string, 1) || !IS_SPACE_AT(string, 1))) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
                 MOVE(string);
             }
@@ -2044,7 +2279,13 @@ yaml_emitter_write_single_quoted_scalar(yaml_emitter_t *emitter,
             if (CHECK(string, '\'')) {
                 if (!PUT(emitter, '\'')) return 0;
             }
-            if (!WRITE(emitter, string)) return 0;
+            span = yaml_emitter_scan_span(string, SINGLE_QUOTED_SPAN_STOPS);
+            if (span) {
+                if (!WRITE_SPAN(emitter, string, span)) return 0;
+            }
+            else {
+                if (!WRITE(emitter, string)) return 0;
+            }
             emitter->is_indention = 0;
             spaces = 0;
             breaks = 0;
@@ -2066,6 +2307,7 @@ yaml_emitter_write_double_quoted_scalar(yaml_emitter_t *emitter,
 {
     yaml_istring_t string = ISTRING(value, length);
     int spaces = 0;
+    size_t span;
 
     if (!yaml_emitter_write_indicator(emitter, "\"", 1, 0, 0))
         return 0;
@@ -2188,7 +2430,7 @@ yaml_emitter_write_double_quoted_scalar(yaml_emitter_t *emitter,
                     && string.pointer > 0
                     && string.pointer < string.length) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
-                if (IS_SPACE_AT(string, 1)) {
+                if (!IS_END_AT(string, 1) && IS_SPACE_AT(string, 1)) {
                     if (!PUT(emitter, '\\')) return 0;
                 }
                 MOVE(string);
@@ -2200,7 +2442,13 @@ yaml_emitter_write_double_quoted_scalar(yaml_emitter_t *emitter,
         }
         else
         {
-            if (!WRITE(emitter, string)) return 0;
+            span = yaml_emitter_scan_span(string, DOUBLE_QUOTED_SPAN_STOPS);
+            if (span) {
+                if (!WRITE_SPAN(emitter, string, span)) return 0;
+            }
+            else {
+                if (!WRITE(emitter, string)) return 0;
+            }
             spaces = 0;
         }
     }
@@ -2244,6 +2492,7 @@ yaml_emitter_write_literal_scalar(yaml_emitter_t *emitter,
     yaml_istring_t string = ISTRING(value, length);
     int chomp = yaml_emitter_determine_chomping(emitter, string);
     int breaks = 0;
+    size_t span;
 
     if (!yaml_emitter_write_indicator(emitter,
                 chomp == -1 ? "|-" : chomp == +1 ? "|+" : "|", 1, 0, 0))
@@ -2264,7 +2513,13 @@ yaml_emitter_write_literal_scalar(yaml_emitter_t *emitter,
             if (breaks) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
             }
-            if (!WRITE(emitter, string)) return 0;
+            span = yaml_emitter_scan_span(string, PLAIN_SPAN_STOPS);
+            if (span) {
+                if (!WRITE_SPAN(emitter, string, span)) return 0;
+            }
+            else {
+                if (!WRITE(emitter, string)) return 0;
+            }
             emitter->is_indention = 0;
             breaks = 0;
         }
@@ -2281,6 +2536,7 @@ yaml_emitter_write_folded_scalar(yaml_emitter_t *emitter,
     int chomp = yaml_emitter_determine_chomping(emitter, string);
     int breaks = 1;
     int leading_spaces = 0;
+    size_t span;
 
     if (!yaml_emitter_write_indicator(emitter,
                 chomp == -1 ? ">-" : chomp == +1 ? ">+" : ">", 1, 0, 0))
@@ -2294,10 +2550,10 @@ yaml_emitter_write_folded_scalar(yaml_emitter_t *emitter,
         {
             if (!breaks && !leading_spaces && CHECK(string, '\n')) {
                 int k = 0;
-                while (IS_BREAK_AT(string, k)) {
+                while (!IS_END_AT(string, k) && IS_BREAK_AT(string, k)) {
                     k += WIDTH_AT(string, k);
                 }
-                if (!IS_BLANK_AT(string, k)) {
+                if (IS_END_AT(string, k) || !IS_BLANK_AT(string, k)) {
                     if (!PUT_BREAK(emitter)) return 0;
                 }
             }
@@ -2311,13 +2567,20 @@ yaml_emitter_write_folded_scalar(yaml_emitter_t *emitter,
                 if (!yaml_emitter_write_indent(emitter)) return 0;
                 leading_spaces = IS_BLANK(string);
             }
-            if (!breaks && IS_SPACE(string) && !IS_SPACE_AT(string, 1)
+            if (!breaks && IS_SPACE(string)
+                    && (IS_END_AT(string, 1) || !IS_SPACE_AT(string, 1))
                     && emitter->column > emitter->best_width) {
                 if (!yaml_emitter_write_indent(emitter)) return 0;
                 MOVE(string);
             }
             else {
-                if (!WRITE(emitter, string)) return 0;
+                span = yaml_emitter_scan_span(string, PLAIN_SPAN_STOPS);
+                if (span) {
+                    if (!WRITE_SPAN(emitter, string, span)) return 0;
+                }
+                else {
+                    if (!WRITE(emitter, string)) return 0;
+                }
             }
             emitter->is_indention = 0;
             breaks = 0;
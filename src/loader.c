@@ -1,434 +1,2378 @@
-
 #include "yaml_private.h"
 
-#if 0
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 /*
  * API functions.
  */
 
 YAML_DECLARE(int)
-yaml_parser_load(yaml_parser_t *parser, yaml_document_t *document);
+yaml_parser_parse_document(yaml_parser_t *parser, yaml_document_t *document);
+
+YAML_DECLARE(int)
+yaml_parser_parse_single_document(yaml_parser_t *parser,
+        yaml_document_t *document);
+
+YAML_DECLARE(int)
+yaml_parser_parse_all_documents(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref, int threads);
+
+YAML_DECLARE(int)
+yaml_parser_parse_selection(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_document_t *document);
+
+/*
+ * Stream loading.
+ */
+
+static int
+yaml_parser_compose(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_document_t *document);
+
+static void
+yaml_parser_clear_composer(yaml_parser_t *parser);
+
+static int
+yaml_parser_load_sequentially(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref);
+
+#if HAVE_PTHREAD_H
+
+/*
+ * A part of the input string containing no more than one document.
+ */
+
+typedef struct yaml_stream_part_s {
+
+    /* The beginning of the part. */
+    const unsigned char *start;
+
+    /* The length of the part. */
+    size_t length;
+
+    /* The document loaded from the part. */
+    yaml_document_t document;
+
+    /* The position of the part end relative to the part start. */
+    yaml_mark_t end_mark;
+
+} yaml_stream_part_t;
+
+/*
+ * The state shared by the loading threads.
+ */
+
+typedef struct yaml_stream_pool_s {
+
+    /* The parser object supplying the settings. */
+    yaml_parser_t *parser;
+
+    /* The parts of the input string. */
+    struct {
+        yaml_stream_part_t *list;
+        size_t length;
+        size_t capacity;
+    } parts;
+
+    /* The next part to load. */
+    size_t next;
+
+    /* Has any part failed to load? */
+    int is_failed;
+
+    /* The lock protecting `next` and `is_failed`. */
+    pthread_mutex_t mutex;
+
+} yaml_stream_pool_t;
+
+static int
+yaml_parser_load_in_parallel(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref, int threads);
+
+static int
+yaml_parser_split_stream(yaml_stream_pool_t *pool,
+        const unsigned char *buffer, size_t length);
+
+static const unsigned char *
+yaml_parser_find_document_start(const unsigned char *buffer,
+        const unsigned char *pointer, const unsigned char *end);
+
+static const unsigned char *
+yaml_parser_skip_prologue(const unsigned char *start,
+        const unsigned char *pointer);
+
+static void *
+yaml_parser_load_parts(void *data);
+
+static void
+yaml_document_shift_marks(yaml_document_t *document, yaml_mark_t base,
+        int is_tracking_marks);
+
+#endif
 
 /*
- * Error handling.
+ * Memory handling.
  */
 
 static int
-yaml_parser_set_composer_error(yaml_parser_t *parser,
-        const char *problem, yaml_mark_t problem_mark);
+yaml_parser_adopt_string(yaml_parser_t *parser,
+        yaml_char_t **string_ref, size_t length, yaml_char_t **target_ref);
 
 static int
-yaml_parser_set_composer_error_context(yaml_parser_t *parser,
-        const char *context, yaml_mark_t context_mark,
-        const char *problem, yaml_mark_t problem_mark);
+yaml_parser_adopt_anchor(yaml_parser_t *parser,
+        yaml_char_t **anchor_ref, yaml_char_t **target_ref);
 
+static int
+yaml_parser_adopt_directives(yaml_parser_t *parser, yaml_event_t *event);
 
 /*
  * Alias handling.
  */
 
 static int
-yaml_parser_register_anchor(yaml_parser_t *parser,
-        int index, yaml_char_t *anchor);
+yaml_parser_register_anchor(yaml_parser_t *parser, int node_id,
+        yaml_char_t *anchor, yaml_mark_t mark);
+
+static int *
+yaml_parser_find_anchor(yaml_parser_t *parser,
+        const yaml_char_t *anchor, size_t hash);
+
+static int
+yaml_parser_extend_alias_index(yaml_parser_t *parser);
+
+static void
+yaml_parser_clear_aliases(yaml_parser_t *parser);
+
+/*
+ * Alias expansion accounting.
+ */
+
+static int
+yaml_parser_start_expansion(yaml_parser_t *parser);
+
+static int
+yaml_parser_expand_item(yaml_parser_t *parser, int node_id, int item_id,
+        yaml_mark_t mark);
 
 /*
- * Clean up functions.
+ * Compact documents.
  */
 
+static int
+yaml_parser_create_compact_nodes(yaml_parser_t *parser);
+
+static int
+yaml_parser_add_compact_node(yaml_parser_t *parser, yaml_node_type_t type,
+        yaml_char_t *tag, size_t offset, size_t length);
+
+static int
+yaml_parser_extend_compact_nodes(yaml_parser_t *parser);
+
+static int
+yaml_parser_get_tag_id(yaml_parser_t *parser, yaml_char_t *tag, int *tag_id);
+
+static int *
+yaml_parser_find_tag(yaml_parser_t *parser, yaml_char_t *tag);
+
+static int
+yaml_parser_extend_tag_index(yaml_parser_t *parser);
+
 static void
-yaml_parser_delete_aliases(yaml_parser_t *parser);
+yaml_parser_clear_tag_index(yaml_parser_t *parser);
+
+static int
+yaml_parser_append_compact_value(yaml_parser_t *parser,
+        const yaml_char_t *value, size_t length, size_t *offset);
+
+static int
+yaml_parser_finish_compact_sequence(yaml_parser_t *parser, int node_id,
+        size_t base);
+
+static int
+yaml_parser_finish_compact_mapping(yaml_parser_t *parser, int node_id,
+        size_t base);
+
+/*
+ * Tag resolution.
+ */
+
+static int
+yaml_parser_resolve_tag(yaml_parser_t *parser, yaml_incomplete_node_t *node,
+        yaml_char_t **tag_ref, yaml_char_t **target_ref);
 
 /*
  * Composer functions.
  */
 
 static int
-yaml_parser_load_document(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_load_document(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event);
+
+static int
+yaml_parser_load_node(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id);
+
+static int
+yaml_parser_load_alias(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id);
+
+static int
+yaml_parser_load_scalar(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id);
+
+static int
+yaml_parser_load_sequence(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id);
+
+static int
+yaml_parser_load_mapping(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id);
+
+static void
+yaml_parser_set_value_arc(yaml_parser_t *parser, yaml_char_t *tag,
+        int key_id);
+
+static int
+yaml_parser_index_key(yaml_parser_t *parser, int node_id,
+        yaml_node_pair_t pair, yaml_mark_t start_mark, yaml_mark_t key_mark);
+
+static yaml_mark_t
+yaml_parser_node_mark(yaml_parser_t *parser, yaml_mark_t mark);
+
+/*
+ * Selective composer functions.
+ */
 
 static int
-yaml_parser_load_node(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_load_selection(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, int *node_id);
 
 static int
-yaml_parser_load_alias(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_select_node(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, unsigned long states, int root_id);
 
 static int
-yaml_parser_load_scalar(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_select_key(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, unsigned long states, unsigned long *value_states);
 
 static int
-yaml_parser_load_sequence(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_add_selected(yaml_parser_t *parser, yaml_selector_t *selector,
+        int root_id, yaml_mark_t mark);
 
 static int
-yaml_parser_load_mapping(yaml_parser_t *parser, yaml_event_t *first_event);
+yaml_parser_pass_node(yaml_parser_t *parser, yaml_event_t *event);
+
+static yaml_char_t *
+yaml_event_get_anchor(yaml_event_t *event);
 
 /*
  * Load the next document of the stream.
  */
 
 YAML_DECLARE(int)
-yaml_parser_load(yaml_parser_t *parser, yaml_document_t *document)
+yaml_parser_parse_document(yaml_parser_t *parser, yaml_document_t *document)
 {
-    yaml_event_t event;
+    assert(parser);     /* Non-NULL parser object is expected. */
+    assert(document);   /* Non-NULL document object is expected. */
+    assert(!document->type);    /* The document must be empty. */
+    assert(!parser->is_push || parser->is_final);
+                        /* The whole input must be fed. */
+
+    return yaml_parser_compose(parser, NULL, document);
+}
 
+/*
+ * Load the selected nodes of the next document of the stream.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_parse_selection(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_document_t *document)
+{
     assert(parser);     /* Non-NULL parser object is expected. */
+    assert(selector);   /* Non-NULL selector object is expected. */
     assert(document);   /* Non-NULL document object is expected. */
+    assert(!document->type);    /* The document must be empty. */
+    assert(!parser->is_push || parser->is_final);
+                        /* The whole input must be fed. */
 
-    memset(document, 0, sizeof(yaml_document_t));
-    if (!STACK_INIT(parser, document->nodes, INITIAL_STACK_SIZE))
-        goto error;
+    return yaml_parser_compose(parser, selector, document);
+}
+
+/*
+ * Compose the next document of the stream or the selected part of it.
+ */
+
+static int
+yaml_parser_compose(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_document_t *document)
+{
+    yaml_event_t event;
+
+    STATS_TIMER_START(parser, loader);
+
+    /* Skip STREAM-START. */
 
-    if (!parser->stream_start_produced) {
-        if (!yaml_parser_parse(parser, &event)) goto error;
+    if (parser->state == YAML_PARSE_STREAM_START_STATE) {
+        if (!yaml_parser_parse_event(parser, &event)) {
+            STATS_TIMER_STOP(parser, loader);
+            return 0;
+        }
         assert(event.type == YAML_STREAM_START_EVENT);
                         /* STREAM-START is expected. */
     }
 
-    if (parser->stream_end_produced) {
-        return 1;
+    if (!yaml_parser_parse_event(parser, &event)) {
+        STATS_TIMER_STOP(parser, loader);
+        return 0;
     }
 
-    if (!yaml_parser_parse(parser, &event)) goto error;
-    if (event.type == YAML_STREAM_END_EVENT) {
+    /* Keep the document empty at the end of the stream. */
+
+    if (event.type == YAML_NO_EVENT || event.type == YAML_STREAM_END_EVENT) {
+        STATS_TIMER_STOP(parser, loader);
         return 1;
     }
 
-    if (!STACK_INIT(parser, parser->aliases, INITIAL_STACK_SIZE))
-        goto error;
-
     parser->document = document;
 
-    if (!yaml_parser_load_document(parser, &event)) goto error;
+    if (!yaml_parser_load_document(parser, selector, &event))
+        goto error;
+
+    yaml_parser_clear_composer(parser);
 
-    yaml_parser_delete_aliases(parser);
-    parser->document = NULL;
+    STATS_TIMER_STOP(parser, loader);
+    STATS_COUNT(parser, documents, 1);
+    STATS_COUNT(parser, nodes, document->nodes.length);
 
     return 1;
 
 error:
 
-    yaml_parser_delete_aliases(parser);
-    yaml_document_delete(document);
-    parser->document = NULL;
+    yaml_document_clear(document);
+
+    yaml_parser_clear_composer(parser);
+
+    STATS_TIMER_STOP(parser, loader);
 
     return 0;
 }
 
 /*
- * Set composer error.
+ * Forget the composer state of the last document.
  */
 
-static int
-yaml_parser_set_composer_error(yaml_parser_t *parser,
-        const char *problem, yaml_mark_t problem_mark)
+static void
+yaml_parser_clear_composer(yaml_parser_t *parser)
 {
-    parser->error = YAML_COMPOSER_ERROR;
-    parser->problem = problem;
-    parser->problem_mark = problem_mark;
-
-    return 0;
+    yaml_parser_clear_aliases(parser);
+    yaml_parser_clear_tag_index(parser);
+    parser->expansions.length = 0;
+    parser->path.length = 0;
+    parser->pending_items.length = 0;
+    parser->pending_pairs.length = 0;
+    parser->document = NULL;
 }
 
 /*
- * Set composer error with context.
+ * Load a stream containing no more than one document.
  */
 
-static int
-yaml_parser_set_composer_error_context(yaml_parser_t *parser,
-        const char *context, yaml_mark_t context_mark,
-        const char *problem, yaml_mark_t problem_mark)
+YAML_DECLARE(int)
+yaml_parser_parse_single_document(yaml_parser_t *parser,
+        yaml_document_t *document)
 {
-    parser->error = YAML_COMPOSER_ERROR;
-    parser->context = context;
-    parser->context_mark = context_mark;
-    parser->problem = problem;
-    parser->problem_mark = problem_mark;
+    yaml_event_t event;
+
+    assert(parser);     /* Non-NULL parser object is expected. */
+    assert(document);   /* Non-NULL document object is expected. */
+
+    if (!yaml_parser_parse_document(parser, document))
+        return 0;
+
+    if (!document->type)
+        return 1;
+
+    if (!yaml_parser_parse_event(parser, &event))
+        goto error;
+
+    if (event.type != YAML_STREAM_END_EVENT) {
+        COMPOSER_ERROR_WITH_CONTEXT_INIT(parser,
+                "expected a single document in the stream",
+                document->start_mark, "but found another document",
+                event.start_mark);
+        yaml_event_clear(&event);
+        goto error;
+    }
+
+    return 1;
+
+error:
+
+    yaml_document_clear(document);
 
     return 0;
 }
 
 /*
- * Delete the stack of aliases.
+ * Load all documents of the stream.
  */
 
-static void
-yaml_parser_delete_aliases(yaml_parser_t *parser)
+YAML_DECLARE(int)
+yaml_parser_parse_all_documents(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref, int threads)
 {
-    while (!STACK_EMPTY(parser, parser->aliases)) {
-        yaml_free(POP(parser, parser->aliases).anchor);
+    assert(parser);         /* Non-NULL parser object is expected. */
+    assert(documents_ref);  /* Non-NULL document list pointer is expected. */
+    assert(count_ref);      /* Non-NULL document count pointer is expected. */
+
+    *documents_ref = NULL;
+    *count_ref = 0;
+
+#if HAVE_PTHREAD_H
+
+    /*
+     * The parts could be loaded independently only if the input string is
+     * not touched yet and is not known to be encoded in UTF-16.
+     */
+
+    if (threads > 1 && parser->is_in_place
+            && parser->state == YAML_PARSE_STREAM_START_STATE
+            && !parser->is_stream_start_produced
+            && (!parser->encoding || parser->encoding == YAML_UTF8_ENCODING)) {
+        if (yaml_parser_load_in_parallel(parser,
+                    documents_ref, count_ref, threads))
+            return 1;
     }
-    STACK_DEL(parser, parser->aliases);
+
+#endif
+
+    return yaml_parser_load_sequentially(parser, documents_ref, count_ref);
 }
 
 /*
- * Compose a document object.
+ * Load the documents of the stream one by one.
  */
 
 static int
-yaml_parser_load_document(yaml_parser_t *parser, yaml_event_t *first_event)
+yaml_parser_load_sequentially(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref)
 {
-    yaml_event_t event;
+    struct {
+        yaml_document_t *list;
+        size_t length;
+        size_t capacity;
+    } documents = { NULL, 0, 0 };
+    yaml_document_t document;
 
-    assert(first_event->type == YAML_DOCUMENT_START_EVENT);
-                        /* DOCUMENT-START is expected. */
+    if (!STACK_INIT(parser, documents, INITIAL_STACK_CAPACITY))
+        return 0;
 
-    parser->document->version_directive
-        = first_event->data.document_start.version_directive;
-    parser->document->tag_directives.start
-        = first_event->data.document_start.tag_directives.start;
-    parser->document->tag_directives.end
-        = first_event->data.document_start.tag_directives.end;
-    parser->document->start_implicit
-        = first_event->data.document_start.implicit;
-    parser->document->start_mark = first_event->start_mark;
+    while (1)
+    {
+        memset(&document, 0, sizeof(yaml_document_t));
 
-    if (!yaml_parser_parse(parser, &event)) return 0;
+        if (!yaml_parser_parse_document(parser, &document))
+            goto error;
 
-    if (!yaml_parser_load_node(parser, &event)) return 0;
+        if (!document.type)
+            break;
 
-    if (!yaml_parser_parse(parser, &event)) return 0;
-    assert(event.type == YAML_DOCUMENT_END_EVENT);
-                        /* DOCUMENT-END is expected. */
+        if (!PUSH(parser, documents, document)) {
+            yaml_document_clear(&document);
+            goto error;
+        }
+    }
 
-    parser->document->end_implicit = event.data.document_end.implicit;
-    parser->document->end_mark = event.end_mark;
+    *documents_ref = documents.list;
+    *count_ref = documents.length;
 
     return 1;
-}
 
-/*
- * Compose a node.
- */
+error:
 
-static int
-yaml_parser_load_node(yaml_parser_t *parser, yaml_event_t *first_event)
-{
-    switch (first_event->type) {
-        case YAML_ALIAS_EVENT:
-            return yaml_parser_load_alias(parser, first_event);
-        case YAML_SCALAR_EVENT:
-            return yaml_parser_load_scalar(parser, first_event);
-        case YAML_SEQUENCE_START_EVENT:
-            return yaml_parser_load_sequence(parser, first_event);
-        case YAML_MAPPING_START_EVENT:
-            return yaml_parser_load_mapping(parser, first_event);
-        default:
-            assert(0);  /* Could not happen. */
-            return 0;
-    }
+    yaml_document_list_delete(documents.list, documents.length);
 
     return 0;
 }
 
+#if HAVE_PTHREAD_H
+
 /*
- * Add an anchor.
+ * Split the input string into parts and load them on several threads.
+ *
+ * Returns `1` if all parts are loaded, `0` if the stream should be loaded
+ * sequentially instead.  The parser object is only inspected, so that the
+ * sequential loading produces the same documents or error as if this function
+ * was never called.
  */
 
 static int
-yaml_parser_register_anchor(yaml_parser_t *parser,
-        int index, yaml_char_t *anchor)
+yaml_parser_load_in_parallel(yaml_parser_t *parser,
+        yaml_document_t **documents_ref, size_t *count_ref, int threads)
 {
-    yaml_alias_data_t data = { anchor, index, { 0, 0, 0 } };
-    yaml_alias_data_t *alias_data;
-
-    if (!anchor) return 1;
+    yaml_stream_pool_t pool;
+    pthread_t *workers = NULL;
+    int workers_count = 0;
+    yaml_document_t *documents = NULL;
+    size_t count = 0;
+    yaml_mark_t base = { 0, 0, 0 };
+    const unsigned char *buffer = parser->standard_reader_data.string.buffer;
+    size_t length = parser->standard_reader_data.string.length;
+    size_t idx;
+    int idx2;
+
+    /* UTF-16 streams are not split. */
+
+    if (length >= 2 && ((buffer[0] == 0xFE && buffer[1] == 0xFF)
+                || (buffer[0] == 0xFF && buffer[1] == 0xFE)))
+        return 0;
 
-    data.mark = parser->document->nodes.start[index-1].start_mark;
+    memset(&pool, 0, sizeof(yaml_stream_pool_t));
+    pool.parser = parser;
 
-    for (alias_data = parser->aliases.start;
-            alias_data != parser->aliases.top; alias_data ++) {
-        if (strcmp((char *)alias_data->anchor, (char *)anchor) == 0) {
-            yaml_free(anchor);
-            return yaml_parser_set_composer_error_context(parser,
-                    "found duplicate anchor; first occurence",
-                    alias_data->mark, "second occurence", data.mark);
-        }
-    }
+    if (!yaml_parser_split_stream(&pool, buffer, length))
+        return 0;
 
-    if (!PUSH(parser, parser->aliases, data)) {
-        yaml_free(anchor);
+    if (pool.parts.length < 2) {
+        yaml_free(pool.parts.list);
         return 0;
     }
 
-    return 1;
-}
+    if ((size_t)threads > pool.parts.length) {
+        threads = (int)pool.parts.length;
+    }
 
-/*
- * Compose a node corresponding to an alias.
- */
+    if (pthread_mutex_init(&pool.mutex, NULL)) {
+        yaml_free(pool.parts.list);
+        return 0;
+    }
 
-static int
-yaml_parser_load_alias(yaml_parser_t *parser, yaml_event_t *first_event)
-{
-    yaml_char_t *anchor = first_event->data.alias.anchor;
-    yaml_alias_data_t *alias_data;
+    /* The calling thread loads the parts too. */
 
-    for (alias_data = parser->aliases.start;
-            alias_data != parser->aliases.top; alias_data ++) {
-        if (strcmp((char *)alias_data->anchor, (char *)anchor) == 0) {
-            yaml_free(anchor);
-            return alias_data->index;
+    workers = yaml_malloc((threads-1)*sizeof(pthread_t));
+    if (workers) {
+        while (workers_count < threads-1
+                && !pthread_create(workers+workers_count, NULL,
+                    yaml_parser_load_parts, &pool)) {
+            workers_count ++;
         }
     }
 
-    yaml_free(anchor);
-    return yaml_parser_set_composer_error(parser, "found undefined alias",
-            first_event->start_mark);
-}
+    yaml_parser_load_parts(&pool);
 
-/*
- * Compose a scalar node.
- */
+    for (idx2 = 0; idx2 < workers_count; idx2 ++) {
+        pthread_join(workers[idx2], NULL);
+    }
+    yaml_free(workers);
+    pthread_mutex_destroy(&pool.mutex);
 
-static int
-yaml_parser_load_scalar(yaml_parser_t *parser, yaml_event_t *first_event)
-{
-    yaml_node_t node;
-    int index;
-    yaml_char_t *tag = first_event->data.scalar.tag;
+    if (!pool.is_failed) {
+        documents = yaml_malloc(pool.parts.length*sizeof(yaml_document_t));
+    }
 
-    if (!tag || strcmp((char *)tag, "!") == 0) {
-        yaml_free(tag);
-        tag = yaml_strdup((yaml_char_t *)YAML_DEFAULT_SCALAR_TAG);
-        if (!tag) goto error;
+    if (!documents) {
+        for (idx = 0; idx < pool.parts.length; idx ++) {
+            yaml_document_clear(&pool.parts.list[idx].document);
+        }
+        yaml_free(pool.parts.list);
+        return 0;
     }
 
-    SCALAR_NODE_INIT(node, tag, first_event->data.scalar.value,
-            first_event->data.scalar.length, first_event->data.scalar.style,
-            first_event->start_mark, first_event->end_mark);
+    /*
+     * Each part is parsed from the beginning of a line, so the marks of its
+     * document are made absolute by adding the preceding line and character
+     * counts.
+     */
+
+    for (idx = 0; idx < pool.parts.length; idx ++)
+    {
+        yaml_stream_part_t *part = pool.parts.list + idx;
+
+        if (part->document.type) {
+            yaml_document_shift_marks(&part->document, base,
+                    !parser->is_markless);
+            documents[count++] = part->document;
+        }
 
-    if (!PUSH(parser, parser->document->nodes, node)) goto error;
+        base.index += part->end_mark.index;
+        base.line += part->end_mark.line;
+    }
 
-    index = parser->document->nodes.top - parser->document->nodes.start;
+    yaml_free(pool.parts.list);
 
-    if (!yaml_parser_register_anchor(parser, index,
-                first_event->data.scalar.anchor)) return 0;
+    parser->mark = base;
+    parser->state = YAML_PARSE_END_STATE;
 
-    return index;
+    *documents_ref = documents;
+    *count_ref = count;
 
-error:
-    yaml_free(tag);
-    yaml_free(first_event->data.scalar.anchor);
-    yaml_free(first_event->data.scalar.value);
-    return 0;
+    return 1;
 }
 
 /*
- * Compose a sequence node.
+ * Split the input string on the document start indicators.
+ *
+ * A `---` indicator at the beginning of a line always starts a document: a
+ * block scalar is always indented and a plain scalar is broken on it, while
+ * a quoted scalar or a flow collection containing it fails to load in both
+ * parts and so the whole stream is loaded sequentially.  Directives and
+ * comments preceding the indicator are moved to the part it starts.
  */
 
 static int
-yaml_parser_load_sequence(yaml_parser_t *parser, yaml_event_t *first_event)
+yaml_parser_split_stream(yaml_stream_pool_t *pool,
+        const unsigned char *buffer, size_t length)
 {
-    yaml_event_t event;
-    yaml_node_t node;
-    struct {
-        yaml_node_item_t *start;
-        yaml_node_item_t *end;
-        yaml_node_item_t *top;
-    } items = { NULL, NULL, NULL };
-    int index, item_index;
-    yaml_char_t *tag = first_event->data.sequence_start.tag;
+    const unsigned char *end = buffer+length;
+    const unsigned char *content = buffer;
+    const unsigned char *start = buffer;
+    const unsigned char *pointer;
+    const unsigned char *indicator;
+    yaml_stream_part_t part;
+
+    memset(&part, 0, sizeof(yaml_stream_part_t));
 
-    if (!tag || strcmp((char *)tag, "!") == 0) {
-        yaml_free(tag);
-        tag = yaml_strdup((yaml_char_t *)YAML_DEFAULT_SEQUENCE_TAG);
-        if (!tag) goto error;
+    /* Skip the UTF-8 BOM. */
+
+    if (length >= 3 && buffer[0] == 0xEF
+            && buffer[1] == 0xBB && buffer[2] == 0xBF) {
+        content += 3;
     }
 
-    if (!STACK_INIT(parser, items, INITIAL_STACK_SIZE)) goto error;
+    pool->parts.list = yaml_malloc(INITIAL_STACK_CAPACITY
+            *sizeof(yaml_stream_part_t));
+    if (!pool->parts.list)
+        return 0;
+    pool->parts.length = 0;
+    pool->parts.capacity = INITIAL_STACK_CAPACITY;
+
+    pointer = content;
+
+    while ((indicator = yaml_parser_find_document_start(buffer,
+                    pointer, end)))
+    {
+        const unsigned char *boundary = yaml_parser_skip_prologue(
+                pool->parts.length ? start : content, indicator);
 
-    SEQUENCE_NODE_INIT(node, tag, items.start, items.end,
-            first_event->data.sequence_start.style,
-            first_event->start_mark, first_event->end_mark);
+        pointer = indicator+3;
 
-    if (!PUSH(parser, parser->document->nodes, node)) goto error;
+        /* The stream prologue belongs to the first document. */
 
-    index = parser->document->nodes.top - parser->document->nodes.start;
+        if (!pool->parts.length && boundary == content)
+            continue;
 
-    if (!yaml_parser_register_anchor(parser, index,
-                first_event->data.sequence_start.anchor)) return 0;
+        part.start = start;
+        part.length = boundary-start;
 
-    if (!yaml_parser_parse(parser, &event)) return 0;
+        if (pool->parts.length == pool->parts.capacity
+                && !yaml_stack_extend((void **)&pool->parts.list,
+                    sizeof(yaml_stream_part_t), &pool->parts.length,
+                    &pool->parts.capacity))
+            goto error;
+        pool->parts.list[pool->parts.length++] = part;
 
-    while (event.type != YAML_SEQUENCE_END_EVENT) {
-        item_index = yaml_parser_load_node(parser, &event);
-        if (!item_index) return 0;
-        if (!PUSH(parser,
-                    parser->document->nodes.start[index-1].data.sequence.items,
-                    item_index)) return 0;
-        if (!yaml_parser_parse(parser, &event)) return 0;
+        start = boundary;
     }
 
-    parser->document->nodes.start[index-1].end_mark = event.end_mark;
+    part.start = start;
+    part.length = end-start;
+
+    if (pool->parts.length == pool->parts.capacity
+            && !yaml_stack_extend((void **)&pool->parts.list,
+                sizeof(yaml_stream_part_t), &pool->parts.length,
+                &pool->parts.capacity))
+        goto error;
+    pool->parts.list[pool->parts.length++] = part;
 
-    return index;
+    return 1;
 
 error:
-    yaml_free(tag);
-    yaml_free(first_event->data.sequence_start.anchor);
+
+    yaml_free(pool->parts.list);
+    pool->parts.list = NULL;
+
     return 0;
 }
 
 /*
- * Compose a mapping node.
+ * Find the next `---` indicator followed by a blank, a line break or the end
+ * of the string that is placed at the beginning of a line.
  */
 
-static int
-yaml_parser_load_mapping(yaml_parser_t *parser, yaml_event_t *first_event)
+static const unsigned char *
+yaml_parser_find_document_start(const unsigned char *buffer,
+        const unsigned char *pointer, const unsigned char *end)
 {
-    yaml_event_t event;
-    yaml_node_t node;
-    struct {
-        yaml_node_pair_t *start;
-        yaml_node_pair_t *end;
-        yaml_node_pair_t *top;
-    } pairs = { NULL, NULL, NULL };
-    int index;
-    yaml_node_pair_t pair;
-    yaml_char_t *tag = first_event->data.mapping_start.tag;
-
-    if (!tag || strcmp((char *)tag, "!") == 0) {
-        yaml_free(tag);
-        tag = yaml_strdup((yaml_char_t *)YAML_DEFAULT_MAPPING_TAG);
-        if (!tag) goto error;
+    while (pointer < end
+            && (pointer = memchr(pointer, '-', end-pointer)))
+    {
+        const unsigned char *next = pointer+3;
+
+        if (next <= end && pointer[1] == '-' && pointer[2] == '-'
+                && (next == end || next[0] == ' ' || next[0] == '\t'
+                    || next[0] == '\r' || next[0] == '\n'
+                    || (end-next >= 2 && next[0] == 0xC2 && next[1] == 0x85)
+                    || (end-next >= 3 && next[0] == 0xE2 && next[1] == 0x80
+                        && (next[2] == 0xA8 || next[2] == 0xA9)))
+                && pointer > buffer
+                && (pointer[-1] == '\r' || pointer[-1] == '\n'
+                    || (pointer-buffer >= 2
+                        && pointer[-2] == 0xC2 && pointer[-1] == 0x85)
+                    || (pointer-buffer >= 3 && pointer[-3] == 0xE2
+                        && pointer[-2] == 0x80
+                        && (pointer[-1] == 0xA8 || pointer[-1] == 0xA9))))
+            return pointer;
+
+        pointer ++;
     }
 
-    if (!STACK_INIT(parser, pairs, INITIAL_STACK_SIZE)) goto error;
+    return NULL;
+}
 
-    MAPPING_NODE_INIT(node, tag, pairs.start, pairs.end,
-            first_event->data.mapping_start.style,
-            first_event->start_mark, first_event->end_mark);
+/*
+ * Move a part boundary back over the directives and comments preceding the
+ * document start indicator.
+ *
+ * The lines could be skipped only if they follow a `...` indicator or the
+ * beginning of the stream, where `%` always starts a directive.  Returns the
+ * beginning of the first skipped line, `start` if all lines up to `start` are
+ * skipped, or `pointer` if nothing could be skipped.
+ */
 
-    if (!PUSH(parser, parser->document->nodes, node)) goto error;
+static const unsigned char *
+yaml_parser_skip_prologue(const unsigned char *start,
+        const unsigned char *pointer)
+{
+    const unsigned char *line_end = pointer;
 
-    index = parser->document->nodes.top - parser->document->nodes.start;
+    while (line_end > start)
+    {
+        const unsigned char *line_start = line_end;
+        size_t length;
 
-    if (!yaml_parser_register_anchor(parser, index,
-                first_event->data.mapping_start.anchor)) return 0;
+        /* Only LF, CR and CR LF breaks are recognized here. */
 
-    if (!yaml_parser_parse(parser, &event)) return 0;
+        if (line_start[-1] == '\n') {
+            line_start --;
+            if (line_start > start && line_start[-1] == '\r') {
+                line_start --;
+            }
+        }
+        else if (line_start[-1] == '\r') {
+            line_start --;
+        }
+        else
+            return pointer;
+
+        length = 0;
+        while (line_start > start
+                && line_start[-1] != '\r' && line_start[-1] != '\n') {
+            line_start --;
+            length ++;
+        }
 
-    while (event.type != YAML_MAPPING_END_EVENT) {
-        pair.key = yaml_parser_load_node(parser, &event);
-        if (!pair.key) return 0;
-        if (!yaml_parser_parse(parser, &event)) return 0;
-        pair.value = yaml_parser_load_node(parser, &event);
-        if (!pair.value) return 0;
-        if (!PUSH(parser,
-                    parser->document->nodes.start[index-1].data.mapping.pairs,
-                    pair)) return 0;
-        if (!yaml_parser_parse(parser, &event)) return 0;
-    }
+        if (length >= 3 && line_start[0] == '.' && line_start[1] == '.'
+                && line_start[2] == '.' && (length == 3
+                    || line_start[3] == ' ' || line_start[3] == '\t'))
+            return line_end;
 
-    parser->document->nodes.start[index-1].end_mark = event.end_mark;
+        if (length && line_start[0] != '%' && line_start[0] != '#')
+            return pointer;
 
-    return index;
+        line_end = line_start;
+    }
+
+    return start;
+}
+
+/*
+ * Load the parts of the input string until all of them are taken or some
+ * part fails to load.
+ */
+
+static void *
+yaml_parser_load_parts(void *data)
+{
+    yaml_stream_pool_t *pool = data;
+    yaml_parser_t *parser = pool->parser;
+    yaml_parser_t *worker = yaml_parser_new();
+
+    while (1)
+    {
+        yaml_stream_part_t *part;
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!worker) {
+            pool->is_failed = 1;
+        }
+        if (pool->is_failed || pool->next == pool->parts.length) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        part = pool->parts.list + pool->next++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        yaml_parser_reset(worker);
+
+        yaml_parser_set_string_reader(worker, part->start, part->length);
+        if (parser->encoding) {
+            yaml_parser_set_encoding(worker, parser->encoding);
+        }
+        if (parser->resolver) {
+            yaml_parser_set_resolver(worker,
+                    parser->resolver, parser->resolver_data);
+        }
+        yaml_parser_set_allocator(worker, &parser->allocator);
+        yaml_parser_set_arena(worker, parser->is_arena);
+        yaml_parser_set_zero_copy(worker, parser->is_zero_copy);
+        yaml_parser_set_compact(worker, parser->is_compact);
+        yaml_parser_set_mark_tracking(worker, !parser->is_markless);
+        yaml_parser_set_unique_keys(worker, parser->is_unique_keys);
+        yaml_parser_set_expansion_limits(worker,
+                parser->max_expanded_nodes, parser->max_expanded_depth);
+
+        if (!yaml_parser_parse_single_document(worker, &part->document)) {
+            pthread_mutex_lock(&pool->mutex);
+            pool->is_failed = 1;
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+
+        part->end_mark = worker->mark;
+    }
+
+    if (worker) {
+        yaml_parser_delete(worker);
+    }
+
+    return NULL;
+}
+
+/*
+ * Add the position of a part to the marks of its document.
+ *
+ * The part starts at the beginning of a line, so the columns stay the same.
+ * Without the mark tracking, the node marks only keep the offsets.
+ */
+
+static void
+yaml_document_shift_marks(yaml_document_t *document, yaml_mark_t base,
+        int is_tracking_marks)
+{
+    size_t idx;
+
+    document->start_mark.index += base.index;
+    document->start_mark.line += base.line;
+    document->end_mark.index += base.index;
+    document->end_mark.line += base.line;
+
+    if (document->compact)
+        return;
+
+    for (idx = 0; idx < document->nodes.length; idx ++) {
+        yaml_node_t *node = document->nodes.list + idx;
+        node->start_mark.index += base.index;
+        node->end_mark.index += base.index;
+        if (is_tracking_marks) {
+            node->start_mark.line += base.line;
+            node->end_mark.line += base.line;
+        }
+    }
+}
+
+#endif
+
+/*
+ * Move a string produced by the parser into the document memory.
+ *
+ * With the standard allocator, the document takes the string as is.
+ * Otherwise, the string is copied using the document allocator and the
+ * original string is freed.  In either case, the source pointer is cleared, so
+ * that the event could be safely cleared on error.
+ */
+
+static int
+yaml_parser_adopt_string(yaml_parser_t *parser,
+        yaml_char_t **string_ref, size_t length, yaml_char_t **target_ref)
+{
+    yaml_document_t *document = parser->document;
+
+    if (!*string_ref) {
+        *target_ref = NULL;
+        return 1;
+    }
+
+    if (IS_STANDARD_ALLOCATOR(document->allocator)) {
+        *target_ref = *string_ref;
+        *string_ref = NULL;
+        return 1;
+    }
+
+    *target_ref = yaml_allocator_strndup(&document->allocator,
+            *string_ref, length);
+    if (!*target_ref)
+        return MEMORY_ERROR_INIT(parser);
+
+    yaml_free(*string_ref);
+    *string_ref = NULL;
+
+    return 1;
+}
+
+/*
+ * Move a node anchor produced by the parser into the document string table.
+ */
+
+static int
+yaml_parser_adopt_anchor(yaml_parser_t *parser,
+        yaml_char_t **anchor_ref, yaml_char_t **target_ref)
+{
+    if (!*anchor_ref) {
+        *target_ref = NULL;
+        return 1;
+    }
+
+    *target_ref = yaml_document_adopt_string(parser->document, anchor_ref,
+            strlen((char *)*anchor_ref));
+    if (!*target_ref)
+        return MEMORY_ERROR_INIT(parser);
+
+    return 1;
+}
+
+/*
+ * Move the document directives from a DOCUMENT-START event into the document.
+ */
+
+static int
+yaml_parser_adopt_directives(yaml_parser_t *parser, yaml_event_t *event)
+{
+    yaml_document_t *document = parser->document;
+    int idx;
+
+    if (IS_STANDARD_ALLOCATOR(document->allocator)) {
+        document->version_directive
+            = event->data.document_start.version_directive;
+        document->tag_directives.list
+            = event->data.document_start.tag_directives.list;
+        document->tag_directives.length
+            = event->data.document_start.tag_directives.length;
+        document->tag_directives.capacity
+            = event->data.document_start.tag_directives.capacity;
+        event->data.document_start.version_directive = NULL;
+        event->data.document_start.tag_directives.list = NULL;
+        event->data.document_start.tag_directives.length = 0;
+        event->data.document_start.tag_directives.capacity = 0;
+        return 1;
+    }
+
+    if (event->data.document_start.version_directive) {
+        document->version_directive = yaml_allocator_malloc(
+                &document->allocator, sizeof(yaml_version_directive_t));
+        if (!document->version_directive)
+            return MEMORY_ERROR_INIT(parser);
+        *document->version_directive
+            = *event->data.document_start.version_directive;
+    }
+
+    if (event->data.document_start.tag_directives.length) {
+        if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                    document->tag_directives,
+                    event->data.document_start.tag_directives.length))
+            return 0;
+        for (idx = 0; idx < event->data.document_start.tag_directives.length;
+                idx ++) {
+            yaml_tag_directive_t *value = STACK_ITER(parser,
+                    event->data.document_start.tag_directives, idx);
+            yaml_tag_directive_t copy;
+            copy.handle = yaml_allocator_strdup(&document->allocator,
+                    value->handle);
+            copy.prefix = yaml_allocator_strdup(&document->allocator,
+                    value->prefix);
+            if (!copy.handle || !copy.prefix) {
+                yaml_allocator_free(&document->allocator, copy.handle);
+                yaml_allocator_free(&document->allocator, copy.prefix);
+                return MEMORY_ERROR_INIT(parser);
+            }
+            if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                        document->tag_directives, copy)) {
+                yaml_allocator_free(&document->allocator, copy.handle);
+                yaml_allocator_free(&document->allocator, copy.prefix);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Register the anchor of a new node.
+ */
+
+static int
+yaml_parser_register_anchor(yaml_parser_t *parser, int node_id,
+        yaml_char_t *anchor, yaml_mark_t mark)
+{
+    yaml_alias_data_t data;
+    int *slot;
+
+    if (!anchor)
+        return 1;
+
+    /* Keep the hash index at most half full. */
+
+    if ((parser->aliases.length+1)*2 > parser->alias_index.capacity) {
+        if (!yaml_parser_extend_alias_index(parser))
+            return 0;
+    }
+
+    data.anchor = anchor;
+    data.hash = yaml_string_hash(anchor, strlen((char *)anchor));
+    data.index = node_id;
+    data.mark = mark;
+
+    slot = yaml_parser_find_anchor(parser, data.anchor, data.hash);
+
+    if (*slot >= 0) {
+        yaml_alias_data_t *alias_data = parser->aliases.list + *slot;
+        return COMPOSER_ERROR_WITH_CONTEXT_INIT(parser,
+                "found duplicate anchor; first occurence",
+                alias_data->mark, "second occurence", mark);
+    }
+
+    if (!PUSH(parser, parser->aliases, data))
+        return 0;
+
+    *slot = parser->aliases.length-1;
+
+    return 1;
+}
+
+/*
+ * Find the hash index slot of an anchor.  Return the slot referring to the
+ * alias data of the anchor or the empty slot where it should be put.
+ */
+
+static int *
+yaml_parser_find_anchor(yaml_parser_t *parser,
+        const yaml_char_t *anchor, size_t hash)
+{
+    size_t mask = parser->alias_index.capacity-1;
+    size_t position = hash & mask;
+
+    while (1)
+    {
+        int *slot = parser->alias_index.list + position;
+        yaml_alias_data_t *alias_data;
+
+        if (*slot < 0)
+            return slot;
+
+        alias_data = parser->aliases.list + *slot;
+
+        if (alias_data->hash == hash
+                && strcmp((char *)alias_data->anchor, (char *)anchor) == 0)
+            return slot;
+
+        position = (position+1) & mask;
+    }
+}
+
+/*
+ * Double the capacity of the hash index and put the alias data into it again.
+ */
+
+static int
+yaml_parser_extend_alias_index(yaml_parser_t *parser)
+{
+    size_t capacity = parser->alias_index.capacity
+        ? parser->alias_index.capacity*2 : INITIAL_STACK_CAPACITY;
+    int *list = yaml_malloc(capacity*sizeof(int));
+    int idx;
+
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+
+    memset(list, 0xFF, capacity*sizeof(int));
+
+    yaml_free(parser->alias_index.list);
+    parser->alias_index.list = list;
+    parser->alias_index.capacity = capacity;
+
+    for (idx = 0; idx < parser->aliases.length; idx ++) {
+        yaml_alias_data_t *alias_data = parser->aliases.list + idx;
+        *yaml_parser_find_anchor(parser, alias_data->anchor, alias_data->hash)
+            = idx;
+    }
+
+    return 1;
+}
+
+/*
+ * Forget the anchors of the last document.
+ */
+
+static void
+yaml_parser_clear_aliases(yaml_parser_t *parser)
+{
+    if (parser->aliases.length) {
+        memset(parser->alias_index.list, 0xFF,
+                parser->alias_index.capacity*sizeof(int));
+    }
+
+    parser->aliases.length = 0;
+}
+
+/*
+ * Start accounting the expanded size of a new node.  Until a collection is
+ * complete, it is counted as a single node.
+ */
+
+static int
+yaml_parser_start_expansion(yaml_parser_t *parser)
+{
+    yaml_expansion_t expansion = { 1, 1 };
+
+    assert(parser->expansions.length == parser->document->nodes.length-1);
+                        /* One record per node is expected. */
+
+    return PUSH(parser, parser->expansions, expansion);
+}
+
+/*
+ * Add the expanded size of a collection item to the collection and check the
+ * limits.  The error is reported at the start mark of the collection where a
+ * limit is exceeded.
+ * Aliases share the node id with the anchored node, so an aliased
+ * subtree is counted as many times as it is referred.
+ */
+
+static int
+yaml_parser_expand_item(yaml_parser_t *parser, int node_id, int item_id,
+        yaml_mark_t mark)
+{
+    yaml_expansion_t *collection = parser->expansions.list + node_id;
+    yaml_expansion_t *item = parser->expansions.list + item_id;
+    size_t depth = parser->path.length + item->depth;
+
+    if (collection->nodes > (size_t)-1 - item->nodes) {
+        collection->nodes = (size_t)-1;
+    }
+    else {
+        collection->nodes += item->nodes;
+    }
+
+    if (collection->depth < item->depth+1) {
+        collection->depth = item->depth+1;
+    }
+
+    if (parser->max_expanded_nodes
+            && collection->nodes > parser->max_expanded_nodes)
+        return COMPOSER_ERROR_INIT(parser,
+                "found too many nodes after expanding aliases", mark);
+
+    if (parser->max_expanded_depth && depth > parser->max_expanded_depth)
+        return COMPOSER_ERROR_INIT(parser,
+                "found too deep nesting after expanding aliases", mark);
+
+    return 1;
+}
+
+/*
+ * Start the compact node storage of a new document.
+ */
+
+static int
+yaml_parser_create_compact_nodes(yaml_parser_t *parser)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes;
+
+    nodes = yaml_allocator_malloc(&document->allocator,
+            sizeof(yaml_compact_nodes_t));
+    if (!nodes)
+        return MEMORY_ERROR_INIT(parser);
+
+    memset(nodes, 0, sizeof(yaml_compact_nodes_t));
+    document->compact = nodes;
+
+    nodes->types = yaml_allocator_malloc(&document->allocator,
+            INITIAL_STACK_CAPACITY*sizeof(*nodes->types));
+    nodes->tag_ids = yaml_allocator_malloc(&document->allocator,
+            INITIAL_STACK_CAPACITY*sizeof(*nodes->tag_ids));
+    nodes->offsets = yaml_allocator_malloc(&document->allocator,
+            INITIAL_STACK_CAPACITY*sizeof(*nodes->offsets));
+    nodes->lengths = yaml_allocator_malloc(&document->allocator,
+            INITIAL_STACK_CAPACITY*sizeof(*nodes->lengths));
+    if (!nodes->types || !nodes->tag_ids || !nodes->offsets || !nodes->lengths)
+        return MEMORY_ERROR_INIT(parser);
+    nodes->capacity = INITIAL_STACK_CAPACITY;
+
+    if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                nodes->tags, INITIAL_STACK_CAPACITY))
+        return 0;
+    if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                nodes->values, INITIAL_STRING_CAPACITY))
+        return 0;
+    if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                nodes->items, INITIAL_STACK_CAPACITY))
+        return 0;
+    if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                nodes->pairs, INITIAL_STACK_CAPACITY))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Add a node to a compact document.
+ */
+
+static int
+yaml_parser_add_compact_node(yaml_parser_t *parser, yaml_node_type_t type,
+        yaml_char_t *tag, size_t offset, size_t length)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+    size_t index = document->nodes.length;
+    int tag_id;
+
+    if (!yaml_parser_get_tag_id(parser, tag, &tag_id))
+        return 0;
+
+    if (index == nodes->capacity) {
+        if (!yaml_parser_extend_compact_nodes(parser))
+            return 0;
+    }
+
+    nodes->types[index] = type;
+    nodes->tag_ids[index] = tag_id;
+    nodes->offsets[index] = offset;
+    nodes->lengths[index] = length;
+
+    document->nodes.length ++;
+
+    return 1;
+}
+
+/*
+ * Double the capacity of the node columns of a compact document.
+ */
+
+static int
+yaml_parser_extend_compact_nodes(yaml_parser_t *parser)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+    size_t capacity = nodes->capacity*2;
+    void *list;
+
+    list = yaml_allocator_realloc(&document->allocator, nodes->types,
+            capacity*sizeof(*nodes->types));
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+    nodes->types = list;
+
+    list = yaml_allocator_realloc(&document->allocator, nodes->tag_ids,
+            capacity*sizeof(*nodes->tag_ids));
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+    nodes->tag_ids = list;
+
+    list = yaml_allocator_realloc(&document->allocator, nodes->offsets,
+            capacity*sizeof(*nodes->offsets));
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+    nodes->offsets = list;
+
+    list = yaml_allocator_realloc(&document->allocator, nodes->lengths,
+            capacity*sizeof(*nodes->lengths));
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+    nodes->lengths = list;
+
+    nodes->capacity = capacity;
+
+    return 1;
+}
+
+/*
+ * Get the position of a tag in the tag list of a compact document, adding the
+ * tag to the list if it is not there yet.
+ */
+
+static int
+yaml_parser_get_tag_id(yaml_parser_t *parser, yaml_char_t *tag, int *tag_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+    int *slot;
+
+    /* Keep the hash index at most half full. */
+
+    if ((nodes->tags.length+1)*2 > parser->tag_index.capacity) {
+        if (!yaml_parser_extend_tag_index(parser))
+            return 0;
+    }
+
+    slot = yaml_parser_find_tag(parser, tag);
+
+    if (*slot < 0) {
+        if (!ALLOCATOR_PUSH(parser, &document->allocator, nodes->tags, tag))
+            return 0;
+        *slot = nodes->tags.length-1;
+    }
+
+    *tag_id = *slot;
+
+    return 1;
+}
+
+/*
+ * Find the hash index slot of a tag.  The tags are interned, so they are
+ * hashed and compared as pointers.
+ */
+
+static int *
+yaml_parser_find_tag(yaml_parser_t *parser, yaml_char_t *tag)
+{
+    yaml_compact_nodes_t *nodes = parser->document->compact;
+    size_t mask = parser->tag_index.capacity-1;
+    size_t position = (((size_t)tag >> 4) * 2654435761U) & mask;
+
+    while (1)
+    {
+        int *slot = parser->tag_index.list + position;
+
+        if (*slot < 0 || nodes->tags.list[*slot] == tag)
+            return slot;
+
+        position = (position+1) & mask;
+    }
+}
+
+/*
+ * Double the capacity of the tag index and put the tags into it again.
+ */
+
+static int
+yaml_parser_extend_tag_index(yaml_parser_t *parser)
+{
+    yaml_compact_nodes_t *nodes = parser->document->compact;
+    size_t capacity = parser->tag_index.capacity
+        ? parser->tag_index.capacity*2 : INITIAL_STACK_CAPACITY;
+    int *list = yaml_malloc(capacity*sizeof(int));
+    int idx;
+
+    if (!list)
+        return MEMORY_ERROR_INIT(parser);
+
+    memset(list, 0xFF, capacity*sizeof(int));
+
+    yaml_free(parser->tag_index.list);
+    parser->tag_index.list = list;
+    parser->tag_index.capacity = capacity;
+
+    for (idx = 0; idx < nodes->tags.length; idx ++) {
+        *yaml_parser_find_tag(parser, nodes->tags.list[idx]) = idx;
+    }
+
+    return 1;
+}
+
+/*
+ * Forget the tags of the last compact document.
+ */
+
+static void
+yaml_parser_clear_tag_index(yaml_parser_t *parser)
+{
+    if (parser->tag_index.list) {
+        memset(parser->tag_index.list, 0xFF,
+                parser->tag_index.capacity*sizeof(int));
+    }
+}
+
+/*
+ * Copy a scalar value into the value buffer of a compact document.
+ *
+ * The path arcs of the values of scalar keys point into the buffer, so when
+ * the buffer is moved, they are moved with it.
+ */
+
+static int
+yaml_parser_append_compact_value(yaml_parser_t *parser,
+        const yaml_char_t *value, size_t length, size_t *offset)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+
+    if (nodes->values.capacity - nodes->values.length < length+1)
+    {
+        size_t capacity = nodes->values.capacity;
+        yaml_char_t *list;
+        int idx;
+
+        while (capacity - nodes->values.length < length+1) {
+            capacity *= 2;
+        }
+
+        list = yaml_allocator_malloc(&document->allocator, capacity);
+        if (!list)
+            return MEMORY_ERROR_INIT(parser);
+
+        memcpy(list, nodes->values.list, nodes->values.length);
+
+        for (idx = 0; idx < parser->path.length; idx ++) {
+            yaml_arc_t *arc = parser->path.list + idx;
+            if (arc->type == YAML_MAPPING_VALUE_ARC
+                    && arc->data.value.key.type == YAML_SCALAR_NODE) {
+                arc->data.value.key.data.scalar.value = list
+                    + (arc->data.value.key.data.scalar.value
+                            - nodes->values.list);
+            }
+        }
+
+        yaml_allocator_free(&document->allocator, nodes->values.list);
+        nodes->values.list = list;
+        nodes->values.capacity = capacity;
+    }
+
+    *offset = nodes->values.length;
+
+    memcpy(nodes->values.list + nodes->values.length, value, length);
+    nodes->values.list[nodes->values.length+length] = '\0';
+    nodes->values.length += length+1;
+
+    return 1;
+}
+
+/*
+ * Move the items of a complete sequence into the item list of a compact
+ * document.
+ *
+ * The items of unfinished sequences are kept on a stack, so the items of
+ * nested sequences come above them and are moved away first.
+ */
+
+static int
+yaml_parser_finish_compact_sequence(yaml_parser_t *parser, int node_id,
+        size_t base)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+    size_t length = parser->pending_items.length - base;
+
+    while (nodes->items.capacity - nodes->items.length < length) {
+        if (!yaml_allocator_stack_extend(&document->allocator,
+                    (void **)&nodes->items.list, sizeof(*nodes->items.list),
+                    &nodes->items.length, &nodes->items.capacity))
+            return MEMORY_ERROR_INIT(parser);
+    }
+
+    memcpy(nodes->items.list + nodes->items.length,
+            parser->pending_items.list + base,
+            length*sizeof(*nodes->items.list));
+
+    nodes->offsets[node_id] = nodes->items.length;
+    nodes->lengths[node_id] = length;
+    nodes->items.length += length;
+    parser->pending_items.length = base;
+
+    return 1;
+}
+
+/*
+ * Move the pairs of a complete mapping into the pair list of a compact
+ * document.
+ */
+
+static int
+yaml_parser_finish_compact_mapping(yaml_parser_t *parser, int node_id,
+        size_t base)
+{
+    yaml_document_t *document = parser->document;
+    yaml_compact_nodes_t *nodes = document->compact;
+    size_t length = parser->pending_pairs.length - base;
+
+    while (nodes->pairs.capacity - nodes->pairs.length < length) {
+        if (!yaml_allocator_stack_extend(&document->allocator,
+                    (void **)&nodes->pairs.list, sizeof(*nodes->pairs.list),
+                    &nodes->pairs.length, &nodes->pairs.capacity))
+            return MEMORY_ERROR_INIT(parser);
+    }
+
+    memcpy(nodes->pairs.list + nodes->pairs.length,
+            parser->pending_pairs.list + base,
+            length*sizeof(*nodes->pairs.list));
+
+    nodes->offsets[node_id] = nodes->pairs.length;
+    nodes->lengths[node_id] = length;
+    nodes->pairs.length += length;
+    parser->pending_pairs.length = base;
+
+    return 1;
+}
+
+/*
+ * Determine the tag of a new node.
+ *
+ * A node with an explicit specific tag keeps it.  For a node without a tag or
+ * with the non-specific tag `!`, the tag is determined by the resolver if it
+ * is set and is the default tag for the node kind otherwise.
+ */
+
+static int
+yaml_parser_resolve_tag(yaml_parser_t *parser, yaml_incomplete_node_t *node,
+        yaml_char_t **tag_ref, yaml_char_t **target_ref)
+{
+    yaml_document_t *document = parser->document;
+    const yaml_char_t *tag = NULL;
+
+    if (*tag_ref && strcmp((char *)*tag_ref, "!") != 0) {
+        *target_ref = yaml_document_adopt_string(document, tag_ref,
+                strlen((char *)*tag_ref));
+        if (!*target_ref)
+            return MEMORY_ERROR_INIT(parser);
+        return 1;
+    }
+
+    if (parser->resolver) {
+        if (!parser->resolver(parser->resolver_data, node, &tag))
+            return RESOLVER_ERROR_INIT(parser, "cannot resolve a node tag");
+        if (!tag)
+            return RESOLVER_ERROR_INIT(parser, "no tag is provided");
+    }
+    else {
+        switch (node->type) {
+            case YAML_SCALAR_NODE:
+                tag = yaml_str_tag;
+                break;
+            case YAML_SEQUENCE_NODE:
+                tag = yaml_seq_tag;
+                break;
+            case YAML_MAPPING_NODE:
+                tag = yaml_map_tag;
+                break;
+            default:
+                assert(0);  /* Could not happen. */
+        }
+    }
+
+    *target_ref = yaml_document_intern_string(document, tag,
+            strlen((char *)tag));
+    if (!*target_ref)
+        return MEMORY_ERROR_INIT(parser);
+
+    yaml_free(*tag_ref);
+    *tag_ref = NULL;
+
+    return 1;
+}
+
+/*
+ * Compose a document object.
+ */
+
+static int
+yaml_parser_load_document(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event)
+{
+    yaml_document_t *document = parser->document;
+    yaml_mark_t mark = { 0, 0, 0 };
+    int root_id;
+
+    assert(event->type == YAML_DOCUMENT_START_EVENT);
+                        /* DOCUMENT-START is expected. */
+
+    DOCUMENT_INIT(*document, NULL, 0, 0, NULL, NULL, 0, 0,
+            event->data.document_start.is_implicit, 0,
+            event->start_mark, mark);
+
+    if (parser->is_arena) {
+        yaml_arena_t *arena = yaml_arena_new(&parser->allocator);
+        if (!arena) {
+            MEMORY_ERROR_INIT(parser);
+            goto error;
+        }
+        document->arena = arena;
+        yaml_arena_get_allocator(arena, &document->allocator);
+    }
+    else {
+        document->allocator = parser->allocator;
+    }
+
+    if (parser->is_compact) {
+        if (!yaml_parser_create_compact_nodes(parser))
+            goto error;
+    }
+    else if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                document->nodes, INITIAL_STACK_CAPACITY))
+        goto error;
+
+    if (!yaml_parser_adopt_directives(parser, event))
+        goto error;
+
+    yaml_event_clear(event);
+
+    if (!yaml_parser_parse_event(parser, event))
+        return 0;
+
+    if (selector) {
+        if (!yaml_parser_load_selection(parser, selector, event, &root_id))
+            return 0;
+    }
+    else if (!yaml_parser_load_node(parser, event, &root_id))
+        return 0;
+
+    document->expanded_nodes = parser->expansions.list[root_id].nodes;
+    document->expanded_depth = parser->expansions.list[root_id].depth;
+
+    if (!yaml_parser_parse_event(parser, event))
+        return 0;
+    assert(event->type == YAML_DOCUMENT_END_EVENT);
+                        /* DOCUMENT-END is expected. */
+
+    document->is_end_implicit = event->data.document_end.is_implicit;
+    document->end_mark = event->end_mark;
+
+    return 1;
+
+error:
+
+    yaml_event_clear(event);
+
+    return 0;
+}
+
+/*
+ * Compose a node.
+ */
+
+static int
+yaml_parser_load_node(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id)
+{
+    switch (event->type) {
+        case YAML_ALIAS_EVENT:
+            return yaml_parser_load_alias(parser, event, node_id);
+        case YAML_SCALAR_EVENT:
+            return yaml_parser_load_scalar(parser, event, node_id);
+        case YAML_SEQUENCE_START_EVENT:
+            return yaml_parser_load_sequence(parser, event, node_id);
+        case YAML_MAPPING_START_EVENT:
+            return yaml_parser_load_mapping(parser, event, node_id);
+        default:
+            assert(0);  /* Could not happen. */
+            return 0;
+    }
+
+    return 0;
+}
+
+/*
+ * Compose a node corresponding to an alias.
+ */
+
+static int
+yaml_parser_load_alias(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id)
+{
+    yaml_char_t *anchor = event->data.alias.anchor;
+
+    if (parser->aliases.length) {
+        int *slot = yaml_parser_find_anchor(parser, anchor,
+                yaml_string_hash(anchor, strlen((char *)anchor)));
+        if (*slot >= 0) {
+            *node_id = parser->aliases.list[*slot].index;
+            yaml_event_clear(event);
+            return 1;
+        }
+    }
+
+    COMPOSER_ERROR_INIT(parser, "found undefined alias", event->start_mark);
+    yaml_event_clear(event);
+
+    return 0;
+}
+
+/*
+ * Compose a scalar node.
+ */
+
+static int
+yaml_parser_load_scalar(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_incomplete_node_t incomplete_node;
+    yaml_mark_t start_mark = event->start_mark;
+    yaml_char_t *anchor = NULL;
+    yaml_char_t *tag = NULL;
+    yaml_char_t *value = NULL;
+    size_t offset = 0;
+    yaml_node_t node;
+
+    /*
+     * A compact document keeps the value in the common value buffer.
+     * Otherwise, a borrowed value points into the input buffer and is not
+     * terminated, so the document gets its own copy of it.
+     */
+
+    if (document->compact) {
+        if (!yaml_parser_append_compact_value(parser, event->data.scalar.value,
+                    event->data.scalar.length, &offset))
+            goto error;
+        value = ((yaml_compact_nodes_t *)document->compact)->values.list
+            + offset;
+    }
+    else if (event->data.scalar.is_borrowed) {
+        value = yaml_allocator_strndup(&document->allocator,
+                event->data.scalar.value, event->data.scalar.length);
+        if (!value) {
+            MEMORY_ERROR_INIT(parser);
+            goto error;
+        }
+    }
+
+    INCOMPLETE_SCALAR_NODE_INIT(incomplete_node, parser->path.list,
+            parser->path.length, parser->path.capacity,
+            (value ? value : event->data.scalar.value),
+            event->data.scalar.length,
+            (!event->data.scalar.tag
+             && event->data.scalar.style == YAML_PLAIN_SCALAR_STYLE),
+            event->start_mark);
+
+    if (!yaml_parser_resolve_tag(parser, &incomplete_node,
+                &event->data.scalar.tag, &tag))
+        goto error;
+
+    if (!yaml_parser_adopt_anchor(parser, &event->data.scalar.anchor,
+                &anchor))
+        goto error;
+
+    if (document->compact) {
+        if (!yaml_parser_add_compact_node(parser, YAML_SCALAR_NODE, tag,
+                    offset, event->data.scalar.length))
+            goto error;
+        value = NULL;
+    }
+    else {
+        if (!event->data.scalar.is_borrowed &&
+                !yaml_parser_adopt_string(parser, &event->data.scalar.value,
+                    event->data.scalar.length, &value))
+            goto error;
+
+        SCALAR_NODE_INIT(node, anchor, tag, value, event->data.scalar.length,
+                event->data.scalar.style,
+                yaml_parser_node_mark(parser, event->start_mark),
+                yaml_parser_node_mark(parser, event->end_mark));
+        node.data.scalar.kind = incomplete_node.data.scalar.kind;
+        node.data.scalar.converted = incomplete_node.data.scalar.converted;
+
+        if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes, node))
+            goto error;
+    }
+
+    *node_id = document->nodes.length-1;
+
+    yaml_event_clear(event);
+
+    if (!yaml_parser_start_expansion(parser))
+        return 0;
+
+    return yaml_parser_register_anchor(parser, *node_id, anchor, start_mark);
 
 error:
-    yaml_free(tag);
-    yaml_free(first_event->data.mapping_start.anchor);
+
+    if (!document->compact) {
+        yaml_allocator_free(&document->allocator, value);
+    }
+    yaml_event_clear(event);
+
     return 0;
 }
 
-#endif
+/*
+ * Compose a sequence node.
+ */
+
+static int
+yaml_parser_load_sequence(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_incomplete_node_t incomplete_node;
+    yaml_mark_t start_mark = event->start_mark;
+    yaml_char_t *anchor = NULL;
+    yaml_char_t *tag = NULL;
+    struct {
+        yaml_node_item_t *list;
+        size_t length;
+        size_t capacity;
+    } items = { NULL, 0, 0 };
+    yaml_node_t node;
+    yaml_arc_t arc;
+    size_t base = parser->pending_items.length;
+    int index, item_id;
+
+    INCOMPLETE_SEQUENCE_NODE_INIT(incomplete_node, parser->path.list,
+            parser->path.length, parser->path.capacity, event->start_mark);
+
+    if (!yaml_parser_resolve_tag(parser, &incomplete_node,
+                &event->data.sequence_start.tag, &tag))
+        goto error;
+
+    if (!yaml_parser_adopt_anchor(parser, &event->data.sequence_start.anchor,
+                &anchor))
+        goto error;
+
+    if (document->compact) {
+        if (!yaml_parser_add_compact_node(parser, YAML_SEQUENCE_NODE, tag,
+                    0, 0))
+            goto error;
+    }
+    else {
+        if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                    items, INITIAL_STACK_CAPACITY))
+            goto error;
+
+        SEQUENCE_NODE_INIT(node, anchor, tag, items.list, items.length,
+                items.capacity, event->data.sequence_start.style,
+                yaml_parser_node_mark(parser, event->start_mark),
+                yaml_parser_node_mark(parser, event->end_mark));
+
+        if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes, node))
+            goto error;
+    }
+
+    index = document->nodes.length-1;
+
+    yaml_event_clear(event);
+
+    if (!yaml_parser_start_expansion(parser))
+        return 0;
+
+    if (!yaml_parser_register_anchor(parser, index, anchor, start_mark))
+        return 0;
+
+    SEQUENCE_ITEM_ARC_INIT(arc, tag, 0);
+    if (!PUSH(parser, parser->path, arc))
+        return 0;
+
+    if (!yaml_parser_parse_event(parser, event))
+        return 0;
+
+    while (event->type != YAML_SEQUENCE_END_EVENT) {
+        if (!yaml_parser_load_node(parser, event, &item_id))
+            return 0;
+        if (document->compact) {
+            if (!PUSH(parser, parser->pending_items, item_id))
+                return 0;
+        }
+        else if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes.list[index].data.sequence.items, item_id))
+            return 0;
+        if (!yaml_parser_expand_item(parser, index, item_id, start_mark))
+            return 0;
+        parser->path.list[parser->path.length-1].data.item.index ++;
+        if (!yaml_parser_parse_event(parser, event))
+            return 0;
+    }
+
+    (void)POP(parser, parser->path);
+
+    if (document->compact) {
+        if (!yaml_parser_finish_compact_sequence(parser, index, base))
+            return 0;
+    }
+    else {
+        document->nodes.list[index].end_mark
+            = yaml_parser_node_mark(parser, event->end_mark);
+    }
+    *node_id = index;
+
+    return 1;
+
+error:
+
+    ALLOCATOR_STACK_DEL(parser, &document->allocator, items);
+    yaml_event_clear(event);
+
+    return 0;
+}
+
+/*
+ * Compose a mapping node.
+ */
+
+static int
+yaml_parser_load_mapping(yaml_parser_t *parser, yaml_event_t *event,
+        int *node_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_incomplete_node_t incomplete_node;
+    yaml_mark_t start_mark = event->start_mark;
+    yaml_char_t *anchor = NULL;
+    yaml_char_t *tag = NULL;
+    struct {
+        yaml_node_pair_t *list;
+        size_t length;
+        size_t capacity;
+    } pairs = { NULL, 0, 0 };
+    yaml_node_t node;
+    yaml_node_pair_t pair;
+    yaml_arc_t arc;
+    size_t base = parser->pending_pairs.length;
+    int index;
+
+    INCOMPLETE_MAPPING_NODE_INIT(incomplete_node, parser->path.list,
+            parser->path.length, parser->path.capacity, event->start_mark);
+
+    if (!yaml_parser_resolve_tag(parser, &incomplete_node,
+                &event->data.mapping_start.tag, &tag))
+        goto error;
+
+    if (!yaml_parser_adopt_anchor(parser, &event->data.mapping_start.anchor,
+                &anchor))
+        goto error;
+
+    if (document->compact) {
+        if (!yaml_parser_add_compact_node(parser, YAML_MAPPING_NODE, tag,
+                    0, 0))
+            goto error;
+    }
+    else {
+        if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                    pairs, INITIAL_STACK_CAPACITY))
+            goto error;
+
+        MAPPING_NODE_INIT(node, anchor, tag, pairs.list, pairs.length,
+                pairs.capacity, event->data.mapping_start.style,
+                yaml_parser_node_mark(parser, event->start_mark),
+                yaml_parser_node_mark(parser, event->end_mark));
+
+        if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes, node))
+            goto error;
+    }
+
+    index = document->nodes.length-1;
+
+    yaml_event_clear(event);
+
+    if (!yaml_parser_start_expansion(parser))
+        return 0;
+
+    if (!yaml_parser_register_anchor(parser, index, anchor, start_mark))
+        return 0;
+
+    MAPPING_KEY_ARC_INIT(arc, tag);
+    if (!PUSH(parser, parser->path, arc))
+        return 0;
+
+    if (!yaml_parser_parse_event(parser, event))
+        return 0;
+
+    while (event->type != YAML_MAPPING_END_EVENT) {
+        yaml_mark_t key_mark = event->start_mark;
+        MAPPING_KEY_ARC_INIT(parser->path.list[parser->path.length-1], tag);
+        if (!yaml_parser_load_node(parser, event, &pair.key))
+            return 0;
+        yaml_parser_set_value_arc(parser, tag, pair.key);
+        if (!yaml_parser_parse_event(parser, event))
+            return 0;
+        if (!yaml_parser_load_node(parser, event, &pair.value))
+            return 0;
+        if (document->compact) {
+            if (!PUSH(parser, parser->pending_pairs, pair))
+                return 0;
+        }
+        else if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes.list[index].data.mapping.pairs, pair))
+            return 0;
+        if (!yaml_parser_expand_item(parser, index, pair.key, start_mark))
+            return 0;
+        if (!yaml_parser_expand_item(parser, index, pair.value, start_mark))
+            return 0;
+        if (parser->is_unique_keys && !yaml_parser_index_key(parser,
+                    index, pair, start_mark, key_mark))
+            return 0;
+        if (!yaml_parser_parse_event(parser, event))
+            return 0;
+    }
+
+    (void)POP(parser, parser->path);
+
+    if (document->compact) {
+        if (!yaml_parser_finish_compact_mapping(parser, index, base))
+            return 0;
+    }
+    else {
+        document->nodes.list[index].end_mark
+            = yaml_parser_node_mark(parser, event->end_mark);
+    }
+    *node_id = index;
+
+    return 1;
+
+error:
+
+    ALLOCATOR_STACK_DEL(parser, &document->allocator, pairs);
+    yaml_event_clear(event);
+
+    return 0;
+}
+
+/*
+ * Describe the path to the value of a mapping pair with the given key.
+ */
+
+static void
+yaml_parser_set_value_arc(yaml_parser_t *parser, yaml_char_t *tag,
+        int key_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_arc_t *arc = parser->path.list + parser->path.length-1;
+    yaml_char_t *key_tag;
+    yaml_char_t *value;
+    size_t length;
+
+    if (yaml_document_get_scalar(document, key_id, &key_tag, &value, &length)) {
+        MAPPING_VALUE_FOR_SCALAR_KEY_ARC_INIT(*arc, tag, key_tag,
+                value, length);
+    }
+    else if (yaml_document_get_sequence(document, key_id, &key_tag,
+                NULL, NULL)) {
+        MAPPING_VALUE_FOR_SEQUENCE_KEY_ARC_INIT(*arc, tag, key_tag);
+    }
+    else {
+        yaml_document_get_mapping(document, key_id, &key_tag, NULL, NULL);
+        MAPPING_VALUE_FOR_MAPPING_KEY_INIT(*arc, tag, key_tag);
+    }
+}
+
+/*
+ * Add a mapping pair to the document key index and check that its key is not
+ * a duplicate.
+ */
+
+static int
+yaml_parser_index_key(yaml_parser_t *parser, int node_id,
+        yaml_node_pair_t pair, yaml_mark_t start_mark, yaml_mark_t key_mark)
+{
+    int is_duplicate;
+
+    if (!yaml_document_index_key(parser->document, node_id, pair,
+                &is_duplicate))
+        return MEMORY_ERROR_INIT(parser);
+
+    if (is_duplicate)
+        return COMPOSER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while composing a mapping", start_mark,
+                "found duplicate key", key_mark);
+
+    return 1;
+}
+
+/*
+ * Get the mark to store in a node.
+ *
+ * Without the mark tracking, only the character offset is kept.
+ */
+
+static yaml_mark_t
+yaml_parser_node_mark(yaml_parser_t *parser, yaml_mark_t mark)
+{
+    if (parser->is_markless) {
+        mark.line = 0;
+        mark.column = 0;
+    }
+
+    return mark;
+}
+
+/*
+ * Compose the root sequence of a selection and the selected nodes.
+ */
+
+static int
+yaml_parser_load_selection(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, int *node_id)
+{
+    yaml_document_t *document = parser->document;
+    yaml_char_t *tag = (yaml_char_t *)yaml_seq_tag;
+    yaml_mark_t mark = event->start_mark;
+    struct {
+        yaml_node_item_t *list;
+        size_t length;
+        size_t capacity;
+    } items = { NULL, 0, 0 };
+    yaml_node_t node;
+    yaml_arc_t arc;
+    size_t base = parser->pending_items.length;
+    int index;
+
+    selector->matches.length = 0;
+
+    if (document->compact) {
+        if (!yaml_parser_add_compact_node(parser, YAML_SEQUENCE_NODE, tag,
+                    0, 0))
+            goto error;
+    }
+    else {
+        if (!ALLOCATOR_STACK_INIT(parser, &document->allocator,
+                    items, INITIAL_STACK_CAPACITY))
+            goto error;
+
+        SEQUENCE_NODE_INIT(node, NULL, tag, items.list, items.length,
+                items.capacity, YAML_ANY_SEQUENCE_STYLE,
+                yaml_parser_node_mark(parser, mark),
+                yaml_parser_node_mark(parser, mark));
+
+        if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes, node))
+            goto error;
+    }
+
+    index = document->nodes.length-1;
+
+    SEQUENCE_ITEM_ARC_INIT(arc, tag, 0);
+
+    if (!yaml_parser_start_expansion(parser)
+            || !PUSH(parser, parser->path, arc)) {
+        yaml_event_clear(event);
+        return 0;
+    }
+
+    if (!yaml_parser_select_node(parser, selector, event,
+                (selector->is_compiled ? 1UL : 0), index))
+        return 0;
+
+    (void)POP(parser, parser->path);
+
+    if (document->compact) {
+        if (!yaml_parser_finish_compact_sequence(parser, index, base))
+            return 0;
+    }
+    *node_id = index;
+
+    return 1;
+
+error:
+
+    ALLOCATOR_STACK_DEL(parser, &document->allocator, items);
+    yaml_event_clear(event);
+
+    return 0;
+}
+
+/*
+ * Walk over a node given the selector steps to apply to it.
+ *
+ * The selected and the anchored nodes are composed in whole and the rest of
+ * the steps is applied to the composed node; the nodes with nothing selected
+ * below are skipped.  Otherwise, the children of a collection are walked over
+ * the same way.
+ */
+
+static int
+yaml_parser_select_node(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, unsigned long states, int root_id)
+{
+    yaml_mark_t mark = event->start_mark;
+    unsigned long child_states;
+    int node_id;
+    int index = 0;
+
+    if (!states)
+        return yaml_parser_pass_node(parser, event);
+
+    if (event->type == YAML_ALIAS_EVENT || yaml_event_get_anchor(event)
+            || (states >> selector->steps.length) & 1) {
+        if (!yaml_parser_load_node(parser, event, &node_id))
+            return 0;
+        if (!yaml_selector_evaluate(selector, parser->document, node_id,
+                    states, 0))
+            return MEMORY_ERROR_INIT(parser);
+        return yaml_parser_add_selected(parser, selector, root_id, mark);
+    }
+
+    switch (event->type)
+    {
+        case YAML_SCALAR_EVENT:
+            yaml_event_clear(event);
+            return 1;
+
+        case YAML_SEQUENCE_START_EVENT:
+            yaml_event_clear(event);
+            if (!yaml_parser_parse_event(parser, event))
+                return 0;
+            while (event->type != YAML_SEQUENCE_END_EVENT) {
+                child_states = yaml_selector_advance(selector, states,
+                        NULL, 0, index++);
+                if (!yaml_parser_select_node(parser, selector, event,
+                            child_states, root_id))
+                    return 0;
+                if (!yaml_parser_parse_event(parser, event))
+                    return 0;
+            }
+            yaml_event_clear(event);
+            return 1;
 
+        case YAML_MAPPING_START_EVENT:
+            yaml_event_clear(event);
+            if (!yaml_parser_parse_event(parser, event))
+                return 0;
+            while (event->type != YAML_MAPPING_END_EVENT) {
+                if (!yaml_parser_select_key(parser, selector, event,
+                            states, &child_states))
+                    return 0;
+                if (!yaml_parser_parse_event(parser, event))
+                    return 0;
+                if (!yaml_parser_select_node(parser, selector, event,
+                            child_states, root_id))
+                    return 0;
+                if (!yaml_parser_parse_event(parser, event))
+                    return 0;
+            }
+            yaml_event_clear(event);
+            return 1;
+
+        default:
+            assert(0);  /* Could not happen. */
+            return 0;
+    }
+}
+
+/*
+ * Walk over a mapping key and get the selector steps to apply to the value.
+ */
+
+static int
+yaml_parser_select_key(yaml_parser_t *parser, yaml_selector_t *selector,
+        yaml_event_t *event, unsigned long states, unsigned long *value_states)
+{
+    yaml_char_t *value;
+    size_t length;
+    int key_id;
+
+    if (event->type == YAML_SCALAR_EVENT && !event->data.scalar.anchor) {
+        *value_states = yaml_selector_advance(selector, states,
+                event->data.scalar.value, event->data.scalar.length, -1);
+        yaml_event_clear(event);
+        return 1;
+    }
+
+    if (event->type == YAML_ALIAS_EVENT || yaml_event_get_anchor(event)) {
+        if (!yaml_parser_load_node(parser, event, &key_id))
+            return 0;
+        if (yaml_document_get_scalar(parser->document, key_id, NULL,
+                    &value, &length)) {
+            *value_states = yaml_selector_advance(selector, states,
+                    value, length, -1);
+            return 1;
+        }
+    }
+    else if (!yaml_parser_pass_node(parser, event))
+        return 0;
+
+    *value_states = yaml_selector_advance(selector, states, NULL, 0, -1);
+
+    return 1;
+}
+
+/*
+ * Append the nodes selected by the last evaluation to the root sequence.
+ */
+
+static int
+yaml_parser_add_selected(yaml_parser_t *parser, yaml_selector_t *selector,
+        int root_id, yaml_mark_t mark)
+{
+    yaml_document_t *document = parser->document;
+    size_t idx;
+
+    for (idx = 0; idx < selector->matches.length; idx ++)
+    {
+        int item_id = selector->matches.list[idx];
+
+        if (document->compact) {
+            if (!PUSH(parser, parser->pending_items, item_id))
+                return 0;
+        }
+        else if (!ALLOCATOR_PUSH(parser, &document->allocator,
+                    document->nodes.list[root_id].data.sequence.items,
+                    item_id))
+            return 0;
+        if (!yaml_parser_expand_item(parser, root_id, item_id, mark))
+            return 0;
+        parser->path.list[parser->path.length-1].data.item.index ++;
+    }
+
+    selector->matches.length = 0;
+
+    return 1;
+}
+
+/*
+ * Skip a node without composing it.  The anchored nodes inside are composed
+ * anyway, so that the aliases to them could be resolved later.
+ */
+
+static int
+yaml_parser_pass_node(yaml_parser_t *parser, yaml_event_t *event)
+{
+    size_t depth = 0;
+    int node_id;
+
+    while (1)
+    {
+        if (event->type == YAML_ALIAS_EVENT || yaml_event_get_anchor(event)) {
+            if (!yaml_parser_load_node(parser, event, &node_id))
+                return 0;
+        }
+        else {
+            if (event->type == YAML_SEQUENCE_START_EVENT
+                    || event->type == YAML_MAPPING_START_EVENT) {
+                depth ++;
+            }
+            else if (event->type == YAML_SEQUENCE_END_EVENT
+                    || event->type == YAML_MAPPING_END_EVENT) {
+                depth --;
+            }
+            yaml_event_clear(event);
+        }
+
+        if (!depth)
+            return 1;
+
+        if (!yaml_parser_parse_event(parser, event))
+            return 0;
+    }
+}
+
+/*
+ * Get the anchor of a node event.
+ */
+
+static yaml_char_t *
+yaml_event_get_anchor(yaml_event_t *event)
+{
+    switch (event->type) {
+        case YAML_SCALAR_EVENT:
+            return event->data.scalar.anchor;
+        case YAML_SEQUENCE_START_EVENT:
+            return event->data.sequence_start.anchor;
+        case YAML_MAPPING_START_EVENT:
+            return event->data.mapping_start.anchor;
+        default:
+            return NULL;
+    }
+}
@@ -67,6 +67,12 @@
 YAML_DECLARE(int)
 yaml_parser_parse_event(yaml_parser_t *parser, yaml_event_t *event);
 
+YAML_DECLARE(int)
+yaml_parser_skip_node(yaml_parser_t *parser);
+
+YAML_DECLARE(void)
+yaml_parser_recycle_event(yaml_parser_t *parser, yaml_event_t *event);
+
 /*
  * State functions.
  */
@@ -164,6 +170,14 @@ yaml_parser_parse_event(yaml_parser_t *parser, yaml_event_t *event)
 
     memset(event, 0, sizeof(yaml_event_t));
 
+    /* Return the event left by `yaml_parser_skip_node()`. */
+
+    if (parser->pending_event.type) {
+        *event = parser->pending_event;
+        memset(&parser->pending_event, 0, sizeof(yaml_event_t));
+        return 1;
+    }
+
     /* No events after the end of the stream or error. */
 
     if (parser->is_stream_end_produced || parser->error.type
@@ -171,9 +185,142 @@ yaml_parser_parse_event(yaml_parser_t *parser, yaml_event_t *event)
         return 1;
     }
 
+    /* In the push mode, wait until all tokens of the event are fed. */
+
+    parser->is_input_needed = 0;
+
+    STATS_TIMER_START(parser, parser);
+
+    if (parser->is_push && !parser->is_final) {
+        if (!yaml_parser_fetch_event_tokens(parser)) {
+            STATS_TIMER_STOP(parser, parser);
+            return parser->is_input_needed;
+        }
+    }
+
     /* Generate the next event. */
 
-    return yaml_parser_state_machine(parser, event);
+    if (!yaml_parser_state_machine(parser, event)) {
+        STATS_TIMER_STOP(parser, parser);
+        return 0;
+    }
+
+    STATS_TIMER_STOP(parser, parser);
+    STATS_COUNT(parser, events, event->type != YAML_NO_EVENT);
+
+    return 1;
+}
+
+/*
+ * Skip the next node.
+ *
+ * The events of the node are produced and recycled at once, but the parser
+ * states drop the scalar values, anchors and tags of the skipped node rather
+ * than passing them to the events, and the tags are not resolved.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_skip_node(yaml_parser_t *parser)
+{
+    yaml_event_t event;
+
+    assert(parser);     /* Non-NULL parser object is expected. */
+
+    parser->is_skipping = 1;
+
+    do {
+        if (!yaml_parser_parse_event(parser, &event))
+            goto error;
+
+        switch (event.type)
+        {
+            case YAML_NO_EVENT:
+                goto done;
+
+            case YAML_ALIAS_EVENT:
+            case YAML_SCALAR_EVENT:
+                break;
+
+            case YAML_SEQUENCE_START_EVENT:
+            case YAML_MAPPING_START_EVENT:
+                parser->skipped_depth ++;
+                break;
+
+            case YAML_SEQUENCE_END_EVENT:
+            case YAML_MAPPING_END_EVENT:
+                if (parser->skipped_depth) {
+                    parser->skipped_depth --;
+                    break;
+                }
+
+                /* Fall through. */
+
+            default:
+
+                /* The next event does not start a node; keep it. */
+
+                parser->pending_event = event;
+                goto done;
+        }
+
+        yaml_parser_recycle_event(parser, &event);
+
+    } while (parser->skipped_depth);
+
+done:
+
+    parser->is_skipping = 0;
+
+    return 1;
+
+error:
+
+    parser->is_skipping = 0;
+    parser->skipped_depth = 0;
+
+    return 0;
+}
+
+/*
+ * Clear an event returning its strings to the parser pool.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_recycle_event(yaml_parser_t *parser, yaml_event_t *event)
+{
+    assert(parser);     /* Non-NULL parser object is expected. */
+    assert(event);      /* Non-NULL event object is expected. */
+
+    switch (event->type)
+    {
+        case YAML_ALIAS_EVENT:
+            POOL_STRING_DEL(parser, event->data.alias.anchor);
+            break;
+
+        case YAML_SCALAR_EVENT:
+            POOL_STRING_DEL(parser, event->data.scalar.anchor);
+            POOL_STRING_DEL(parser, event->data.scalar.tag);
+            if (!event->data.scalar.is_borrowed)
+                yaml_pool_free(&parser->pool, event->data.scalar.value,
+                        event->data.scalar.length+1);
+            break;
+
+        case YAML_SEQUENCE_START_EVENT:
+            POOL_STRING_DEL(parser, event->data.sequence_start.anchor);
+            POOL_STRING_DEL(parser, event->data.sequence_start.tag);
+            break;
+
+        case YAML_MAPPING_START_EVENT:
+            POOL_STRING_DEL(parser, event->data.mapping_start.anchor);
+            POOL_STRING_DEL(parser, event->data.mapping_start.tag);
+            break;
+
+        default:
+            yaml_event_clear(event);
+            break;
+    }
+
+    memset(event, 0, sizeof(yaml_event_t));
 }
 
 /*
@@ -498,6 +645,7 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
     yaml_char_t *tag = NULL;
     yaml_mark_t start_mark, end_mark, tag_mark;
     int implicit;
+    int has_properties;
 
     token = PEEK_TOKEN(parser);
     if (!token) return 0;
@@ -505,6 +653,11 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
     if (token->type == YAML_ALIAS_TOKEN)
     {
         parser->state = POP(parser, parser->states);
+        if (parser->is_skipping) {
+            /* The payload of a skipped node is never used. */
+            POOL_STRING_DEL(parser, token->data.alias.value);
+            token->data.alias.value = NULL;
+        }
         ALIAS_EVENT_INIT(*event, token->data.alias.value,
                 token->start_mark, token->end_mark);
         SKIP_TOKEN(parser);
@@ -556,7 +709,7 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
         if (tag_handle) {
             if (!*tag_handle) {
                 tag = tag_suffix;
-                yaml_free(tag_handle);
+                POOL_STRING_DEL(parser, tag_handle);
                 tag_handle = tag_suffix = NULL;
             }
             else {
@@ -567,16 +720,23 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
                     if (strcmp((char *)tag_directive->handle, (char *)tag_handle) == 0) {
                         size_t prefix_len = strlen((char *)tag_directive->prefix);
                         size_t suffix_len = strlen((char *)tag_suffix);
-                        tag = yaml_malloc(prefix_len+suffix_len+1);
+                        if (parser->is_skipping) {
+                            /* The tag of a skipped node is never used. */
+                            tag = tag_suffix;
+                            POOL_STRING_DEL(parser, tag_handle);
+                            tag_handle = tag_suffix = NULL;
+                            break;
+                        }
+                        tag = yaml_pool_malloc(&parser->pool,
+                                prefix_len+suffix_len+1, NULL);
                         if (!tag) {
                             MEMORY_ERROR_INIT(parser);
                             goto error;
                         }
                         memcpy(tag, tag_directive->prefix, prefix_len);
                         memcpy(tag+prefix_len, tag_suffix, suffix_len);
-                        tag[prefix_len+suffix_len] = '\0';
-                        yaml_free(tag_handle);
-                        yaml_free(tag_suffix);
+                        POOL_STRING_DEL(parser, tag_handle);
+                        POOL_STRING_DEL(parser, tag_suffix);
                         tag_handle = tag_suffix = NULL;
                         break;
                     }
@@ -590,12 +750,21 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
             }
         }
 
+        has_properties = (anchor || tag);
+        if (parser->is_skipping) {
+            /* The properties of a skipped node are never used. */
+            POOL_STRING_DEL(parser, anchor);
+            POOL_STRING_DEL(parser, tag);
+            anchor = tag = NULL;
+        }
+
         implicit = (!tag || !*tag);
         if (indentless_sequence && token->type == YAML_BLOCK_ENTRY_TOKEN) {
             end_mark = token->end_mark;
             parser->state = YAML_PARSE_INDENTLESS_SEQUENCE_ENTRY_STATE;
             SEQUENCE_START_EVENT_INIT(*event, anchor, tag, implicit,
                     YAML_BLOCK_SEQUENCE_STYLE, start_mark, end_mark);
+            event->data.sequence_start.hint = YAML_NONEMPTY_COLLECTION_HINT;
             return 1;
         }
         else {
@@ -611,10 +780,20 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
                     quoted_implicit = 1;
                 }
                 parser->state = POP(parser, parser->states);
+                if (parser->is_skipping) {
+                    /* Drop the value instead of passing it on. */
+                    if (!token->data.scalar.is_borrowed)
+                        yaml_pool_free(&parser->pool, token->data.scalar.value,
+                                token->data.scalar.length+1);
+                    token->data.scalar.value = NULL;
+                    token->data.scalar.length = 0;
+                    token->data.scalar.is_borrowed = 0;
+                }
                 SCALAR_EVENT_INIT(*event, anchor, tag,
                         token->data.scalar.value, token->data.scalar.length,
                         plain_implicit, quoted_implicit,
                         token->data.scalar.style, start_mark, end_mark);
+                event->data.scalar.is_borrowed = token->data.scalar.is_borrowed;
                 SKIP_TOKEN(parser);
                 return 1;
             }
@@ -637,6 +816,8 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
                 parser->state = YAML_PARSE_BLOCK_SEQUENCE_FIRST_ENTRY_STATE;
                 SEQUENCE_START_EVENT_INIT(*event, anchor, tag, implicit,
                         YAML_BLOCK_SEQUENCE_STYLE, start_mark, end_mark);
+                event->data.sequence_start.hint
+                    = YAML_NONEMPTY_COLLECTION_HINT;
                 return 1;
             }
             else if (block && token->type == YAML_BLOCK_MAPPING_START_TOKEN) {
@@ -644,15 +825,16 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
                 parser->state = YAML_PARSE_BLOCK_MAPPING_FIRST_KEY_STATE;
                 MAPPING_START_EVENT_INIT(*event, anchor, tag, implicit,
                         YAML_BLOCK_MAPPING_STYLE, start_mark, end_mark);
+                event->data.mapping_start.hint = YAML_NONEMPTY_COLLECTION_HINT;
                 return 1;
             }
-            else if (anchor || tag) {
-                yaml_char_t *value = yaml_malloc(1);
-                if (!value) {
+            else if (has_properties) {
+                yaml_char_t *value = NULL;
+                if (!parser->is_skipping
+                        && !(value = yaml_pool_malloc(&parser->pool, 1, NULL))) {
                     MEMORY_ERROR_INIT(parser);
                     goto error;
                 }
-                value[0] = '\0';
                 parser->state = POP(parser, parser->states);
                 SCALAR_EVENT_INIT(*event, anchor, tag, value, 0,
                         implicit, 0, YAML_PLAIN_SCALAR_STYLE,
@@ -670,10 +852,10 @@ yaml_parser_parse_node(yaml_parser_t *parser, yaml_event_t *event,
     }
 
 error:
-    yaml_free(anchor);
-    yaml_free(tag_handle);
-    yaml_free(tag_suffix);
-    yaml_free(tag);
+    POOL_STRING_DEL(parser, anchor);
+    POOL_STRING_DEL(parser, tag_handle);
+    POOL_STRING_DEL(parser, tag_suffix);
+    POOL_STRING_DEL(parser, tag);
 
     return 0;
 }
@@ -946,6 +1128,7 @@ yaml_parser_parse_flow_sequence_entry(yaml_parser_t *parser,
             MAPPING_START_EVENT_INIT(*event, NULL, NULL,
                     1, YAML_FLOW_MAPPING_STYLE,
                     token->start_mark, token->end_mark);
+            event->data.mapping_start.hint = YAML_NONEMPTY_COLLECTION_HINT;
             SKIP_TOKEN(parser);
             return 1;
         }
@@ -1172,13 +1355,12 @@ static int
 yaml_parser_process_empty_scalar(yaml_parser_t *parser, yaml_event_t *event,
         yaml_mark_t mark)
 {
-    yaml_char_t *value;
+    yaml_char_t *value = NULL;
 
-    value = yaml_malloc(1);
-    if (!value) {
+    if (!parser->is_skipping
+            && !(value = yaml_pool_malloc(&parser->pool, 1, NULL))) {
         return MEMORY_ERROR_INIT(parser);
     }
-    value[0] = '\0';
 
     SCALAR_EVENT_INIT(*event, NULL, NULL, value, 0,
             1, 0, YAML_PLAIN_SCALAR_STYLE, mark, mark);
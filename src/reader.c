@@ -8,9 +8,25 @@
 static int
 yaml_parser_update_raw_buffer(yaml_parser_t *parser);
 
+static int
+yaml_parser_grow_raw_buffer(yaml_parser_t *parser);
+
 static int
 yaml_parser_determine_encoding(yaml_parser_t *parser);
 
+static size_t
+yaml_parser_scan_ascii(const unsigned char *octets, size_t length);
+
+static int
+yaml_parser_decode_utf8(yaml_parser_t *parser, const unsigned char *octets,
+        size_t length, int is_final, unsigned int *value, unsigned int *width);
+
+static int
+yaml_parser_check_in_place_input(yaml_parser_t *parser, size_t end);
+
+static int
+yaml_parser_update_in_place_buffer(yaml_parser_t *parser, size_t length);
+
 YAML_DECLARE(int)
 yaml_parser_update_buffer(yaml_parser_t *parser, size_t length);
 
@@ -22,6 +38,173 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length);
 #define BOM_UTF16LE "\xff\xfe"
 #define BOM_UTF16BE "\xfe\xff"
 
+/*
+ * Check if a character is allowed in the input stream:
+ *      #x9 | #xA | #xD | [#x20-#x7E]               (8 bit)
+ *      | #x85 | [#xA0-#xD7FF] | [#xE000-#xFFFD]    (16 bit)
+ *      | [#x10000-#x10FFFF]                        (32 bit)
+ */
+
+#define IS_ALLOWED_CHARACTER(value)                                             \
+    ((value) == 0x09 || (value) == 0x0A || (value) == 0x0D                      \
+     || ((value) >= 0x20 && (value) <= 0x7E)                                    \
+     || ((value) == 0x85) || ((value) >= 0xA0 && (value) <= 0xD7FF)             \
+     || ((value) >= 0xE000 && (value) <= 0xFFFD)                                \
+     || ((value) >= 0x10000 && (value) <= 0x10FFFF))
+
+/*
+ * Word-at-a-time octet tests.  A word with every octet set to `octet` is
+ * produced by multiplying it by `0x01...01`, whatever is the size of a word.
+ * `HAS_OCTET_LESS(word, octet)` is true if some octet of the word is less than
+ * `octet` (<= 0x80) and `HAS_ZERO_OCTET(word)` is true if some octet is zero.
+ */
+
+#define OCTET_WORD(octet)   (((size_t)-1/0xFF)*(octet))
+
+#define HAS_OCTET_LESS(word, octet)                                             \
+    (((word) - OCTET_WORD(octet)) & ~(word) & OCTET_WORD(0x80))
+
+#define HAS_ZERO_OCTET(word)    HAS_OCTET_LESS((word), 0x01)
+
+/*
+ * Find the length of the leading run of the octets that are printable ASCII
+ * characters, tabs or line breaks.  Such characters need no decoding, so the
+ * run could be copied or left in place at once.  The octets are checked a word
+ * at a time; a word containing a multibyte, control or line break octet is
+ * checked octet by octet.
+ */
+
+static size_t
+yaml_parser_scan_ascii(const unsigned char *octets, size_t length)
+{
+    size_t idx = 0;
+
+    while (idx < length)
+    {
+        unsigned char octet;
+
+        if (idx + sizeof(size_t) <= length)
+        {
+            size_t word;
+
+            memcpy(&word, octets + idx, sizeof(size_t));
+
+            if (!(word & OCTET_WORD(0x80))
+                    && !HAS_OCTET_LESS(word, 0x20)
+                    && !HAS_ZERO_OCTET(word ^ OCTET_WORD(0x7F))) {
+                idx += sizeof(size_t);
+                continue;
+            }
+        }
+
+        octet = octets[idx];
+
+        if (!((octet >= 0x20 && octet <= 0x7E)
+                    || octet == 0x09 || octet == 0x0A || octet == 0x0D))
+            break;
+
+        idx ++;
+    }
+
+    return idx;
+}
+
+/*
+ * Decode a UTF-8 character.  Check RFC 3629
+ * (http://www.ietf.org/rfc/rfc3629.txt) for more details.
+ *
+ * The following table (taken from the RFC) is used for decoding.
+ *
+ *    Char. number range |        UTF-8 octet sequence
+ *      (hexadecimal)    |              (binary)
+ *   --------------------+------------------------------------
+ *   0000 0000-0000 007F | 0xxxxxxx
+ *   0000 0080-0000 07FF | 110xxxxx 10xxxxxx
+ *   0000 0800-0000 FFFF | 1110xxxx 10xxxxxx 10xxxxxx
+ *   0001 0000-0010 FFFF | 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+ *
+ * Additionally, the characters in the range 0xD800-0xDFFF are prohibited as
+ * they are reserved for use with UTF-16 surrogate pairs.
+ *
+ * If the `length` octets available contain an incomplete character and more
+ * octets may follow (`is_final` is not set), `width` is set to 0.  Return 1 on
+ * success, 0 on a decoder error.
+ */
+
+static int
+yaml_parser_decode_utf8(yaml_parser_t *parser, const unsigned char *octets,
+        size_t length, int is_final, unsigned int *value, unsigned int *width)
+{
+    unsigned char octet;
+    size_t idx;
+
+    /* Determine the length of the UTF-8 sequence. */
+
+    octet = octets[0];
+    *width = (octet & 0x80) == 0x00 ? 1 :
+             (octet & 0xE0) == 0xC0 ? 2 :
+             (octet & 0xF0) == 0xE0 ? 3 :
+             (octet & 0xF8) == 0xF0 ? 4 : 0;
+
+    /* Check if the leading octet is valid. */
+
+    if (!*width)
+        return DECODER_ERROR_INIT(parser,
+                "invalid leading UTF-8 octet", parser->offset, octet);
+
+    /* Check if the octets contain an incomplete character. */
+
+    if (*width > length) {
+        if (is_final) {
+            return DECODER_ERROR_INIT(parser,
+                    "incomplete UTF-8 octet sequence", parser->offset, -1);
+        }
+        *width = 0;
+        return 1;
+    }
+
+    /* Decode the leading octet. */
+
+    *value = (octet & 0x80) == 0x00 ? octet & 0x7F :
+             (octet & 0xE0) == 0xC0 ? octet & 0x1F :
+             (octet & 0xF0) == 0xE0 ? octet & 0x0F :
+             (octet & 0xF8) == 0xF0 ? octet & 0x07 : 0;
+
+    /* Check and decode the trailing octets. */
+
+    for (idx = 1; idx < *width; idx ++)
+    {
+        octet = octets[idx];
+
+        /* Check if the octet is valid. */
+
+        if ((octet & 0xC0) != 0x80)
+            return DECODER_ERROR_INIT(parser,
+                    "invalid trailing UTF-8 octet", parser->offset+idx, octet);
+
+        /* Decode the octet. */
+
+        *value = (*value << 6) + (octet & 0x3F);
+    }
+
+    /* Check the length of the sequence against the value. */
+
+    if (!((*width == 1) ||
+            (*width == 2 && *value >= 0x80) ||
+            (*width == 3 && *value >= 0x800) ||
+            (*width == 4 && *value >= 0x10000)))
+        return DECODER_ERROR_INIT(parser,
+                "invalid length of a UTF-8 sequence", parser->offset, -1);
+
+    /* Check the range of the value. */
+
+    if ((*value >= 0xD800 && *value <= 0xDFFF) || *value > 0x10FFFF)
+        return DECODER_ERROR_INIT(parser,
+                "invalid Unicode character", parser->offset, *value);
+
+    return 1;
+}
+
 /*
  * Determine the input stream encoding by checking the BOM symbol. If no BOM is
  * found, the UTF-8 encoding is assumed. Return 1 on success, 0 on failure.
@@ -77,6 +260,21 @@ yaml_parser_update_raw_buffer(yaml_parser_t *parser)
 {
     size_t length = 0;
 
+    /* In the push mode, use the fed bytes or ask for more. */
+
+    if (parser->is_push) {
+        if (parser->is_fed) {
+            parser->is_fed = 0;
+            return 1;
+        }
+        if (parser->is_final) {
+            parser->is_eof = 1;
+            return 1;
+        }
+        parser->is_input_needed = 1;
+        return 0;
+    }
+
     /* Return if the raw buffer is full. */
 
     if (parser->raw_input.pointer == 0 &&
@@ -101,17 +299,200 @@ yaml_parser_update_raw_buffer(yaml_parser_t *parser)
 
     /* Call the read handler to fill the buffer. */
 
+    STATS_TIMER_START(parser, reader);
     if (!parser->reader(parser->reader_data,
                 parser->raw_input.buffer + parser->raw_input.length,
                 parser->raw_input.capacity - parser->raw_input.length,
                 &length)) {
+        STATS_TIMER_STOP(parser, reader);
         return READER_ERROR_INIT(parser, "read handler error", parser->offset);
     }
+    STATS_TIMER_STOP(parser, reader);
+    STATS_COUNT(parser, reader_calls, 1);
+    STATS_COUNT(parser, bytes_read, length);
     parser->raw_input.length += length;
     if (!length) {
         parser->is_eof = 1;
     }
 
+    /* If the read handler filled the whole buffer, ask for more next time. */
+
+    if (parser->raw_input.length == parser->raw_input.capacity
+            && parser->raw_input.capacity < parser->max_raw_input_capacity) {
+        if (!yaml_parser_grow_raw_buffer(parser))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Double the raw buffer up to the maximal capacity and extend the working
+ * buffer accordingly.  Both buffers keep their content.
+ */
+
+static int
+yaml_parser_grow_raw_buffer(yaml_parser_t *parser)
+{
+    size_t capacity = parser->raw_input.capacity*2;
+    unsigned char *raw_buffer;
+    yaml_char_t *buffer;
+
+    if (capacity > parser->max_raw_input_capacity) {
+        capacity = parser->max_raw_input_capacity;
+    }
+
+    buffer = yaml_realloc(parser->input.buffer, capacity*3);
+    if (!buffer)
+        return MEMORY_ERROR_INIT(parser);
+    memset(buffer + parser->input.capacity, 0,
+            capacity*3 - parser->input.capacity);
+    parser->input.buffer = buffer;
+    parser->input.capacity = capacity*3;
+
+    raw_buffer = yaml_realloc(parser->raw_input.buffer, capacity);
+    if (!raw_buffer)
+        return MEMORY_ERROR_INIT(parser);
+    memset(raw_buffer + parser->raw_input.capacity, 0,
+            capacity - parser->raw_input.capacity);
+    parser->raw_input.buffer = raw_buffer;
+    parser->raw_input.capacity = capacity;
+
+    return 1;
+}
+
+/*
+ * Check the input string up to the `end` offset and make it available in the
+ * working buffer.  The last character is allowed to cross the `end` offset.
+ */
+
+static int
+yaml_parser_check_in_place_input(yaml_parser_t *parser, size_t end)
+{
+    yaml_istring_t *string = &parser->standard_reader_data.string;
+
+    while (string->pointer < end)
+    {
+        unsigned int value = 0;
+        unsigned int width = 0;
+
+        /* Skip a run of ASCII characters at once. */
+
+        size_t run = yaml_parser_scan_ascii(string->buffer + string->pointer,
+                end - string->pointer);
+
+        string->pointer += run;
+        parser->offset += run;
+        parser->unread += run;
+
+        if (string->pointer == end)
+            break;
+
+        /* Check the next character. */
+
+        if (!yaml_parser_decode_utf8(parser, string->buffer + string->pointer,
+                    string->length - string->pointer, 1, &value, &width))
+            return 0;
+
+        if (!IS_ALLOWED_CHARACTER(value))
+            return DECODER_ERROR_INIT(parser,
+                    "control characters are not allowed",
+                    parser->offset, value);
+
+        string->pointer += width;
+        parser->offset += width;
+        parser->unread ++;
+    }
+
+    parser->input.length = string->pointer;
+
+    return 1;
+}
+
+/*
+ * Ensure that the buffer contains at least `length` characters reading the
+ * input string in place.
+ *
+ * A UTF-8 input string is not copied to the raw and the working buffers.
+ * Instead, the working buffer refers to the string itself and the string is
+ * only checked ahead of the scanner.  Once the whole string is checked, the
+ * remaining characters are moved to the parser's own working buffer, which is
+ * terminated with NUL as usual.  Other encodings are decoded as usual.
+ */
+
+static int
+yaml_parser_update_in_place_buffer(yaml_parser_t *parser, size_t length)
+{
+    yaml_istring_t *string = &parser->standard_reader_data.string;
+
+    /* Determine the input encoding if it is not known yet. */
+
+    if (!parser->encoding)
+    {
+        if (string->length >= 2
+                && (!memcmp(string->buffer, BOM_UTF16LE, 2)
+                    || !memcmp(string->buffer, BOM_UTF16BE, 2))) {
+            parser->is_in_place = 0;
+            return yaml_parser_update_buffer(parser, length);
+        }
+
+        parser->encoding = YAML_UTF8_ENCODING;
+
+        if (string->length >= 3 && !memcmp(string->buffer, BOM_UTF8, 3)) {
+            string->pointer = 3;
+            parser->offset = 3;
+        }
+    }
+    else if (parser->encoding != YAML_UTF8_ENCODING) {
+        parser->is_in_place = 0;
+        return yaml_parser_update_buffer(parser, length);
+    }
+
+    /* Set the parser's own working buffer aside. */
+
+    if (!parser->saved_input.buffer) {
+        parser->saved_input = parser->input;
+        parser->input.buffer = (yaml_char_t *)string->buffer;
+        parser->input.pointer = parser->input.length = string->pointer;
+        parser->input.capacity = string->length;
+    }
+
+    /* Check the string until it has enough characters. */
+
+    while (parser->unread < length && string->pointer < string->length)
+    {
+        size_t end = string->length - string->pointer > parser->raw_input.capacity
+            ? string->pointer + parser->raw_input.capacity : string->length;
+
+        if (!yaml_parser_check_in_place_input(parser, end))
+            return 0;
+    }
+
+    /* On the end of the string, move the rest to the own buffer and put NUL. */
+
+    if (parser->unread < length)
+    {
+        size_t rest = parser->input.length - parser->input.pointer;
+
+        assert(rest < parser->saved_input.capacity);
+                        /* The rest is not longer than a checked chunk. */
+
+        memcpy(parser->saved_input.buffer,
+                parser->input.buffer + parser->input.pointer, rest);
+        parser->input = parser->saved_input;
+        parser->input.pointer = rest;
+        JOIN_OCTET(parser->input, '\0');
+        parser->input.length = parser->input.pointer;
+        parser->input.pointer = 0;
+        parser->unread ++;
+
+        parser->saved_input.buffer = NULL;
+        parser->saved_input.pointer = parser->saved_input.length
+            = parser->saved_input.capacity = 0;
+        parser->is_in_place = 0;
+        parser->is_eof = 1;
+    }
+
     return 1;
 }
 
@@ -125,6 +506,8 @@ yaml_parser_update_raw_buffer(yaml_parser_t *parser)
 YAML_DECLARE(int)
 yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
 {
+    size_t consumed = 0;
+
     assert(parser->reader); /* Read handler must be set. */
 
     /* If the EOF flag is set and the raw buffer is empty, do nothing. */
@@ -137,6 +520,11 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
     if (parser->unread >= length)
         return 1;
 
+    /* Scan the input string in place if possible. */
+
+    if (parser->is_in_place)
+        return yaml_parser_update_in_place_buffer(parser, length);
+
     /* Determine the input encoding if it is not known yet. */
 
     if (!parser->encoding) {
@@ -144,9 +532,29 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
             return 0;
     }
 
+    /*
+     * In the push mode, the scanner may return to an earlier position, so the
+     * consumed characters are kept and the buffer is extended instead.
+     */
+
+    if (parser->is_push)
+    {
+        size_t capacity = parser->input.length
+            + (parser->raw_input.length - parser->raw_input.pointer)*2 + 1;
+
+        if (capacity > parser->input.capacity) {
+            yaml_char_t *buffer = yaml_realloc(parser->input.buffer, capacity);
+            if (!buffer)
+                return MEMORY_ERROR_INIT(parser);
+            parser->input.buffer = buffer;
+            parser->input.capacity = capacity;
+        }
+        consumed = parser->input.pointer;
+    }
+
     /* Move the unread characters to the beginning of the buffer. */
 
-    if (parser->input.pointer > 0 &&
+    else if (parser->input.pointer > 0 &&
             parser->input.pointer < parser->input.length) {
         memmove(parser->input.buffer,
                 parser->input.buffer + parser->input.pointer,
@@ -167,7 +575,11 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
     {
         /* Fill the raw buffer. */
 
-        if (!yaml_parser_update_raw_buffer(parser)) return 0;
+        if (!yaml_parser_update_raw_buffer(parser)) {
+            parser->input.length = parser->input.pointer;
+            parser->input.pointer = consumed;
+            return 0;
+        }
 
         /* Decode the raw buffer. */
 
@@ -177,108 +589,47 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
                 parser->raw_input.length - parser->raw_input.pointer;
             unsigned int value = 0, value2 = 0;
             int is_incomplete = 0;
-            unsigned char octet;
             unsigned int width = 0;
             int low, high;
-            size_t idx;
 
-            /* Decode the next character. */
+            /* Copy a run of ASCII characters at once. */
 
-            switch (parser->encoding)
+            if (parser->encoding == YAML_UTF8_ENCODING)
             {
-                case YAML_UTF8_ENCODING:
+                size_t run = yaml_parser_scan_ascii(parser->raw_input.buffer
+                        + parser->raw_input.pointer, raw_unread);
+
+                memcpy(parser->input.buffer + parser->input.pointer,
+                        parser->raw_input.buffer + parser->raw_input.pointer,
+                        run);
+                parser->input.pointer += run;
+                parser->raw_input.pointer += run;
+                parser->offset += run;
+                parser->unread += run;
+
+                if (run == raw_unread)
+                    break;
 
-                    /*
-                     * Decode a UTF-8 character.  Check RFC 3629
-                     * (http://www.ietf.org/rfc/rfc3629.txt) for more details.
-                     *
-                     * The following table (taken from the RFC) is used for
-                     * decoding.
-                     *
-                     *    Char. number range |        UTF-8 octet sequence
-                     *      (hexadecimal)    |              (binary)
-                     *   --------------------+------------------------------------
-                     *   0000 0000-0000 007F | 0xxxxxxx
-                     *   0000 0080-0000 07FF | 110xxxxx 10xxxxxx
-                     *   0000 0800-0000 FFFF | 1110xxxx 10xxxxxx 10xxxxxx
-                     *   0001 0000-0010 FFFF | 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-                     *
-                     * Additionally, the characters in the range 0xD800-0xDFFF
-                     * are prohibited as they are reserved for use with UTF-16
-                     * surrogate pairs.
-                     */
+                raw_unread -= run;
+            }
 
-                    /* Determine the length of the UTF-8 sequence. */
+            /* Decode the next character. */
 
-                    octet = OCTET(parser->raw_input);
-                    width = (octet & 0x80) == 0x00 ? 1 :
-                            (octet & 0xE0) == 0xC0 ? 2 :
-                            (octet & 0xF0) == 0xE0 ? 3 :
-                            (octet & 0xF8) == 0xF0 ? 4 : 0;
+            switch (parser->encoding)
+            {
+                case YAML_UTF8_ENCODING:
 
-                    /* Check if the leading octet is valid. */
+                    if (!yaml_parser_decode_utf8(parser,
+                                parser->raw_input.buffer
+                                + parser->raw_input.pointer, raw_unread,
+                                parser->is_eof, &value, &width))
+                        return 0;
 
                     if (!width)
-                        return DECODER_ERROR_INIT(parser,
-                                "invalid leading UTF-8 octet",
-                                parser->offset, octet);
-
-                    /* Check if the raw buffer contains an incomplete character. */
-
-                    if (width > raw_unread) {
-                        if (parser->is_eof) {
-                            return DECODER_ERROR_INIT(parser,
-                                    "incomplete UTF-8 octet sequence",
-                                    parser->offset, -1);
-                        }
                         is_incomplete = 1;
-                        break;
-                    }
-
-                    /* Decode the leading octet. */
-
-                    value = (octet & 0x80) == 0x00 ? octet & 0x7F :
-                            (octet & 0xE0) == 0xC0 ? octet & 0x1F :
-                            (octet & 0xF0) == 0xE0 ? octet & 0x0F :
-                            (octet & 0xF8) == 0xF0 ? octet & 0x07 : 0;
-
-                    /* Check and decode the trailing octets. */
-
-                    for (idx = 1; idx < width; idx ++)
-                    {
-                        octet = OCTET_AT(parser->raw_input, idx);
-
-                        /* Check if the octet is valid. */
-
-                        if ((octet & 0xC0) != 0x80)
-                            return DECODER_ERROR_INIT(parser,
-                                    "invalid trailing UTF-8 octet",
-                                    parser->offset+idx, octet);
-
-                        /* Decode the octet. */
-
-                        value = (value << 6) + (octet & 0x3F);
-                    }
-
-                    /* Check the length of the sequence against the value. */
-
-                    if (!((width == 1) ||
-                            (width == 2 && value >= 0x80) ||
-                            (width == 3 && value >= 0x800) ||
-                            (width == 4 && value >= 0x10000)))
-                        return DECODER_ERROR_INIT(parser,
-                                "invalid length of a UTF-8 sequence",
-                                parser->offset, -1);
-
-                    /* Check the range of the value. */
-
-                    if ((value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF)
-                        return DECODER_ERROR_INIT(parser,
-                                "invalid Unicode character",
-                                parser->offset, value);
 
                     break;
-                
+
                 case YAML_UTF16LE_ENCODING:
                 case YAML_UTF16BE_ENCODING:
 
@@ -385,18 +736,9 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
             if (is_incomplete)
                 break;
 
-            /*
-             * Check if the character is in the allowed range:
-             *      #x9 | #xA | #xD | [#x20-#x7E]               (8 bit)
-             *      | #x85 | [#xA0-#xD7FF] | [#xE000-#xFFFD]    (16 bit)
-             *      | [#x10000-#x10FFFF]                        (32 bit)
-             */
-
-            if (! (value == 0x09 || value == 0x0A || value == 0x0D
-                        || (value >= 0x20 && value <= 0x7E)
-                        || (value == 0x85) || (value >= 0xA0 && value <= 0xD7FF)
-                        || (value >= 0xE000 && value <= 0xFFFD)
-                        || (value >= 0x10000 && value <= 0x10FFFF)))
+            /* Check if the character is in the allowed range. */
+
+            if (!IS_ALLOWED_CHARACTER(value))
                 return DECODER_ERROR_INIT(parser,
                         "control characters are not allowed",
                         parser->offset, value);
@@ -447,7 +789,7 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length)
     /* Switch the the buffer back to the input mode. */
 
     parser->input.length = parser->input.pointer;
-    parser->input.pointer = 0;
+    parser->input.pointer = consumed;
 
     return 1;
 }
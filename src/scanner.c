@@ -477,6 +477,12 @@
 
 #include "yaml_private.h"
 
+#if defined(__SSE2__) || defined(_M_X64)                                        \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YAML_SPAN_SSE2
+#include <emmintrin.h>
+#endif
+
 /*
  * Ensure that the buffer contains the required number of characters.
  * Return 1 on success, 0 on failure (reader error or memory error).
@@ -516,7 +522,7 @@
  */
 
 #define READ(parser, string)                                                    \
-     (OSTRING_EXTEND(parser, string) ?                                          \
+     (POOL_OSTRING_EXTEND(parser, string) ?                                     \
          (COPY(string, parser->input),                                          \
           parser->mark.index ++,                                                \
           parser->mark.column ++,                                               \
@@ -528,7 +534,7 @@
  */
 
 #define READ_LINE(parser, string)                                               \
-    (OSTRING_EXTEND(parser, string) ?                                           \
+    (POOL_OSTRING_EXTEND(parser, string) ?                                      \
     (((CHECK_AT(parser->input, '\r', 0)                                         \
        && CHECK_AT(parser->input, '\n', 1)) ?       /* CR LF -> LF */           \
      (JOIN_OCTET(string, (yaml_char_t) '\n'),                                   \
@@ -566,6 +572,64 @@
       parser->unread --) : 0),                                                  \
     1) : 0)
 
+/*
+ * Copy a run of `length` ASCII characters to a string buffer and advance
+ * pointers.
+ */
+
+#define READ_SPAN(parser, string, length)                                       \
+     (yaml_parser_extend_string(parser, &(string), (length)) ?                  \
+         (memcpy((string).buffer + (string).pointer,                            \
+                 parser->input.buffer + parser->input.pointer, (length)),       \
+          (string).pointer += (length),                                         \
+          SKIP_SPAN(parser, (length)),                                          \
+          1) : 0)
+
+/*
+ * Advance the buffer pointer over a run of `length` ASCII characters.
+ */
+
+#define SKIP_SPAN(parser, length)                                               \
+     (parser->mark.index += (length),                                           \
+      parser->mark.column += (length),                                          \
+      parser->unread -= (length),                                               \
+      parser->input.pointer += (length))
+
+/*
+ * The characters that stop a run of safe scalar characters in addition to
+ * blanks, breaks, NUL and non-ASCII characters.
+ */
+
+#define PLAIN_BLOCK_SPAN_STOPS  ":"
+#define PLAIN_FLOW_SPAN_STOPS   ":,?[]{}"
+#define SINGLE_QUOTED_SPAN_STOPS    "'"
+#define DOUBLE_QUOTED_SPAN_STOPS    "\"\\"
+
+/*
+ * Check if scalar values could be borrowed from the input string.  In this
+ * case the working buffer repeats the UTF-8 input byte for byte.
+ */
+
+#define IS_ZERO_COPY(parser)                                                    \
+    (parser->is_zero_copy && parser->encoding == YAML_UTF8_ENCODING)
+
+/*
+ * Get the offset of the current position in the input string (in the
+ * zero-copy mode only).  The NUL character put into the working buffer on EOF
+ * does not belong to the input.
+ */
+
+#define INPUT_OFFSET(parser)                                                    \
+    (parser->offset + (parser->is_eof ? 1 : 0)                                  \
+     - (parser->input.length - parser->input.pointer))
+
+/*
+ * Get a pointer to the input string at the given offset.
+ */
+
+#define BORROWED_VALUE(parser, _offset)                                         \
+    ((yaml_char_t *)(parser->standard_reader_data.string.buffer + (_offset)))
+
 /*
  * Public API declarations.
  */
@@ -573,6 +637,9 @@
 YAML_DECLARE(int)
 yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token);
 
+YAML_DECLARE(void)
+yaml_parser_recycle_token(yaml_parser_t *parser, yaml_token_t *token);
+
 /*
  * High-level token API.
  */
@@ -583,12 +650,47 @@ yaml_parser_fetch_more_tokens(yaml_parser_t *parser);
 static int
 yaml_parser_fetch_next_token(yaml_parser_t *parser);
 
+/*
+ * Push mode support.
+ */
+
+YAML_DECLARE(int)
+yaml_parser_fetch_event_tokens(yaml_parser_t *parser);
+
+static int
+yaml_parser_fetch_pushed_token(yaml_parser_t *parser);
+
+static int
+yaml_parser_wait_for_input(yaml_parser_t *parser);
+
+static int
+yaml_parser_save_scanner_state(yaml_parser_t *parser);
+
+static int
+yaml_parser_save_tokens(yaml_parser_t *parser);
+
+static int
+yaml_parser_save_list(yaml_parser_t *parser, void **list, size_t *capacity,
+        const void *items, size_t start, size_t length, size_t size);
+
+static void
+yaml_parser_restore_scanner_state(yaml_parser_t *parser);
+
+static void
+yaml_parser_postpone_scanning(yaml_parser_t *parser);
+
 /*
  * Potential simple keys.
  */
 
 static int
-yaml_parser_stale_simple_keys(yaml_parser_t *parser);
+yaml_parser_stale_simple_keys(yaml_parser_t *parser, int keep_required);
+
+static int
+yaml_parser_is_required_key_stale(yaml_parser_t *parser);
+
+static yaml_simple_key_t *
+yaml_parser_first_simple_key(yaml_parser_t *parser);
 
 static int
 yaml_parser_save_simple_key(yaml_parser_t *parser);
@@ -726,6 +828,34 @@ yaml_parser_scan_flow_scalar(yaml_parser_t *parser, yaml_token_t *token,
 static int
 yaml_parser_scan_plain_scalar(yaml_parser_t *parser, yaml_token_t *token);
 
+static int
+yaml_parser_copy_borrowed_value(yaml_parser_t *parser,
+        yaml_ostring_t *string, size_t start, size_t end);
+
+static size_t
+yaml_parser_scan_span(const yaml_char_t *octets, size_t length,
+        const char *stops);
+
+static int
+yaml_parser_extend_string(yaml_parser_t *parser,
+        yaml_ostring_t *string, size_t length);
+
+/*
+ * JSON scanner.
+ */
+
+static int
+yaml_parser_fetch_json_token(yaml_parser_t *parser, int *is_fetched);
+
+static int
+yaml_parser_fetch_json_string(yaml_parser_t *parser, int *is_fetched);
+
+static int
+yaml_parser_fetch_json_literal(yaml_parser_t *parser, int *is_fetched);
+
+static size_t
+yaml_parser_scan_json_span(const yaml_char_t *octets, size_t length);
+
 /*
  * Get the next token.
  */
@@ -748,9 +878,11 @@ yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token)
 
     /* Ensure that the tokens queue contains enough tokens. */
 
+    parser->is_input_needed = 0;
+
     if (!parser->is_token_available) {
         if (!yaml_parser_fetch_more_tokens(parser))
-            return 0;
+            return parser->is_input_needed;
     }
 
     /* Fetch the next token from the queue. */
@@ -766,6 +898,45 @@ yaml_parser_parse_token(yaml_parser_t *parser, yaml_token_t *token)
     return 1;
 }
 
+/*
+ * Clear a token returning its strings to the parser pool.
+ */
+
+YAML_DECLARE(void)
+yaml_parser_recycle_token(yaml_parser_t *parser, yaml_token_t *token)
+{
+    assert(parser); /* Non-NULL parser object is expected. */
+    assert(token);  /* Non-NULL token object is expected. */
+
+    switch (token->type)
+    {
+        case YAML_ALIAS_TOKEN:
+            POOL_STRING_DEL(parser, token->data.alias.value);
+            break;
+
+        case YAML_ANCHOR_TOKEN:
+            POOL_STRING_DEL(parser, token->data.anchor.value);
+            break;
+
+        case YAML_TAG_TOKEN:
+            POOL_STRING_DEL(parser, token->data.tag.handle);
+            POOL_STRING_DEL(parser, token->data.tag.suffix);
+            break;
+
+        case YAML_SCALAR_TOKEN:
+            if (!token->data.scalar.is_borrowed)
+                yaml_pool_free(&parser->pool, token->data.scalar.value,
+                        token->data.scalar.length+1);
+            break;
+
+        default:
+            yaml_token_clear(token);
+            break;
+    }
+
+    memset(token, 0, sizeof(yaml_token_t));
+}
+
 /*
  * Ensure that the tokens queue contains at least one token which can be
  * returned to the Parser.
@@ -776,6 +947,8 @@ yaml_parser_fetch_more_tokens(yaml_parser_t *parser)
 {
     int need_more_tokens;
 
+    STATS_TIMER_START(parser, scanner);
+
     /* While we need more tokens to fetch, do it. */
 
     while (1)
@@ -794,20 +967,25 @@ yaml_parser_fetch_more_tokens(yaml_parser_t *parser)
         }
         else
         {
-            size_t idx;
+            yaml_simple_key_t *simple_key;
 
-            /* Check if any potential simple key may occupy the head position. */
+            /*
+             * Check if any potential simple key may occupy the head position.
+             * If the scanner may be ahead of the parser, a missing required
+             * key is only reported when the next token is fetched.
+             */
 
-            if (!yaml_parser_stale_simple_keys(parser))
+            if (!yaml_parser_stale_simple_keys(parser,
+                        parser->is_scanning_ahead && !parser->is_final)) {
+                STATS_TIMER_STOP(parser, scanner);
                 return 0;
+            }
 
-            for (idx = 0; idx < parser->simple_keys.length; idx++) {
-                yaml_simple_key_t *simple_key  = parser->simple_keys.list + idx;
-                if (simple_key->is_possible
-                        && simple_key->token_number == parser->tokens_parsed) {
-                    need_more_tokens = 1;
-                    break;
-                }
+            simple_key = yaml_parser_first_simple_key(parser);
+
+            if (simple_key
+                    && simple_key->token_number == parser->tokens_parsed) {
+                need_more_tokens = 1;
             }
         }
 
@@ -818,833 +996,1053 @@ yaml_parser_fetch_more_tokens(yaml_parser_t *parser)
 
         /* Fetch the next token. */
 
-        if (!yaml_parser_fetch_next_token(parser))
+        if (!yaml_parser_fetch_pushed_token(parser)) {
+            STATS_TIMER_STOP(parser, scanner);
             return 0;
+        }
     }
 
     parser->is_token_available = 1;
 
+    STATS_PEAK(parser, max_queued_tokens,
+            parser->tokens.tail - parser->tokens.head);
+    STATS_TIMER_STOP(parser, scanner);
+
     return 1;
 }
 
 /*
- * The dispatcher for token fetchers.
+ * Check if a token may be followed by other tokens of the same event.
  */
 
-static int
-yaml_parser_fetch_next_token(yaml_parser_t *parser)
-{
-    yaml_mark_t start_mark = parser->mark;
-
-    /* Ensure that the buffer is initialized. */
-
-    if (!CACHE(parser, 1))
-        return 0;
+#define IS_EVENT_PREFIX_TOKEN(type)                                             \
+    ((type) == YAML_KEY_TOKEN                                                   \
+     || (type) == YAML_VALUE_TOKEN                                              \
+     || (type) == YAML_BLOCK_ENTRY_TOKEN                                        \
+     || (type) == YAML_FLOW_ENTRY_TOKEN                                         \
+     || (type) == YAML_ANCHOR_TOKEN                                             \
+     || (type) == YAML_TAG_TOKEN                                                \
+     || (type) == YAML_VERSION_DIRECTIVE_TOKEN                                  \
+     || (type) == YAML_TAG_DIRECTIVE_TOKEN                                      \
+     || (type) == YAML_DOCUMENT_END_TOKEN)
 
-    /* Check if we just started scanning.  Fetch STREAM-START then. */
+/*
+ * Ensure that the tokens queue contains all tokens of the next event.
+ *
+ * An event is produced from a run of prefix tokens (keys, values, entries,
+ * properties and directives) and at most one other token, and the parser may
+ * peek at the token that follows.  So the queue is ready when it contains two
+ * tokens that are not prefixes and no token up to the second one could be
+ * preceded by a KEY token yet.  Then the parser never needs to fetch a token
+ * while producing the event.
+ *
+ * If the fed input ends before the tokens do, the scanner returns to the state
+ * it had before, and the tokens are fetched again once enough input is fed.  If
+ * the scanner fails ahead of the event or passes the line of a required simple
+ * key, it returns to the saved state as well, and the tokens are fetched one by
+ * one from then on as in the pull mode, so that the parser produces the same
+ * events before the error.
+ */
 
-    if (!parser->is_stream_start_produced)
-        return yaml_parser_fetch_stream_start(parser);
+YAML_DECLARE(int)
+yaml_parser_fetch_event_tokens(yaml_parser_t *parser)
+{
+    if (parser->is_error_ahead)
+        return 1;
 
-    /* Eat whitespaces and comments until we reach the next token. */
+    parser->is_scanning_ahead = 1;
 
-    if (!yaml_parser_scan_to_next_token(parser))
+    if (yaml_parser_wait_for_input(parser))
         return 0;
 
-    /* Remove obsolete potential simple keys. */
-
-    if (!yaml_parser_stale_simple_keys(parser))
+    if (!yaml_parser_save_scanner_state(parser))
         return 0;
 
-    /* Check the indentation level against the current column. */
+    STATS_TIMER_START(parser, scanner);
 
-    if (!yaml_parser_unroll_indent(parser, parser->mark.column))
-        return 0;
+    while (1)
+    {
+        size_t count = 0;
+        size_t idx;
+        int is_ready = 0;
 
-    /*
-     * Ensure that the buffer contains at least 4 characters.  4 is the length
-     * of the longest indicators ('--- ' and '... ').
-     */
+        /* Look for the second token that is not a prefix. */
 
-    if (!CACHE(parser, 4))
-        return 0;
+        for (idx = parser->tokens.head; idx < parser->tokens.tail; idx++) {
+            yaml_token_type_t type = parser->tokens.list[idx].type;
+            if (!IS_EVENT_PREFIX_TOKEN(type) && ++count == 2) {
+                is_ready = 1;
+                break;
+            }
+        }
 
-    /* Is it the end of the stream? */
+        /* Check if any potential simple key may precede it. */
 
-    if (IS_Z(parser->input))
-        return yaml_parser_fetch_stream_end(parser);
+        if (is_ready)
+        {
+            size_t number = parser->tokens_parsed + (idx - parser->tokens.head);
+            yaml_simple_key_t *simple_key = yaml_parser_first_simple_key(parser);
 
-    /* Is it a directive? */
+            if (simple_key && simple_key->token_number <= number) {
+                is_ready = 0;
+            }
+        }
 
-    if (parser->mark.column == 0 && CHECK(parser->input, '%'))
-        return yaml_parser_fetch_directive(parser);
+        /* We are finished. */
 
-    /* Is it the document start indicator? */
+        if (is_ready) {
+            parser->checkpoint.retry_length = 0;
+            STATS_PEAK(parser, max_queued_tokens,
+                    parser->tokens.tail - parser->tokens.head);
+            STATS_TIMER_STOP(parser, scanner);
+            return 1;
+        }
 
-    if (parser->mark.column == 0
-            && CHECK_AT(parser->input, '-', 0)
-            && CHECK_AT(parser->input, '-', 1)
-            && CHECK_AT(parser->input, '-', 2)
-            && IS_BLANKZ_AT(parser->input, 3))
-        return yaml_parser_fetch_document_indicator(parser,
-                YAML_DOCUMENT_START_TOKEN);
+        /* Fetch the next token. */
 
-    /* Is it the document end indicator? */
+        if (!yaml_parser_fetch_next_token(parser))
+        {
+            STATS_TIMER_STOP(parser, scanner);
+            if (parser->is_input_needed) {
+                yaml_parser_restore_scanner_state(parser);
+                yaml_parser_postpone_scanning(parser);
+            }
+            else if (parser->error.type == YAML_SCANNER_ERROR) {
+                memset(&parser->error, 0, sizeof(yaml_error_t));
+                goto error_ahead;
+            }
+            return 0;
+        }
 
-    if (parser->mark.column == 0
-            && CHECK_AT(parser->input, '.', 0)
-            && CHECK_AT(parser->input, '.', 1)
-            && CHECK_AT(parser->input, '.', 2)
-            && IS_BLANKZ_AT(parser->input, 3))
-        return yaml_parser_fetch_document_indicator(parser,
-                YAML_DOCUMENT_END_TOKEN);
+        /*
+         * The token may end the line of a required key, and the parser in the
+         * pull mode would fail before it could produce any other event.
+         */
 
-    /* Is it the flow sequence start indicator? */
+        if (yaml_parser_is_required_key_stale(parser)) {
+            STATS_TIMER_STOP(parser, scanner);
+            goto error_ahead;
+        }
+    }
 
-    if (CHECK(parser->input, '['))
-        return yaml_parser_fetch_flow_collection_start(parser,
-                YAML_FLOW_SEQUENCE_START_TOKEN);
+    /*
+     * Return to the saved state and let the parser fetch the tokens one by one
+     * from now on, so that it fails exactly where the pull parser does.
+     */
 
-    /* Is it the flow mapping start indicator? */
+error_ahead:
 
-    if (CHECK(parser->input, '{'))
-        return yaml_parser_fetch_flow_collection_start(parser,
-                YAML_FLOW_MAPPING_START_TOKEN);
+    yaml_parser_restore_scanner_state(parser);
+    parser->is_scanning_ahead = 0;
+    parser->is_error_ahead = 1;
 
-    /* Is it the flow sequence end indicator? */
+    return 1;
+}
 
-    if (CHECK(parser->input, ']'))
-        return yaml_parser_fetch_flow_collection_end(parser,
-                YAML_FLOW_SEQUENCE_END_TOKEN);
+/*
+ * Fetch the next token.  In the push mode, if the fed input ends before the
+ * token does, return the scanner to the state it had before, so that the
+ * token could be fetched again once the application feeds more input.
+ */
 
-    /* Is it the flow mapping end indicator? */
+static int
+yaml_parser_fetch_pushed_token(yaml_parser_t *parser)
+{
+    if (!parser->is_push || parser->is_final)
+        return yaml_parser_fetch_next_token(parser);
 
-    if (CHECK(parser->input, '}'))
-        return yaml_parser_fetch_flow_collection_end(parser,
-                YAML_FLOW_MAPPING_END_TOKEN);
+    if (yaml_parser_wait_for_input(parser))
+        return 0;
 
-    /* Is it the flow entry indicator? */
+    if (!yaml_parser_save_scanner_state(parser))
+        return 0;
 
-    if (CHECK(parser->input, ','))
-        return yaml_parser_fetch_flow_entry(parser);
+    if (!yaml_parser_fetch_next_token(parser)) {
+        if (parser->is_input_needed) {
+            yaml_parser_restore_scanner_state(parser);
+            yaml_parser_postpone_scanning(parser);
+        }
+        return 0;
+    }
 
-    /* Is it the block entry indicator? */
+    parser->checkpoint.retry_length = 0;
 
-    if (CHECK(parser->input, '-') && IS_BLANKZ_AT(parser->input, 1))
-        return yaml_parser_fetch_block_entry(parser);
+    return 1;
+}
 
-    /* Is it the key indicator? */
+/*
+ * Mark the saved items that may change from now on.  A queued token moves only
+ * when a token is inserted before it.  An indentation level changes only when
+ * it is popped.  A simple key changes when it is at the top of the stack or
+ * when it is not below the lowest flow level with a potential key.
+ */
 
-    if (CHECK(parser->input, '?')
-            && (parser->flow_level || IS_BLANKZ_AT(parser->input, 1)))
-        return yaml_parser_fetch_key(parser);
+#define CHECKPOINT_DIRTY(dirty, index)                                          \
+    ((dirty) > (index) ? (void)((dirty) = (index)) : (void)0)
 
-    /* Is it the value indicator? */
+#define CHECKPOINT_INDENTS_DIRTY(parser)                                        \
+    CHECKPOINT_DIRTY((parser)->checkpoint.indents.dirty,                        \
+            (parser)->indents.length)
 
-    if (CHECK(parser->input, ':')
-            && (parser->flow_level || IS_BLANKZ_AT(parser->input, 1)))
-        return yaml_parser_fetch_value(parser);
+#define CHECKPOINT_SIMPLE_KEYS_DIRTY(parser)                                    \
+    CHECKPOINT_DIRTY((parser)->checkpoint.simple_keys.dirty,                    \
+            (parser)->simple_keys_start < (parser)->simple_keys.length ?        \
+            (parser)->simple_keys_start : (parser)->simple_keys.length-1)
 
-    /* Is it an alias? */
+/*
+ * Get the number of the fed input bytes that are not scanned yet.
+ */
 
-    if (CHECK(parser->input, '*'))
-        return yaml_parser_fetch_anchor(parser, YAML_ALIAS_TOKEN);
+#define UNSCANNED_INPUT(parser)                                                 \
+    ((parser)->input.length - (parser)->input.pointer                           \
+     + (parser)->raw_input.length - (parser)->raw_input.pointer)
 
-    /* Is it an anchor? */
+/*
+ * Check if the input fed since the scanner returned to the saved state is too
+ * short to try fetching the tokens again.
+ */
 
-    if (CHECK(parser->input, '&'))
-        return yaml_parser_fetch_anchor(parser, YAML_ANCHOR_TOKEN);
+static int
+yaml_parser_wait_for_input(yaml_parser_t *parser)
+{
+    if (parser->checkpoint.retry_length
+            && UNSCANNED_INPUT(parser) < parser->checkpoint.retry_length) {
+        parser->is_input_needed = 1;
+        return 1;
+    }
 
-    /* Is it a tag? */
+    return 0;
+}
 
-    if (CHECK(parser->input, '!'))
-        return yaml_parser_fetch_tag(parser);
+/*
+ * Postpone fetching the tokens again until the unread input doubles.  Then a
+ * token split over many parts is scanned in the linear time.
+ */
 
-    /* Is it a literal scalar? */
+static void
+yaml_parser_postpone_scanning(yaml_parser_t *parser)
+{
+    parser->checkpoint.retry_length = UNSCANNED_INPUT(parser)*2;
+}
 
-    if (CHECK(parser->input, '|') && !parser->flow_level)
-        return yaml_parser_fetch_block_scalar(parser, 1);
+/*
+ * Save the scanner state before fetching a token in the push mode.
+ *
+ * Only the queued tokens and the stack items that may have changed since the
+ * state was saved the last time are copied, so that the time of saving the
+ * state depends neither on the depth of the nesting nor on the number of the
+ * tokens waiting for a simple key.
+ */
 
-    /* Is it a folded scalar? */
+static int
+yaml_parser_save_scanner_state(yaml_parser_t *parser)
+{
+    /* Drop the consumed characters when they fill the most of the buffer. */
+
+    if (parser->input.pointer > 0
+            && parser->input.pointer >= parser->input.length/2) {
+        memmove(parser->input.buffer,
+                parser->input.buffer + parser->input.pointer,
+                parser->input.length - parser->input.pointer);
+        parser->input.length -= parser->input.pointer;
+        parser->input.pointer = 0;
+    }
 
-    if (CHECK(parser->input, '>') && !parser->flow_level)
-        return yaml_parser_fetch_block_scalar(parser, 0);
+    parser->checkpoint.input_pointer = parser->input.pointer;
+    parser->checkpoint.mark = parser->mark;
+    parser->checkpoint.is_stream_start_produced
+        = parser->is_stream_start_produced;
+    parser->checkpoint.flow_level = parser->flow_level;
+    parser->checkpoint.indent = parser->indent;
+    parser->checkpoint.is_simple_key_allowed = parser->is_simple_key_allowed;
+    parser->checkpoint.simple_keys_start = parser->simple_keys_start;
+    parser->checkpoint.is_json = parser->is_json;
 
-    /* Is it a single-quoted scalar? */
+    /* Copy the new queued tokens and the changed items of the stacks. */
 
-    if (CHECK(parser->input, '\''))
-        return yaml_parser_fetch_flow_scalar(parser, 1);
-
-    /* Is it a double-quoted scalar? */
-
-    if (CHECK(parser->input, '"'))
-        return yaml_parser_fetch_flow_scalar(parser, 0);
-
-    /*
-     * Is it a plain scalar?
-     *
-     * A plain scalar may start with any non-blank characters except
-     *
-     *      '-', '?', ':', ',', '[', ']', '{', '}',
-     *      '#', '&', '*', '!', '|', '>', '\'', '\"',
-     *      '%', '@', '`'.
-     *
-     * In the block context (and, for the '-' indicator, in the flow context
-     * too), it may also start with the characters
-     *
-     *      '-', '?', ':'
-     *
-     * if it is followed by a non-space character.
-     *
-     * The last rule is more restrictive than the specification requires.
-     */
-
-    if (!(IS_BLANKZ(parser->input) || CHECK(parser->input, '-')
-                || CHECK(parser->input, '?') || CHECK(parser->input, ':')
-                || CHECK(parser->input, ',') || CHECK(parser->input, '[')
-                || CHECK(parser->input, ']') || CHECK(parser->input, '{')
-                || CHECK(parser->input, '}') || CHECK(parser->input, '#')
-                || CHECK(parser->input, '&') || CHECK(parser->input, '*')
-                || CHECK(parser->input, '!') || CHECK(parser->input, '|')
-                || CHECK(parser->input, '>') || CHECK(parser->input, '\'')
-                || CHECK(parser->input, '"') || CHECK(parser->input, '%')
-                || CHECK(parser->input, '@') || CHECK(parser->input, '`')) ||
-            (CHECK(parser->input, '-') && !IS_BLANK_AT(parser->input, 1)) ||
-            (!parser->flow_level &&
-             (CHECK(parser->input, '?') || CHECK(parser->input, ':'))
-             && !IS_BLANKZ_AT(parser->input, 1)))
-        return yaml_parser_fetch_plain_scalar(parser);
+    if (!yaml_parser_save_tokens(parser))
+        return 0;
 
-    /*
-     * If we don't determine the token type so far, it is an error.
-     */
+    if (!yaml_parser_save_list(parser,
+                (void **)&parser->checkpoint.indents.list,
+                &parser->checkpoint.indents.capacity,
+                parser->indents.list, parser->checkpoint.indents.dirty,
+                parser->indents.length, sizeof(int)))
+        return 0;
+    parser->checkpoint.indents.length = parser->indents.length;
+    parser->checkpoint.indents.dirty = parser->indents.length;
+
+    if (!yaml_parser_save_list(parser,
+                (void **)&parser->checkpoint.simple_keys.list,
+                &parser->checkpoint.simple_keys.capacity,
+                parser->simple_keys.list, parser->checkpoint.simple_keys.dirty,
+                parser->simple_keys.length, sizeof(yaml_simple_key_t)))
+        return 0;
+    if (parser->simple_keys.length) {
+        parser->checkpoint.simple_keys.list[0] = parser->simple_keys.list[0];
+    }
+    parser->checkpoint.simple_keys.length = parser->simple_keys.length;
+    parser->checkpoint.simple_keys.dirty = parser->simple_keys.length;
+    CHECKPOINT_SIMPLE_KEYS_DIRTY(parser);
 
-    return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-            "while scanning for the next token", start_mark,
-            "found character that cannot start any token", parser->mark);
+    return 1;
 }
 
 /*
- * Check the list of potential simple keys and remove the positions that
- * cannot contain simple keys anymore.
+ * Update the saved tokens queue.  Drop the tokens taken by the parser since
+ * the state was saved the last time and copy the tokens queued after the
+ * lowest inserted one.
  */
 
 static int
-yaml_parser_stale_simple_keys(yaml_parser_t *parser)
+yaml_parser_save_tokens(yaml_parser_t *parser)
 {
-    size_t idx;
+    size_t number = parser->tokens_parsed;
+    size_t length = parser->tokens.tail - parser->tokens.head;
+    size_t valid = parser->checkpoint.tokens.number
+        + (parser->checkpoint.tokens.tail - parser->checkpoint.tokens.head);
 
-    /* Check for a potential simple key for each flow level. */
-
-    for (idx = 0; idx < parser->simple_keys.length; idx ++)
-    {
-        yaml_simple_key_t *simple_key = parser->simple_keys.list + idx;
+    if (valid > parser->checkpoint.tokens.dirty) {
+        valid = parser->checkpoint.tokens.dirty;
+    }
 
-        /*
-         * The specification requires that a simple key
-         *
-         *  - is limited to a single line,
-         *  - is shorter than 1024 characters.
-         */
+    /* Drop the parsed tokens and the tokens that may have been displaced. */
 
-        if (simple_key->is_possible
-                && (simple_key->mark.line < parser->mark.line
-                    || simple_key->mark.index+1024 < parser->mark.index)) {
+    if (valid < number) {
+        valid = number;
+    }
+    parser->checkpoint.tokens.head += number - parser->checkpoint.tokens.number;
+    parser->checkpoint.tokens.tail = parser->checkpoint.tokens.head
+        + (valid - number);
+    parser->checkpoint.tokens.number = number;
 
-            /* Check if the potential simple key to be removed is required. */
+    /* Make room for the new tokens. */
 
-            if (simple_key->is_required) {
-                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                        "while scanning a simple key", simple_key->mark,
-                        "could not find expected ':'", parser->mark);
+    if (parser->checkpoint.tokens.head + length
+            > parser->checkpoint.tokens.capacity)
+    {
+        size_t saved = valid - number;
+
+        if (parser->checkpoint.tokens.head >= saved
+                && length <= parser->checkpoint.tokens.capacity) {
+            if (saved) {
+                memmove(parser->checkpoint.tokens.list,
+                        parser->checkpoint.tokens.list
+                        + parser->checkpoint.tokens.head,
+                        saved*sizeof(yaml_token_t));
             }
-
-            simple_key->is_possible = 0;
         }
+        else {
+            size_t capacity = length*2;
+            yaml_token_t *list = yaml_malloc(capacity*sizeof(yaml_token_t));
+            if (!list)
+                return MEMORY_ERROR_INIT(parser);
+            if (saved) {
+                memcpy(list, parser->checkpoint.tokens.list
+                        + parser->checkpoint.tokens.head,
+                        saved*sizeof(yaml_token_t));
+            }
+            yaml_free(parser->checkpoint.tokens.list);
+            parser->checkpoint.tokens.list = list;
+            parser->checkpoint.tokens.capacity = capacity;
+        }
+
+        parser->checkpoint.tokens.head = 0;
+        parser->checkpoint.tokens.tail = saved;
+    }
+
+    /* Copy the tokens that are not saved yet. */
+
+    if (valid < number + length) {
+        memcpy(parser->checkpoint.tokens.list + parser->checkpoint.tokens.tail,
+                parser->tokens.list + parser->tokens.head + (valid - number),
+                (number + length - valid)*sizeof(yaml_token_t));
     }
+    parser->checkpoint.tokens.tail = parser->checkpoint.tokens.head + length;
+    parser->checkpoint.tokens.dirty = number + length;
 
     return 1;
 }
 
 /*
- * Check if a simple key may start at the current position and add it if
- * needed.
+ * Copy the items from `start` to `length` of the given `size` to a saved list.
+ * The items below `start` are already saved.
  */
 
 static int
-yaml_parser_save_simple_key(yaml_parser_t *parser)
+yaml_parser_save_list(yaml_parser_t *parser, void **list, size_t *capacity,
+        const void *items, size_t start, size_t length, size_t size)
 {
-    /*
-     * A simple key is required at the current position if the scanner is in
-     * the block context and the current column coincides with the indentation
-     * level.
-     */
-
-    int is_required = (!parser->flow_level
-            && parser->indent == (int)parser->mark.column);
-
-    /*
-     * A simple key is required only when it is the first token in the current
-     * line.  Therefore it is always allowed.  But we add a check anyway.
-     */
-
-    assert(parser->is_simple_key_allowed || !is_required);  /* Impossible. */
-
-    /*
-     * If the current position may start a simple key, save it.
-     */
-
-    if (parser->is_simple_key_allowed)
-    {
-        yaml_simple_key_t simple_key = { 1, is_required,
-            parser->tokens_parsed + parser->tokens.tail - parser->tokens.head,
-            { 0, 0, 0 } };
-        simple_key.mark = parser->mark;
-
-        if (!yaml_parser_remove_simple_key(parser)) return 0;
+    if (*capacity < length) {
+        size_t new_capacity = (*capacity)*2;
+        void *new_list;
+        if (new_capacity < length) {
+            new_capacity = length;
+        }
+        new_list = yaml_realloc(*list, new_capacity*size);
+        if (!new_list)
+            return MEMORY_ERROR_INIT(parser);
+        *list = new_list;
+        *capacity = new_capacity;
+    }
 
-        parser->simple_keys.list[parser->simple_keys.length-1] = simple_key;
+    if (start < length) {
+        memcpy((char *)*list + start*size, (const char *)items + start*size,
+                (length-start)*size);
     }
 
     return 1;
 }
 
 /*
- * Remove a potential simple key at the current flow level.
+ * Return the scanner to the saved state.
  */
 
-static int
-yaml_parser_remove_simple_key(yaml_parser_t *parser)
+static void
+yaml_parser_restore_scanner_state(yaml_parser_t *parser)
 {
-    yaml_simple_key_t *simple_key =
-        parser->simple_keys.list + parser->simple_keys.length - 1;
+    yaml_token_t *saved_tokens =
+        parser->checkpoint.tokens.list + parser->checkpoint.tokens.head;
+    size_t length =
+        parser->checkpoint.tokens.tail - parser->checkpoint.tokens.head;
+    size_t start = parser->checkpoint.tokens.dirty - parser->tokens_parsed;
+    size_t idx, saved_idx;
 
-    if (simple_key->is_possible)
-    {
-        /* If the key is required, it is an error. */
+    assert(parser->checkpoint.tokens.number == parser->tokens_parsed);
+                                    /* No tokens are parsed since then. */
 
-        if (simple_key->is_required) {
-            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a simple key", simple_key->mark,
-                    "could not find expected ':'", parser->mark);
-        }
-    }
+    /*
+     * The saved tokens are still in the queue, possibly interleaved with the
+     * tokens inserted since then.  The tokens before the lowest inserted one
+     * are in place.  Destroy the new ones and put the saved tokens back.
+     */
 
-    /* Remove the key from the stack. */
+    if (start > length) {
+        start = length;
+    }
 
-    simple_key->is_possible = 0;
+    saved_idx = start;
 
-    return 1;
-}
+    for (idx = parser->tokens.head + start; idx < parser->tokens.tail; idx++) {
+        if (saved_idx < length && !memcmp(parser->tokens.list + idx,
+                    saved_tokens + saved_idx, sizeof(yaml_token_t))) {
+            saved_idx ++;
+        }
+        else {
+            yaml_parser_recycle_token(parser, parser->tokens.list + idx);
+        }
+    }
 
-/*
- * Increase the flow level and resize the simple key list if needed.
- */
+    assert(saved_idx == length);    /* All saved tokens are found. */
 
-static int
-yaml_parser_increase_flow_level(yaml_parser_t *parser)
-{
-    yaml_simple_key_t empty_simple_key = { 0, 0, 0, { 0, 0, 0 } };
+    if (start < length) {
+        memcpy(parser->tokens.list + parser->tokens.head + start,
+                saved_tokens + start, (length-start)*sizeof(yaml_token_t));
+    }
+    parser->tokens.tail = parser->tokens.head + length;
+    parser->checkpoint.tokens.dirty = parser->tokens_parsed + length;
 
-    /* Reset the simple key on the next level. */
+    /* Restore only the stack items that may have changed. */
 
-    if (!PUSH(parser, parser->simple_keys, empty_simple_key))
-        return 0;
+    length = parser->checkpoint.indents.length;
+    idx = parser->checkpoint.indents.dirty;
+    if (idx < length) {
+        memcpy(parser->indents.list + idx,
+                parser->checkpoint.indents.list + idx,
+                (length-idx)*sizeof(int));
+    }
+    parser->indents.length = length;
+
+    length = parser->checkpoint.simple_keys.length;
+    idx = parser->checkpoint.simple_keys.dirty;
+    if (idx < length) {
+        memcpy(parser->simple_keys.list + idx,
+                parser->checkpoint.simple_keys.list + idx,
+                (length-idx)*sizeof(yaml_simple_key_t));
+    }
+    if (length) {
+        parser->simple_keys.list[0] = parser->checkpoint.simple_keys.list[0];
+    }
+    parser->simple_keys.length = length;
 
-    /* Increase the flow level. */
+    /* Return the characters consumed since then to the working buffer. */
 
-    parser->flow_level++;
+    parser->unread += parser->mark.index - parser->checkpoint.mark.index;
+    parser->input.pointer = parser->checkpoint.input_pointer;
+    parser->mark = parser->checkpoint.mark;
 
-    return 1;
+    parser->is_stream_start_produced
+        = parser->checkpoint.is_stream_start_produced;
+    parser->flow_level = parser->checkpoint.flow_level;
+    parser->indent = parser->checkpoint.indent;
+    parser->is_simple_key_allowed = parser->checkpoint.is_simple_key_allowed;
+    parser->simple_keys_start = parser->checkpoint.simple_keys_start;
+    parser->is_json = parser->checkpoint.is_json;
 }
 
 /*
- * Decrease the flow level.
+ * The dispatcher for token fetchers.
  */
 
 static int
-yaml_parser_decrease_flow_level(yaml_parser_t *parser)
+yaml_parser_fetch_next_token(yaml_parser_t *parser)
 {
-    yaml_simple_key_t dummy_key;    /* Used to eliminate a compiler warning. */
-
-    if (parser->flow_level) {
-        parser->flow_level --;
-        dummy_key = POP(parser, parser->simple_keys);
-    }
+    yaml_mark_t start_mark = parser->mark;
 
-    return 1;
-}
+    /* Ensure that the buffer is initialized. */
 
-/*
- * Push the current indentation level to the stack and set the new level
- * the current column is greater than the indentation level.  In this case,
- * append or insert the specified token into the token queue.
- * 
- */
+    if (!CACHE(parser, 1))
+        return 0;
 
-static int
-yaml_parser_roll_indent(yaml_parser_t *parser, int column,
-        int number, yaml_token_type_t type, yaml_mark_t mark)
-{
-    yaml_token_t token;
+    /* Check if we just started scanning.  Fetch STREAM-START then. */
 
-    /* In the flow context, do nothing. */
+    if (!parser->is_stream_start_produced)
+        return yaml_parser_fetch_stream_start(parser);
 
-    if (parser->flow_level)
-        return 1;
+    /* Try the JSON scanner first if it is enabled. */
 
-    if (parser->indent < column)
+    if (parser->is_json && parser->flow_level)
     {
-        /*
-         * Push the current indentation level to the stack and set the new
-         * indentation level.
-         */
+        int is_fetched;
 
-        if (!PUSH(parser, parser->indents, parser->indent))
+        if (!yaml_parser_fetch_json_token(parser, &is_fetched))
             return 0;
 
-        parser->indent = column;
+        if (is_fetched)
+            return 1;
+    }
 
-        /* Create a token and insert it into the queue. */
+    /* Eat whitespaces and comments until we reach the next token. */
 
-        TOKEN_INIT(token, type, mark, mark);
+    if (!yaml_parser_scan_to_next_token(parser))
+        return 0;
 
-        if (number == -1) {
-            if (!ENQUEUE(parser, parser->tokens, token))
-                return 0;
-        }
-        else {
-            if (!QUEUE_INSERT(parser,
-                        parser->tokens, number - parser->tokens_parsed, token))
-                return 0;
-        }
-    }
+    /* Remove obsolete potential simple keys. */
 
-    return 1;
-}
+    if (!yaml_parser_stale_simple_keys(parser, 0))
+        return 0;
 
-/*
- * Pop indentation levels from the indents stack until the current level
- * becomes less or equal to the column.  For each intendation level, append
- * the BLOCK-END token.
- */
+    /* Check the indentation level against the current column. */
 
+    if (!yaml_parser_unroll_indent(parser, parser->mark.column))
+        return 0;
 
-static int
-yaml_parser_unroll_indent(yaml_parser_t *parser, int column)
-{
-    yaml_token_t token;
+    /*
+     * Ensure that the buffer contains at least 4 characters.  4 is the length
+     * of the longest indicators ('--- ' and '... ').
+     */
 
-    /* In the flow context, do nothing. */
+    if (!CACHE(parser, 4))
+        return 0;
 
-    if (parser->flow_level)
-        return 1;
+    /* Is it the end of the stream? */
 
-    /* Loop through the intendation levels in the stack. */
+    if (IS_Z(parser->input))
+        return yaml_parser_fetch_stream_end(parser);
 
-    while (parser->indent > column)
-    {
-        /* Create a token and append it to the queue. */
+    /* Is it a directive? */
 
-        TOKEN_INIT(token, YAML_BLOCK_END_TOKEN, parser->mark, parser->mark);
+    if (parser->mark.column == 0 && CHECK(parser->input, '%'))
+        return yaml_parser_fetch_directive(parser);
 
-        if (!ENQUEUE(parser, parser->tokens, token))
-            return 0;
+    /* Is it the document start indicator? */
 
-        /* Pop the indentation level. */
+    if (parser->mark.column == 0
+            && CHECK_AT(parser->input, '-', 0)
+            && CHECK_AT(parser->input, '-', 1)
+            && CHECK_AT(parser->input, '-', 2)
+            && IS_BLANKZ_AT(parser->input, 3))
+        return yaml_parser_fetch_document_indicator(parser,
+                YAML_DOCUMENT_START_TOKEN);
 
-        parser->indent = POP(parser, parser->indents);
-    }
+    /* Is it the document end indicator? */
 
-    return 1;
-}
-
-/*
- * Initialize the scanner and produce the STREAM-START token.
- */
-
-static int
-yaml_parser_fetch_stream_start(yaml_parser_t *parser)
-{
-    yaml_simple_key_t simple_key = { 0, 0, 0, { 0, 0, 0 } };
-    yaml_token_t token;
-
-    /* Set the initial indentation. */
+    if (parser->mark.column == 0
+            && CHECK_AT(parser->input, '.', 0)
+            && CHECK_AT(parser->input, '.', 1)
+            && CHECK_AT(parser->input, '.', 2)
+            && IS_BLANKZ_AT(parser->input, 3))
+        return yaml_parser_fetch_document_indicator(parser,
+                YAML_DOCUMENT_END_TOKEN);
 
-    parser->indent = -1;
+    /* Is it the flow sequence start indicator? */
 
-    /* Initialize the simple key stack. */
+    if (CHECK(parser->input, '['))
+        return yaml_parser_fetch_flow_collection_start(parser,
+                YAML_FLOW_SEQUENCE_START_TOKEN);
 
-    if (!PUSH(parser, parser->simple_keys, simple_key))
-        return 0;
+    /* Is it the flow mapping start indicator? */
 
-    /* A simple key is allowed at the beginning of the stream. */
+    if (CHECK(parser->input, '{'))
+        return yaml_parser_fetch_flow_collection_start(parser,
+                YAML_FLOW_MAPPING_START_TOKEN);
 
-    parser->is_simple_key_allowed = 1;
+    /* Is it the flow sequence end indicator? */
 
-    /* We have started. */
+    if (CHECK(parser->input, ']'))
+        return yaml_parser_fetch_flow_collection_end(parser,
+                YAML_FLOW_SEQUENCE_END_TOKEN);
 
-    parser->is_stream_start_produced = 1;
+    /* Is it the flow mapping end indicator? */
 
-    /* Create the STREAM-START token and append it to the queue. */
+    if (CHECK(parser->input, '}'))
+        return yaml_parser_fetch_flow_collection_end(parser,
+                YAML_FLOW_MAPPING_END_TOKEN);
 
-    STREAM_START_TOKEN_INIT(token, parser->encoding,
-            parser->mark, parser->mark);
+    /* Is it the flow entry indicator? */
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+    if (CHECK(parser->input, ','))
+        return yaml_parser_fetch_flow_entry(parser);
 
-    return 1;
-}
+    /* Is it the block entry indicator? */
 
-/*
- * Produce the STREAM-END token and shut down the scanner.
- */
+    if (CHECK(parser->input, '-') && IS_BLANKZ_AT(parser->input, 1))
+        return yaml_parser_fetch_block_entry(parser);
 
-static int
-yaml_parser_fetch_stream_end(yaml_parser_t *parser)
-{
-    yaml_token_t token;
+    /* Is it the key indicator? */
 
-    /* Force new line. */
+    if (CHECK(parser->input, '?')
+            && (parser->flow_level || IS_BLANKZ_AT(parser->input, 1)))
+        return yaml_parser_fetch_key(parser);
 
-    if (parser->mark.column != 0) {
-        parser->mark.column = 0;
-        parser->mark.line ++;
-    }
+    /* Is it the value indicator? */
 
-    /* Reset the indentation level. */
+    if (CHECK(parser->input, ':')
+            && (parser->flow_level || IS_BLANKZ_AT(parser->input, 1)))
+        return yaml_parser_fetch_value(parser);
 
-    if (!yaml_parser_unroll_indent(parser, -1))
-        return 0;
+    /* Is it an alias? */
 
-    /* Reset simple keys. */
+    if (CHECK(parser->input, '*'))
+        return yaml_parser_fetch_anchor(parser, YAML_ALIAS_TOKEN);
 
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+    /* Is it an anchor? */
 
-    parser->is_simple_key_allowed = 0;
+    if (CHECK(parser->input, '&'))
+        return yaml_parser_fetch_anchor(parser, YAML_ANCHOR_TOKEN);
 
-    /* Create the STREAM-END token and append it to the queue. */
+    /* Is it a tag? */
 
-    STREAM_END_TOKEN_INIT(token, parser->mark, parser->mark);
+    if (CHECK(parser->input, '!'))
+        return yaml_parser_fetch_tag(parser);
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+    /* Is it a literal scalar? */
 
-    return 1;
-}
+    if (CHECK(parser->input, '|') && !parser->flow_level)
+        return yaml_parser_fetch_block_scalar(parser, 1);
 
-/*
- * Produce a VERSION-DIRECTIVE or TAG-DIRECTIVE token.
- */
+    /* Is it a folded scalar? */
 
-static int
-yaml_parser_fetch_directive(yaml_parser_t *parser)
-{
-    yaml_token_t token;
+    if (CHECK(parser->input, '>') && !parser->flow_level)
+        return yaml_parser_fetch_block_scalar(parser, 0);
 
-    /* Reset the indentation level. */
+    /* Is it a single-quoted scalar? */
 
-    if (!yaml_parser_unroll_indent(parser, -1))
-        return 0;
+    if (CHECK(parser->input, '\''))
+        return yaml_parser_fetch_flow_scalar(parser, 1);
 
-    /* Reset simple keys. */
+    /* Is it a double-quoted scalar? */
 
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+    if (CHECK(parser->input, '"'))
+        return yaml_parser_fetch_flow_scalar(parser, 0);
 
-    parser->is_simple_key_allowed = 0;
+    /*
+     * Is it a plain scalar?
+     *
+     * A plain scalar may start with any non-blank characters except
+     *
+     *      '-', '?', ':', ',', '[', ']', '{', '}',
+     *      '#', '&', '*', '!', '|', '>', '\'', '\"',
+     *      '%', '@', '`'.
+     *
+     * In the block context (and, for the '-' indicator, in the flow context
+     * too), it may also start with the characters
+     *
+     *      '-', '?', ':'
+     *
+     * if it is followed by a non-space character.
+     *
+     * The last rule is more restrictive than the specification requires.
+     */
 
-    /* Create the YAML-DIRECTIVE or TAG-DIRECTIVE token. */
+    if (!(IS_BLANKZ(parser->input) || CHECK(parser->input, '-')
+                || CHECK(parser->input, '?') || CHECK(parser->input, ':')
+                || CHECK(parser->input, ',') || CHECK(parser->input, '[')
+                || CHECK(parser->input, ']') || CHECK(parser->input, '{')
+                || CHECK(parser->input, '}') || CHECK(parser->input, '#')
+                || CHECK(parser->input, '&') || CHECK(parser->input, '*')
+                || CHECK(parser->input, '!') || CHECK(parser->input, '|')
+                || CHECK(parser->input, '>') || CHECK(parser->input, '\'')
+                || CHECK(parser->input, '"') || CHECK(parser->input, '%')
+                || CHECK(parser->input, '@') || CHECK(parser->input, '`')) ||
+            (CHECK(parser->input, '-') && !IS_BLANK_AT(parser->input, 1)) ||
+            (!parser->flow_level &&
+             (CHECK(parser->input, '?') || CHECK(parser->input, ':'))
+             && !IS_BLANKZ_AT(parser->input, 1)))
+        return yaml_parser_fetch_plain_scalar(parser);
 
-    if (!yaml_parser_scan_directive(parser, &token))
-        return 0;
+    /*
+     * If we don't determine the token type so far, it is an error.
+     */
 
-    /* Append the token to the queue. */
+    return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+            "while scanning for the next token", start_mark,
+            "found character that cannot start any token", parser->mark);
+}
 
-    if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
-        return 0;
-    }
+/*
+ * Check if a potential simple key cannot be completed at the current position.
+ *
+ * The specification requires that a simple key
+ *
+ *  - is limited to a single line,
+ *  - is shorter than 1024 characters.
+ */
 
-    return 1;
-}
+#define IS_STALE_SIMPLE_KEY(parser, simple_key)                                 \
+    ((simple_key).mark.line < (parser)->mark.line                               \
+     || (simple_key).mark.index+1024 < (parser)->mark.index)
 
 /*
- * Produce the DOCUMENT-START or DOCUMENT-END token.
+ * Check the list of potential simple keys and remove the positions that
+ * cannot contain simple keys anymore.  If `keep_required` is set, a required
+ * key is kept instead of reporting an error.
+ *
+ * A key of a flow level is saved after the keys of the levels below it, so
+ * the stale keys of the flow levels come first; the check stops at the first
+ * possible key that is still valid, and the levels below it are not checked
+ * again.
  */
 
 static int
-yaml_parser_fetch_document_indicator(yaml_parser_t *parser,
-        yaml_token_type_t type)
+yaml_parser_stale_simple_keys(yaml_parser_t *parser, int keep_required)
 {
-    yaml_mark_t start_mark, end_mark;
-    yaml_token_t token;
-
-    /* Reset the indentation level. */
-
-    if (!yaml_parser_unroll_indent(parser, -1))
-        return 0;
-
-    /* Reset simple keys. */
+    yaml_simple_key_t *simple_key = parser->simple_keys.list;
 
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+    if (!parser->simple_keys.length)
+        return 1;
 
-    parser->is_simple_key_allowed = 0;
+    /* Check for a potential simple key in the block context. */
 
-    /* Consume the token. */
+    STATS_COUNT(parser, simple_key_checks, 1);
 
-    start_mark = parser->mark;
+    if (simple_key->is_possible && IS_STALE_SIMPLE_KEY(parser, *simple_key))
+    {
+        /* Check if the potential simple key to be removed is required. */
 
-    SKIP(parser);
-    SKIP(parser);
-    SKIP(parser);
+        if (simple_key->is_required) {
+            if (!keep_required) {
+                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                        "while scanning a simple key", simple_key->mark,
+                        "could not find expected ':'", parser->mark);
+            }
+        }
+        else {
+            simple_key->is_possible = 0;
+        }
+    }
 
-    end_mark = parser->mark;
+    /* Check for the potential simple keys of the flow levels. */
 
-    /* Create the DOCUMENT-START or DOCUMENT-END token. */
+    while (parser->simple_keys_start < parser->simple_keys.length)
+    {
+        simple_key = parser->simple_keys.list + parser->simple_keys_start;
 
-    TOKEN_INIT(token, type, start_mark, end_mark);
+        STATS_COUNT(parser, simple_key_checks, 1);
 
-    /* Append the token to the queue. */
+        if (simple_key->is_possible) {
+            if (!IS_STALE_SIMPLE_KEY(parser, *simple_key))
+                break;
+            assert(!simple_key->is_required);   /* Required in a flow? */
+            simple_key->is_possible = 0;
+        }
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+        parser->simple_keys_start ++;
+    }
 
     return 1;
 }
 
 /*
- * Produce the FLOW-SEQUENCE-START or FLOW-MAPPING-START token.
+ * Check if the potential simple key in the block context is required and
+ * cannot be completed anymore.
  */
 
 static int
-yaml_parser_fetch_flow_collection_start(yaml_parser_t *parser,
-        yaml_token_type_t type)
+yaml_parser_is_required_key_stale(yaml_parser_t *parser)
 {
-    yaml_mark_t start_mark, end_mark;
-    yaml_token_t token;
+    yaml_simple_key_t *simple_key = parser->simple_keys.list;
 
-    /* The indicators '[' and '{' may start a simple key. */
+    return (parser->simple_keys.length && simple_key->is_possible
+            && simple_key->is_required
+            && IS_STALE_SIMPLE_KEY(parser, *simple_key));
+}
 
-    if (!yaml_parser_save_simple_key(parser))
-        return 0;
+/*
+ * Get the potential simple key with the lowest token number or `NULL`.
+ */
 
-    /* Increase the flow level. */
+static yaml_simple_key_t *
+yaml_parser_first_simple_key(yaml_parser_t *parser)
+{
+    if (!parser->simple_keys.length)
+        return NULL;
+
+    if (parser->simple_keys.list[0].is_possible)
+        return parser->simple_keys.list;
+
+    while (parser->simple_keys_start < parser->simple_keys.length) {
+        yaml_simple_key_t *simple_key =
+            parser->simple_keys.list + parser->simple_keys_start;
+        if (simple_key->is_possible)
+            return simple_key;
+        parser->simple_keys_start ++;
+    }
 
-    if (!yaml_parser_increase_flow_level(parser))
-        return 0;
+    return NULL;
+}
 
-    /* A simple key may follow the indicators '[' and '{'. */
+/*
+ * Check if a simple key may start at the current position and add it if
+ * needed.
+ */
 
-    parser->is_simple_key_allowed = 1;
+static int
+yaml_parser_save_simple_key(yaml_parser_t *parser)
+{
+    /*
+     * A simple key is required at the current position if the scanner is in
+     * the block context and the current column coincides with the indentation
+     * level.
+     */
 
-    /* Consume the token. */
+    int is_required = (!parser->flow_level
+            && parser->indent == (int)parser->mark.column);
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+    /*
+     * A simple key is required only when it is the first token in the current
+     * line.  Therefore it is always allowed.  But we add a check anyway.
+     */
 
-    /* Create the FLOW-SEQUENCE-START of FLOW-MAPPING-START token. */
+    assert(parser->is_simple_key_allowed || !is_required);  /* Impossible. */
 
-    TOKEN_INIT(token, type, start_mark, end_mark);
+    /*
+     * If the current position may start a simple key, save it.
+     */
 
-    /* Append the token to the queue. */
+    if (parser->is_simple_key_allowed)
+    {
+        yaml_simple_key_t simple_key = { 1, is_required,
+            parser->tokens_parsed + parser->tokens.tail - parser->tokens.head,
+            { 0, 0, 0 } };
+        simple_key.mark = parser->mark;
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+        if (!yaml_parser_remove_simple_key(parser)) return 0;
+
+        parser->simple_keys.list[parser->simple_keys.length-1] = simple_key;
+
+        if (parser->flow_level
+                && parser->simple_keys_start > (size_t)parser->flow_level) {
+            parser->simple_keys_start = parser->flow_level;
+        }
+    }
 
     return 1;
 }
 
 /*
- * Produce the FLOW-SEQUENCE-END or FLOW-MAPPING-END token.
+ * Remove a potential simple key at the current flow level.
  */
 
 static int
-yaml_parser_fetch_flow_collection_end(yaml_parser_t *parser,
-        yaml_token_type_t type)
+yaml_parser_remove_simple_key(yaml_parser_t *parser)
 {
-    yaml_mark_t start_mark, end_mark;
-    yaml_token_t token;
+    yaml_simple_key_t *simple_key =
+        parser->simple_keys.list + parser->simple_keys.length - 1;
 
-    /* Reset any potential simple key on the current flow level. */
+    if (simple_key->is_possible)
+    {
+        /* If the key is required, it is an error. */
 
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+        if (simple_key->is_required) {
+            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a simple key", simple_key->mark,
+                    "could not find expected ':'", parser->mark);
+        }
+    }
 
-    /* Decrease the flow level. */
+    /* Remove the key from the stack. */
 
-    if (!yaml_parser_decrease_flow_level(parser))
-        return 0;
+    simple_key->is_possible = 0;
 
-    /* No simple keys after the indicators ']' and '}'. */
+    return 1;
+}
 
-    parser->is_simple_key_allowed = 0;
+/*
+ * Increase the flow level and resize the simple key list if needed.
+ */
 
-    /* Consume the token. */
+static int
+yaml_parser_increase_flow_level(yaml_parser_t *parser)
+{
+    yaml_simple_key_t empty_simple_key = { 0, 0, 0, { 0, 0, 0 } };
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+    /* Reset the simple key on the next level. */
 
-    /* Create the FLOW-SEQUENCE-END of FLOW-MAPPING-END token. */
+    if (!PUSH(parser, parser->simple_keys, empty_simple_key))
+        return 0;
 
-    TOKEN_INIT(token, type, start_mark, end_mark);
+    /* Increase the flow level. */
 
-    /* Append the token to the queue. */
+    parser->flow_level++;
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+    return 1;
+}
+
+/*
+ * Decrease the flow level.
+ */
+
+static int
+yaml_parser_decrease_flow_level(yaml_parser_t *parser)
+{
+    yaml_simple_key_t dummy_key;    /* Used to eliminate a compiler warning. */
+
+    if (parser->flow_level) {
+        parser->flow_level --;
+        dummy_key = POP(parser, parser->simple_keys);
+        if (parser->simple_keys_start > parser->simple_keys.length) {
+            parser->simple_keys_start = parser->simple_keys.length;
+        }
+        CHECKPOINT_SIMPLE_KEYS_DIRTY(parser);
+    }
 
     return 1;
 }
 
 /*
- * Produce the FLOW-ENTRY token.
+ * Push the current indentation level to the stack and set the new level
+ * the current column is greater than the indentation level.  In this case,
+ * append or insert the specified token into the token queue.
+ * 
  */
 
 static int
-yaml_parser_fetch_flow_entry(yaml_parser_t *parser)
+yaml_parser_roll_indent(yaml_parser_t *parser, int column,
+        int number, yaml_token_type_t type, yaml_mark_t mark)
 {
-    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* Reset any potential simple keys on the current flow level. */
-
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+    /* In the flow context, do nothing. */
 
-    /* Simple keys are allowed after ','. */
+    if (parser->flow_level)
+        return 1;
 
-    parser->is_simple_key_allowed = 1;
+    if (parser->indent < column)
+    {
+        /*
+         * Push the current indentation level to the stack and set the new
+         * indentation level.
+         */
 
-    /* Consume the token. */
+        if (!PUSH(parser, parser->indents, parser->indent))
+            return 0;
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+        parser->indent = column;
 
-    /* Create the FLOW-ENTRY token and append it to the queue. */
+        /* Create a token and insert it into the queue. */
 
-    TOKEN_INIT(token, YAML_FLOW_ENTRY_TOKEN, start_mark, end_mark);
+        TOKEN_INIT(token, type, mark, mark);
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+        if (number == -1) {
+            if (!ENQUEUE(parser, parser->tokens, token))
+                return 0;
+        }
+        else {
+            CHECKPOINT_DIRTY(parser->checkpoint.tokens.dirty, (size_t)number);
+            if (!QUEUE_INSERT(parser,
+                        parser->tokens, number - parser->tokens_parsed, token))
+                return 0;
+        }
+    }
 
     return 1;
 }
 
 /*
- * Produce the BLOCK-ENTRY token.
+ * Pop indentation levels from the indents stack until the current level
+ * becomes less or equal to the column.  For each intendation level, append
+ * the BLOCK-END token.
  */
 
+
 static int
-yaml_parser_fetch_block_entry(yaml_parser_t *parser)
+yaml_parser_unroll_indent(yaml_parser_t *parser, int column)
 {
-    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* Check if the scanner is in the block context. */
-
-    if (!parser->flow_level)
-    {
-        /* Check if we are allowed to start a new entry. */
+    /* In the flow context, do nothing. */
 
-        if (!parser->is_simple_key_allowed) {
-            return SCANNER_ERROR_INIT(parser,
-                    "block sequence entries are not allowed in this context",
-                    parser->mark);
-        }
+    if (parser->flow_level)
+        return 1;
 
-        /* Add the BLOCK-SEQUENCE-START token if needed. */
+    /* Loop through the intendation levels in the stack. */
 
-        if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
-                    YAML_BLOCK_SEQUENCE_START_TOKEN, parser->mark))
-            return 0;
-    }
-    else
+    while (parser->indent > column)
     {
-        /*
-         * It is an error for the '-' indicator to occur in the flow context,
-         * but we let the Parser detect and report about it because the Parser
-         * is able to point to the context.
-         */
-    }
-
-    /* Reset any potential simple keys on the current flow level. */
-
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
-
-    /* Simple keys are allowed after '-'. */
-
-    parser->is_simple_key_allowed = 1;
-
-    /* Consume the token. */
+        /* Create a token and append it to the queue. */
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+        TOKEN_INIT(token, YAML_BLOCK_END_TOKEN, parser->mark, parser->mark);
 
-    /* Create the BLOCK-ENTRY token and append it to the queue. */
+        if (!ENQUEUE(parser, parser->tokens, token))
+            return 0;
 
-    TOKEN_INIT(token, YAML_BLOCK_ENTRY_TOKEN, start_mark, end_mark);
+        /* Pop the indentation level. */
 
-    if (!ENQUEUE(parser, parser->tokens, token))
-        return 0;
+        parser->indent = POP(parser, parser->indents);
+        CHECKPOINT_INDENTS_DIRTY(parser);
+    }
 
     return 1;
 }
 
 /*
- * Produce the KEY token.
+ * Initialize the scanner and produce the STREAM-START token.
  */
 
 static int
-yaml_parser_fetch_key(yaml_parser_t *parser)
+yaml_parser_fetch_stream_start(yaml_parser_t *parser)
 {
-    yaml_mark_t start_mark, end_mark;
+    yaml_simple_key_t simple_key = { 0, 0, 0, { 0, 0, 0 } };
     yaml_token_t token;
 
-    /* In the block context, additional checks are required. */
+    /* Set the initial indentation. */
 
-    if (!parser->flow_level)
-    {
-        /* Check if we are allowed to start a new key (not nessesary simple). */
+    parser->indent = -1;
 
-        if (!parser->is_simple_key_allowed) {
-            return SCANNER_ERROR_INIT(parser,
-                    "mapping keys are not allowed in this context", parser->mark);
-        }
+    /* Initialize the simple key stack. */
 
-        /* Add the BLOCK-MAPPING-START token if needed. */
+    if (!PUSH(parser, parser->simple_keys, simple_key))
+        return 0;
 
-        if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
-                    YAML_BLOCK_MAPPING_START_TOKEN, parser->mark))
-            return 0;
-    }
+    parser->simple_keys_start = 1;
 
-    /* Reset any potential simple keys on the current flow level. */
+    /* Enable the JSON scanner if it is requested for the whole stream. */
 
-    if (!yaml_parser_remove_simple_key(parser))
-        return 0;
+    parser->is_json = (parser->json_mode == YAML_ALWAYS_JSON_MODE);
 
-    /* Simple keys are allowed after '?' in the block context. */
+    /* A simple key is allowed at the beginning of the stream. */
 
-    parser->is_simple_key_allowed = (!parser->flow_level);
+    parser->is_simple_key_allowed = 1;
 
-    /* Consume the token. */
+    /* We have started. */
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+    parser->is_stream_start_produced = 1;
 
-    /* Create the KEY token and append it to the queue. */
+    /* Create the STREAM-START token and append it to the queue. */
 
-    TOKEN_INIT(token, YAML_KEY_TOKEN, start_mark, end_mark);
+    STREAM_START_TOKEN_INIT(token, parser->encoding,
+            parser->mark, parser->mark);
 
     if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
@@ -1653,82 +2051,36 @@ yaml_parser_fetch_key(yaml_parser_t *parser)
 }
 
 /*
- * Produce the VALUE token.
+ * Produce the STREAM-END token and shut down the scanner.
  */
 
 static int
-yaml_parser_fetch_value(yaml_parser_t *parser)
+yaml_parser_fetch_stream_end(yaml_parser_t *parser)
 {
-    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
-    yaml_simple_key_t *simple_key =
-        parser->simple_keys.list + parser->simple_keys.length - 1;
 
-    /* Have we found a simple key? */
+    /* Force new line. */
 
-    if (simple_key->is_possible)
-    {
-
-        /* Create the KEY token and insert it into the queue. */
-
-        TOKEN_INIT(token, YAML_KEY_TOKEN, simple_key->mark, simple_key->mark);
-
-        if (!QUEUE_INSERT(parser, parser->tokens,
-                    simple_key->token_number - parser->tokens_parsed, token))
-            return 0;
-
-        /* In the block context, we may need to add the BLOCK-MAPPING-START token. */
-
-        if (!yaml_parser_roll_indent(parser, simple_key->mark.column,
-                    simple_key->token_number,
-                    YAML_BLOCK_MAPPING_START_TOKEN, simple_key->mark))
-            return 0;
-
-        /* Remove the simple key. */
-
-        simple_key->is_possible = 0;
-
-        /* A simple key cannot follow another simple key. */
-
-        parser->is_simple_key_allowed = 0;
+    if (parser->mark.column != 0) {
+        parser->mark.column = 0;
+        parser->mark.line ++;
     }
-    else
-    {
-        /* The ':' indicator follows a complex key. */
-
-        /* In the block context, extra checks are required. */
-
-        if (!parser->flow_level)
-        {
-            /* Check if we are allowed to start a complex value. */
-
-            if (!parser->is_simple_key_allowed) {
-                return SCANNER_ERROR_INIT(parser,
-                        "mapping values are not allowed in this context",
-                        parser->mark);
-            }
-
-            /* Add the BLOCK-MAPPING-START token if needed. */
 
-            if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
-                        YAML_BLOCK_MAPPING_START_TOKEN, parser->mark))
-                return 0;
-        }
+    /* Reset the indentation level. */
 
-        /* Simple keys after ':' are allowed in the block context. */
+    if (!yaml_parser_unroll_indent(parser, -1))
+        return 0;
 
-        parser->is_simple_key_allowed = (!parser->flow_level);
-    }
+    /* Reset simple keys. */
 
-    /* Consume the token. */
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
-    start_mark = parser->mark;
-    SKIP(parser);
-    end_mark = parser->mark;
+    parser->is_simple_key_allowed = 0;
 
-    /* Create the VALUE token and append it to the queue. */
+    /* Create the STREAM-END token and append it to the queue. */
 
-    TOKEN_INIT(token, YAML_VALUE_TOKEN, start_mark, end_mark);
+    STREAM_END_TOKEN_INIT(token, parser->mark, parser->mark);
 
     if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
@@ -1737,785 +2089,778 @@ yaml_parser_fetch_value(yaml_parser_t *parser)
 }
 
 /*
- * Produce the ALIAS or ANCHOR token.
+ * Produce a VERSION-DIRECTIVE or TAG-DIRECTIVE token.
  */
 
 static int
-yaml_parser_fetch_anchor(yaml_parser_t *parser, yaml_token_type_t type)
+yaml_parser_fetch_directive(yaml_parser_t *parser)
 {
     yaml_token_t token;
 
-    /* An anchor or an alias could be a simple key. */
+    /* Reset the indentation level. */
 
-    if (!yaml_parser_save_simple_key(parser))
+    if (!yaml_parser_unroll_indent(parser, -1))
         return 0;
 
-    /* A simple key cannot follow an anchor or an alias. */
+    /* Reset simple keys. */
+
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
     parser->is_simple_key_allowed = 0;
 
-    /* Create the ALIAS or ANCHOR token and append it to the queue. */
+    /* Create the YAML-DIRECTIVE or TAG-DIRECTIVE token. */
 
-    if (!yaml_parser_scan_anchor(parser, &token, type))
+    if (!yaml_parser_scan_directive(parser, &token))
         return 0;
 
+    /* Append the token to the queue. */
+
     if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
+        yaml_parser_recycle_token(parser, &token);
         return 0;
     }
+
     return 1;
 }
 
 /*
- * Produce the TAG token.
+ * Produce the DOCUMENT-START or DOCUMENT-END token.
  */
 
 static int
-yaml_parser_fetch_tag(yaml_parser_t *parser)
+yaml_parser_fetch_document_indicator(yaml_parser_t *parser,
+        yaml_token_type_t type)
 {
+    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* A tag could be a simple key. */
+    /* Reset the indentation level. */
 
-    if (!yaml_parser_save_simple_key(parser))
+    if (!yaml_parser_unroll_indent(parser, -1))
         return 0;
 
-    /* A simple key cannot follow a tag. */
+    /* Reset simple keys. */
+
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
     parser->is_simple_key_allowed = 0;
 
-    /* Create the TAG token and append it to the queue. */
+    /* Consume the token. */
 
-    if (!yaml_parser_scan_tag(parser, &token))
-        return 0;
+    start_mark = parser->mark;
 
-    if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
+    SKIP(parser);
+    SKIP(parser);
+    SKIP(parser);
+
+    end_mark = parser->mark;
+
+    /* Create the DOCUMENT-START or DOCUMENT-END token. */
+
+    TOKEN_INIT(token, type, start_mark, end_mark);
+
+    /* Append the token to the queue. */
+
+    if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
-    }
 
     return 1;
 }
 
 /*
- * Produce the SCALAR(...,literal) or SCALAR(...,folded) tokens.
+ * Produce the FLOW-SEQUENCE-START or FLOW-MAPPING-START token.
  */
 
 static int
-yaml_parser_fetch_block_scalar(yaml_parser_t *parser, int literal)
+yaml_parser_fetch_flow_collection_start(yaml_parser_t *parser,
+        yaml_token_type_t type)
 {
+    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* Remove any potential simple keys. */
+    /* The indicators '[' and '{' may start a simple key. */
 
-    if (!yaml_parser_remove_simple_key(parser))
+    if (!yaml_parser_save_simple_key(parser))
         return 0;
 
-    /* A simple key may follow a block scalar. */
+    /* Increase the flow level. */
+
+    if (!yaml_parser_increase_flow_level(parser))
+        return 0;
+
+    /* A simple key may follow the indicators '[' and '{'. */
 
     parser->is_simple_key_allowed = 1;
 
-    /* Create the SCALAR token and append it to the queue. */
+    /* Enable the JSON scanner if the stream starts with a flow collection. */
 
-    if (!yaml_parser_scan_block_scalar(parser, &token, literal))
-        return 0;
+    if (parser->json_mode == YAML_AUTO_JSON_MODE
+            && parser->tokens_parsed
+                + (parser->tokens.tail - parser->tokens.head) == 1) {
+        parser->is_json = 1;
+    }
 
-    if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
+    /* Consume the token. */
+
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
+
+    /* Create the FLOW-SEQUENCE-START of FLOW-MAPPING-START token. */
+
+    TOKEN_INIT(token, type, start_mark, end_mark);
+
+    /* Append the token to the queue. */
+
+    if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
-    }
 
     return 1;
 }
 
 /*
- * Produce the SCALAR(...,single-quoted) or SCALAR(...,double-quoted) tokens.
+ * Produce the FLOW-SEQUENCE-END or FLOW-MAPPING-END token.
  */
 
 static int
-yaml_parser_fetch_flow_scalar(yaml_parser_t *parser, int single)
+yaml_parser_fetch_flow_collection_end(yaml_parser_t *parser,
+        yaml_token_type_t type)
 {
+    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* A plain scalar could be a simple key. */
+    /* Reset any potential simple key on the current flow level. */
 
-    if (!yaml_parser_save_simple_key(parser))
+    if (!yaml_parser_remove_simple_key(parser))
         return 0;
 
-    /* A simple key cannot follow a flow scalar. */
+    /* Decrease the flow level. */
+
+    if (!yaml_parser_decrease_flow_level(parser))
+        return 0;
+
+    /* No simple keys after the indicators ']' and '}'. */
 
     parser->is_simple_key_allowed = 0;
 
-    /* Create the SCALAR token and append it to the queue. */
+    /* Consume the token. */
 
-    if (!yaml_parser_scan_flow_scalar(parser, &token, single))
-        return 0;
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
 
-    if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
+    /* Create the FLOW-SEQUENCE-END of FLOW-MAPPING-END token. */
+
+    TOKEN_INIT(token, type, start_mark, end_mark);
+
+    /* Append the token to the queue. */
+
+    if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
-    }
 
     return 1;
 }
 
 /*
- * Produce the SCALAR(...,plain) token.
+ * Produce the FLOW-ENTRY token.
  */
 
 static int
-yaml_parser_fetch_plain_scalar(yaml_parser_t *parser)
+yaml_parser_fetch_flow_entry(yaml_parser_t *parser)
 {
+    yaml_mark_t start_mark, end_mark;
     yaml_token_t token;
 
-    /* A plain scalar could be a simple key. */
+    /* Reset any potential simple keys on the current flow level. */
 
-    if (!yaml_parser_save_simple_key(parser))
+    if (!yaml_parser_remove_simple_key(parser))
         return 0;
 
-    /* A simple key cannot follow a flow scalar. */
+    /* Simple keys are allowed after ','. */
 
-    parser->is_simple_key_allowed = 0;
+    parser->is_simple_key_allowed = 1;
 
-    /* Create the SCALAR token and append it to the queue. */
+    /* Consume the token. */
 
-    if (!yaml_parser_scan_plain_scalar(parser, &token))
-        return 0;
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
 
-    if (!ENQUEUE(parser, parser->tokens, token)) {
-        yaml_token_destroy(&token);
+    /* Create the FLOW-ENTRY token and append it to the queue. */
+
+    TOKEN_INIT(token, YAML_FLOW_ENTRY_TOKEN, start_mark, end_mark);
+
+    if (!ENQUEUE(parser, parser->tokens, token))
         return 0;
-    }
 
     return 1;
 }
 
 /*
- * Eat whitespaces and comments until the next token is found.
+ * Produce the BLOCK-ENTRY token.
  */
 
 static int
-yaml_parser_scan_to_next_token(yaml_parser_t *parser)
+yaml_parser_fetch_block_entry(yaml_parser_t *parser)
 {
-    /* Until the next token is not found. */
+    yaml_mark_t start_mark, end_mark;
+    yaml_token_t token;
 
-    while (1)
+    /* Check if the scanner is in the block context. */
+
+    if (!parser->flow_level)
     {
-        /* Allow the BOM mark to start a line. */
+        /* Check if we are allowed to start a new entry. */
 
-        if (!CACHE(parser, 1)) return 0;
+        if (!parser->is_simple_key_allowed) {
+            return SCANNER_ERROR_INIT(parser,
+                    "block sequence entries are not allowed in this context",
+                    parser->mark);
+        }
 
-        if (parser->mark.column == 0 && IS_BOM(parser->input))
-            SKIP(parser);
+        /* Add the BLOCK-SEQUENCE-START token if needed. */
 
+        if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
+                    YAML_BLOCK_SEQUENCE_START_TOKEN, parser->mark))
+            return 0;
+    }
+    else
+    {
         /*
-         * Eat whitespaces.
-         *
-         * Tabs are allowed:
-         *
-         *  - in the flow context;
-         *  - in the block context, but not at the beginning of the line or
-         *  after '-', '?', or ':' (complex value).  
+         * It is an error for the '-' indicator to occur in the flow context,
+         * but we let the Parser detect and report about it because the Parser
+         * is able to point to the context.
          */
+    }
 
-        if (!CACHE(parser, 1)) return 0;
+    /* Reset any potential simple keys on the current flow level. */
 
-        while (CHECK(parser->input,' ') ||
-                ((parser->flow_level || !parser->is_simple_key_allowed) &&
-                 CHECK(parser->input, '\t'))) {
-            SKIP(parser);
-            if (!CACHE(parser, 1)) return 0;
-        }
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
-        /* Eat a comment until a line break. */
+    /* Simple keys are allowed after '-'. */
 
-        if (CHECK(parser->input, '#')) {
-            while (!IS_BREAKZ(parser->input)) {
-                SKIP(parser);
-                if (!CACHE(parser, 1)) return 0;
-            }
-        }
+    parser->is_simple_key_allowed = 1;
 
-        /* If it is a line break, eat it. */
+    /* Consume the token. */
 
-        if (IS_BREAK(parser->input))
-        {
-            if (!CACHE(parser, 2)) return 0;
-            SKIP_LINE(parser);
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
 
-            /* In the block context, a new line may start a simple key. */
+    /* Create the BLOCK-ENTRY token and append it to the queue. */
 
-            if (!parser->flow_level) {
-                parser->is_simple_key_allowed = 1;
-            }
-        }
-        else
-        {
-            /* We have found a token. */
+    TOKEN_INIT(token, YAML_BLOCK_ENTRY_TOKEN, start_mark, end_mark);
 
-            break;
-        }
-    }
+    if (!ENQUEUE(parser, parser->tokens, token))
+        return 0;
 
     return 1;
 }
 
 /*
- * Scan a YAML-DIRECTIVE or TAG-DIRECTIVE token.
- *
- * Scope:
- *      %YAML    1.1    # a comment \n
- *      ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
- *      %TAG    !yaml!  tag:yaml.org,2002:  \n
- *      ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+ * Produce the KEY token.
  */
 
-int
-yaml_parser_scan_directive(yaml_parser_t *parser, yaml_token_t *token)
+static int
+yaml_parser_fetch_key(yaml_parser_t *parser)
 {
     yaml_mark_t start_mark, end_mark;
-    yaml_char_t *name = NULL;
-    int major, minor;
-    yaml_char_t *handle = NULL, *prefix = NULL;
+    yaml_token_t token;
 
-    /* Eat '%'. */
+    /* In the block context, additional checks are required. */
 
-    start_mark = parser->mark;
+    if (!parser->flow_level)
+    {
+        /* Check if we are allowed to start a new key (not nessesary simple). */
 
-    SKIP(parser);
+        if (!parser->is_simple_key_allowed) {
+            return SCANNER_ERROR_INIT(parser,
+                    "mapping keys are not allowed in this context", parser->mark);
+        }
 
-    /* Scan the directive name. */
+        /* Add the BLOCK-MAPPING-START token if needed. */
 
-    if (!yaml_parser_scan_directive_name(parser, start_mark, &name))
-        goto error;
+        if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
+                    YAML_BLOCK_MAPPING_START_TOKEN, parser->mark))
+            return 0;
+    }
 
-    /* Is it a YAML directive? */
+    /* Reset any potential simple keys on the current flow level. */
 
-    if (strcmp((char *)name, "YAML") == 0)
-    {
-        /* Scan the VERSION directive value. */
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
-        if (!yaml_parser_scan_version_directive_value(parser, start_mark,
-                    &major, &minor))
-            goto error;
+    /* Simple keys are allowed after '?' in the block context. */
 
-        end_mark = parser->mark;
+    parser->is_simple_key_allowed = (!parser->flow_level);
 
-        /* Create a VERSION-DIRECTIVE token. */
+    /* Consume the token. */
 
-        VERSION_DIRECTIVE_TOKEN_INIT(*token, major, minor,
-                start_mark, end_mark);
-    }
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
 
-    /* Is it a TAG directive? */
+    /* Create the KEY token and append it to the queue. */
 
-    else if (strcmp((char *)name, "TAG") == 0)
+    TOKEN_INIT(token, YAML_KEY_TOKEN, start_mark, end_mark);
+
+    if (!ENQUEUE(parser, parser->tokens, token))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Produce the VALUE token.
+ */
+
+static int
+yaml_parser_fetch_value(yaml_parser_t *parser)
+{
+    yaml_mark_t start_mark, end_mark;
+    yaml_token_t token;
+    yaml_simple_key_t *simple_key =
+        parser->simple_keys.list + parser->simple_keys.length - 1;
+
+    /* Have we found a simple key? */
+
+    if (simple_key->is_possible)
     {
-        /* Scan the TAG directive value. */
 
-        if (!yaml_parser_scan_tag_directive_value(parser, start_mark,
-                    &handle, &prefix))
-            goto error;
+        /* Create the KEY token and insert it into the queue. */
 
-        end_mark = parser->mark;
+        TOKEN_INIT(token, YAML_KEY_TOKEN, simple_key->mark, simple_key->mark);
 
-        /* Create a TAG-DIRECTIVE token. */
+        CHECKPOINT_DIRTY(parser->checkpoint.tokens.dirty,
+                simple_key->token_number);
+        if (!QUEUE_INSERT(parser, parser->tokens,
+                    simple_key->token_number - parser->tokens_parsed, token))
+            return 0;
 
-        TAG_DIRECTIVE_TOKEN_INIT(*token, handle, prefix,
-                start_mark, end_mark);
-    }
+        /* In the block context, we may need to add the BLOCK-MAPPING-START token. */
 
-    /* Unknown directive. */
+        if (!yaml_parser_roll_indent(parser, simple_key->mark.column,
+                    simple_key->token_number,
+                    YAML_BLOCK_MAPPING_START_TOKEN, simple_key->mark))
+            return 0;
+
+        /* Remove the simple key. */
+
+        simple_key->is_possible = 0;
+
+        /* A simple key cannot follow another simple key. */
 
+        parser->is_simple_key_allowed = 0;
+    }
     else
     {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a directive", start_mark,
-                "found uknown directive name", parser->mark);
-        goto error;
-    }
+        /* The ':' indicator follows a complex key. */
 
-    /* Eat the rest of the line including any comments. */
+        /* In the block context, extra checks are required. */
 
-    if (!CACHE(parser, 1)) goto error;
+        if (!parser->flow_level)
+        {
+            /* Check if we are allowed to start a complex value. */
 
-    while (IS_BLANK(parser->input)) {
-        SKIP(parser);
-        if (!CACHE(parser, 1)) goto error;
-    }
+            if (!parser->is_simple_key_allowed) {
+                return SCANNER_ERROR_INIT(parser,
+                        "mapping values are not allowed in this context",
+                        parser->mark);
+            }
 
-    if (CHECK(parser->input, '#')) {
-        while (!IS_BREAKZ(parser->input)) {
-            SKIP(parser);
-            if (!CACHE(parser, 1)) goto error;
+            /* Add the BLOCK-MAPPING-START token if needed. */
+
+            if (!yaml_parser_roll_indent(parser, parser->mark.column, -1,
+                        YAML_BLOCK_MAPPING_START_TOKEN, parser->mark))
+                return 0;
         }
-    }
 
-    /* Check if we are at the end of the line. */
+        /* Simple keys after ':' are allowed in the block context. */
 
-    if (!IS_BREAKZ(parser->input)) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a directive", start_mark,
-                "did not find expected comment or line break", parser->mark);
-        goto error;
+        parser->is_simple_key_allowed = (!parser->flow_level);
     }
 
-    /* Eat a line break. */
+    /* Consume the token. */
 
-    if (IS_BREAK(parser->input)) {
-        if (!CACHE(parser, 2)) goto error;
-        SKIP_LINE(parser);
-    }
+    start_mark = parser->mark;
+    SKIP(parser);
+    end_mark = parser->mark;
 
-    yaml_free(name);
+    /* Create the VALUE token and append it to the queue. */
 
-    return 1;
+    TOKEN_INIT(token, YAML_VALUE_TOKEN, start_mark, end_mark);
 
-error:
-    yaml_free(prefix);
-    yaml_free(handle);
-    yaml_free(name);
-    return 0;
+    if (!ENQUEUE(parser, parser->tokens, token))
+        return 0;
+
+    return 1;
 }
 
 /*
- * Scan the directive name.
- *
- * Scope:
- *      %YAML   1.1     # a comment \n
- *       ^^^^
- *      %TAG    !yaml!  tag:yaml.org,2002:  \n
- *       ^^^
+ * Produce the ALIAS or ANCHOR token.
  */
 
 static int
-yaml_parser_scan_directive_name(yaml_parser_t *parser,
-        yaml_mark_t start_mark, yaml_char_t **name)
+yaml_parser_fetch_anchor(yaml_parser_t *parser, yaml_token_type_t type)
 {
-    yaml_ostring_t string = NULL_OSTRING;
+    yaml_token_t token;
 
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
+    /* An anchor or an alias could be a simple key. */
 
-    /* Consume the directive name. */
+    if (!yaml_parser_save_simple_key(parser))
+        return 0;
 
-    if (!CACHE(parser, 1)) goto error;
+    /* A simple key cannot follow an anchor or an alias. */
 
-    while (IS_ALPHA(parser->input))
-    {
-        if (!READ(parser, string)) goto error;
-        if (!CACHE(parser, 1)) goto error;
-    }
+    parser->is_simple_key_allowed = 0;
 
-    /* Check if the name is empty. */
+    /* Create the ALIAS or ANCHOR token and append it to the queue. */
 
-    if (!string.pointer) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a directive", start_mark,
-                "could not find expected directive name", parser->mark);
-        goto error;
+    if (!yaml_parser_scan_anchor(parser, &token, type))
+        return 0;
+
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
     }
-
-    /* Check for an blank character after the name. */
-
-    if (!IS_BLANKZ(parser->input)) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a directive", start_mark,
-                "found unexpected non-alphabetical character", parser->mark);
-        goto error;
-    }
-
-    *name = string.buffer;
-
-    return 1;
-
-error:
-    OSTRING_DEL(parser, string);
-    return 0;
-}
+    return 1;
+}
 
 /*
- * Scan the value of VERSION-DIRECTIVE.
- *
- * Scope:
- *      %YAML   1.1     # a comment \n
- *           ^^^^^^
+ * Produce the TAG token.
  */
 
 static int
-yaml_parser_scan_version_directive_value(yaml_parser_t *parser,
-        yaml_mark_t start_mark, int *major, int *minor)
+yaml_parser_fetch_tag(yaml_parser_t *parser)
 {
-    /* Eat whitespaces. */
-
-    if (!CACHE(parser, 1)) return 0;
-
-    while (IS_BLANK(parser->input)) {
-        SKIP(parser);
-        if (!CACHE(parser, 1)) return 0;
-    }
+    yaml_token_t token;
 
-    /* Consume the major version number. */
+    /* A tag could be a simple key. */
 
-    if (!yaml_parser_scan_version_directive_number(parser, start_mark, major))
+    if (!yaml_parser_save_simple_key(parser))
         return 0;
 
-    /* Eat '.'. */
+    /* A simple key cannot follow a tag. */
 
-    if (!CHECK(parser->input, '.')) {
-        return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a %YAML directive", start_mark,
-                "did not find expected digit or '.' character", parser->mark);
-    }
+    parser->is_simple_key_allowed = 0;
 
-    SKIP(parser);
+    /* Create the TAG token and append it to the queue. */
 
-    /* Consume the minor version number. */
+    if (!yaml_parser_scan_tag(parser, &token))
+        return 0;
 
-    if (!yaml_parser_scan_version_directive_number(parser, start_mark, minor))
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
         return 0;
+    }
 
     return 1;
 }
 
-#define MAX_NUMBER_LENGTH   9
-
 /*
- * Scan the version number of VERSION-DIRECTIVE.
- *
- * Scope:
- *      %YAML   1.1     # a comment \n
- *              ^
- *      %YAML   1.1     # a comment \n
- *                ^
+ * Produce the SCALAR(...,literal) or SCALAR(...,folded) tokens.
  */
 
 static int
-yaml_parser_scan_version_directive_number(yaml_parser_t *parser,
-        yaml_mark_t start_mark, int *number)
+yaml_parser_fetch_block_scalar(yaml_parser_t *parser, int literal)
 {
-    int value = 0;
-    size_t length = 0;
-
-    /* Repeat while the next character is digit. */
-
-    if (!CACHE(parser, 1)) return 0;
+    yaml_token_t token;
 
-    while (IS_DIGIT(parser->input))
-    {
-        /* Check if the number is too long. */
+    /* Remove any potential simple keys. */
 
-        if (++length > MAX_NUMBER_LENGTH) {
-            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a %YAML directive", start_mark,
-                    "found extremely long version number", parser->mark);
-        }
+    if (!yaml_parser_remove_simple_key(parser))
+        return 0;
 
-        value = value*10 + AS_DIGIT(parser->input);
+    /* A simple key may follow a block scalar. */
 
-        SKIP(parser);
+    parser->is_simple_key_allowed = 1;
 
-        if (!CACHE(parser, 1)) return 0;
-    }
+    /* Create the SCALAR token and append it to the queue. */
 
-    /* Check if the number was present. */
+    if (!yaml_parser_scan_block_scalar(parser, &token, literal))
+        return 0;
 
-    if (!length) {
-        return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a %YAML directive", start_mark,
-                "did not find expected version number", parser->mark);
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
     }
 
-    *number = value;
-
     return 1;
 }
 
 /*
- * Scan the value of a TAG-DIRECTIVE token.
- *
- * Scope:
- *      %TAG    !yaml!  tag:yaml.org,2002:  \n
- *          ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+ * Produce the SCALAR(...,single-quoted) or SCALAR(...,double-quoted) tokens.
  */
 
 static int
-yaml_parser_scan_tag_directive_value(yaml_parser_t *parser,
-        yaml_mark_t start_mark, yaml_char_t **handle, yaml_char_t **prefix)
+yaml_parser_fetch_flow_scalar(yaml_parser_t *parser, int single)
 {
-    yaml_char_t *handle_value = NULL;
-    yaml_char_t *prefix_value = NULL;
-
-    /* Eat whitespaces. */
-
-    if (!CACHE(parser, 1)) goto error;
-
-    while (IS_BLANK(parser->input)) {
-        SKIP(parser);
-        if (!CACHE(parser, 1)) goto error;
-    }
-
-    /* Scan a handle. */
-
-    if (!yaml_parser_scan_tag_handle(parser, 1, start_mark, &handle_value))
-        goto error;
-
-    /* Expect a whitespace. */
-
-    if (!CACHE(parser, 1)) goto error;
-
-    if (!IS_BLANK(parser->input)) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a %TAG directive", start_mark,
-                "did not find expected whitespace", parser->mark);
-        goto error;
-    }
+    yaml_token_t token;
 
-    /* Eat whitespaces. */
+    /* A plain scalar could be a simple key. */
 
-    while (IS_BLANK(parser->input)) {
-        SKIP(parser);
-        if (!CACHE(parser, 1)) goto error;
-    }
+    if (!yaml_parser_save_simple_key(parser))
+        return 0;
 
-    /* Scan a prefix. */
+    /* A simple key cannot follow a flow scalar. */
 
-    if (!yaml_parser_scan_tag_uri(parser, 1, NULL, start_mark, &prefix_value))
-        goto error;
+    parser->is_simple_key_allowed = 0;
 
-    /* Expect a whitespace or line break. */
+    /* Create the SCALAR token and append it to the queue. */
 
-    if (!CACHE(parser, 1)) goto error;
+    if (!yaml_parser_scan_flow_scalar(parser, &token, single))
+        return 0;
 
-    if (!IS_BLANKZ(parser->input)) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a %TAG directive", start_mark,
-                "did not find expected whitespace or line break", parser->mark);
-        goto error;
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
     }
 
-    *handle = handle_value;
-    *prefix = prefix_value;
-
     return 1;
-
-error:
-    yaml_free(handle_value);
-    yaml_free(prefix_value);
-    return 0;
 }
 
+/*
+ * Produce the SCALAR(...,plain) token.
+ */
+
 static int
-yaml_parser_scan_anchor(yaml_parser_t *parser, yaml_token_t *token,
-        yaml_token_type_t type)
+yaml_parser_fetch_plain_scalar(yaml_parser_t *parser)
 {
-    int length = 0;
-    yaml_mark_t start_mark, end_mark;
-    yaml_ostring_t string = NULL_OSTRING;
-
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
-
-    /* Eat the indicator character. */
-
-    start_mark = parser->mark;
-
-    SKIP(parser);
-
-    /* Consume the value. */
+    yaml_token_t token;
 
-    if (!CACHE(parser, 1)) goto error;
+    /* A plain scalar could be a simple key. */
 
-    while (IS_ALPHA(parser->input)) {
-        if (!READ(parser, string)) goto error;
-        if (!CACHE(parser, 1)) goto error;
-        length ++;
-    }
+    if (!yaml_parser_save_simple_key(parser))
+        return 0;
 
-    end_mark = parser->mark;
+    /* A simple key cannot follow a flow scalar. */
 
-    /*
-     * Check if length of the anchor is greater than 0 and it is followed by
-     * a whitespace character or one of the indicators:
-     *
-     *      '?', ':', ',', ']', '}', '%', '@', '`'.
-     */
+    parser->is_simple_key_allowed = 0;
 
-    if (!length || !(IS_BLANKZ(parser->input) || CHECK(parser->input, '?')
-                || CHECK(parser->input, ':') || CHECK(parser->input, ',')
-                || CHECK(parser->input, ']') || CHECK(parser->input, '}')
-                || CHECK(parser->input, '%') || CHECK(parser->input, '@')
-                || CHECK(parser->input, '`'))) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, type == YAML_ANCHOR_TOKEN ?
-                "while scanning an anchor" : "while scanning an alias",
-                start_mark,
-                "did not find expected alphabetic or numeric character",
-                parser->mark);
-        goto error;
-    }
+    /* Create the SCALAR token and append it to the queue. */
 
-    /* Create a token. */
+    if (!yaml_parser_scan_plain_scalar(parser, &token))
+        return 0;
 
-    if (type == YAML_ANCHOR_TOKEN) {
-        ANCHOR_TOKEN_INIT(*token, string.buffer, start_mark, end_mark);
-    }
-    else {
-        ALIAS_TOKEN_INIT(*token, string.buffer, start_mark, end_mark);
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
     }
 
     return 1;
-
-error:
-    OSTRING_DEL(parser, string);
-    return 0;
 }
 
 /*
- * Scan a TAG token.
+ * Eat whitespaces and comments until the next token is found.
  */
 
 static int
-yaml_parser_scan_tag(yaml_parser_t *parser, yaml_token_t *token)
+yaml_parser_scan_to_next_token(yaml_parser_t *parser)
 {
-    yaml_char_t *handle = NULL;
-    yaml_char_t *suffix = NULL;
-    yaml_mark_t start_mark, end_mark;
+    /* Until the next token is not found. */
 
-    start_mark = parser->mark;
+    while (1)
+    {
+        /* Allow the BOM mark to start a line. */
 
-    /* Check if the tag is in the canonical form. */
+        if (!CACHE(parser, 1)) return 0;
 
-    if (!CACHE(parser, 2)) goto error;
+        if (parser->mark.column == 0 && IS_BOM(parser->input))
+            SKIP(parser);
 
-    if (CHECK_AT(parser->input, '<', 1))
-    {
-        /* Set the handle to '' */
+        /*
+         * Eat whitespaces.
+         *
+         * Tabs are allowed:
+         *
+         *  - in the flow context;
+         *  - in the block context, but not at the beginning of the line or
+         *  after '-', '?', or ':' (complex value).  
+         */
 
-        handle = yaml_malloc(1);
-        if (!handle) goto error;
-        handle[0] = '\0';
+        if (!CACHE(parser, 1)) return 0;
 
-        /* Eat '!<' */
+        while (CHECK(parser->input,' ') ||
+                ((parser->flow_level || !parser->is_simple_key_allowed) &&
+                 CHECK(parser->input, '\t'))) {
+            SKIP(parser);
+            if (!CACHE(parser, 1)) return 0;
+        }
 
-        SKIP(parser);
-        SKIP(parser);
+        /* Eat a comment until a line break. */
 
-        /* Consume the tag value. */
+        if (CHECK(parser->input, '#')) {
+            while (!IS_BREAKZ(parser->input)) {
+                SKIP(parser);
+                if (!CACHE(parser, 1)) return 0;
+            }
+        }
 
-        if (!yaml_parser_scan_tag_uri(parser, 0, NULL, start_mark, &suffix))
-            goto error;
+        /* If it is a line break, eat it. */
 
-        /* Check for '>' and eat it. */
+        if (IS_BREAK(parser->input))
+        {
+            if (!CACHE(parser, 2)) return 0;
+            SKIP_LINE(parser);
 
-        if (!CHECK(parser->input, '>')) {
-            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a tag", start_mark,
-                    "did not find the expected '>'", parser->mark);
-            goto error;
+            /* In the block context, a new line may start a simple key. */
+
+            if (!parser->flow_level) {
+                parser->is_simple_key_allowed = 1;
+            }
         }
+        else
+        {
+            /* We have found a token. */
 
-        SKIP(parser);
+            break;
+        }
     }
-    else
-    {
-        /* The tag has either the '!suffix' or the '!handle!suffix' form. */
 
-        /* First, try to scan a handle. */
+    return 1;
+}
 
-        if (!yaml_parser_scan_tag_handle(parser, 0, start_mark, &handle))
+/*
+ * Scan a YAML-DIRECTIVE or TAG-DIRECTIVE token.
+ *
+ * Scope:
+ *      %YAML    1.1    # a comment \n
+ *      ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+ *      %TAG    !yaml!  tag:yaml.org,2002:  \n
+ *      ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+ */
+
+int
+yaml_parser_scan_directive(yaml_parser_t *parser, yaml_token_t *token)
+{
+    yaml_mark_t start_mark, end_mark;
+    yaml_char_t *name = NULL;
+    int major, minor;
+    yaml_char_t *handle = NULL, *prefix = NULL;
+
+    /* Eat '%'. */
+
+    start_mark = parser->mark;
+
+    SKIP(parser);
+
+    /* Scan the directive name. */
+
+    if (!yaml_parser_scan_directive_name(parser, start_mark, &name))
+        goto error;
+
+    /* Is it a YAML directive? */
+
+    if (strcmp((char *)name, "YAML") == 0)
+    {
+        /* Scan the VERSION directive value. */
+
+        if (!yaml_parser_scan_version_directive_value(parser, start_mark,
+                    &major, &minor))
             goto error;
 
-        /* Check if it is, indeed, handle. */
+        end_mark = parser->mark;
 
-        if (handle[0] == '!' && handle[1] != '\0' && handle[strlen((char *)handle)-1] == '!')
-        {
-            /* Scan the suffix now. */
+        /* Create a VERSION-DIRECTIVE token. */
 
-            if (!yaml_parser_scan_tag_uri(parser, 0, NULL, start_mark, &suffix))
-                goto error;
-        }
-        else
-        {
-            /* It wasn't a handle after all.  Scan the rest of the tag. */
+        VERSION_DIRECTIVE_TOKEN_INIT(*token, major, minor,
+                start_mark, end_mark);
+    }
 
-            if (!yaml_parser_scan_tag_uri(parser, 0, handle, start_mark, &suffix))
-                goto error;
+    /* Is it a TAG directive? */
 
-            /* Set the handle to '!'. */
+    else if (strcmp((char *)name, "TAG") == 0)
+    {
+        /* Scan the TAG directive value. */
 
-            yaml_free(handle);
-            handle = yaml_malloc(2);
-            if (!handle) goto error;
-            handle[0] = '!';
-            handle[1] = '\0';
+        if (!yaml_parser_scan_tag_directive_value(parser, start_mark,
+                    &handle, &prefix))
+            goto error;
 
-            /*
-             * A special case: the '!' tag.  Set the handle to '' and the
-             * suffix to '!'.
-             */
+        end_mark = parser->mark;
 
-            if (suffix[0] == '\0') {
-                yaml_char_t *tmp = handle;
-                handle = suffix;
-                suffix = tmp;
-            }
-        }
+        /* Create a TAG-DIRECTIVE token. */
+
+        TAG_DIRECTIVE_TOKEN_INIT(*token, handle, prefix,
+                start_mark, end_mark);
     }
 
-    /* Check the character which ends the tag. */
+    /* Unknown directive. */
+
+    else
+    {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a directive", start_mark,
+                "found uknown directive name", parser->mark);
+        goto error;
+    }
+
+    /* Eat the rest of the line including any comments. */
 
     if (!CACHE(parser, 1)) goto error;
 
-    if (!IS_BLANKZ(parser->input)) {
+    while (IS_BLANK(parser->input)) {
+        SKIP(parser);
+        if (!CACHE(parser, 1)) goto error;
+    }
+
+    if (CHECK(parser->input, '#')) {
+        while (!IS_BREAKZ(parser->input)) {
+            SKIP(parser);
+            if (!CACHE(parser, 1)) goto error;
+        }
+    }
+
+    /* Check if we are at the end of the line. */
+
+    if (!IS_BREAKZ(parser->input)) {
         SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a tag", start_mark,
-                "did not find expected whitespace or line break", parser->mark);
+                "while scanning a directive", start_mark,
+                "did not find expected comment or line break", parser->mark);
         goto error;
     }
 
-    end_mark = parser->mark;
+    /* Eat a line break. */
 
-    /* Create a token. */
+    if (IS_BREAK(parser->input)) {
+        if (!CACHE(parser, 2)) goto error;
+        SKIP_LINE(parser);
+    }
 
-    TAG_TOKEN_INIT(*token, handle, suffix, start_mark, end_mark);
+    yaml_free(name);
 
     return 1;
 
 error:
+    yaml_free(prefix);
     yaml_free(handle);
-    yaml_free(suffix);
+    yaml_free(name);
     return 0;
 }
 
 /*
- * Scan a tag handle.
+ * Scan the directive name.
+ *
+ * Scope:
+ *      %YAML   1.1     # a comment \n
+ *       ^^^^
+ *      %TAG    !yaml!  tag:yaml.org,2002:  \n
+ *       ^^^
  */
 
 static int
-yaml_parser_scan_tag_handle(yaml_parser_t *parser, int directive,
-        yaml_mark_t start_mark, yaml_char_t **handle)
+yaml_parser_scan_directive_name(yaml_parser_t *parser,
+        yaml_mark_t start_mark, yaml_char_t **name)
 {
     yaml_ostring_t string = NULL_OSTRING;
 
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
-
-    /* Check the initial '!' character. */
-
-    if (!CACHE(parser, 1)) goto error;
-
-    if (!CHECK(parser->input, '!')) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
-                "while scanning a tag directive" : "while scanning a tag",
-                start_mark, "did not find expected '!'", parser->mark);
+    if (!POOL_OSTRING_INIT(parser, string))
         goto error;
-    }
 
-    /* Copy the '!' character. */
-
-    if (!READ(parser, string)) goto error;
-
-    /* Copy all subsequent alphabetical and numerical characters. */
+    /* Consume the directive name. */
 
     if (!CACHE(parser, 1)) goto error;
 
@@ -2525,500 +2870,1366 @@ yaml_parser_scan_tag_handle(yaml_parser_t *parser, int directive,
         if (!CACHE(parser, 1)) goto error;
     }
 
-    /* Check if the trailing character is '!' and copy it. */
+    /* Check if the name is empty. */
 
-    if (CHECK(parser->input, '!'))
-    {
-        if (!READ(parser, string)) goto error;
+    if (!string.pointer) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a directive", start_mark,
+                "could not find expected directive name", parser->mark);
+        goto error;
     }
-    else
-    {
-        /*
-         * It's either the '!' tag or not really a tag handle.  If it's a %TAG
-         * directive, it's an error.  If it's a tag token, it must be a part of
-         * URI.
-         */
 
-        if (directive &&
-                !(string.buffer[0] == '!' && string.buffer[1] == '\0')) {
-            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while parsing a tag directive", start_mark,
-                    "did not find expected '!'", parser->mark);
-            goto error;
-        }
+    /* Check for an blank character after the name. */
+
+    if (!IS_BLANKZ(parser->input)) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a directive", start_mark,
+                "found unexpected non-alphabetical character", parser->mark);
+        goto error;
     }
 
-    *handle = string.buffer;
+    *name = string.buffer;
 
     return 1;
 
 error:
-    OSTRING_DEL(parser, string);
+    POOL_OSTRING_DEL(parser, string);
     return 0;
 }
 
 /*
- * Scan a tag.
+ * Scan the value of VERSION-DIRECTIVE.
+ *
+ * Scope:
+ *      %YAML   1.1     # a comment \n
+ *           ^^^^^^
  */
 
 static int
-yaml_parser_scan_tag_uri(yaml_parser_t *parser, int directive,
-        yaml_char_t *head, yaml_mark_t start_mark, yaml_char_t **uri)
-{
-    size_t length = head ? strlen((char *)head) : 0;
-    yaml_ostring_t string = NULL_OSTRING;
-
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
+yaml_parser_scan_version_directive_value(yaml_parser_t *parser,
+        yaml_mark_t start_mark, int *major, int *minor)
+{
+    /* Eat whitespaces. */
 
-    /* Resize the string to include the head. */
+    if (!CACHE(parser, 1)) return 0;
 
-    while (string.capacity <= length) {
-        if (!yaml_ostring_extend(&string.buffer, &string.capacity)) {
-            MEMORY_ERROR_INIT(parser);
-            goto error;
-        }
+    while (IS_BLANK(parser->input)) {
+        SKIP(parser);
+        if (!CACHE(parser, 1)) return 0;
     }
 
-    /*
-     * Copy the head if needed.
-     *
-     * Note that we don't copy the leading '!' character.
-     */
+    /* Consume the major version number. */
 
-    if (length > 1) {
-        memcpy(string.buffer, head+1, length-1);
-        string.pointer += length-1;
+    if (!yaml_parser_scan_version_directive_number(parser, start_mark, major))
+        return 0;
+
+    /* Eat '.'. */
+
+    if (!CHECK(parser->input, '.')) {
+        return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a %YAML directive", start_mark,
+                "did not find expected digit or '.' character", parser->mark);
     }
 
-    /* Scan the tag. */
+    SKIP(parser);
 
-    if (!CACHE(parser, 1)) goto error;
+    /* Consume the minor version number. */
 
-    /*
-     * The set of characters that may appear in URI is as follows:
-     *
-     *      '0'-'9', 'A'-'Z', 'a'-'z', '_', '-', ';', '/', '?', ':', '@', '&',
-     *      '=', '+', '$', ',', '.', '!', '~', '*', '\'', '(', ')', '[', ']',
-     *      '%'.
-     */
+    if (!yaml_parser_scan_version_directive_number(parser, start_mark, minor))
+        return 0;
 
-    while (IS_ALPHA(parser->input) || CHECK(parser->input, ';')
-            || CHECK(parser->input, '/') || CHECK(parser->input, '?')
-            || CHECK(parser->input, ':') || CHECK(parser->input, '@')
-            || CHECK(parser->input, '&') || CHECK(parser->input, '=')
-            || CHECK(parser->input, '+') || CHECK(parser->input, '$')
-            || CHECK(parser->input, ',') || CHECK(parser->input, '.')
-            || CHECK(parser->input, '!') || CHECK(parser->input, '~')
-            || CHECK(parser->input, '*') || CHECK(parser->input, '\'')
-            || CHECK(parser->input, '(') || CHECK(parser->input, ')')
-            || CHECK(parser->input, '[') || CHECK(parser->input, ']')
-            || CHECK(parser->input, '%'))
+    return 1;
+}
+
+#define MAX_NUMBER_LENGTH   9
+
+/*
+ * Scan the version number of VERSION-DIRECTIVE.
+ *
+ * Scope:
+ *      %YAML   1.1     # a comment \n
+ *              ^
+ *      %YAML   1.1     # a comment \n
+ *                ^
+ */
+
+static int
+yaml_parser_scan_version_directive_number(yaml_parser_t *parser,
+        yaml_mark_t start_mark, int *number)
+{
+    int value = 0;
+    size_t length = 0;
+
+    /* Repeat while the next character is digit. */
+
+    if (!CACHE(parser, 1)) return 0;
+
+    while (IS_DIGIT(parser->input))
     {
-        /* Check if it is a URI-escape sequence. */
+        /* Check if the number is too long. */
 
-        if (CHECK(parser->input, '%')) {
-            if (!yaml_parser_scan_uri_escapes(parser,
-                        directive, start_mark, &string)) goto error;
-        }
-        else {
-            if (!READ(parser, string)) goto error;
+        if (++length > MAX_NUMBER_LENGTH) {
+            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a %YAML directive", start_mark,
+                    "found extremely long version number", parser->mark);
         }
 
-        length ++;
-        if (!CACHE(parser, 1)) goto error;
+        value = value*10 + AS_DIGIT(parser->input);
+
+        SKIP(parser);
+
+        if (!CACHE(parser, 1)) return 0;
     }
 
-    /* Check if the tag is non-empty. */
+    /* Check if the number was present. */
 
     if (!length) {
-        if (!OSTRING_EXTEND(parser, string))
-            goto error;
-
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
-                "while parsing a %TAG directive" : "while parsing a tag",
-                start_mark, "did not find expected tag URI", parser->mark);
-        goto error;
+        return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a %YAML directive", start_mark,
+                "did not find expected version number", parser->mark);
     }
 
-    *uri = string.buffer;
+    *number = value;
 
     return 1;
-
-error:
-    OSTRING_DEL(parser, string);
-    return 0;
 }
 
 /*
- * Decode an URI-escape sequence corresponding to a single UTF-8 character.
+ * Scan the value of a TAG-DIRECTIVE token.
+ *
+ * Scope:
+ *      %TAG    !yaml!  tag:yaml.org,2002:  \n
+ *          ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
  */
 
 static int
-yaml_parser_scan_uri_escapes(yaml_parser_t *parser, int directive,
-        yaml_mark_t start_mark, yaml_ostring_t *string)
+yaml_parser_scan_tag_directive_value(yaml_parser_t *parser,
+        yaml_mark_t start_mark, yaml_char_t **handle, yaml_char_t **prefix)
 {
-    int width = 0;
+    yaml_char_t *handle_value = NULL;
+    yaml_char_t *prefix_value = NULL;
 
-    /* Decode the required number of characters. */
+    /* Eat whitespaces. */
 
-    do {
-        unsigned char octet = 0;
+    if (!CACHE(parser, 1)) goto error;
 
-        /* Check for a URI-escaped octet. */
+    while (IS_BLANK(parser->input)) {
+        SKIP(parser);
+        if (!CACHE(parser, 1)) goto error;
+    }
 
-        if (!CACHE(parser, 3)) return 0;
+    /* Scan a handle. */
 
-        if (!(CHECK(parser->input, '%')
-                    && IS_HEX_AT(parser->input, 1)
-                    && IS_HEX_AT(parser->input, 2))) {
-            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
-                    "while parsing a %TAG directive" : "while parsing a tag",
-                    start_mark, "did not find URI escaped octet", parser->mark);
-        }
+    if (!yaml_parser_scan_tag_handle(parser, 1, start_mark, &handle_value))
+        goto error;
 
-        /* Get the octet. */
+    /* Expect a whitespace. */
 
-        octet = (AS_HEX_AT(parser->input, 1) << 4) + AS_HEX_AT(parser->input, 2);
+    if (!CACHE(parser, 1)) goto error;
 
-        /* If it is the leading octet, determine the length of the UTF-8 sequence. */
+    if (!IS_BLANK(parser->input)) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a %TAG directive", start_mark,
+                "did not find expected whitespace", parser->mark);
+        goto error;
+    }
 
-        if (!width)
-        {
-            width = (octet & 0x80) == 0x00 ? 1 :
-                    (octet & 0xE0) == 0xC0 ? 2 :
-                    (octet & 0xF0) == 0xE0 ? 3 :
-                    (octet & 0xF8) == 0xF0 ? 4 : 0;
-            if (!width) {
-                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
-                        "while parsing a %TAG directive" : "while parsing a tag",
-                        start_mark, "found an incorrect leading UTF-8 octet",
-                        parser->mark);
-            }
-        }
-        else
-        {
-            /* Check if the trailing octet is correct. */
+    /* Eat whitespaces. */
 
-            if ((octet & 0xC0) != 0x80) {
-                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
-                        "while parsing a %TAG directive" : "while parsing a tag",
-                        start_mark, "found an incorrect trailing UTF-8 octet",
-                        parser->mark);
-            }
-        }
+    while (IS_BLANK(parser->input)) {
+        SKIP(parser);
+        if (!CACHE(parser, 1)) goto error;
+    }
 
-        /* Copy the octet and move the pointers. */
+    /* Scan a prefix. */
 
-        JOIN_OCTET(*string, octet);
-        SKIP(parser);
-        SKIP(parser);
-        SKIP(parser);
+    if (!yaml_parser_scan_tag_uri(parser, 1, NULL, start_mark, &prefix_value))
+        goto error;
 
-    } while (--width);
+    /* Expect a whitespace or line break. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    if (!IS_BLANKZ(parser->input)) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a %TAG directive", start_mark,
+                "did not find expected whitespace or line break", parser->mark);
+        goto error;
+    }
+
+    *handle = handle_value;
+    *prefix = prefix_value;
 
     return 1;
-}
 
-/*
- * Scan a block scalar.
- */
+error:
+    yaml_free(handle_value);
+    yaml_free(prefix_value);
+    return 0;
+}
 
 static int
-yaml_parser_scan_block_scalar(yaml_parser_t *parser, yaml_token_t *token,
-        int literal)
+yaml_parser_scan_anchor(yaml_parser_t *parser, yaml_token_t *token,
+        yaml_token_type_t type)
 {
-    yaml_mark_t start_mark;
-    yaml_mark_t end_mark;
+    int length = 0;
+    yaml_mark_t start_mark, end_mark;
     yaml_ostring_t string = NULL_OSTRING;
-    yaml_ostring_t leading_break = NULL_OSTRING;
-    yaml_ostring_t trailing_breaks = NULL_OSTRING;
-    int chomping = 0;
-    int increment = 0;
-    int indent = 0;
-    int leading_blank = 0;
-    int trailing_blank = 0;
 
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
-    if (!OSTRING_INIT(parser, leading_break, INITIAL_STRING_CAPACITY))
-        goto error;
-    if (!OSTRING_INIT(parser, trailing_breaks, INITIAL_STRING_CAPACITY))
+    if (!POOL_OSTRING_INIT(parser, string))
         goto error;
 
-    /* Eat the indicator '|' or '>'. */
+    /* Eat the indicator character. */
 
     start_mark = parser->mark;
 
     SKIP(parser);
 
-    /* Scan the additional block scalar indicators. */
+    /* Consume the value. */
 
     if (!CACHE(parser, 1)) goto error;
 
-    /* Check for a chomping indicator. */
+    while (IS_ALPHA(parser->input)) {
+        if (!READ(parser, string)) goto error;
+        if (!CACHE(parser, 1)) goto error;
+        length ++;
+    }
 
-    if (CHECK(parser->input, '+') || CHECK(parser->input, '-'))
-    {
-        /* Set the chomping method and eat the indicator. */
+    end_mark = parser->mark;
 
-        chomping = CHECK(parser->input, '+') ? +1 : -1;
-
-        SKIP(parser);
-
-        /* Check for an indentation indicator. */
-
-        if (!CACHE(parser, 1)) goto error;
-
-        if (IS_DIGIT(parser->input))
-        {
-            /* Check that the intendation is greater than 0. */
-
-            if (CHECK(parser->input, '0')) {
-                SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                        "while scanning a block scalar", start_mark,
-                        "found an intendation indicator equal to 0", parser->mark);
-                goto error;
-            }
-
-            /* Get the intendation level and eat the indicator. */
-
-            increment = AS_DIGIT(parser->input);
+    /*
+     * Check if length of the anchor is greater than 0 and it is followed by
+     * a whitespace character or one of the indicators:
+     *
+     *      '?', ':', ',', ']', '}', '%', '@', '`'.
+     */
 
-            SKIP(parser);
-        }
+    if (!length || !(IS_BLANKZ(parser->input) || CHECK(parser->input, '?')
+                || CHECK(parser->input, ':') || CHECK(parser->input, ',')
+                || CHECK(parser->input, ']') || CHECK(parser->input, '}')
+                || CHECK(parser->input, '%') || CHECK(parser->input, '@')
+                || CHECK(parser->input, '`'))) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, type == YAML_ANCHOR_TOKEN ?
+                "while scanning an anchor" : "while scanning an alias",
+                start_mark,
+                "did not find expected alphabetic or numeric character",
+                parser->mark);
+        goto error;
     }
 
-    /* Do the same as above, but in the opposite order. */
-
-    else if (IS_DIGIT(parser->input))
-    {
-        if (CHECK(parser->input, '0')) {
-            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a block scalar", start_mark,
-                    "found an intendation indicator equal to 0", parser->mark);
-            goto error;
-        }
-
-        increment = AS_DIGIT(parser->input);
-
-        SKIP(parser);
-
-        if (!CACHE(parser, 1)) goto error;
-
-        if (CHECK(parser->input, '+') || CHECK(parser->input, '-')) {
-            chomping = CHECK(parser->input, '+') ? +1 : -1;
+    /* Create a token. */
 
-            SKIP(parser);
-        }
+    if (type == YAML_ANCHOR_TOKEN) {
+        ANCHOR_TOKEN_INIT(*token, string.buffer, start_mark, end_mark);
+    }
+    else {
+        ALIAS_TOKEN_INIT(*token, string.buffer, start_mark, end_mark);
     }
 
-    /* Eat whitespaces and comments to the end of the line. */
+    return 1;
 
-    if (!CACHE(parser, 1)) goto error;
+error:
+    POOL_OSTRING_DEL(parser, string);
+    return 0;
+}
 
-    while (IS_BLANK(parser->input)) {
-        SKIP(parser);
-        if (!CACHE(parser, 1)) goto error;
-    }
+/*
+ * Scan a TAG token.
+ */
 
-    if (CHECK(parser->input, '#')) {
-        while (!IS_BREAKZ(parser->input)) {
-            SKIP(parser);
-            if (!CACHE(parser, 1)) goto error;
-        }
-    }
+static int
+yaml_parser_scan_tag(yaml_parser_t *parser, yaml_token_t *token)
+{
+    yaml_char_t *handle = NULL;
+    yaml_char_t *suffix = NULL;
+    yaml_mark_t start_mark, end_mark;
 
-    /* Check if we are at the end of the line. */
+    start_mark = parser->mark;
 
-    if (!IS_BREAKZ(parser->input)) {
-        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                "while scanning a block scalar", start_mark,
-                "did not find expected comment or line break", parser->mark);
-        goto error;
-    }
+    /* Check if the tag is in the canonical form. */
 
-    /* Eat a line break. */
+    if (!CACHE(parser, 2)) goto error;
 
-    if (IS_BREAK(parser->input)) {
-        if (!CACHE(parser, 2)) goto error;
-        SKIP_LINE(parser);
-    }
+    if (CHECK_AT(parser->input, '<', 1))
+    {
+        /* Set the handle to '' */
 
-    end_mark = parser->mark;
+        handle = yaml_pool_malloc(&parser->pool, 1, NULL);
+        if (!handle) goto error;
+        handle[0] = '\0';
 
-    /* Set the intendation level if it was specified. */
+        /* Eat '!<' */
 
-    if (increment) {
-        indent = parser->indent >= 0 ? parser->indent+increment : increment;
-    }
+        SKIP(parser);
+        SKIP(parser);
 
-    /* Scan the leading line breaks and determine the indentation level if needed. */
+        /* Consume the tag value. */
 
-    if (!yaml_parser_scan_block_scalar_breaks(parser, &indent, &trailing_breaks,
-                start_mark, &end_mark)) goto error;
+        if (!yaml_parser_scan_tag_uri(parser, 0, NULL, start_mark, &suffix))
+            goto error;
 
-    /* Scan the block scalar content. */
+        /* Check for '>' and eat it. */
 
-    if (!CACHE(parser, 1)) goto error;
+        if (!CHECK(parser->input, '>')) {
+            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a tag", start_mark,
+                    "did not find the expected '>'", parser->mark);
+            goto error;
+        }
 
-    while ((int)parser->mark.column == indent && !IS_Z(parser->input))
+        SKIP(parser);
+    }
+    else
     {
-        /*
-         * We are at the beginning of a non-empty line.
-         */
+        /* The tag has either the '!suffix' or the '!handle!suffix' form. */
 
-        /* Is it a trailing whitespace? */
+        /* First, try to scan a handle. */
 
-        trailing_blank = IS_BLANK(parser->input);
+        if (!yaml_parser_scan_tag_handle(parser, 0, start_mark, &handle))
+            goto error;
 
-        /* Check if we need to fold the leading line break. */
+        /* Check if it is, indeed, handle. */
 
-        if (!literal && (*leading_break.buffer == '\n')
-                && !leading_blank && !trailing_blank)
+        if (handle[0] == '!' && handle[1] != '\0' && handle[strlen((char *)handle)-1] == '!')
         {
-            /* Do we need to join the lines by space? */
-
-            if (*trailing_breaks.buffer == '\0') {
-                if (!OSTRING_EXTEND(parser, string)) goto error;
-                JOIN_OCTET(string, ' ');
-            }
+            /* Scan the suffix now. */
 
-            CLEAR(parser, leading_break);
-        }
-        else {
-            if (!JOIN(parser, string, leading_break)) goto error;
-            CLEAR(parser, leading_break);
+            if (!yaml_parser_scan_tag_uri(parser, 0, NULL, start_mark, &suffix))
+                goto error;
         }
+        else
+        {
+            /* It wasn't a handle after all.  Scan the rest of the tag. */
 
-        /* Append the remaining line breaks. */
-
-        if (!JOIN(parser, string, trailing_breaks)) goto error;
-        CLEAR(parser, trailing_breaks);
+            if (!yaml_parser_scan_tag_uri(parser, 0, handle, start_mark, &suffix))
+                goto error;
 
-        /* Is it a leading whitespace? */
+            /* Set the handle to '!'. */
 
-        leading_blank = IS_BLANK(parser->input);
+            POOL_STRING_DEL(parser, handle);
+            handle = yaml_pool_malloc(&parser->pool, 2, NULL);
+            if (!handle) goto error;
+            handle[0] = '!';
+            handle[1] = '\0';
 
-        /* Consume the current line. */
+            /*
+             * A special case: the '!' tag.  Set the handle to '' and the
+             * suffix to '!'.
+             */
 
-        while (!IS_BREAKZ(parser->input)) {
-            if (!READ(parser, string)) goto error;
-            if (!CACHE(parser, 1)) goto error;
+            if (suffix[0] == '\0') {
+                yaml_char_t *tmp = handle;
+                handle = suffix;
+                suffix = tmp;
+            }
         }
+    }
 
-        /* Consume the line break. */
-
-        if (!CACHE(parser, 2)) goto error;
-
-        if (!READ_LINE(parser, leading_break)) goto error;
+    /* Check the character which ends the tag. */
 
-        /* Eat the following intendation spaces and line breaks. */
+    if (!CACHE(parser, 1)) goto error;
 
-        if (!yaml_parser_scan_block_scalar_breaks(parser,
-                    &indent, &trailing_breaks, start_mark, &end_mark)) goto error;
+    if (!IS_BLANKZ(parser->input)) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a tag", start_mark,
+                "did not find expected whitespace or line break", parser->mark);
+        goto error;
     }
 
-    /* Chomp the tail. */
-
-    if (chomping != -1) {
-        if (!JOIN(parser, string, leading_break)) goto error;
-    }
-    if (chomping == 1) {
-        if (!JOIN(parser, string, trailing_breaks)) goto error;
-    }
+    end_mark = parser->mark;
 
     /* Create a token. */
 
-    SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
-            literal ? YAML_LITERAL_SCALAR_STYLE : YAML_FOLDED_SCALAR_STYLE,
-            start_mark, end_mark);
-
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
+    TAG_TOKEN_INIT(*token, handle, suffix, start_mark, end_mark);
 
     return 1;
 
 error:
-    OSTRING_DEL(parser, string);
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
-
+    POOL_STRING_DEL(parser, handle);
+    POOL_STRING_DEL(parser, suffix);
     return 0;
 }
 
 /*
- * Scan intendation spaces and line breaks for a block scalar.  Determine the
- * intendation level if needed.
+ * Scan a tag handle.
  */
 
 static int
-yaml_parser_scan_block_scalar_breaks(yaml_parser_t *parser,
-        int *indent, yaml_ostring_t *breaks,
-        yaml_mark_t start_mark, yaml_mark_t *end_mark)
+yaml_parser_scan_tag_handle(yaml_parser_t *parser, int directive,
+        yaml_mark_t start_mark, yaml_char_t **handle)
 {
-    int max_indent = 0;
+    yaml_ostring_t string = NULL_OSTRING;
 
-    *end_mark = parser->mark;
+    if (!POOL_OSTRING_INIT(parser, string))
+        goto error;
 
-    /* Eat the intendation spaces and line breaks. */
+    /* Check the initial '!' character. */
 
-    while (1)
-    {
-        /* Eat the intendation spaces. */
+    if (!CACHE(parser, 1)) goto error;
 
-        if (!CACHE(parser, 1)) return 0;
+    if (!CHECK(parser->input, '!')) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
+                "while scanning a tag directive" : "while scanning a tag",
+                start_mark, "did not find expected '!'", parser->mark);
+        goto error;
+    }
 
-        while ((!*indent || (int)parser->mark.column < *indent)
-                && IS_SPACE(parser->input)) {
-            SKIP(parser);
-            if (!CACHE(parser, 1)) return 0;
-        }
+    /* Copy the '!' character. */
 
-        if ((int)parser->mark.column > max_indent)
-            max_indent = (int)parser->mark.column;
+    if (!READ(parser, string)) goto error;
+
+    /* Copy all subsequent alphabetical and numerical characters. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    while (IS_ALPHA(parser->input))
+    {
+        if (!READ(parser, string)) goto error;
+        if (!CACHE(parser, 1)) goto error;
+    }
+
+    /* Check if the trailing character is '!' and copy it. */
+
+    if (CHECK(parser->input, '!'))
+    {
+        if (!READ(parser, string)) goto error;
+    }
+    else
+    {
+        /*
+         * It's either the '!' tag or not really a tag handle.  If it's a %TAG
+         * directive, it's an error.  If it's a tag token, it must be a part of
+         * URI.
+         */
+
+        if (directive &&
+                !(string.buffer[0] == '!' && string.buffer[1] == '\0')) {
+            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while parsing a tag directive", start_mark,
+                    "did not find expected '!'", parser->mark);
+            goto error;
+        }
+    }
+
+    *handle = string.buffer;
+
+    return 1;
+
+error:
+    POOL_OSTRING_DEL(parser, string);
+    return 0;
+}
+
+/*
+ * Scan a tag.
+ */
+
+static int
+yaml_parser_scan_tag_uri(yaml_parser_t *parser, int directive,
+        yaml_char_t *head, yaml_mark_t start_mark, yaml_char_t **uri)
+{
+    size_t length = head ? strlen((char *)head) : 0;
+    yaml_ostring_t string = NULL_OSTRING;
+
+    if (!POOL_OSTRING_INIT(parser, string))
+        goto error;
+
+    /* Resize the string to include the head. */
+
+    while (string.capacity <= length) {
+        if (!yaml_pool_extend(&parser->pool,
+                    &string.buffer, &string.capacity)) {
+            MEMORY_ERROR_INIT(parser);
+            goto error;
+        }
+    }
+
+    /*
+     * Copy the head if needed.
+     *
+     * Note that we don't copy the leading '!' character.
+     */
+
+    if (length > 1) {
+        memcpy(string.buffer, head+1, length-1);
+        string.pointer += length-1;
+    }
+
+    /* Scan the tag. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    /*
+     * The set of characters that may appear in URI is as follows:
+     *
+     *      '0'-'9', 'A'-'Z', 'a'-'z', '_', '-', ';', '/', '?', ':', '@', '&',
+     *      '=', '+', '$', ',', '.', '!', '~', '*', '\'', '(', ')', '[', ']',
+     *      '%'.
+     */
+
+    while (IS_ALPHA(parser->input) || CHECK(parser->input, ';')
+            || CHECK(parser->input, '/') || CHECK(parser->input, '?')
+            || CHECK(parser->input, ':') || CHECK(parser->input, '@')
+            || CHECK(parser->input, '&') || CHECK(parser->input, '=')
+            || CHECK(parser->input, '+') || CHECK(parser->input, '$')
+            || CHECK(parser->input, ',') || CHECK(parser->input, '.')
+            || CHECK(parser->input, '!') || CHECK(parser->input, '~')
+            || CHECK(parser->input, '*') || CHECK(parser->input, '\'')
+            || CHECK(parser->input, '(') || CHECK(parser->input, ')')
+            || CHECK(parser->input, '[') || CHECK(parser->input, ']')
+            || CHECK(parser->input, '%'))
+    {
+        /* Check if it is a URI-escape sequence. */
+
+        if (CHECK(parser->input, '%')) {
+            if (!yaml_parser_scan_uri_escapes(parser,
+                        directive, start_mark, &string)) goto error;
+        }
+        else {
+            if (!READ(parser, string)) goto error;
+        }
+
+        length ++;
+        if (!CACHE(parser, 1)) goto error;
+    }
+
+    /* Check if the tag is non-empty. */
+
+    if (!length) {
+        if (!POOL_OSTRING_EXTEND(parser, string))
+            goto error;
+
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
+                "while parsing a %TAG directive" : "while parsing a tag",
+                start_mark, "did not find expected tag URI", parser->mark);
+        goto error;
+    }
+
+    *uri = string.buffer;
+
+    return 1;
+
+error:
+    POOL_OSTRING_DEL(parser, string);
+    return 0;
+}
+
+/*
+ * Decode an URI-escape sequence corresponding to a single UTF-8 character.
+ */
+
+static int
+yaml_parser_scan_uri_escapes(yaml_parser_t *parser, int directive,
+        yaml_mark_t start_mark, yaml_ostring_t *string)
+{
+    int width = 0;
+
+    /* Decode the required number of characters. */
+
+    do {
+        unsigned char octet = 0;
+
+        /* Check for a URI-escaped octet. */
+
+        if (!CACHE(parser, 3)) return 0;
+
+        if (!(CHECK(parser->input, '%')
+                    && IS_HEX_AT(parser->input, 1)
+                    && IS_HEX_AT(parser->input, 2))) {
+            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
+                    "while parsing a %TAG directive" : "while parsing a tag",
+                    start_mark, "did not find URI escaped octet", parser->mark);
+        }
+
+        /* Get the octet. */
+
+        octet = (AS_HEX_AT(parser->input, 1) << 4) + AS_HEX_AT(parser->input, 2);
+
+        /* If it is the leading octet, determine the length of the UTF-8 sequence. */
+
+        if (!width)
+        {
+            width = (octet & 0x80) == 0x00 ? 1 :
+                    (octet & 0xE0) == 0xC0 ? 2 :
+                    (octet & 0xF0) == 0xE0 ? 3 :
+                    (octet & 0xF8) == 0xF0 ? 4 : 0;
+            if (!width) {
+                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
+                        "while parsing a %TAG directive" : "while parsing a tag",
+                        start_mark, "found an incorrect leading UTF-8 octet",
+                        parser->mark);
+            }
+        }
+        else
+        {
+            /* Check if the trailing octet is correct. */
+
+            if ((octet & 0xC0) != 0x80) {
+                return SCANNER_ERROR_WITH_CONTEXT_INIT(parser, directive ?
+                        "while parsing a %TAG directive" : "while parsing a tag",
+                        start_mark, "found an incorrect trailing UTF-8 octet",
+                        parser->mark);
+            }
+        }
+
+        /* Copy the octet and move the pointers. */
+
+        JOIN_OCTET(*string, octet);
+        SKIP(parser);
+        SKIP(parser);
+        SKIP(parser);
+
+    } while (--width);
+
+    return 1;
+}
+
+/*
+ * Scan a block scalar.
+ */
+
+static int
+yaml_parser_scan_block_scalar(yaml_parser_t *parser, yaml_token_t *token,
+        int literal)
+{
+    yaml_mark_t start_mark;
+    yaml_mark_t end_mark;
+    yaml_ostring_t string = NULL_OSTRING;
+    yaml_ostring_t leading_break = NULL_OSTRING;
+    yaml_ostring_t trailing_breaks = NULL_OSTRING;
+    int chomping = 0;
+    int increment = 0;
+    int indent = 0;
+    int leading_blank = 0;
+    int trailing_blank = 0;
+
+    if (!POOL_OSTRING_INIT(parser, string))
+        goto error;
+    if (!POOL_OSTRING_INIT(parser, leading_break))
+        goto error;
+    if (!POOL_OSTRING_INIT(parser, trailing_breaks))
+        goto error;
+
+    /* Eat the indicator '|' or '>'. */
+
+    start_mark = parser->mark;
+
+    SKIP(parser);
+
+    /* Scan the additional block scalar indicators. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    /* Check for a chomping indicator. */
+
+    if (CHECK(parser->input, '+') || CHECK(parser->input, '-'))
+    {
+        /* Set the chomping method and eat the indicator. */
+
+        chomping = CHECK(parser->input, '+') ? +1 : -1;
+
+        SKIP(parser);
+
+        /* Check for an indentation indicator. */
+
+        if (!CACHE(parser, 1)) goto error;
+
+        if (IS_DIGIT(parser->input))
+        {
+            /* Check that the intendation is greater than 0. */
+
+            if (CHECK(parser->input, '0')) {
+                SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                        "while scanning a block scalar", start_mark,
+                        "found an intendation indicator equal to 0", parser->mark);
+                goto error;
+            }
+
+            /* Get the intendation level and eat the indicator. */
+
+            increment = AS_DIGIT(parser->input);
+
+            SKIP(parser);
+        }
+    }
+
+    /* Do the same as above, but in the opposite order. */
+
+    else if (IS_DIGIT(parser->input))
+    {
+        if (CHECK(parser->input, '0')) {
+            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a block scalar", start_mark,
+                    "found an intendation indicator equal to 0", parser->mark);
+            goto error;
+        }
+
+        increment = AS_DIGIT(parser->input);
+
+        SKIP(parser);
+
+        if (!CACHE(parser, 1)) goto error;
+
+        if (CHECK(parser->input, '+') || CHECK(parser->input, '-')) {
+            chomping = CHECK(parser->input, '+') ? +1 : -1;
+
+            SKIP(parser);
+        }
+    }
+
+    /* Eat whitespaces and comments to the end of the line. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    while (IS_BLANK(parser->input)) {
+        SKIP(parser);
+        if (!CACHE(parser, 1)) goto error;
+    }
+
+    if (CHECK(parser->input, '#')) {
+        while (!IS_BREAKZ(parser->input)) {
+            SKIP(parser);
+            if (!CACHE(parser, 1)) goto error;
+        }
+    }
+
+    /* Check if we are at the end of the line. */
+
+    if (!IS_BREAKZ(parser->input)) {
+        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                "while scanning a block scalar", start_mark,
+                "did not find expected comment or line break", parser->mark);
+        goto error;
+    }
+
+    /* Eat a line break. */
+
+    if (IS_BREAK(parser->input)) {
+        if (!CACHE(parser, 2)) goto error;
+        SKIP_LINE(parser);
+    }
+
+    end_mark = parser->mark;
+
+    /* Set the intendation level if it was specified. */
+
+    if (increment) {
+        indent = parser->indent >= 0 ? parser->indent+increment : increment;
+    }
+
+    /* Scan the leading line breaks and determine the indentation level if needed. */
+
+    if (!yaml_parser_scan_block_scalar_breaks(parser, &indent, &trailing_breaks,
+                start_mark, &end_mark)) goto error;
+
+    /* Scan the block scalar content. */
+
+    if (!CACHE(parser, 1)) goto error;
+
+    while ((int)parser->mark.column == indent && !IS_Z(parser->input))
+    {
+        /*
+         * We are at the beginning of a non-empty line.
+         */
+
+        /* Is it a trailing whitespace? */
+
+        trailing_blank = IS_BLANK(parser->input);
+
+        /* Check if we need to fold the leading line break. */
+
+        if (!literal && (*leading_break.buffer == '\n')
+                && !leading_blank && !trailing_blank)
+        {
+            /* Do we need to join the lines by space? */
+
+            if (*trailing_breaks.buffer == '\0') {
+                if (!POOL_OSTRING_EXTEND(parser, string)) goto error;
+                JOIN_OCTET(string, ' ');
+            }
+
+            CLEAR(parser, leading_break);
+        }
+        else {
+            if (!POOL_JOIN(parser, string, leading_break)) goto error;
+            CLEAR(parser, leading_break);
+        }
+
+        /* Append the remaining line breaks. */
+
+        if (!POOL_JOIN(parser, string, trailing_breaks)) goto error;
+        CLEAR(parser, trailing_breaks);
+
+        /* Is it a leading whitespace? */
+
+        leading_blank = IS_BLANK(parser->input);
+
+        /* Consume the current line. */
+
+        while (!IS_BREAKZ(parser->input)) {
+            if (!READ(parser, string)) goto error;
+            if (!CACHE(parser, 1)) goto error;
+        }
+
+        /* Consume the line break. */
+
+        if (!CACHE(parser, 2)) goto error;
+
+        if (!READ_LINE(parser, leading_break)) goto error;
+
+        /* Eat the following intendation spaces and line breaks. */
+
+        if (!yaml_parser_scan_block_scalar_breaks(parser,
+                    &indent, &trailing_breaks, start_mark, &end_mark)) goto error;
+    }
+
+    /* Chomp the tail. */
+
+    if (chomping != -1) {
+        if (!POOL_JOIN(parser, string, leading_break)) goto error;
+    }
+    if (chomping == 1) {
+        if (!POOL_JOIN(parser, string, trailing_breaks)) goto error;
+    }
+
+    /* Create a token. */
+
+    SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
+            literal ? YAML_LITERAL_SCALAR_STYLE : YAML_FOLDED_SCALAR_STYLE,
+            start_mark, end_mark);
+
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+
+    return 1;
+
+error:
+    POOL_OSTRING_DEL(parser, string);
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+
+    return 0;
+}
+
+/*
+ * Scan intendation spaces and line breaks for a block scalar.  Determine the
+ * intendation level if needed.
+ */
+
+static int
+yaml_parser_scan_block_scalar_breaks(yaml_parser_t *parser,
+        int *indent, yaml_ostring_t *breaks,
+        yaml_mark_t start_mark, yaml_mark_t *end_mark)
+{
+    int max_indent = 0;
+
+    *end_mark = parser->mark;
+
+    /* Eat the intendation spaces and line breaks. */
+
+    while (1)
+    {
+        /* Eat the intendation spaces. */
+
+        if (!CACHE(parser, 1)) return 0;
+
+        while ((!*indent || (int)parser->mark.column < *indent)
+                && IS_SPACE(parser->input)) {
+            SKIP(parser);
+            if (!CACHE(parser, 1)) return 0;
+        }
+
+        if ((int)parser->mark.column > max_indent)
+            max_indent = (int)parser->mark.column;
 
         /* Check for a tab character messing the intendation. */
 
-        if ((!*indent || (int)parser->mark.column < *indent)
-                && IS_TAB(parser->input)) {
-            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a block scalar", start_mark,
-                    "found a tab character where an intendation space is expected",
-                    parser->mark);
+        if ((!*indent || (int)parser->mark.column < *indent)
+                && IS_TAB(parser->input)) {
+            return SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a block scalar", start_mark,
+                    "found a tab character where an intendation space is expected",
+                    parser->mark);
+        }
+
+        /* Have we found a non-empty line? */
+
+        if (!IS_BREAK(parser->input)) break;
+
+        /* Consume the line break. */
+
+        if (!CACHE(parser, 2)) return 0;
+        if (!READ_LINE(parser, *breaks)) return 0;
+        *end_mark = parser->mark;
+    }
+
+    /* Determine the indentation level if needed. */
+
+    if (!*indent) {
+        *indent = max_indent;
+        if (*indent < parser->indent + 1)
+            *indent = parser->indent + 1;
+        if (*indent < 1)
+            *indent = 1;
+    }
+
+   return 1; 
+}
+
+/*
+ * Scan a quoted scalar.
+ */
+
+static int
+yaml_parser_scan_flow_scalar(yaml_parser_t *parser, yaml_token_t *token,
+        int single)
+{
+    yaml_mark_t start_mark;
+    yaml_mark_t end_mark;
+    yaml_ostring_t string = NULL_OSTRING;
+    yaml_ostring_t leading_break = NULL_OSTRING;
+    yaml_ostring_t trailing_breaks = NULL_OSTRING;
+    yaml_ostring_t whitespaces = NULL_OSTRING;
+    int leading_blanks;
+    int is_borrowed = IS_ZERO_COPY(parser);
+    size_t value_start = 0;
+    size_t value_end = 0;
+
+    if (!is_borrowed && !POOL_OSTRING_INIT(parser, string))
+        goto error;
+    if (!POOL_OSTRING_INIT(parser, leading_break))
+        goto error;
+    if (!POOL_OSTRING_INIT(parser, trailing_breaks))
+        goto error;
+    if (!POOL_OSTRING_INIT(parser, whitespaces))
+        goto error;
+
+    /* Eat the left quote. */
+
+    start_mark = parser->mark;
+
+    SKIP(parser);
+
+    if (is_borrowed) {
+        value_start = value_end = INPUT_OFFSET(parser);
+    }
+
+    /* Consume the content of the quoted scalar. */
+
+    while (1)
+    {
+        /* Check that there are no document indicators at the beginning of the line. */
+
+        if (!CACHE(parser, 4)) goto error;
+
+        if (parser->mark.column == 0 &&
+            ((CHECK_AT(parser->input, '-', 0) &&
+              CHECK_AT(parser->input, '-', 1) &&
+              CHECK_AT(parser->input, '-', 2)) ||
+             (CHECK_AT(parser->input, '.', 0) &&
+              CHECK_AT(parser->input, '.', 1) &&
+              CHECK_AT(parser->input, '.', 2))) &&
+            IS_BLANKZ_AT(parser->input, 3))
+        {
+            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a quoted scalar", start_mark,
+                    "found unexpected document indicator", parser->mark);
+            goto error;
+        }
+
+        /* Check for EOF. */
+
+        if (IS_Z(parser->input)) {
+            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                    "while scanning a quoted scalar", start_mark,
+                    "found unexpected end of stream", parser->mark);
+            goto error;
+        }
+
+        /* Consume non-blank characters. */
+
+        if (!CACHE(parser, 2)) goto error;
+
+        leading_blanks = 0;
+
+        while (!IS_BLANKZ(parser->input))
+        {
+            /* Stop borrowing the value if it has to be unescaped. */
+
+            if (is_borrowed && (single ? CHECK_AT(parser->input, '\'', 0)
+                        && CHECK_AT(parser->input, '\'', 1)
+                        : CHECK(parser->input, '\\')))
+            {
+                if (!yaml_parser_copy_borrowed_value(parser, &string,
+                            value_start, INPUT_OFFSET(parser)))
+                    goto error;
+                is_borrowed = 0;
+            }
+
+            /* Check for an escaped single quote. */
+
+            if (single && CHECK_AT(parser->input, '\'', 0)
+                    && CHECK_AT(parser->input, '\'', 1))
+            {
+                if (!POOL_OSTRING_EXTEND(parser, string)) goto error;
+                JOIN_OCTET(string, '\'');
+                SKIP(parser);
+                SKIP(parser);
+            }
+
+            /* Check for the right quote. */
+
+            else if (CHECK(parser->input, single ? '\'' : '"'))
+            {
+                break;
+            }
+
+            /* Check for an escaped line break. */
+
+            else if (!single && CHECK(parser->input, '\\')
+                    && IS_BREAK_AT(parser->input, 1))
+            {
+                if (!CACHE(parser, 3)) goto error;
+                SKIP(parser);
+                SKIP_LINE(parser);
+                leading_blanks = 1;
+                break;
+            }
+
+            /* Check for an escape sequence. */
+
+            else if (!single && CHECK(parser->input, '\\'))
+            {
+                size_t code_length = 0;
+
+                if (!POOL_OSTRING_EXTEND(parser, string)) goto error;
+
+                /* Check the escape character. */
+
+                switch (OCTET_AT(parser->input, 1))
+                {
+                    case '0':
+                        JOIN_OCTET(string, '\0');
+                        break;
+
+                    case 'a':
+                        JOIN_OCTET(string, '\x07');
+                        break;
+
+                    case 'b':
+                        JOIN_OCTET(string, '\x08');
+                        break;
+
+                    case 't':
+                    case '\t':
+                        JOIN_OCTET(string, '\x09');
+                        break;
+
+                    case 'n':
+                        JOIN_OCTET(string, '\x0A');
+                        break;
+
+                    case 'v':
+                        JOIN_OCTET(string, '\x0B');
+                        break;
+
+                    case 'f':
+                        JOIN_OCTET(string, '\x0C');
+                        break;
+
+                    case 'r':
+                        JOIN_OCTET(string, '\x0D');
+                        break;
+
+                    case 'e':
+                        JOIN_OCTET(string, '\x1B');
+                        break;
+
+                    case ' ':
+                        JOIN_OCTET(string, '\x20');
+                        break;
+
+                    case '"':
+                        JOIN_OCTET(string, '"');
+                        break;
+
+                    case '\'':
+                        JOIN_OCTET(string, '\'');
+                        break;
+
+                    case '\\':
+                        JOIN_OCTET(string, '\\');
+                        break;
+
+                    case 'N':   /* NEL (#x85) */
+                        JOIN_OCTET(string, '\xC2');
+                        JOIN_OCTET(string, '\x85');
+                        break;
+
+                    case '_':   /* #xA0 */
+                        JOIN_OCTET(string, '\xC2');
+                        JOIN_OCTET(string, '\xA0');
+                        break;
+
+                    case 'L':   /* LS (#x2028) */
+                        JOIN_OCTET(string, '\xE2');
+                        JOIN_OCTET(string, '\x80');
+                        JOIN_OCTET(string, '\xA8');
+                        break;
+
+                    case 'P':   /* PS (#x2029) */
+                        JOIN_OCTET(string, '\xE2');
+                        JOIN_OCTET(string, '\x80');
+                        JOIN_OCTET(string, '\xA9');
+                        break;
+
+                    case 'x':
+                        code_length = 2;
+                        break;
+
+                    case 'u':
+                        code_length = 4;
+                        break;
+
+                    case 'U':
+                        code_length = 8;
+                        break;
+
+                    default:
+                        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                                "while parsing a quoted scalar", start_mark,
+                                "found unknown escape character", parser->mark);
+                        goto error;
+                }
+
+                SKIP(parser);
+                SKIP(parser);
+
+                /* Consume an arbitrary escape code. */
+
+                if (code_length)
+                {
+                    unsigned int value = 0;
+                    size_t idx;
+
+                    /* Scan the character value. */
+
+                    if (!CACHE(parser, code_length)) goto error;
+
+                    for (idx = 0; idx < code_length; idx ++) {
+                        if (!IS_HEX_AT(parser->input, idx)) {
+                            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                                    "while parsing a quoted scalar", start_mark,
+                                    "did not find expected hexdecimal number",
+                                    parser->mark);
+                            goto error;
+                        }
+                        value = (value << 4) + AS_HEX_AT(parser->input, idx);
+                    }
+
+                    /* Check the value and write the character. */
+
+                    if ((value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF) {
+                        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                                "while parsing a quoted scalar", start_mark,
+                                "found invalid Unicode character escape code",
+                                parser->mark);
+                        goto error;
+                    }
+
+                    if (value <= 0x7F) {
+                        JOIN_OCTET(string, value);
+                    }
+                    else if (value <= 0x7FF) {
+                        JOIN_OCTET(string, 0xC0 + (value >> 6));
+                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
+                    }
+                    else if (value <= 0xFFFF) {
+                        JOIN_OCTET(string, 0xE0 + (value >> 12));
+                        JOIN_OCTET(string, 0x80 + ((value >> 6) & 0x3F));
+                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
+                    }
+                    else {
+                        JOIN_OCTET(string, 0xF0 + (value >> 18));
+                        JOIN_OCTET(string, 0x80 + ((value >> 12) & 0x3F));
+                        JOIN_OCTET(string, 0x80 + ((value >> 6) & 0x3F));
+                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
+                    }
+
+                    /* Advance the pointer. */
+
+                    for (idx = 0; idx < code_length; idx ++) {
+                        SKIP(parser);
+                    }
+                }
+            }
+
+            else
+            {
+                /* It is a run of non-escaped non-blank characters. */
+
+                size_t span = yaml_parser_scan_span(
+                        parser->input.buffer + parser->input.pointer,
+                        parser->input.length - parser->input.pointer,
+                        single ? SINGLE_QUOTED_SPAN_STOPS
+                        : DOUBLE_QUOTED_SPAN_STOPS);
+
+                if (is_borrowed) {
+                    if (span) {
+                        SKIP_SPAN(parser, span);
+                    }
+                    else {
+                        SKIP(parser);
+                    }
+                }
+                else {
+                    if (span) {
+                        if (!READ_SPAN(parser, string, span)) goto error;
+                    }
+                    else {
+                        if (!READ(parser, string)) goto error;
+                    }
+                }
+            }
+
+            if (!CACHE(parser, 2)) goto error;
+        }
+
+        if (is_borrowed) {
+            value_end = INPUT_OFFSET(parser);
+        }
+
+        /* Check if we are at the end of the scalar. */
+
+        if (CHECK(parser->input, single ? '\'' : '"'))
+            break;
+
+        /* Consume blank characters. */
+
+        if (!CACHE(parser, 1)) goto error;
+
+        while (IS_BLANK(parser->input) || IS_BREAK(parser->input))
+        {
+            if (IS_BLANK(parser->input))
+            {
+                /* Consume a space or a tab character. */
+
+                if (!leading_blanks) {
+                    if (!READ(parser, whitespaces)) goto error;
+                }
+                else {
+                    SKIP(parser);
+                }
+            }
+            else
+            {
+                if (!CACHE(parser, 2)) goto error;
+
+                /* Check if it is a first line break. */
+
+                if (!leading_blanks)
+                {
+                    if (is_borrowed) {
+                        if (!yaml_parser_copy_borrowed_value(parser, &string,
+                                    value_start, value_end))
+                            goto error;
+                        is_borrowed = 0;
+                    }
+                    CLEAR(parser, whitespaces);
+                    if (!READ_LINE(parser, leading_break)) goto error;
+                    leading_blanks = 1;
+                }
+                else
+                {
+                    if (!READ_LINE(parser, trailing_breaks)) goto error;
+                }
+            }
+            if (!CACHE(parser, 1)) goto error;
+        }
+
+        /* Join the whitespaces or fold line breaks. */
+
+        if (is_borrowed)
+        {
+            /* The whitespaces are already in the input. */
+
+            CLEAR(parser, whitespaces);
+        }
+        else if (leading_blanks)
+        {
+            /* Do we need to fold line breaks? */
+
+            if (leading_break.buffer[0] == '\n') {
+                if (trailing_breaks.buffer[0] == '\0') {
+                    if (!POOL_OSTRING_EXTEND(parser, string)) goto error;
+                    JOIN_OCTET(string, ' ');
+                }
+                else {
+                    if (!POOL_JOIN(parser, string, trailing_breaks)) goto error;
+                    CLEAR(parser, trailing_breaks);
+                }
+                CLEAR(parser, leading_break);
+            }
+            else {
+                if (!POOL_JOIN(parser, string, leading_break)) goto error;
+                if (!POOL_JOIN(parser, string, trailing_breaks)) goto error;
+                CLEAR(parser, leading_break);
+                CLEAR(parser, trailing_breaks);
+            }
+        }
+        else
+        {
+            if (!POOL_JOIN(parser, string, whitespaces)) goto error;
+            CLEAR(parser, whitespaces);
         }
+    }
 
-        /* Have we found a non-empty line? */
+    /* Eat the right quote. */
 
-        if (!IS_BREAK(parser->input)) break;
+    if (is_borrowed) {
+        value_end = INPUT_OFFSET(parser);
+    }
 
-        /* Consume the line break. */
+    SKIP(parser);
 
-        if (!CACHE(parser, 2)) return 0;
-        if (!READ_LINE(parser, *breaks)) return 0;
-        *end_mark = parser->mark;
-    }
+    end_mark = parser->mark;
 
-    /* Determine the indentation level if needed. */
+    /* Create a token. */
 
-    if (!*indent) {
-        *indent = max_indent;
-        if (*indent < parser->indent + 1)
-            *indent = parser->indent + 1;
-        if (*indent < 1)
-            *indent = 1;
+    if (is_borrowed) {
+        SCALAR_TOKEN_INIT(*token, BORROWED_VALUE(parser, value_start),
+                value_end - value_start,
+                single ? YAML_SINGLE_QUOTED_SCALAR_STYLE : YAML_DOUBLE_QUOTED_SCALAR_STYLE,
+                start_mark, end_mark);
+        token->data.scalar.is_borrowed = 1;
+    }
+    else {
+        SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
+                single ? YAML_SINGLE_QUOTED_SCALAR_STYLE : YAML_DOUBLE_QUOTED_SCALAR_STYLE,
+                start_mark, end_mark);
     }
 
-   return 1; 
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+    POOL_OSTRING_DEL(parser, whitespaces);
+
+    return 1;
+
+error:
+    POOL_OSTRING_DEL(parser, string);
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+    POOL_OSTRING_DEL(parser, whitespaces);
+
+    return 0;
 }
 
 /*
- * Scan a quoted scalar.
+ * Scan a plain scalar.
  */
 
 static int
-yaml_parser_scan_flow_scalar(yaml_parser_t *parser, yaml_token_t *token,
-        int single)
+yaml_parser_scan_plain_scalar(yaml_parser_t *parser, yaml_token_t *token)
 {
     yaml_mark_t start_mark;
     yaml_mark_t end_mark;
@@ -3026,28 +4237,33 @@ yaml_parser_scan_flow_scalar(yaml_parser_t *parser, yaml_token_t *token,
     yaml_ostring_t leading_break = NULL_OSTRING;
     yaml_ostring_t trailing_breaks = NULL_OSTRING;
     yaml_ostring_t whitespaces = NULL_OSTRING;
-    int leading_blanks;
+    int leading_blanks = 0;
+    int indent = parser->indent+1;
+    int is_borrowed = IS_ZERO_COPY(parser);
+    size_t value_start = 0;
+    size_t value_end = 0;
+    size_t span;
 
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
+    if (!is_borrowed && !POOL_OSTRING_INIT(parser, string))
         goto error;
-    if (!OSTRING_INIT(parser, leading_break, INITIAL_STRING_CAPACITY))
+    if (!POOL_OSTRING_INIT(parser, leading_break))
         goto error;
-    if (!OSTRING_INIT(parser, trailing_breaks, INITIAL_STRING_CAPACITY))
+    if (!POOL_OSTRING_INIT(parser, trailing_breaks))
         goto error;
-    if (!OSTRING_INIT(parser, whitespaces, INITIAL_STRING_CAPACITY))
+    if (!POOL_OSTRING_INIT(parser, whitespaces))
         goto error;
 
-    /* Eat the left quote. */
-
-    start_mark = parser->mark;
+    start_mark = end_mark = parser->mark;
 
-    SKIP(parser);
+    if (is_borrowed) {
+        value_start = value_end = INPUT_OFFSET(parser);
+    }
 
-    /* Consume the content of the quoted scalar. */
+    /* Consume the content of the plain scalar. */
 
     while (1)
     {
-        /* Check that there are no document indicators at the beginning of the line. */
+        /* Check for a document indicator. */
 
         if (!CACHE(parser, 4)) goto error;
 
@@ -3058,539 +4274,907 @@ yaml_parser_scan_flow_scalar(yaml_parser_t *parser, yaml_token_t *token,
              (CHECK_AT(parser->input, '.', 0) &&
               CHECK_AT(parser->input, '.', 1) &&
               CHECK_AT(parser->input, '.', 2))) &&
-            IS_BLANKZ_AT(parser->input, 3))
+            IS_BLANKZ_AT(parser->input, 3)) break;
+
+        /* Check for a comment. */
+
+        if (CHECK(parser->input, '#'))
+            break;
+
+        /* Consume non-blank characters. */
+
+        while (!IS_BLANKZ(parser->input))
         {
-            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a quoted scalar", start_mark,
-                    "found unexpected document indicator", parser->mark);
-            goto error;
-        }
+            /* Check for 'x:x' in the flow context. TODO: Fix the test "spec-08-13". */
 
-        /* Check for EOF. */
+            if (parser->flow_level
+                    && CHECK(parser->input, ':')
+                    && !IS_BLANKZ_AT(parser->input, 1)) {
+                SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                        "while scanning a plain scalar", start_mark,
+                        "found unexpected ':'", parser->mark);
+                goto error;
+            }
 
-        if (IS_Z(parser->input)) {
-            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                    "while scanning a quoted scalar", start_mark,
-                    "found unexpected end of stream", parser->mark);
-            goto error;
+            /* Check for indicators that may end a plain scalar. */
+
+            if ((CHECK(parser->input, ':') && IS_BLANKZ_AT(parser->input, 1))
+                    || (parser->flow_level &&
+                        (CHECK(parser->input, ',') || CHECK(parser->input, ':')
+                         || CHECK(parser->input, '?') || CHECK(parser->input, '[')
+                         || CHECK(parser->input, ']') || CHECK(parser->input, '{')
+                         || CHECK(parser->input, '}'))))
+                break;
+
+            /* Stop borrowing the value if line breaks are to be folded. */
+
+            if (is_borrowed && leading_blanks)
+            {
+                if (!yaml_parser_copy_borrowed_value(parser, &string,
+                            value_start, value_end))
+                    goto error;
+                is_borrowed = 0;
+            }
+
+            /* Check if we need to join whitespaces and breaks. */
+
+            if (is_borrowed)
+            {
+                /* The whitespaces are already in the input. */
+
+                CLEAR(parser, whitespaces);
+            }
+            else if (leading_blanks || whitespaces.pointer > 0)
+            {
+                if (leading_blanks)
+                {
+                    /* Do we need to fold line breaks? */
+
+                    if (leading_break.buffer[0] == '\n') {
+                        if (trailing_breaks.buffer[0] == '\0') {
+                            if (!POOL_OSTRING_EXTEND(parser, string))
+                                goto error;
+                            JOIN_OCTET(string, ' ');
+                        }
+                        else {
+                            if (!POOL_JOIN(parser, string, trailing_breaks))
+                                goto error;
+                            CLEAR(parser, trailing_breaks);
+                        }
+                        CLEAR(parser, leading_break);
+                    }
+                    else {
+                        if (!POOL_JOIN(parser, string, leading_break))
+                            goto error;
+                        if (!POOL_JOIN(parser, string, trailing_breaks))
+                            goto error;
+                        CLEAR(parser, leading_break);
+                        CLEAR(parser, trailing_breaks);
+                    }
+
+                    leading_blanks = 0;
+                }
+                else
+                {
+                    if (!POOL_JOIN(parser, string, whitespaces)) goto error;
+                    CLEAR(parser, whitespaces);
+                }
+            }
+
+            /* Copy the character and the run of safe characters after it. */
+
+            span = yaml_parser_scan_span(
+                    parser->input.buffer + parser->input.pointer,
+                    parser->input.length - parser->input.pointer,
+                    parser->flow_level ? PLAIN_FLOW_SPAN_STOPS
+                    : PLAIN_BLOCK_SPAN_STOPS);
+
+            if (is_borrowed) {
+                if (span) {
+                    SKIP_SPAN(parser, span);
+                }
+                else {
+                    SKIP(parser);
+                }
+                value_end = INPUT_OFFSET(parser);
+            }
+            else {
+                if (span) {
+                    if (!READ_SPAN(parser, string, span)) goto error;
+                }
+                else {
+                    if (!READ(parser, string)) goto error;
+                }
+            }
+
+            end_mark = parser->mark;
+
+            if (!CACHE(parser, 2)) goto error;
         }
 
-        /* Consume non-blank characters. */
+        /* Is it the end? */
 
-        if (!CACHE(parser, 2)) goto error;
+        if (!(IS_BLANK(parser->input) || IS_BREAK(parser->input)))
+            break;
 
-        leading_blanks = 0;
+        /* Consume blank characters. */
 
-        while (!IS_BLANKZ(parser->input))
+        if (!CACHE(parser, 1)) goto error;
+
+        while (IS_BLANK(parser->input) || IS_BREAK(parser->input))
         {
-            /* Check for an escaped single quote. */
+            if (IS_BLANK(parser->input))
+            {
+                /* Check for tab character that abuse intendation. */
+
+                if (leading_blanks && (int)parser->mark.column < indent
+                        && IS_TAB(parser->input)) {
+                    SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
+                            "while scanning a plain scalar", start_mark,
+                            "found a tab character that violate intendation",
+                            parser->mark);
+                    goto error;
+                }
+
+                /* Consume a space or a tab character. */
+
+                if (!leading_blanks) {
+                    if (!READ(parser, whitespaces)) goto error;
+                }
+                else {
+                    SKIP(parser);
+                }
+            }
+            else
+            {
+                if (!CACHE(parser, 2)) goto error;
+
+                /* Check if it is a first line break. */
+
+                if (!leading_blanks)
+                {
+                    CLEAR(parser, whitespaces);
+                    if (!READ_LINE(parser, leading_break)) goto error;
+                    leading_blanks = 1;
+                }
+                else
+                {
+                    if (!READ_LINE(parser, trailing_breaks)) goto error;
+                }
+            }
+            if (!CACHE(parser, 1)) goto error;
+        }
+
+        /* Check intendation level. */
+
+        if (!parser->flow_level && (int)parser->mark.column < indent)
+            break;
+    }
+
+    /* Create a token. */
+
+    if (is_borrowed) {
+        SCALAR_TOKEN_INIT(*token, BORROWED_VALUE(parser, value_start),
+                value_end - value_start,
+                YAML_PLAIN_SCALAR_STYLE, start_mark, end_mark);
+        token->data.scalar.is_borrowed = 1;
+    }
+    else {
+        SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
+                YAML_PLAIN_SCALAR_STYLE, start_mark, end_mark);
+    }
+
+    /* Note that we change the 'is_simple_key_allowed' flag. */
+
+    if (leading_blanks) {
+        parser->is_simple_key_allowed = 1;
+    }
+
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+    POOL_OSTRING_DEL(parser, whitespaces);
+
+    return 1;
+
+error:
+    POOL_OSTRING_DEL(parser, string);
+    POOL_OSTRING_DEL(parser, leading_break);
+    POOL_OSTRING_DEL(parser, trailing_breaks);
+    POOL_OSTRING_DEL(parser, whitespaces);
+
+    return 0;
+}
+
+/*
+ * Copy the borrowed part of a scalar value into an owned string when the value
+ * turns out to need unescaping or folding.
+ */
+
+static int
+yaml_parser_copy_borrowed_value(yaml_parser_t *parser,
+        yaml_ostring_t *string, size_t start, size_t end)
+{
+    size_t length = end - start;
+
+    if (!POOL_OSTRING_INIT(parser, *string))
+        return 0;
+
+    if (!yaml_parser_extend_string(parser, string, length))
+        return 0;
+
+    memcpy(string->buffer, BORROWED_VALUE(parser, start), length);
+    string->pointer = length;
+
+    return 1;
+}
+
+/*
+ * Ensure that a string buffer has room for `length` more octets.
+ */
+
+static int
+yaml_parser_extend_string(yaml_parser_t *parser,
+        yaml_ostring_t *string, size_t length)
+{
+    while (string->pointer+length+5 >= string->capacity) {
+        if (!yaml_pool_extend(&parser->pool,
+                    &string->buffer, &string->capacity))
+            return MEMORY_ERROR_INIT(parser);
+    }
+
+    return 1;
+}
+
+/*
+ * Find the length of the leading run of octets that could be copied to a
+ * scalar value as is: ASCII characters other than blanks, breaks, NUL and the
+ * given `stops` characters.  Any other character ends the run and is left to
+ * the character-by-character scanner.
+ *
+ * With SSE2, the octets are checked 16 at a time.  Note that the signed
+ * comparison with `!` (#x21) catches both the blanks and breaks and the
+ * non-ASCII octets.
+ */
+
+static size_t
+yaml_parser_scan_span(const yaml_char_t *octets, size_t length,
+        const char *stops)
+{
+    size_t idx = 0;
+
+#ifdef YAML_SPAN_SSE2
+
+    __m128i stop_vectors[8];
+    size_t stops_length = strlen(stops);
+    size_t kdx;
 
-            if (single && CHECK_AT(parser->input, '\'', 0)
-                    && CHECK_AT(parser->input, '\'', 1))
-            {
-                if (!OSTRING_EXTEND(parser, string)) goto error;
-                JOIN_OCTET(string, '\'');
-                SKIP(parser);
-                SKIP(parser);
-            }
+    assert(stops_length <= 8);  /* Not too many stop characters expected. */
 
-            /* Check for the right quote. */
+    for (kdx = 0; kdx < stops_length; kdx ++) {
+        stop_vectors[kdx] = _mm_set1_epi8(stops[kdx]);
+    }
 
-            else if (CHECK(parser->input, single ? '\'' : '"'))
-            {
-                break;
-            }
+    while (idx + 16 <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(octets + idx));
+        __m128i matches = _mm_cmplt_epi8(chunk, _mm_set1_epi8('!'));
+        unsigned int mask;
 
-            /* Check for an escaped line break. */
+        for (kdx = 0; kdx < stops_length; kdx ++) {
+            matches = _mm_or_si128(matches,
+                    _mm_cmpeq_epi8(chunk, stop_vectors[kdx]));
+        }
 
-            else if (!single && CHECK(parser->input, '\\')
-                    && IS_BREAK_AT(parser->input, 1))
-            {
-                if (!CACHE(parser, 3)) goto error;
-                SKIP(parser);
-                SKIP_LINE(parser);
-                leading_blanks = 1;
-                break;
+        mask = (unsigned int)_mm_movemask_epi8(matches);
+
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                idx ++;
             }
+            return idx;
+        }
 
-            /* Check for an escape sequence. */
+        idx += 16;
+    }
 
-            else if (!single && CHECK(parser->input, '\\'))
-            {
-                size_t code_length = 0;
+#endif
 
-                if (!OSTRING_EXTEND(parser, string)) goto error;
+    while (idx < length)
+    {
+        yaml_char_t octet = octets[idx];
 
-                /* Check the escape character. */
+        if (octet <= ' ' || octet >= 0x80 || strchr(stops, octet))
+            break;
 
-                switch (OCTET_AT(parser->input, 1))
-                {
-                    case '0':
-                        JOIN_OCTET(string, '\0');
-                        break;
+        idx ++;
+    }
 
-                    case 'a':
-                        JOIN_OCTET(string, '\x07');
-                        break;
+    return idx;
+}
 
-                    case 'b':
-                        JOIN_OCTET(string, '\x08');
-                        break;
 
-                    case 't':
-                    case '\t':
-                        JOIN_OCTET(string, '\x09');
-                        break;
+/*
+ * The JSON scanner.
+ *
+ * In the JSON mode, the tokens inside flow collections are fetched by a
+ * simplified scanner that knows only the JSON syntax: flow indicators, double
+ * quoted strings without line breaks, numbers, and the literals `true`,
+ * `false` and `null`.  The produced tokens are exactly the tokens the general
+ * scanner would produce for the same input.  Anything the JSON scanner does
+ * not recognize switches it off for the rest of the stream and the general
+ * scanner continues from the same position.  If a token is cut by the end of
+ * the buffer, it is fetched by the general scanner, but the JSON mode stays
+ * on.
+ */
 
-                    case 'n':
-                        JOIN_OCTET(string, '\x0A');
-                        break;
+/*
+ * Fetch the next token inside a flow collection with the JSON scanner.  Set
+ * `is_fetched` if the token is produced; otherwise the position is left
+ * intact for the general scanner.
+ */
 
-                    case 'v':
-                        JOIN_OCTET(string, '\x0B');
-                        break;
+static int
+yaml_parser_fetch_json_token(yaml_parser_t *parser, int *is_fetched)
+{
+    *is_fetched = 0;
 
-                    case 'f':
-                        JOIN_OCTET(string, '\x0C');
-                        break;
+    /* Eat whitespaces until we reach the next token. */
 
-                    case 'r':
-                        JOIN_OCTET(string, '\x0D');
-                        break;
+    while (parser->input.pointer < parser->input.length)
+    {
+        if (CHECK(parser->input, ' ') || CHECK(parser->input, '\t')) {
+            SKIP_SPAN(parser, 1);
+        }
+        else if (CHECK(parser->input, '\n') || (CHECK(parser->input, '\r')
+                    && parser->input.pointer+1 < parser->input.length)) {
+            SKIP_LINE(parser);
+        }
+        else break;
+    }
 
-                    case 'e':
-                        JOIN_OCTET(string, '\x1B');
-                        break;
+    /* Leave the end of the buffer to the general scanner. */
 
-                    case ' ':
-                        JOIN_OCTET(string, '\x20');
-                        break;
+    if (parser->input.length - parser->input.pointer < 2)
+        return 1;
 
-                    case '"':
-                        JOIN_OCTET(string, '"');
-                        break;
+    /* Remove obsolete potential simple keys. */
 
-                    case '\'':
-                        JOIN_OCTET(string, '\'');
-                        break;
+    if (!yaml_parser_stale_simple_keys(parser, 0))
+        return 0;
 
-                    case '\\':
-                        JOIN_OCTET(string, '\\');
-                        break;
+    switch (OCTET(parser->input))
+    {
+        case '[':
+            *is_fetched = 1;
+            return yaml_parser_fetch_flow_collection_start(parser,
+                    YAML_FLOW_SEQUENCE_START_TOKEN);
+
+        case '{':
+            *is_fetched = 1;
+            return yaml_parser_fetch_flow_collection_start(parser,
+                    YAML_FLOW_MAPPING_START_TOKEN);
+
+        case ']':
+            *is_fetched = 1;
+            return yaml_parser_fetch_flow_collection_end(parser,
+                    YAML_FLOW_SEQUENCE_END_TOKEN);
+
+        case '}':
+            *is_fetched = 1;
+            return yaml_parser_fetch_flow_collection_end(parser,
+                    YAML_FLOW_MAPPING_END_TOKEN);
+
+        case ',':
+            *is_fetched = 1;
+            return yaml_parser_fetch_flow_entry(parser);
+
+        case ':':
+            *is_fetched = 1;
+            return yaml_parser_fetch_value(parser);
+
+        case '"':
+            return yaml_parser_fetch_json_string(parser, is_fetched);
+
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+        case 'f': case 'n': case 't':
+            return yaml_parser_fetch_json_literal(parser, is_fetched);
+    }
 
-                    case 'N':   /* NEL (#x85) */
-                        JOIN_OCTET(string, '\xC2');
-                        JOIN_OCTET(string, '\x85');
-                        break;
+    /* It is not JSON; switch to the general scanner. */
 
-                    case '_':   /* #xA0 */
-                        JOIN_OCTET(string, '\xC2');
-                        JOIN_OCTET(string, '\xA0');
-                        break;
+    parser->is_json = 0;
 
-                    case 'L':   /* LS (#x2028) */
-                        JOIN_OCTET(string, '\xE2');
-                        JOIN_OCTET(string, '\x80');
-                        JOIN_OCTET(string, '\xA8');
-                        break;
+    return 1;
+}
 
-                    case 'P':   /* PS (#x2029) */
-                        JOIN_OCTET(string, '\xE2');
-                        JOIN_OCTET(string, '\x80');
-                        JOIN_OCTET(string, '\xA9');
-                        break;
+/*
+ * Fetch a JSON string as the SCALAR(...,double-quoted) token.  If the string
+ * is followed by ':' on the same line, it is a simple key, and the KEY,
+ * SCALAR and VALUE tokens are produced at once.
+ */
 
-                    case 'x':
-                        code_length = 2;
-                        break;
+static int
+yaml_parser_fetch_json_string(yaml_parser_t *parser, int *is_fetched)
+{
+    size_t length = parser->input.length - parser->input.pointer;
+    size_t octets = 1;          /* The octets up to the right quote. */
+    size_t characters = 1;      /* The characters up to the right quote. */
+    size_t value_length = 0;    /* The octets of the unescaped value. */
+    size_t blanks = 0;          /* The blanks between the string and ':'. */
+    int is_escaped = 0;
+    int is_key = 0;
+    yaml_mark_t start_mark, end_mark;
+    yaml_token_t token;
+    yaml_char_t *value;
 
-                    case 'u':
-                        code_length = 4;
-                        break;
+    /*
+     * Find the right quote and check that the string is JSON that the general
+     * scanner would read in the same way.
+     */
 
-                    case 'U':
-                        code_length = 8;
-                        break;
+    while (1)
+    {
+        size_t span = yaml_parser_scan_json_span(
+                parser->input.buffer + parser->input.pointer + octets,
+                length - octets);
 
-                    default:
-                        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                                "while parsing a quoted scalar", start_mark,
-                                "found unknown escape character", parser->mark);
-                        goto error;
-                }
+        octets += span;
+        characters += span;
+        value_length += span;
 
-                SKIP(parser);
-                SKIP(parser);
+        if (octets >= length)
+            return 1;
 
-                /* Consume an arbitrary escape code. */
+        if (CHECK_AT(parser->input, '"', octets))
+            break;
 
-                if (code_length)
-                {
-                    unsigned int value = 0;
-                    size_t idx;
+        if (CHECK_AT(parser->input, '\\', octets))
+        {
+            unsigned int code = 0;
+            size_t idx;
 
-                    /* Scan the character value. */
+            if (octets+1 >= length)
+                return 1;
 
-                    if (!CACHE(parser, code_length)) goto error;
+            switch (OCTET_AT(parser->input, octets+1))
+            {
+                case '"': case '\\': case 'b': case 'f':
+                case 'n': case 'r': case 't':
+                    octets += 2;
+                    characters += 2;
+                    value_length ++;
+                    break;
 
-                    for (idx = 0; idx < code_length; idx ++) {
-                        if (!IS_HEX_AT(parser->input, idx)) {
-                            SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                                    "while parsing a quoted scalar", start_mark,
-                                    "did not find expected hexdecimal number",
-                                    parser->mark);
-                            goto error;
-                        }
-                        value = (value << 4) + AS_HEX_AT(parser->input, idx);
+                case 'u':
+                    if (octets+6 > length)
+                        return 1;
+                    for (idx = 2; idx < 6; idx ++) {
+                        if (!IS_HEX_AT(parser->input, octets+idx))
+                            goto not_json;
+                        code = (code << 4) + AS_HEX_AT(parser->input, octets+idx);
                     }
+                    if (code >= 0xD800 && code <= 0xDFFF)
+                        goto not_json;
+                    octets += 6;
+                    characters += 6;
+                    value_length += (code <= 0x7F ? 1 : code <= 0x7FF ? 2 : 3);
+                    break;
 
-                    /* Check the value and write the character. */
+                default:
+                    goto not_json;
+            }
 
-                    if ((value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF) {
-                        SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                                "while parsing a quoted scalar", start_mark,
-                                "found invalid Unicode character escape code",
-                                parser->mark);
-                        goto error;
-                    }
+            is_escaped = 1;
+        }
+        else if (OCTET_AT(parser->input, octets) & 0x80)
+        {
+            size_t width = WIDTH_AT(parser->input, octets);
 
-                    if (value <= 0x7F) {
-                        JOIN_OCTET(string, value);
-                    }
-                    else if (value <= 0x7FF) {
-                        JOIN_OCTET(string, 0xC0 + (value >> 6));
-                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
-                    }
-                    else if (value <= 0xFFFF) {
-                        JOIN_OCTET(string, 0xE0 + (value >> 12));
-                        JOIN_OCTET(string, 0x80 + ((value >> 6) & 0x3F));
-                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
-                    }
-                    else {
-                        JOIN_OCTET(string, 0xF0 + (value >> 18));
-                        JOIN_OCTET(string, 0x80 + ((value >> 12) & 0x3F));
-                        JOIN_OCTET(string, 0x80 + ((value >> 6) & 0x3F));
-                        JOIN_OCTET(string, 0x80 + (value & 0x3F));
-                    }
+            if (!width)
+                goto not_json;
 
-                    /* Advance the pointer. */
+            if (octets+width > length)
+                return 1;
 
-                    for (idx = 0; idx < code_length; idx ++) {
-                        SKIP(parser);
-                    }
-                }
-            }
+            if (IS_BREAK_AT(parser->input, octets))
+                goto not_json;
 
-            else
-            {
-                /* It is a non-escaped non-blank character. */
+            octets += width;
+            characters ++;
+            value_length += width;
+        }
+        else goto not_json;
+    }
 
-                if (!READ(parser, string)) goto error;
-            }
+    /* Include the right quote. */
 
-            if (!CACHE(parser, 2)) goto error;
+    octets ++;
+    characters ++;
+
+    /* Check if the string is a simple key. */
+
+    if (parser->is_simple_key_allowed)
+    {
+        while (octets+blanks < length
+                && IS_BLANK_AT(parser->input, octets+blanks)) {
+            blanks ++;
         }
 
-        /* Check if we are at the end of the scalar. */
+        is_key = (octets+blanks < length
+                && CHECK_AT(parser->input, ':', octets+blanks)
+                && characters+blanks <= 1024);
+    }
 
-        if (CHECK(parser->input, single ? '\'' : '"'))
-            break;
+    /* Produce the KEY token or save a potential simple key. */
 
-        /* Consume blank characters. */
+    if (is_key)
+    {
+        parser->simple_keys.list[parser->simple_keys.length-1].is_possible = 0;
 
-        if (!CACHE(parser, 1)) goto error;
+        TOKEN_INIT(token, YAML_KEY_TOKEN, parser->mark, parser->mark);
 
-        while (IS_BLANK(parser->input) || IS_BREAK(parser->input))
-        {
-            if (IS_BLANK(parser->input))
-            {
-                /* Consume a space or a tab character. */
+        if (!ENQUEUE(parser, parser->tokens, token))
+            return 0;
+    }
+    else
+    {
+        if (!yaml_parser_save_simple_key(parser))
+            return 0;
+    }
 
-                if (!leading_blanks) {
-                    if (!READ(parser, whitespaces)) goto error;
-                }
-                else {
-                    SKIP(parser);
-                }
-            }
-            else
-            {
-                if (!CACHE(parser, 2)) goto error;
+    /* A simple key cannot follow a flow scalar. */
 
-                /* Check if it is a first line break. */
+    parser->is_simple_key_allowed = 0;
 
-                if (!leading_blanks)
-                {
-                    CLEAR(parser, whitespaces);
-                    if (!READ_LINE(parser, leading_break)) goto error;
-                    leading_blanks = 1;
-                }
-                else
-                {
-                    if (!READ_LINE(parser, trailing_breaks)) goto error;
-                }
-            }
-            if (!CACHE(parser, 1)) goto error;
-        }
+    /* Get the value. */
+
+    if (IS_ZERO_COPY(parser) && !is_escaped)
+    {
+        value = BORROWED_VALUE(parser, INPUT_OFFSET(parser)+1);
+    }
+    else
+    {
+        size_t capacity;
+        size_t src = 1, dst = 0;
 
-        /* Join the whitespaces or fold line breaks. */
+        value = yaml_pool_malloc(&parser->pool, value_length+1, &capacity);
+        if (!value)
+            return MEMORY_ERROR_INIT(parser);
 
-        if (leading_blanks)
+        while (dst < value_length)
         {
-            /* Do we need to fold line breaks? */
+            yaml_char_t octet = OCTET_AT(parser->input, src);
+            unsigned int code = 0;
+            size_t idx;
 
-            if (leading_break.buffer[0] == '\n') {
-                if (trailing_breaks.buffer[0] == '\0') {
-                    if (!OSTRING_EXTEND(parser, string)) goto error;
-                    JOIN_OCTET(string, ' ');
-                }
-                else {
-                    if (!JOIN(parser, string, trailing_breaks)) goto error;
-                    CLEAR(parser, trailing_breaks);
-                }
-                CLEAR(parser, leading_break);
+            if (octet != '\\') {
+                value[dst++] = octet;
+                src ++;
+                continue;
             }
-            else {
-                if (!JOIN(parser, string, leading_break)) goto error;
-                if (!JOIN(parser, string, trailing_breaks)) goto error;
-                CLEAR(parser, leading_break);
-                CLEAR(parser, trailing_breaks);
+
+            switch (OCTET_AT(parser->input, src+1))
+            {
+                case 'b':   value[dst++] = '\b';    break;
+                case 'f':   value[dst++] = '\f';    break;
+                case 'n':   value[dst++] = '\n';    break;
+                case 'r':   value[dst++] = '\r';    break;
+                case 't':   value[dst++] = '\t';    break;
+
+                case 'u':
+                    for (idx = 2; idx < 6; idx ++) {
+                        code = (code << 4) + AS_HEX_AT(parser->input, src+idx);
+                    }
+                    if (code <= 0x7F) {
+                        value[dst++] = code;
+                    }
+                    else if (code <= 0x7FF) {
+                        value[dst++] = 0xC0 + (code >> 6);
+                        value[dst++] = 0x80 + (code & 0x3F);
+                    }
+                    else {
+                        value[dst++] = 0xE0 + (code >> 12);
+                        value[dst++] = 0x80 + ((code >> 6) & 0x3F);
+                        value[dst++] = 0x80 + (code & 0x3F);
+                    }
+                    src += 4;
+                    break;
+
+                default:    value[dst++] = OCTET_AT(parser->input, src+1);
             }
-        }
-        else
-        {
-            if (!JOIN(parser, string, whitespaces)) goto error;
-            CLEAR(parser, whitespaces);
+
+            src += 2;
         }
     }
 
-    /* Eat the right quote. */
+    /* Consume the string. */
 
-    SKIP(parser);
+    start_mark = parser->mark;
+
+    parser->mark.index += characters;
+    parser->mark.column += characters;
+    parser->unread -= characters;
+    parser->input.pointer += octets;
 
     end_mark = parser->mark;
 
-    /* Create a token. */
+    /* Create the SCALAR token and append it to the queue. */
 
-    SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
-            single ? YAML_SINGLE_QUOTED_SCALAR_STYLE : YAML_DOUBLE_QUOTED_SCALAR_STYLE,
-            start_mark, end_mark);
+    SCALAR_TOKEN_INIT(token, value, value_length,
+            YAML_DOUBLE_QUOTED_SCALAR_STYLE, start_mark, end_mark);
+    token.data.scalar.is_borrowed = (IS_ZERO_COPY(parser) && !is_escaped);
+
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
+    }
+
+    /* Produce the VALUE token. */
+
+    if (is_key)
+    {
+        SKIP_SPAN(parser, blanks);
+
+        if (!yaml_parser_stale_simple_keys(parser, 0))
+            return 0;
 
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
-    OSTRING_DEL(parser, whitespaces);
+        start_mark = parser->mark;
+        SKIP(parser);
+        end_mark = parser->mark;
+
+        TOKEN_INIT(token, YAML_VALUE_TOKEN, start_mark, end_mark);
+
+        if (!ENQUEUE(parser, parser->tokens, token))
+            return 0;
+    }
+
+    *is_fetched = 1;
 
     return 1;
 
-error:
-    OSTRING_DEL(parser, string);
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
-    OSTRING_DEL(parser, whitespaces);
+not_json:
 
-    return 0;
+    /* The string has to be scanned by the general scanner. */
+
+    parser->is_json = 0;
+
+    return 1;
 }
 
 /*
- * Scan a plain scalar.
+ * Fetch a JSON number or one of the literals `true`, `false` and `null` as the
+ * SCALAR(...,plain) token.  The scalar must be followed by ',', ']' or '}'
+ * so that it cannot continue on the next line.
  */
 
 static int
-yaml_parser_scan_plain_scalar(yaml_parser_t *parser, yaml_token_t *token)
+yaml_parser_fetch_json_literal(yaml_parser_t *parser, int *is_fetched)
 {
-    yaml_mark_t start_mark;
-    yaml_mark_t end_mark;
-    yaml_ostring_t string = NULL_OSTRING;
-    yaml_ostring_t leading_break = NULL_OSTRING;
-    yaml_ostring_t trailing_breaks = NULL_OSTRING;
-    yaml_ostring_t whitespaces = NULL_OSTRING;
-    int leading_blanks = 0;
-    int indent = parser->indent+1;
+    size_t length = parser->input.length - parser->input.pointer;
+    size_t octets = 0;          /* The octets of the literal. */
+    size_t trailing = 0;        /* The blanks and breaks after the literal. */
+    int is_break = 0;
+    yaml_mark_t start_mark, end_mark;
+    yaml_token_t token;
+    yaml_char_t *value;
 
-    if (!OSTRING_INIT(parser, string, INITIAL_STRING_CAPACITY))
-        goto error;
-    if (!OSTRING_INIT(parser, leading_break, INITIAL_STRING_CAPACITY))
-        goto error;
-    if (!OSTRING_INIT(parser, trailing_breaks, INITIAL_STRING_CAPACITY))
-        goto error;
-    if (!OSTRING_INIT(parser, whitespaces, INITIAL_STRING_CAPACITY))
-        goto error;
+    /* Match the literal. */
 
-    start_mark = end_mark = parser->mark;
+    if (CHECK(parser->input, 't') || CHECK(parser->input, 'f')
+            || CHECK(parser->input, 'n'))
+    {
+        const char *literal = CHECK(parser->input, 't') ? "true"
+            : CHECK(parser->input, 'f') ? "false" : "null";
+
+        while (literal[octets]) {
+            if (octets >= length)
+                return 1;
+            if (!CHECK_AT(parser->input, literal[octets], octets))
+                goto not_json;
+            octets ++;
+        }
+    }
+    else
+    {
+        /* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
 
-    /* Consume the content of the plain scalar. */
+        if (CHECK(parser->input, '-'))
+            octets ++;
 
-    while (1)
-    {
-        /* Check for a document indicator. */
+        if (octets >= length)
+            return 1;
 
-        if (!CACHE(parser, 4)) goto error;
+        if (CHECK_AT(parser->input, '0', octets)) {
+            octets ++;
+        }
+        else if (IS_DIGIT_AT(parser->input, octets)) {
+            while (octets < length && IS_DIGIT_AT(parser->input, octets))
+                octets ++;
+        }
+        else goto not_json;
+
+        if (octets < length && CHECK_AT(parser->input, '.', octets)) {
+            octets ++;
+            if (octets >= length)
+                return 1;
+            if (!IS_DIGIT_AT(parser->input, octets))
+                goto not_json;
+            while (octets < length && IS_DIGIT_AT(parser->input, octets))
+                octets ++;
+        }
 
-        if (parser->mark.column == 0 &&
-            ((CHECK_AT(parser->input, '-', 0) &&
-              CHECK_AT(parser->input, '-', 1) &&
-              CHECK_AT(parser->input, '-', 2)) ||
-             (CHECK_AT(parser->input, '.', 0) &&
-              CHECK_AT(parser->input, '.', 1) &&
-              CHECK_AT(parser->input, '.', 2))) &&
-            IS_BLANKZ_AT(parser->input, 3)) break;
+        if (octets < length && (CHECK_AT(parser->input, 'e', octets)
+                    || CHECK_AT(parser->input, 'E', octets))) {
+            octets ++;
+            if (octets < length && (CHECK_AT(parser->input, '+', octets)
+                        || CHECK_AT(parser->input, '-', octets)))
+                octets ++;
+            if (octets >= length)
+                return 1;
+            if (!IS_DIGIT_AT(parser->input, octets))
+                goto not_json;
+            while (octets < length && IS_DIGIT_AT(parser->input, octets))
+                octets ++;
+        }
+    }
 
-        /* Check for a comment. */
+    /*
+     * Check that the literal is followed by ',', ']' or '}' with nothing but
+     * blanks and breaks in between.  A tab after a break could violate the
+     * indentation, so it is left to the general scanner.
+     */
 
-        if (CHECK(parser->input, '#'))
-            break;
+    while (1)
+    {
+        size_t idx = octets+trailing;
 
-        /* Consume non-blank characters. */
+        if (idx >= length)
+            return 1;
 
-        while (!IS_BLANKZ(parser->input))
-        {
-            /* Check for 'x:x' in the flow context. TODO: Fix the test "spec-08-13". */
+        if (CHECK_AT(parser->input, ' ', idx)
+                || (!is_break && CHECK_AT(parser->input, '\t', idx))) {
+            trailing ++;
+        }
+        else if (CHECK_AT(parser->input, '\n', idx)) {
+            trailing ++;
+            is_break = 1;
+        }
+        else if (CHECK_AT(parser->input, '\r', idx)) {
+            if (idx+1 >= length)
+                return 1;
+            trailing += CHECK_AT(parser->input, '\n', idx+1) ? 2 : 1;
+            is_break = 1;
+        }
+        else if (CHECK_AT(parser->input, ',', idx)
+                || CHECK_AT(parser->input, ']', idx)
+                || CHECK_AT(parser->input, '}', idx)) {
+            break;
+        }
+        else goto not_json;
+    }
 
-            if (parser->flow_level
-                    && CHECK(parser->input, ':')
-                    && !IS_BLANKZ_AT(parser->input, 1)) {
-                SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                        "while scanning a plain scalar", start_mark,
-                        "found unexpected ':'", parser->mark);
-                goto error;
-            }
+    /* A plain scalar could be a simple key. */
 
-            /* Check for indicators that may end a plain scalar. */
+    if (!yaml_parser_save_simple_key(parser))
+        return 0;
 
-            if ((CHECK(parser->input, ':') && IS_BLANKZ_AT(parser->input, 1))
-                    || (parser->flow_level &&
-                        (CHECK(parser->input, ',') || CHECK(parser->input, ':')
-                         || CHECK(parser->input, '?') || CHECK(parser->input, '[')
-                         || CHECK(parser->input, ']') || CHECK(parser->input, '{')
-                         || CHECK(parser->input, '}'))))
-                break;
+    /* A simple key cannot follow a flow scalar. */
 
-            /* Check if we need to join whitespaces and breaks. */
+    parser->is_simple_key_allowed = 0;
 
-            if (leading_blanks || whitespaces.pointer > 0)
-            {
-                if (leading_blanks)
-                {
-                    /* Do we need to fold line breaks? */
+    /* Get the value. */
 
-                    if (leading_break.buffer[0] == '\n') {
-                        if (trailing_breaks.buffer[0] == '\0') {
-                            if (!OSTRING_EXTEND(parser, string)) goto error;
-                            JOIN_OCTET(string, ' ');
-                        }
-                        else {
-                            if (!JOIN(parser, string, trailing_breaks)) goto error;
-                            CLEAR(parser, trailing_breaks);
-                        }
-                        CLEAR(parser, leading_break);
-                    }
-                    else {
-                        if (!JOIN(parser, string, leading_break)) goto error;
-                        if (!JOIN(parser, string, trailing_breaks)) goto error;
-                        CLEAR(parser, leading_break);
-                        CLEAR(parser, trailing_breaks);
-                    }
+    if (IS_ZERO_COPY(parser))
+    {
+        value = BORROWED_VALUE(parser, INPUT_OFFSET(parser));
+    }
+    else
+    {
+        size_t capacity;
 
-                    leading_blanks = 0;
-                }
-                else
-                {
-                    if (!JOIN(parser, string, whitespaces)) goto error;
-                    CLEAR(parser, whitespaces);
-                }
-            }
+        value = yaml_pool_malloc(&parser->pool, octets+1, &capacity);
+        if (!value)
+            return MEMORY_ERROR_INIT(parser);
 
-            /* Copy the character. */
+        memcpy(value, parser->input.buffer + parser->input.pointer, octets);
+    }
 
-            if (!READ(parser, string)) goto error;
+    /* Consume the literal and the blanks and breaks after it. */
 
-            end_mark = parser->mark;
+    start_mark = parser->mark;
+    SKIP_SPAN(parser, octets);
+    end_mark = parser->mark;
 
-            if (!CACHE(parser, 2)) goto error;
+    while (!(CHECK(parser->input, ',') || CHECK(parser->input, ']')
+                || CHECK(parser->input, '}')))
+    {
+        if (IS_BREAK(parser->input)) {
+            SKIP_LINE(parser);
         }
+        else {
+            SKIP_SPAN(parser, 1);
+        }
+    }
 
-        /* Is it the end? */
+    /* A simple key is allowed on the next line. */
 
-        if (!(IS_BLANK(parser->input) || IS_BREAK(parser->input)))
-            break;
+    if (is_break) {
+        parser->is_simple_key_allowed = 1;
+    }
 
-        /* Consume blank characters. */
+    /* Create the SCALAR token and append it to the queue. */
 
-        if (!CACHE(parser, 1)) goto error;
+    SCALAR_TOKEN_INIT(token, value, octets, YAML_PLAIN_SCALAR_STYLE,
+            start_mark, end_mark);
+    token.data.scalar.is_borrowed = IS_ZERO_COPY(parser);
 
-        while (IS_BLANK(parser->input) || IS_BREAK(parser->input))
-        {
-            if (IS_BLANK(parser->input))
-            {
-                /* Check for tab character that abuse intendation. */
+    if (!ENQUEUE(parser, parser->tokens, token)) {
+        yaml_parser_recycle_token(parser, &token);
+        return 0;
+    }
 
-                if (leading_blanks && (int)parser->mark.column < indent
-                        && IS_TAB(parser->input)) {
-                    SCANNER_ERROR_WITH_CONTEXT_INIT(parser,
-                            "while scanning a plain scalar", start_mark,
-                            "found a tab character that violate intendation",
-                            parser->mark);
-                    goto error;
-                }
+    *is_fetched = 1;
 
-                /* Consume a space or a tab character. */
+    return 1;
 
-                if (!leading_blanks) {
-                    if (!READ(parser, whitespaces)) goto error;
-                }
-                else {
-                    SKIP(parser);
-                }
-            }
-            else
-            {
-                if (!CACHE(parser, 2)) goto error;
+not_json:
 
-                /* Check if it is a first line break. */
+    /* The scalar has to be scanned by the general scanner. */
 
-                if (!leading_blanks)
-                {
-                    CLEAR(parser, whitespaces);
-                    if (!READ_LINE(parser, leading_break)) goto error;
-                    leading_blanks = 1;
-                }
-                else
-                {
-                    if (!READ_LINE(parser, trailing_breaks)) goto error;
-                }
-            }
-            if (!CACHE(parser, 1)) goto error;
-        }
+    parser->is_json = 0;
 
-        /* Check intendation level. */
+    return 1;
+}
 
-        if (!parser->flow_level && (int)parser->mark.column < indent)
-            break;
-    }
+/*
+ * Find the length of the leading run of octets that could be copied from a
+ * JSON string as is: ASCII characters other than control characters, '"' and
+ * '\'.
+ *
+ * With SSE2, the octets are checked 16 at a time; the signed comparison with
+ * #x20 catches both the control characters and the non-ASCII octets.
+ */
 
-    /* Create a token. */
+static size_t
+yaml_parser_scan_json_span(const yaml_char_t *octets, size_t length)
+{
+    size_t idx = 0;
 
-    SCALAR_TOKEN_INIT(*token, string.buffer, string.pointer,
-            YAML_PLAIN_SCALAR_STYLE, start_mark, end_mark);
+#ifdef YAML_SPAN_SSE2
 
-    /* Note that we change the 'is_simple_key_allowed' flag. */
+    while (idx + 16 <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(octets + idx));
+        __m128i matches = _mm_or_si128(
+                _mm_cmplt_epi8(chunk, _mm_set1_epi8(' ')),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(matches);
+
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                idx ++;
+            }
+            return idx;
+        }
 
-    if (leading_blanks) {
-        parser->is_simple_key_allowed = 1;
+        idx += 16;
     }
 
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
-    OSTRING_DEL(parser, whitespaces);
+#endif
 
-    return 1;
+    while (idx < length)
+    {
+        yaml_char_t octet = octets[idx];
 
-error:
-    OSTRING_DEL(parser, string);
-    OSTRING_DEL(parser, leading_break);
-    OSTRING_DEL(parser, trailing_breaks);
-    OSTRING_DEL(parser, whitespaces);
+        if (octet < ' ' || octet >= 0x80 || octet == '"' || octet == '\\')
+            break;
 
-    return 0;
-}
+        idx ++;
+    }
 
+    return idx;
+}
@@ -0,0 +1,445 @@
+
+#include "yaml_private.h"
+
+/*
+ * API functions.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_compile(yaml_selector_t *selector, const char *path);
+
+YAML_DECLARE(int)
+yaml_selector_select(yaml_selector_t *selector, yaml_document_t *document,
+        int node_id, int **node_ids, size_t *count);
+
+/*
+ * Path compilation.
+ */
+
+static int
+yaml_selector_add_step(yaml_selector_t *selector,
+        yaml_selector_step_type_t type, int is_recursive,
+        const yaml_char_t *key, size_t length, size_t index, size_t offset);
+
+static int
+yaml_selector_compile_key(yaml_selector_t *selector, int is_recursive,
+        size_t *offset);
+
+static int
+yaml_selector_compile_bracket(yaml_selector_t *selector, int is_recursive,
+        size_t *offset);
+
+/*
+ * Evaluation.
+ */
+
+static int
+yaml_selector_find_value(yaml_document_t *document, int node_id,
+        const yaml_char_t *key, size_t length, int is_complete,
+        int *value_id);
+
+/*
+ * Compile a path expression.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_compile(yaml_selector_t *selector, const char *path)
+{
+    size_t offset = 0;
+    int is_first = 1;
+
+    assert(selector);   /* Non-NULL selector object expected. */
+    assert(path);       /* Non-NULL path expected. */
+
+    selector->is_compiled = 0;
+    selector->steps.length = 0;
+
+    yaml_free(selector->path);
+    selector->path = yaml_strdup((const yaml_char_t *)path);
+    if (!selector->path)
+        return MEMORY_ERROR_INIT(selector);
+
+    if (selector->path[0] == '$') {
+        offset ++;
+    }
+
+    while (selector->path[offset])
+    {
+        yaml_char_t ch = selector->path[offset];
+        int is_recursive = 0;
+
+        if (ch == '.') {
+            offset ++;
+            if (selector->path[offset] == '.') {
+                is_recursive = 1;
+                offset ++;
+                if (selector->path[offset] == '[') {
+                    if (!yaml_selector_compile_bracket(selector, 1, &offset))
+                        goto error;
+                    continue;
+                }
+            }
+            if (!yaml_selector_compile_key(selector, is_recursive, &offset))
+                goto error;
+        }
+        else if (ch == '[') {
+            if (!yaml_selector_compile_bracket(selector, 0, &offset))
+                goto error;
+        }
+        else if (is_first) {
+            if (!yaml_selector_compile_key(selector, 0, &offset))
+                goto error;
+        }
+        else {
+            SELECTOR_ERROR_INIT(selector,
+                    "did not find expected '.' or '['", offset);
+            goto error;
+        }
+
+        is_first = 0;
+    }
+
+    selector->is_compiled = 1;
+
+    return 1;
+
+error:
+
+    selector->steps.length = 0;
+
+    return 0;
+}
+
+/*
+ * Add a step to the compiled path.
+ */
+
+static int
+yaml_selector_add_step(yaml_selector_t *selector,
+        yaml_selector_step_type_t type, int is_recursive,
+        const yaml_char_t *key, size_t length, size_t index, size_t offset)
+{
+    yaml_selector_step_t step;
+
+    if (selector->steps.length == MAX_SELECTOR_STEPS)
+        return SELECTOR_ERROR_INIT(selector, "found too many steps", offset);
+
+    step.type = type;
+    step.is_recursive = is_recursive;
+    step.key = key;
+    step.length = length;
+    step.index = index;
+
+    return PUSH(selector, selector->steps, step);
+}
+
+/*
+ * Compile a `.key` or `.*` step; the offset points after the dots.
+ */
+
+static int
+yaml_selector_compile_key(yaml_selector_t *selector, int is_recursive,
+        size_t *offset)
+{
+    const yaml_char_t *key = selector->path + *offset;
+    size_t length = 0;
+
+    if (key[0] == '*') {
+        (*offset) ++;
+        return yaml_selector_add_step(selector, YAML_SELECTOR_ANY_STEP,
+                is_recursive, NULL, 0, 0, *offset-1);
+    }
+
+    while (key[length] && key[length] != '.' && key[length] != '['
+            && key[length] != ']') {
+        length ++;
+    }
+
+    if (key[length] == ']')
+        return SELECTOR_ERROR_INIT(selector, "found unexpected ']'",
+                *offset+length);
+
+    if (!length)
+        return SELECTOR_ERROR_INIT(selector, "did not find expected key",
+                *offset);
+
+    *offset += length;
+
+    return yaml_selector_add_step(selector, YAML_SELECTOR_KEY_STEP,
+            is_recursive, key, length, 0, *offset-length);
+}
+
+/*
+ * Compile a `[N]`, `[*]` or `["key"]` step; the offset points to `[`.
+ */
+
+static int
+yaml_selector_compile_bracket(yaml_selector_t *selector, int is_recursive,
+        size_t *offset)
+{
+    const yaml_char_t *path = selector->path;
+    size_t start = *offset;
+    size_t pointer = start+1;
+    yaml_selector_step_type_t type;
+    const yaml_char_t *key = NULL;
+    size_t length = 0;
+    size_t index = 0;
+
+    if (path[pointer] == '*') {
+        type = YAML_SELECTOR_ANY_STEP;
+        pointer ++;
+    }
+    else if (path[pointer] >= '0' && path[pointer] <= '9') {
+        type = YAML_SELECTOR_INDEX_STEP;
+        while (path[pointer] >= '0' && path[pointer] <= '9') {
+            index = index*10 + (path[pointer] - '0');
+            if (index > INT_MAX)
+                return SELECTOR_ERROR_INIT(selector, "found too large index",
+                        start+1);
+            pointer ++;
+        }
+    }
+    else if (path[pointer] == '"' || path[pointer] == '\'') {
+        yaml_char_t quote = path[pointer];
+        type = YAML_SELECTOR_KEY_STEP;
+        pointer ++;
+        key = path + pointer;
+        while (path[pointer] && path[pointer] != quote) {
+            pointer ++;
+        }
+        if (!path[pointer])
+            return SELECTOR_ERROR_INIT(selector,
+                    "did not find the closing quote", start+1);
+        length = path + pointer - key;
+        pointer ++;
+    }
+    else {
+        return SELECTOR_ERROR_INIT(selector,
+                "did not find expected index, quoted key or '*'", pointer);
+    }
+
+    if (path[pointer] != ']')
+        return SELECTOR_ERROR_INIT(selector, "did not find expected ']'",
+                pointer);
+
+    *offset = pointer+1;
+
+    return yaml_selector_add_step(selector, type, is_recursive,
+            key, length, index, start);
+}
+
+/*
+ * Select the nodes of a document.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_select(yaml_selector_t *selector, yaml_document_t *document,
+        int node_id, int **node_ids, size_t *count)
+{
+    assert(selector);       /* Non-NULL selector object expected. */
+    assert(document);       /* Non-NULL document is required. */
+    assert(document->type); /* Initialized document is expected. */
+    assert(node_ids);       /* Non-NULL node_ids is required. */
+    assert(count);          /* Non-NULL count is required. */
+
+    if (node_id < 0) {
+        node_id += document->nodes.length;
+    }
+
+    assert(node_id >= 0 && node_id < document->nodes.length);
+                            /* Valid node id is required. */
+
+    selector->matches.length = 0;
+
+    if (selector->is_compiled
+            && !yaml_selector_evaluate(selector, document, node_id, 1UL, 1))
+        return 0;
+
+    *node_ids = selector->matches.list;
+    *count = selector->matches.length;
+
+    return 1;
+}
+
+/*
+ * Get the states of a child node.
+ */
+
+YAML_DECLARE(unsigned long)
+yaml_selector_advance(yaml_selector_t *selector, unsigned long states,
+        const yaml_char_t *key, size_t length, int index)
+{
+    unsigned long result = 0;
+    int idx;
+
+    for (idx = 0; idx < (int)selector->steps.length; idx ++)
+    {
+        yaml_selector_step_t *step = selector->steps.list + idx;
+        int is_matched = 0;
+
+        if (!(states & (1UL << idx)))
+            continue;
+
+        switch (step->type) {
+            case YAML_SELECTOR_KEY_STEP:
+                is_matched = (index < 0 && key && length == step->length
+                        && memcmp(key, step->key, length) == 0);
+                break;
+            case YAML_SELECTOR_INDEX_STEP:
+                is_matched = (index >= 0 && (size_t)index == step->index);
+                break;
+            case YAML_SELECTOR_ANY_STEP:
+                is_matched = 1;
+                break;
+        }
+
+        if (is_matched) {
+            result |= 1UL << (idx+1);
+        }
+        if (step->is_recursive) {
+            result |= 1UL << idx;
+        }
+    }
+
+    return result;
+}
+
+/*
+ * Apply the steps to a document node.
+ *
+ * The pending node evaluations are kept on a stack, with the children pushed
+ * in the reverse order, so that the nodes are selected in the document order,
+ * the same as in the selective composer.  A single key or index step is
+ * applied directly; otherwise, every child is advanced in turn.  A node is not
+ * walked deeper than the number of nodes, which is only possible with an alias
+ * to an ancestor node.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_evaluate(yaml_selector_t *selector, yaml_document_t *document,
+        int node_id, unsigned long states, int is_complete)
+{
+    unsigned long final = 1UL << selector->steps.length;
+    yaml_selector_frame_t root = { node_id, states, 0 };
+
+    selector->frames.length = 0;
+
+    if (!PUSH(selector, selector->frames, root))
+        return 0;
+
+    while (!STACK_EMPTY(selector, selector->frames))
+    {
+        yaml_selector_frame_t frame = POP(selector, selector->frames);
+        unsigned long rest = frame.states & ~final;
+        yaml_node_item_t *items = NULL;
+        yaml_node_pair_t *pairs = NULL;
+        size_t length = 0;
+        size_t item;
+
+        if (frame.states & final) {
+            if (!PUSH(selector, selector->matches, frame.node_id))
+                return 0;
+        }
+
+        if (!rest || frame.depth >= document->nodes.length)
+            continue;
+
+        if (!yaml_document_get_sequence(document, frame.node_id, NULL,
+                    &items, &length)) {
+            yaml_document_get_mapping(document, frame.node_id, NULL,
+                    &pairs, &length);
+        }
+
+        if (!(rest & (rest-1))) {
+            yaml_selector_step_t *step = selector->steps.list;
+            yaml_selector_frame_t child = { -1, rest << 1, frame.depth+1 };
+
+            while (!(rest & 1UL)) {
+                rest >>= 1;
+                step ++;
+            }
+
+            if (step->is_recursive || step->type == YAML_SELECTOR_ANY_STEP)
+                goto walk;
+
+            if (step->type == YAML_SELECTOR_KEY_STEP) {
+                if (pairs && !yaml_selector_find_value(document,
+                            frame.node_id, step->key, step->length,
+                            is_complete, &child.node_id)) {
+                    child.node_id = -1;
+                }
+            }
+            else if (items && step->index < length) {
+                child.node_id = items[step->index];
+            }
+
+            if (child.node_id >= 0
+                    && !PUSH(selector, selector->frames, child))
+                return 0;
+            continue;
+        }
+
+    walk:
+
+        for (item = length; item > 0; item --)
+        {
+            yaml_selector_frame_t child = { 0, 0, frame.depth+1 };
+
+            if (items) {
+                child.node_id = items[item-1];
+                child.states = yaml_selector_advance(selector, frame.states,
+                        NULL, 0, item-1);
+            }
+            else {
+                yaml_char_t *key = NULL;
+                size_t key_length = 0;
+                child.node_id = pairs[item-1].value;
+                yaml_document_get_scalar(document, pairs[item-1].key, NULL,
+                        &key, &key_length);
+                child.states = yaml_selector_advance(selector, frame.states,
+                        key, key_length, -1);
+            }
+
+            if (child.states && !PUSH(selector, selector->frames, child))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Find the value of a mapping pair by its scalar key.  The key index of a
+ * document being composed would miss the mappings composed later, so such a
+ * document is searched pair by pair.
+ */
+
+static int
+yaml_selector_find_value(yaml_document_t *document, int node_id,
+        const yaml_char_t *key, size_t length, int is_complete,
+        int *value_id)
+{
+    yaml_node_pair_t *pairs;
+    size_t count;
+    size_t idx;
+
+    if (is_complete || document->key_index)
+        return yaml_document_find_mapping_value(document, node_id,
+                key, length, value_id);
+
+    yaml_document_get_mapping(document, node_id, NULL, &pairs, &count);
+
+    for (idx = 0; idx < count; idx ++) {
+        yaml_char_t *value;
+        size_t value_length;
+        if (yaml_document_get_scalar(document, pairs[idx].key, NULL,
+                    &value, &value_length)
+                && value_length == length
+                && memcmp(value, key, length) == 0) {
+            *value_id = pairs[idx].value;
+            return 1;
+        }
+    }
+
+    return 0;
+}
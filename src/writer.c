@@ -8,6 +8,9 @@
 YAML_DECLARE(int)
 yaml_emitter_flush(yaml_emitter_t *emitter);
 
+static int
+yaml_emitter_write_output(yaml_emitter_t *emitter);
+
 /*
  * Flush the output buffer.
  */
@@ -15,18 +18,71 @@ yaml_emitter_flush(yaml_emitter_t *emitter);
 YAML_DECLARE(int)
 yaml_emitter_flush(yaml_emitter_t *emitter)
 {
-    int low, high;
+    int result;
 
     assert(emitter);    /* Non-NULL emitter object is expected. */
-    assert(emitter->writer);    /* Write handler must be set. */
+    assert(emitter->writer || emitter->vector_writer);
+                        /* Write handler must be set. */
     assert(emitter->encoding);  /* Output encoding must be set. */
 
+    STATS_TIMER_START(emitter, writer);
+    result = yaml_emitter_write_output(emitter);
+    STATS_TIMER_STOP(emitter, writer);
+
+    return result;
+}
+
+/*
+ * Pass the output buffer to the write handler.
+ */
+
+static int
+yaml_emitter_write_output(yaml_emitter_t *emitter)
+{
+    int low, high;
+    int is_written;
+
     /* Check if the buffer is empty. */
 
-    if (!emitter->output.pointer) {
+    if (!emitter->output.pointer && !emitter->vectors.length) {
         return 1;
     }
 
+    /* Pass the buffer and the referenced scalar characters as chunks. */
+
+    if (emitter->vector_writer && emitter->encoding == YAML_UTF8_ENCODING)
+    {
+        size_t length = 0;
+        size_t idx;
+
+        if (emitter->output.pointer > emitter->vectors_mark) {
+            yaml_iovec_t vector;
+            vector.buffer = emitter->output.buffer + emitter->vectors_mark;
+            vector.length = emitter->output.pointer - emitter->vectors_mark;
+            if (!PUSH(emitter, emitter->vectors, vector))
+                return 0;
+        }
+
+        for (idx = 0; idx < emitter->vectors.length; idx ++) {
+            length += emitter->vectors.list[idx].length;
+        }
+
+        STATS_COUNT(emitter, writer_calls, 1);
+
+        if (emitter->vector_writer(emitter->vector_writer_data,
+                    emitter->vectors.list, emitter->vectors.length)) {
+            emitter->offset += length;
+            emitter->output.pointer = 0;
+            emitter->vectors.length = 0;
+            emitter->vectors_mark = 0;
+            return 1;
+        }
+        else {
+            return WRITER_ERROR_INIT(emitter,
+                    "write handler error", emitter->offset);
+        }
+    }
+
     /* Switch the buffer into the input mode. */
 
     emitter->output.length = emitter->output.pointer;
@@ -36,6 +92,8 @@ yaml_emitter_flush(yaml_emitter_t *emitter)
 
     if (emitter->encoding == YAML_UTF8_ENCODING)
     {
+        STATS_COUNT(emitter, writer_calls, 1);
+
         if (emitter->writer(emitter->writer_data,
                     emitter->output.buffer, emitter->output.length)) {
             emitter->offset += emitter->output.length;
@@ -111,8 +169,21 @@ yaml_emitter_flush(yaml_emitter_t *emitter)
 
     /* Write the raw buffer. */
 
-    if (emitter->writer(emitter->writer_data,
-                emitter->raw_output.buffer, emitter->raw_output.pointer)) {
+    STATS_COUNT(emitter, writer_calls, 1);
+
+    if (emitter->vector_writer) {
+        yaml_iovec_t vector;
+        vector.buffer = emitter->raw_output.buffer;
+        vector.length = emitter->raw_output.pointer;
+        is_written = emitter->vector_writer(emitter->vector_writer_data,
+                &vector, 1);
+    }
+    else {
+        is_written = emitter->writer(emitter->writer_data,
+                emitter->raw_output.buffer, emitter->raw_output.pointer);
+    }
+
+    if (is_written) {
         emitter->output.pointer = 0;
         emitter->output.length = 0;
         emitter->offset += emitter->raw_output.pointer;
@@ -124,4 +195,3 @@ yaml_emitter_flush(yaml_emitter_t *emitter)
                 "write handler error", emitter->offset);
     }
 }
-
@@ -19,6 +19,14 @@
 #include <ctype.h>
 #include <locale.h>
 
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#if YAML_STATS_TIMERS
+#include <time.h>
+#endif
+
 /*****************************************************************************
  * Memory Management
  *****************************************************************************/
@@ -35,6 +43,588 @@ yaml_free(void *ptr);
 YAML_DECLARE(yaml_char_t *)
 yaml_strdup(const yaml_char_t *);
 
+/*
+ * Compute the hash of a string for the hash indices (FNV-1a).
+ */
+
+YAML_DECLARE(size_t)
+yaml_string_hash(const yaml_char_t *str, size_t length);
+
+/*
+ * The standard tags.  Documents never copy them, so the tag of a node could be
+ * checked against them by comparing pointers.
+ */
+
+extern const yaml_char_t yaml_null_tag[];
+extern const yaml_char_t yaml_bool_tag[];
+extern const yaml_char_t yaml_str_tag[];
+extern const yaml_char_t yaml_int_tag[];
+extern const yaml_char_t yaml_float_tag[];
+extern const yaml_char_t yaml_seq_tag[];
+extern const yaml_char_t yaml_map_tag[];
+
+/*
+ * Get the shared copy of a tag or an anchor from the document string table.
+ * The string is copied into the table if it is not there yet.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_document_intern_string(yaml_document_t *document,
+        const yaml_char_t *string, size_t length);
+
+/*
+ * Same as `yaml_document_intern_string()`, but the document takes the
+ * ownership of a string allocated with `yaml_malloc()`.  The string is freed
+ * or moved into the table and the source pointer is cleared on success.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_document_adopt_string(yaml_document_t *document,
+        yaml_char_t **string_ref, size_t length);
+
+/*
+ * Allocator-aware versions of the functions above.  An allocator with `NULL`
+ * handlers stands for `yaml_malloc()`, `yaml_realloc()` and `yaml_free()`.
+ */
+
+YAML_DECLARE(void *)
+yaml_allocator_malloc(const yaml_allocator_t *allocator, size_t size);
+
+YAML_DECLARE(void *)
+yaml_allocator_realloc(const yaml_allocator_t *allocator,
+        void *ptr, size_t size);
+
+YAML_DECLARE(void)
+yaml_allocator_free(const yaml_allocator_t *allocator, void *ptr);
+
+YAML_DECLARE(yaml_char_t *)
+yaml_allocator_strdup(const yaml_allocator_t *allocator,
+        const yaml_char_t *str);
+
+YAML_DECLARE(yaml_char_t *)
+yaml_allocator_strndup(const yaml_allocator_t *allocator,
+        const yaml_char_t *str, size_t length);
+
+/*
+ * Check if the allocator is the standard allocator.
+ */
+
+#define IS_STANDARD_ALLOCATOR(allocator)                                        \
+    (!(allocator).allocate && !(allocator).reallocate && !(allocator).deallocate)
+
+/*
+ * The size of a memory arena block.
+ */
+
+#define ARENA_BLOCK_CAPACITY    65536
+
+/*
+ * A bump-pointer memory arena.
+ *
+ * The arena hands out memory from large blocks obtained from the upstream
+ * allocator.  Individual blocks are never freed; the whole arena is released
+ * with `yaml_arena_delete()`.  The last allocation could be resized in place.
+ */
+
+typedef struct yaml_arena_block_s yaml_arena_block_t;
+
+typedef struct yaml_arena_s {
+    /* The upstream allocator. */
+    yaml_allocator_t allocator;
+    /* The list of blocks; the current block is the first one. */
+    yaml_arena_block_t *blocks;
+    /* The last allocated chunk (could be resized in place). */
+    void *last;
+} yaml_arena_t;
+
+/*
+ * Create an arena on top of the given allocator.
+ */
+
+YAML_DECLARE(yaml_arena_t *)
+yaml_arena_new(const yaml_allocator_t *allocator);
+
+/*
+ * Release all the memory allocated from an arena.
+ */
+
+YAML_DECLARE(void)
+yaml_arena_delete(yaml_arena_t *arena);
+
+/*
+ * Get the allocator handlers that allocate from an arena.
+ */
+
+YAML_DECLARE(void)
+yaml_arena_get_allocator(yaml_arena_t *arena, yaml_allocator_t *allocator);
+
+/*
+ * The number of the pool capacity classes and the number of the free buffers
+ * kept in each class.
+ */
+
+#define POOL_CLASSES        8
+#define POOL_CLASS_DEPTH    64
+
+/*
+ * A pool of string buffers.
+ *
+ * A pooled buffer has the capacity of `INITIAL_STRING_CAPACITY` times a power
+ * of two, up to `INITIAL_STRING_CAPACITY << (POOL_CLASSES-1)`, so that a
+ * string of `length` octets allocated by the library (including a string grown
+ * with `yaml_pool_extend()`) is known to fit the smallest class holding
+ * `length+1` octets.  The free buffers of each class are linked through their
+ * first octets.  The buffers are allocated with `yaml_malloc()` and could be
+ * released with `yaml_free()` as usual.
+ */
+
+typedef struct yaml_pool_s {
+    /* The lists of free buffers, one per class. */
+    yaml_char_t *buffers[POOL_CLASSES];
+    /* The number of free buffers in each list. */
+    size_t counts[POOL_CLASSES];
+#if YAML_STATS
+    /* The number of buffers allocated because no free buffer was available. */
+    size_t allocations;
+    /* The capacity of these buffers. */
+    size_t allocated_bytes;
+#endif
+} yaml_pool_t;
+
+/*
+ * Allocate a zeroed buffer of at least `size` octets from a pool; the pool
+ * could be `NULL`.  The capacity of the buffer is saved to `capacity` unless
+ * it is `NULL`.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_malloc(yaml_pool_t *pool, size_t size, size_t *capacity);
+
+/*
+ * Allocate a copy of a string of `length` octets with a trailing NUL from a
+ * pool; the pool could be `NULL`.
+ */
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_strndup(yaml_pool_t *pool, const yaml_char_t *str, size_t length);
+
+YAML_DECLARE(yaml_char_t *)
+yaml_pool_strdup(yaml_pool_t *pool, const yaml_char_t *str);
+
+/*
+ * Return a buffer of at least `size` octets allocated with `yaml_pool_malloc()`
+ * to a pool, or free it if the pool is full or `NULL`.
+ */
+
+YAML_DECLARE(void)
+yaml_pool_free(yaml_pool_t *pool, yaml_char_t *buffer, size_t size);
+
+/*
+ * Double the capacity of a buffer allocated with `yaml_pool_malloc()`.
+ */
+
+YAML_DECLARE(int)
+yaml_pool_extend(yaml_pool_t *pool, yaml_char_t **buffer, size_t *capacity);
+
+/*
+ * Append a string to the end of a pooled base string expanding it if needed.
+ */
+
+YAML_DECLARE(int)
+yaml_pool_join(yaml_pool_t *pool,
+        yaml_char_t **base_buffer, size_t *base_pointer, size_t *base_capacity,
+        yaml_char_t *adj_buffer, size_t adj_pointer);
+
+/*
+ * Free all the buffers kept in a pool.
+ */
+
+YAML_DECLARE(void)
+yaml_pool_clear(yaml_pool_t *pool);
+
+/*****************************************************************************
+ * Compact Documents
+ *****************************************************************************/
+
+/*
+ * The compact node storage of a document.
+ *
+ * The node `i` has the type `types[i]` and the tag `tags.list[tag_ids[i]]`.
+ * The content of a scalar node is `lengths[i]` bytes of `values` starting at
+ * `offsets[i]`, followed by NUL.  The content of a sequence or a mapping node
+ * is `lengths[i]` entries of `items` or `pairs` starting at `offsets[i]`.  The
+ * node columns have the capacity `capacity`; the number of nodes is kept in
+ * `document->nodes.length`.  All the lists are allocated with the document
+ * allocator, except for a document loaded from a binary image: its node
+ * columns, values, items and pairs point into the image and only the
+ * structure and the tag list are allocated.
+ */
+
+typedef struct yaml_compact_nodes_s {
+
+    /* The capacity of the node columns. */
+    size_t capacity;
+
+    /* The node types. */
+    unsigned char *types;
+
+    /* The node tags as positions in the tag list. */
+    int *tag_ids;
+
+    /* The content offsets. */
+    size_t *offsets;
+
+    /* The content lengths. */
+    size_t *lengths;
+
+    /* The distinct node tags (interned in the document string table). */
+    struct {
+        yaml_char_t **list;
+        size_t length;
+        size_t capacity;
+    } tags;
+
+    /* The scalar values. */
+    struct {
+        yaml_char_t *list;
+        size_t length;
+        size_t capacity;
+    } values;
+
+    /* The sequence items. */
+    struct {
+        yaml_node_item_t *list;
+        size_t length;
+        size_t capacity;
+    } items;
+
+    /* The mapping pairs. */
+    struct {
+        yaml_node_pair_t *list;
+        size_t length;
+        size_t capacity;
+    } pairs;
+
+    /* The binary image the node columns point into or `NULL`. */
+    const unsigned char *image;
+
+} yaml_compact_nodes_t;
+
+/*
+ * Release the compact node storage of a document.
+ */
+
+YAML_DECLARE(void)
+yaml_compact_nodes_delete(yaml_compact_nodes_t *nodes,
+        const yaml_allocator_t *allocator);
+
+/*****************************************************************************
+ * Mapping Key Index
+ *****************************************************************************/
+
+/*
+ * An indexed mapping pair with a scalar key.
+ */
+
+typedef struct yaml_key_entry_s {
+
+    /* The hash of the mapping id and the key value. */
+    size_t hash;
+
+    /* The mapping node id. */
+    int mapping_id;
+
+    /* The key node id. */
+    int key_id;
+
+    /* The value node id. */
+    int value_id;
+
+} yaml_key_entry_t;
+
+/*
+ * The hash index of the mapping keys of a document.
+ *
+ * The entries are kept in the order they are added.  The slots form an open
+ * addressing table of the entry positions keyed by the entry hashes, `-1`
+ * marks an empty slot.  The slot capacity is a power of 2.  All the lists are
+ * allocated with the document allocator.
+ */
+
+typedef struct yaml_key_index_s {
+
+    /* The indexed pairs. */
+    struct {
+        yaml_key_entry_t *list;
+        size_t length;
+        size_t capacity;
+    } entries;
+
+    /* The hash table. */
+    struct {
+        int *list;
+        size_t capacity;
+    } slots;
+
+} yaml_key_index_t;
+
+/*
+ * Add a mapping pair to the key index of a document, creating the index if
+ * needed.  Pairs with non-scalar keys are ignored.  If the mapping already
+ * has a key with the same value and tag, `is_duplicate` is set and the pair
+ * is not added.  Return 0 on memory error.
+ */
+
+YAML_DECLARE(int)
+yaml_document_index_key(yaml_document_t *document, int mapping_id,
+        yaml_node_pair_t pair, int *is_duplicate);
+
+/*
+ * Release the key index of a document.
+ */
+
+YAML_DECLARE(void)
+yaml_key_index_delete(yaml_key_index_t *index,
+        const yaml_allocator_t *allocator);
+
+/*****************************************************************************
+ * Node Reference Counts
+ *****************************************************************************/
+
+/*
+ * The reference counts of the document nodes.
+ *
+ * A count is the number of sequence items, mapping keys and mapping values
+ * referring to a node; it stops at 2, which is enough to tell a shared node.
+ * The counts are built when the first item or pair is appended to a document,
+ * or when the document is emitted, and then kept up to date by
+ * `yaml_document_append_*()`; the counts of the nodes added since are zeroed
+ * on the next call.  The list is allocated with the document allocator.
+ */
+
+typedef struct yaml_references_s {
+
+    /* The number of nodes with two or more references. */
+    size_t shared;
+
+    /* The counts indexed by the node ids. */
+    struct {
+        unsigned char *list;
+        size_t length;
+        size_t capacity;
+    } counts;
+
+} yaml_references_t;
+
+/*
+ * Get the reference counts of a document, counting the references of the
+ * existing nodes if needed.  Return `NULL` on memory error.
+ */
+
+YAML_DECLARE(yaml_references_t *)
+yaml_document_count_references(yaml_document_t *document);
+
+/*
+ * Release the reference counts of a document.
+ */
+
+YAML_DECLARE(void)
+yaml_references_delete(yaml_references_t *references,
+        const yaml_allocator_t *allocator);
+
+/*****************************************************************************
+ * Binary Images
+ *****************************************************************************/
+
+/*
+ * The binary image sections.  Each section starts at a multiple of
+ * `BINARY_IMAGE_ALIGNMENT` bytes from the beginning of the image, in this
+ * order, right after the header.
+ */
+
+typedef enum yaml_binary_section_e {
+    /* The content offsets of the nodes (`size_t` each). */
+    YAML_BINARY_OFFSETS_SECTION,
+    /* The content lengths of the nodes (`size_t` each). */
+    YAML_BINARY_LENGTHS_SECTION,
+    /* The tag offsets in the tag section (`size_t` each). */
+    YAML_BINARY_TAG_OFFSETS_SECTION,
+    /* The tag ids of the nodes (`int` each). */
+    YAML_BINARY_TAG_IDS_SECTION,
+    /* The sequence items. */
+    YAML_BINARY_ITEMS_SECTION,
+    /* The mapping pairs. */
+    YAML_BINARY_PAIRS_SECTION,
+    /* The node types (a byte each). */
+    YAML_BINARY_TYPES_SECTION,
+    /* The scalar values, each followed by NUL. */
+    YAML_BINARY_VALUES_SECTION,
+    /* The distinct tags, each followed by NUL. */
+    YAML_BINARY_TAGS_SECTION,
+    /* The tag directive handles and prefixes, each followed by NUL. */
+    YAML_BINARY_DIRECTIVES_SECTION,
+    /* The end of the image. */
+    YAML_BINARY_END_SECTION
+} yaml_binary_section_t;
+
+/*
+ * The binary image header.  The numbers are kept in the byte order and the
+ * width of the platform that wrote the image; an image written on another
+ * platform is rejected.
+ */
+
+typedef struct yaml_binary_header_s {
+
+    /* The image signature, `BINARY_IMAGE_MAGIC`. */
+    unsigned char magic[8];
+
+    /* The format version, `BINARY_IMAGE_FORMAT`. */
+    unsigned int format;
+
+    /* `BINARY_IMAGE_BYTE_ORDER` as written by the platform. */
+    unsigned int byte_order;
+
+    /* The width of `size_t`. */
+    unsigned int word_size;
+
+    /* The document flags (`BINARY_IMAGE_*_FLAG`). */
+    unsigned int flags;
+
+    /* The version directive numbers if `BINARY_IMAGE_VERSION_FLAG` is set. */
+    int major;
+    int minor;
+
+    /* The hash of the source bytes. */
+    size_t source_hash;
+
+    /* The size of the whole image. */
+    size_t size;
+
+    /* The number of nodes. */
+    size_t nodes;
+
+    /* The expansion size and depth of the document. */
+    size_t expanded_nodes;
+    size_t expanded_depth;
+
+    /* The number of distinct tags and the size of the tag section. */
+    size_t tags;
+    size_t tag_bytes;
+
+    /* The size of the value section. */
+    size_t values;
+
+    /* The number of sequence items and mapping pairs. */
+    size_t items;
+    size_t pairs;
+
+    /* The number of tag directives and the size of the directive section. */
+    size_t tag_directives;
+    size_t directive_bytes;
+
+} yaml_binary_header_t;
+
+/*****************************************************************************
+ * Shared Documents
+ *****************************************************************************/
+
+/*
+ * Atomic reference count updates; the result is the new value.  Without the
+ * GCC builtins, the updates are not atomic.
+ */
+
+#if defined(__GNUC__)
+#define ATOMIC_INCREMENT(value) __sync_add_and_fetch(&(value), 1)
+#define ATOMIC_DECREMENT(value) __sync_sub_and_fetch(&(value), 1)
+#else
+#define ATOMIC_INCREMENT(value) (++ (value))
+#define ATOMIC_DECREMENT(value) (-- (value))
+#endif
+
+/*
+ * The shared document handle.
+ */
+
+struct yaml_shared_document_s {
+
+    /* The frozen document. */
+    yaml_document_t document;
+
+    /* The number of references. */
+    int count;
+
+};
+
+/*
+ * The document slot.
+ */
+
+struct yaml_document_slot_s {
+
+    /* The current document or `NULL`. */
+    yaml_shared_document_t *shared;
+
+#if HAVE_PTHREAD_H
+    /* The lock of the current document pointer. */
+    pthread_mutex_t mutex;
+#endif
+
+};
+
+/*****************************************************************************
+ * Statistics
+ *****************************************************************************/
+
+/*
+ * The counters are updated only if the library is configured with
+ * `--enable-stats`; otherwise these macros expand to nothing.
+ */
+
+#if YAML_STATS
+
+#define STATS_COUNT(self, counter, value)                                       \
+    ((self)->stats.counter += (value))
+
+#define STATS_PEAK(self, counter, value)                                        \
+    ((self)->stats.counter < (size_t)(value) ?                                  \
+     ((self)->stats.counter = (value)) : 0)
+
+#else
+
+#define STATS_COUNT(self, counter, value)   ((void)0)
+
+#define STATS_PEAK(self, counter, value)    ((void)0)
+
+#endif
+
+/*
+ * The stage timers are updated only with `--enable-stats=timers`.  A timer
+ * is started when the control enters a stage and stopped when it leaves; the
+ * time spent in the nested stages is included.
+ */
+
+#if YAML_STATS_TIMERS
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define STATS_TICKS()   ((double)__builtin_ia32_rdtsc())
+#else
+#define STATS_TICKS()   ((double)clock())
+#endif
+
+#define STATS_TIMER_START(self, timer)                                          \
+    ((self)->stats_starts.timer = STATS_TICKS())
+
+#define STATS_TIMER_STOP(self, timer)                                           \
+    ((self)->stats.timer##_ticks += STATS_TICKS() - (self)->stats_starts.timer)
+
+#else
+
+#define STATS_TIMER_START(self, timer)  ((void)0)
+
+#define STATS_TIMER_STOP(self, timer)   ((void)0)
+
+#endif
+
 /*****************************************************************************
  * Error Management
  *****************************************************************************/
@@ -90,6 +680,12 @@ yaml_strdup(const yaml_char_t *);
      (error).data.resolving.problem = (_problem),                               \
      0)
 
+#define SELECTING_ERROR_INIT(error, _type, _problem, _offset)                   \
+    (ERROR_INIT(error, _type),                                                  \
+     (error).data.selecting.problem = (_problem),                               \
+     (error).data.selecting.offset = (_offset),                                 \
+     0)
+
 /*
  * Specific error initializers.
  */
@@ -137,7 +733,10 @@ yaml_strdup(const yaml_char_t *);
     DUMPING_ERROR_INIT((self)->error, YAML_SERIALIZER_ERROR, _problem)
 
 #define RESOLVER_ERROR_INIT(self, _problem)                                     \
-    RESOLVER_ERROR_INIT((self)->error, YAML_RESOLVER_ERROR, _problem)
+    RESOLVING_ERROR_INIT((self)->error, YAML_RESOLVER_ERROR, _problem)
+
+#define SELECTOR_ERROR_INIT(self, _problem, _offset)                            \
+    SELECTING_ERROR_INIT((self)->error, YAML_SELECTOR_ERROR, _problem, _offset)
 
 /*****************************************************************************
  * Buffer Sizes
@@ -149,6 +748,15 @@ yaml_strdup(const yaml_char_t *);
 
 #define RAW_INPUT_BUFFER_CAPACITY   16384
 
+/*
+ * The minimal size of the input raw buffer.
+ *
+ * The scanner looks ahead for up to 4 characters, so even the smallest buffer
+ * holds several times more.
+ */
+
+#define MIN_RAW_INPUT_BUFFER_CAPACITY   64
+
 /*
  * The size of the input buffer.
  *
@@ -167,6 +775,12 @@ yaml_strdup(const yaml_char_t *);
 
 #define OUTPUT_BUFFER_CAPACITY  16384
 
+/*
+ * The minimal size of the output buffer.
+ */
+
+#define MIN_OUTPUT_BUFFER_CAPACITY  64
+
 /*
  * The size of the output raw buffer.
  *
@@ -176,6 +790,13 @@ yaml_strdup(const yaml_char_t *);
 
 #define RAW_OUTPUT_BUFFER_CAPACITY  (OUTPUT_BUFFER_CAPACITY*2+2)
 
+/*
+ * The minimal length of a run of scalar characters passed to a vector writer
+ * by reference rather than copied to the output buffer.
+ */
+
+#define MIN_OUTPUT_REFERENCE_LENGTH 512
+
 /*
  * The size of other stacks and queues.
  */
@@ -308,6 +929,45 @@ yaml_ostring_join(
         ((self)->error.type = YAML_MEMORY_ERROR,                                \
          0))
 
+/*
+ * String operations on the string buffer pool of an object.
+ */
+
+#define POOL_OSTRING_INIT(self, string)                                         \
+    (((string).buffer = yaml_pool_malloc(&(self)->pool,                         \
+                INITIAL_STRING_CAPACITY, &(string).capacity)) ?                 \
+        ((string).pointer = 0,                                                  \
+         1) :                                                                   \
+        ((self)->error.type = YAML_MEMORY_ERROR,                                \
+         0))
+
+#define POOL_OSTRING_DEL(self, string)                                          \
+    (yaml_pool_free(&(self)->pool, (string).buffer, (string).capacity),         \
+     (string).buffer = NULL,                                                    \
+     ((string).pointer = (string).capacity = 0))
+
+#define POOL_OSTRING_EXTEND(self, string)                                       \
+    ((((string).pointer+5 < (string).capacity)                                  \
+        || yaml_pool_extend(&(self)->pool,                                      \
+            &(string).buffer, &(string).capacity)) ?                            \
+     1 :                                                                        \
+     ((self)->error.type = YAML_MEMORY_ERROR,                                   \
+      0))
+
+#define POOL_JOIN(self, base_string, adj_string)                                \
+    ((yaml_pool_join(&(self)->pool, &(base_string).buffer,                      \
+                     &(base_string).pointer, &(base_string).capacity,           \
+                     (adj_string).buffer, (adj_string).pointer)) ?              \
+        ((adj_string).pointer = 0,                                              \
+         1) :                                                                   \
+        ((self)->error.type = YAML_MEMORY_ERROR,                                \
+         0))
+
+#define POOL_STRING_DEL(self, string)                                           \
+    ((string) ?                                                                 \
+     yaml_pool_free(&(self)->pool, (string), strlen((char *)(string))+1) :      \
+     (void)0)
+
 /*****************************************************************************
  * String Tests
  *****************************************************************************/
@@ -530,6 +1190,17 @@ yaml_ostring_join(
 
 #define IS_BLANKZ(string)   IS_BLANKZ_AT((string), 0)
 
+/*
+ * Check if the position is past the end of the string.
+ *
+ * The scalar values given to the emitter may be not NUL-terminated (say, the
+ * borrowed values of the zero-copy mode), so a look-ahead check must not read
+ * past the end.
+ */
+
+#define IS_END_AT(string, offset)                                               \
+    ((string).pointer+(offset) >= (string).length)
+
 /*
  * Determine the width of the character.
  */
@@ -594,6 +1265,14 @@ yaml_ostring_join(
 YAML_DECLARE(int)
 yaml_stack_extend(void **list, size_t size, size_t *length, size_t *capacity);
 
+/*
+ * Double the stack capacity using the given allocator.
+ */
+
+YAML_DECLARE(int)
+yaml_allocator_stack_extend(const yaml_allocator_t *allocator,
+        void **list, size_t size, size_t *length, size_t *capacity);
+
 /*
  * Double the queue capacity.
  */
@@ -642,6 +1321,34 @@ yaml_queue_extend(void **list, size_t size,
 #define POP(self, stack)                                                        \
     ((stack).list[--(stack).length])
 
+/*
+ * Stack operations for lists owned by a document (or any other object that
+ * carries its own allocator).
+ */
+
+#define ALLOCATOR_STACK_INIT(self, allocator, stack, _capacity)                 \
+    (((stack).list = yaml_allocator_malloc((allocator),                         \
+                    (_capacity)*sizeof(*(stack).list))) ?                       \
+        ((stack).length = 0,                                                    \
+         (stack).capacity = (_capacity),                                        \
+         1) :                                                                   \
+        ((self)->error.type = YAML_MEMORY_ERROR,                                \
+         0))
+
+#define ALLOCATOR_STACK_DEL(self, allocator, stack)                             \
+    (yaml_allocator_free((allocator), (stack).list),                            \
+     (stack).list = NULL,                                                       \
+     (stack).length = (stack).capacity = 0)
+
+#define ALLOCATOR_PUSH(self, allocator, stack, value)                           \
+    (((stack).length < (stack).capacity                                         \
+      || yaml_allocator_stack_extend((allocator), (void **)&(stack).list,       \
+              sizeof(*(stack).list), &(stack).length, &(stack).capacity)) ?     \
+        ((stack).list[(stack).length++] = (value),                              \
+         1) :                                                                   \
+        ((self)->error.type = YAML_MEMORY_ERROR,                                \
+         0))
+
 /*
  * Basic queue operations.
  */
@@ -906,7 +1613,7 @@ yaml_queue_extend(void **list, size_t size,
 #define INCOMPLETE_SCALAR_NODE_INIT(node, _path_list, _path_length,             \
         _path_capacity, _value, _length, _is_plain, _mark)                      \
     (INCOMPLETE_NODE_INIT((node), YAML_SCALAR_NODE, (_path_list),               \
-                          (_path_length), (_path_capacity), (_mark)).           \
+                          (_path_length), (_path_capacity), (_mark)),           \
      (node).data.scalar.value = (_value),                                       \
      (node).data.scalar.length = (_length),                                     \
      (node).data.scalar.is_plain = (_is_plain))
@@ -1000,14 +1707,27 @@ typedef enum yaml_parser_state_e {
  */
 
 typedef struct yaml_alias_data_s {
-    /* The anchor. */
+    /* The anchor (owned by the document node). */
     yaml_char_t *anchor;
+    /* The hash of the anchor. */
+    size_t hash;
     /* The node id. */
     int index;
     /* The anchor mark. */
     yaml_mark_t mark;
 } yaml_alias_data_t;
 
+/*
+ * This structure holds the size of a node tree with all aliases expanded.
+ */
+
+typedef struct yaml_expansion_s {
+    /* The number of nodes. */
+    size_t nodes;
+    /* The depth of the tree. */
+    size_t depth;
+} yaml_expansion_t;
+
 /*
  * The structure that holds data used by the file and string readers.
  */
@@ -1017,6 +1737,12 @@ typedef struct yaml_standard_reader_data_t {
     yaml_istring_t string;
     /* File input data. */
     FILE *file;
+    /* File descriptor input data. */
+    int fd;
+    /* The mapped file or `NULL`. */
+    void *mapping;
+    /* The length of the mapped file. */
+    size_t mapping_length;
 } yaml_standard_reader_data_t;
 
 /*
@@ -1031,6 +1757,23 @@ struct yaml_parser_s {
 
     yaml_error_t error;
 
+    /*
+     * Statistics stuff.
+     */
+
+    /* The profiling counters; updated only with `--enable-stats`. */
+    yaml_parser_stats_t stats;
+
+#if YAML_STATS_TIMERS
+    /* The ticks at which the running stage timers were started. */
+    struct {
+        double reader;
+        double scanner;
+        double parser;
+        double loader;
+    } stats_starts;
+#endif
+
     /*
      * Reader stuff.
      */
@@ -1056,6 +1799,9 @@ struct yaml_parser_s {
     /* The raw buffer. */
     yaml_raw_iostring_t raw_input;
 
+    /* The maximum capacity the raw buffer could grow to or 0. */
+    size_t max_raw_input_capacity;
+
     /* The input encoding. */
     yaml_encoding_t encoding;
 
@@ -1065,6 +1811,33 @@ struct yaml_parser_s {
     /* The mark of the current position. */
     yaml_mark_t mark;
 
+    /* Are scalar values allowed to point into the input string? */
+    int is_zero_copy;
+
+    /* Is the input string scanned in place? */
+    int is_in_place;
+
+    /* The parser's own working buffer while the input string is in place. */
+    yaml_iostring_t saved_input;
+
+    /* Is the input fed with `yaml_parser_feed()`? */
+    int is_push;
+
+    /* Has the last part of the input been fed? */
+    int is_final;
+
+    /* Has any input been fed since the raw buffer was last filled? */
+    int is_fed;
+
+    /* Has the parser stopped to wait for more input? */
+    int is_input_needed;
+
+    /* Does the scanner fetch all tokens of an event ahead of the parser? */
+    int is_scanning_ahead;
+
+    /* Has the scanner failed ahead of the parser? */
+    int is_error_ahead;
+
     /*
      * Scanner stuff.
      */
@@ -1078,6 +1851,12 @@ struct yaml_parser_s {
     /* The number of unclosed '[' and '{' indicators. */
     int flow_level;
 
+    /* The use of the JSON scanner. */
+    yaml_json_mode_t json_mode;
+
+    /* Is the JSON scanner used for the flow collections? */
+    int is_json;
+
     /* The tokens queue. */
     struct {
         yaml_token_t *list;
@@ -1112,6 +1891,76 @@ struct yaml_parser_s {
         size_t capacity;
     } simple_keys;
 
+    /*
+     * The lowest flow level that may have a potential simple key; the keys of
+     * the flow levels below it are not possible.  The key of the block context
+     * (at the bottom of the stack) is tracked separately.
+     */
+    size_t simple_keys_start;
+
+    /*
+     * The pool of the string buffers of the scanner; the values of recycled
+     * tokens and events are returned here.
+     */
+    yaml_pool_t pool;
+
+    /*
+     * The scanner state saved before fetching a token in the push mode, so
+     * that the token could be fetched again once more input is fed.
+     */
+    struct {
+        /* The position in the working buffer. */
+        size_t input_pointer;
+        /* The mark of the position. */
+        yaml_mark_t mark;
+        /* The scanner flags and levels. */
+        int is_stream_start_produced;
+        int flow_level;
+        int indent;
+        int is_simple_key_allowed;
+        size_t simple_keys_start;
+        int is_json;
+        /*
+         * The number of input bytes to wait for before fetching the tokens
+         * again, or 0.  When the input runs out, the scanner waits until the
+         * unread input doubles, so a long token is not scanned over and over.
+         */
+        size_t retry_length;
+        /*
+         * The tokens queue from the token number `number`.  The tokens are
+         * only appended or inserted into the live queue, so the tokens below
+         * `dirty` (the lowest number of an inserted token) are saved already.
+         */
+        struct {
+            yaml_token_t *list;
+            size_t head;
+            size_t tail;
+            size_t capacity;
+            size_t number;
+            size_t dirty;
+        } tokens;
+        /*
+         * The indentation levels stack.  The items below `dirty` have not
+         * changed since the state was saved, so they are not copied again.
+         */
+        struct {
+            int *list;
+            size_t length;
+            size_t capacity;
+            size_t dirty;
+        } indents;
+        /*
+         * The stack of simple keys.  The items below `dirty` have not changed
+         * since the state was saved except for the key of the block context.
+         */
+        struct {
+            yaml_simple_key_t *list;
+            size_t length;
+            size_t capacity;
+            size_t dirty;
+        } simple_keys;
+    } checkpoint;
+
     /*
      * Parser stuff.
      */
@@ -1140,6 +1989,15 @@ struct yaml_parser_s {
         size_t capacity;
     } tag_directives;
 
+    /* Is the parser skipping a node? */
+    int is_skipping;
+
+    /* The depth of the node skipped while more input is needed. */
+    size_t skipped_depth;
+
+    /* The event left by `yaml_parser_skip_node()` for the next call. */
+    yaml_event_t pending_event;
+
     /*
      * Dumper stuff.
      */
@@ -1157,9 +2015,77 @@ struct yaml_parser_s {
         size_t capacity;
     } aliases;
 
+    /*
+     * The hash index of the alias data: an open addressing table of the alias
+     * data positions, `-1` marks an empty slot.  The capacity is a power of 2.
+     */
+    struct {
+        int *list;
+        size_t capacity;
+    } alias_index;
+
+    /* The expanded sizes of the document nodes (indexed by the node id). */
+    struct {
+        yaml_expansion_t *list;
+        size_t length;
+        size_t capacity;
+    } expansions;
+
+    /* The maximum number of nodes in an expanded document or 0. */
+    size_t max_expanded_nodes;
+
+    /* The maximum depth of an expanded document or 0. */
+    size_t max_expanded_depth;
+
+    /* The path from the root node to the node being composed. */
+    struct {
+        yaml_arc_t *list;
+        size_t length;
+        size_t capacity;
+    } path;
+
     /* The document being parsed. */
     yaml_document_t *document;
 
+    /* The allocator for the document content. */
+    yaml_allocator_t allocator;
+
+    /* Are the documents allocated in a memory arena? */
+    int is_arena;
+
+    /* Are the documents stored in the compact layout? */
+    int is_compact;
+
+    /* Do the node marks keep only the offsets? */
+    int is_markless;
+
+    /* Are duplicate mapping keys rejected? */
+    int is_unique_keys;
+
+    /*
+     * The hash index of the compact document tags: an open addressing table
+     * of the tag ids keyed by the interned tag pointers, `-1` marks an empty
+     * slot.  The capacity is a power of 2.
+     */
+    struct {
+        int *list;
+        size_t capacity;
+    } tag_index;
+
+    /* The items of the unfinished compact sequences. */
+    struct {
+        yaml_node_item_t *list;
+        size_t length;
+        size_t capacity;
+    } pending_items;
+
+    /* The pairs of the unfinished compact mappings. */
+    struct {
+        yaml_node_pair_t *list;
+        size_t length;
+        size_t capacity;
+    } pending_pairs;
+
 };
 
 /*****************************************************************************
@@ -1180,6 +2106,14 @@ yaml_parser_update_buffer(yaml_parser_t *parser, size_t length);
 YAML_DECLARE(int)
 yaml_parser_fetch_more_tokens(yaml_parser_t *parser);
 
+/*
+ * Scanner: Ensure that the token queue contains all tokens needed to produce
+ * the next event (used in the push mode).
+ */
+
+YAML_DECLARE(int)
+yaml_parser_fetch_event_tokens(yaml_parser_t *parser);
+
 /*****************************************************************************
  * Emitter Structures
  *****************************************************************************/
@@ -1231,7 +2165,7 @@ typedef enum yaml_emitter_state_e {
  * The information of a node being emitted.
  */
 
-struct typedef yaml_node_data_s {
+typedef struct yaml_node_data_s {
     /* The node id. */
     int id;
     /* The collection iterator. */
@@ -1248,6 +2182,8 @@ typedef struct yaml_standard_writer_data_t {
     size_t *length;
     /* File output data. */
     FILE *file;
+    /* File descriptor output data. */
+    int fd;
 } yaml_standard_writer_data_t;
 
 /*
@@ -1262,6 +2198,21 @@ struct yaml_emitter_s {
 
     yaml_error_t error;
 
+    /*
+     * Statistics stuff.
+     */
+
+    /* The profiling counters; updated only with `--enable-stats`. */
+    yaml_emitter_stats_t stats;
+
+#if YAML_STATS_TIMERS
+    /* The ticks at which the running stage timers were started. */
+    struct {
+        double emitter;
+        double writer;
+    } stats_starts;
+#endif
+
     /*
      * Writer stuff.
      */
@@ -1281,6 +2232,22 @@ struct yaml_emitter_s {
     /* The raw buffer. */
     yaml_raw_iostring_t raw_output;
 
+    /* Vector write handler. */
+    yaml_vector_writer_t *vector_writer;
+
+    /* A pointer for passing to the vector write handler. */
+    void *vector_writer_data;
+
+    /* The chunks for passing to the vector write handler. */
+    struct {
+        yaml_iovec_t *list;
+        size_t length;
+        size_t capacity;
+    } vectors;
+
+    /* The start of the working buffer bytes not added to the chunks yet. */
+    size_t vectors_mark;
+
     /* The offset of the current position (in bytes). */
     size_t offset;
 
@@ -1320,6 +2287,12 @@ struct yaml_emitter_s {
         size_t capacity;
     } events;
 
+    /* The handler releasing the emitted events. */
+    yaml_recycler_t *recycler;
+
+    /* A pointer for passing to the recycler. */
+    void *recycler_data;
+
     /* The stack of indentation levels. */
     struct {
         int *list;
@@ -1415,15 +2388,20 @@ struct yaml_emitter_s {
     /* If the stream was already closed? */
     int is_closed;
 
-    /* The information associated with the document nodes. */
-    struct {
-        /* The number of references. */
-        size_t references;
-        /* The anchor id. */
-        int anchor;
-        /* If the node has been emitted? */
-        int is_serialized;
-    } *anchors;
+    /* If the documents are known to have no shared nodes? */
+    int is_tree;
+
+    /* The reference counts of the document nodes or `NULL` for a tree. */
+    yaml_references_t *references;
+
+    /*
+     * The anchor ids of the document nodes, `0` until a shared node is
+     * emitted, or `NULL` for a tree.
+     */
+    int *anchors;
+
+    /* The generated anchors, `ANCHOR_TEMPLATE_LENGTH` bytes for each id. */
+    yaml_char_t *anchor_names;
 
     /* The last assigned anchor id. */
     int last_anchor_id;
@@ -1431,5 +2409,124 @@ struct yaml_emitter_s {
     /* The document being emitted. */
     yaml_document_t *document;
 
+    /* The allocator for the tag directives and the anchor data. */
+    yaml_allocator_t allocator;
+
+};
+
+/*****************************************************************************
+ * Selector Structures
+ *****************************************************************************/
+
+/*
+ * The maximum number of selector steps.  The evaluation states of a node are
+ * kept in a bit set of the steps to apply to it; the bit after the last step
+ * marks a selected node.
+ */
+
+#define MAX_SELECTOR_STEPS  31
+
+/*
+ * The selector step types.
+ */
+
+typedef enum yaml_selector_step_type_e {
+    /* Select the value of a mapping pair by its scalar key. */
+    YAML_SELECTOR_KEY_STEP,
+    /* Select a sequence item by its index. */
+    YAML_SELECTOR_INDEX_STEP,
+    /* Select all sequence items or mapping values. */
+    YAML_SELECTOR_ANY_STEP
+} yaml_selector_step_type_t;
+
+/*
+ * A selector step.
+ */
+
+typedef struct yaml_selector_step_s {
+    /* The step type. */
+    yaml_selector_step_type_t type;
+    /* Is the step applied to all descendants? */
+    int is_recursive;
+    /* The key (points into the selector path). */
+    const yaml_char_t *key;
+    /* The key length. */
+    size_t length;
+    /* The item index. */
+    size_t index;
+} yaml_selector_step_t;
+
+/*
+ * A pending evaluation of a document node.
+ */
+
+typedef struct yaml_selector_frame_s {
+    /* The node id. */
+    int node_id;
+    /* The steps to apply to the node. */
+    unsigned long states;
+    /* The depth of the node below the starting node. */
+    size_t depth;
+} yaml_selector_frame_t;
+
+/*
+ * The internal selector structure.
+ */
+
+struct yaml_selector_s {
+
+    /* Error stuff. */
+    yaml_error_t error;
+
+    /* The copy of the compiled path. */
+    yaml_char_t *path;
+
+    /* The compiled steps. */
+    struct {
+        yaml_selector_step_t *list;
+        size_t length;
+        size_t capacity;
+    } steps;
+
+    /* Is the path compiled successfully? */
+    int is_compiled;
+
+    /* The evaluation stack. */
+    struct {
+        yaml_selector_frame_t *list;
+        size_t length;
+        size_t capacity;
+    } frames;
+
+    /* The selected node ids. */
+    struct {
+        int *list;
+        size_t length;
+        size_t capacity;
+    } matches;
+
 };
 
+/*****************************************************************************
+ * Internal Selector API
+ *****************************************************************************/
+
+/*
+ * Get the states of a child node given the states of its parent.  For a
+ * sequence item, `index` is the item index; for a mapping value, `index` is
+ * `-1` and `key` is the scalar key or `NULL` if the key is not a scalar.
+ */
+
+YAML_DECLARE(unsigned long)
+yaml_selector_advance(yaml_selector_t *selector, unsigned long states,
+        const yaml_char_t *key, size_t length, int index);
+
+/*
+ * Apply the steps in `states` to a document node and append the selected node
+ * ids to `selector->matches`.  If `is_complete` is not set, the document is
+ * still being composed and the key index is not used.
+ */
+
+YAML_DECLARE(int)
+yaml_selector_evaluate(yaml_selector_t *selector, yaml_document_t *document,
+        int node_id, unsigned long states, int is_complete);
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 int
 main(int argc, char *argv[])
@@ -12,9 +13,10 @@ main(int argc, char *argv[])
     int unicode = 0;
     int k;
     int done = 0;
+    char message[256];
 
-    yaml_parser_t parser;
-    yaml_emitter_t emitter;
+    yaml_parser_t *parser = NULL;
+    yaml_emitter_t *emitter = NULL;
     yaml_event_t input_event;
     yaml_document_t output_document;
 
@@ -22,8 +24,6 @@ main(int argc, char *argv[])
 
     /* Clear the objects. */
 
-    memset(&parser, 0, sizeof(parser));
-    memset(&emitter, 0, sizeof(emitter));
     memset(&input_event, 0, sizeof(input_event));
     memset(&output_document, 0, sizeof(output_document));
 
@@ -67,45 +67,47 @@ main(int argc, char *argv[])
         return 0;
     }
 
-    /* Initialize the parser and emitter objects. */
+    /* Create the parser and emitter objects. */
 
-    if (!yaml_parser_initialize(&parser)) {
-        fprintf(stderr, "Could not initialize the parser object\n");
+    parser = yaml_parser_new();
+    if (!parser) {
+        fprintf(stderr, "Memory error: Not enough memory for parsing\n");
         return 1;
     }
 
-    if (!yaml_emitter_initialize(&emitter)) {
-        yaml_parser_delete(&parser);
-        fprintf(stderr, "Could not inialize the emitter object\n");
+    emitter = yaml_emitter_new();
+    if (!emitter) {
+        fprintf(stderr, "Memory error: Not enough memory for emitting\n");
+        yaml_parser_delete(parser);
         return 1;
     }
 
     /* Set the parser parameters. */
 
-    yaml_parser_set_input_file(&parser, stdin);
+    yaml_parser_set_file_reader(parser, stdin);
 
     /* Set the emitter parameters. */
 
-    yaml_emitter_set_output_file(&emitter, stdout);
+    yaml_emitter_set_file_writer(emitter, stdout);
 
-    yaml_emitter_set_canonical(&emitter, canonical);
-    yaml_emitter_set_unicode(&emitter, unicode);
+    yaml_emitter_set_canonical(emitter, canonical);
+    yaml_emitter_set_unicode(emitter, unicode);
 
-    /* Create and emit the STREAM-START event. */
+    /* Start the stream. */
 
-    if (!yaml_emitter_open(&emitter))
+    if (!yaml_emitter_start(emitter))
         goto emitter_error;
 
     /* Create a output_document object. */
 
-    if (!yaml_document_initialize(&output_document, NULL, NULL, NULL, 0, 0))
+    if (!yaml_document_create(&output_document, NULL, NULL, 0, 0, 0))
         goto document_error;
 
     /* Create the root sequence. */
 
-    root = yaml_document_add_sequence(&output_document, NULL,
-            YAML_BLOCK_SEQUENCE_STYLE);
-    if (!root) goto document_error;
+    if (!yaml_document_add_sequence(&output_document, &root,
+                NULL, YAML_SEQ_TAG, YAML_BLOCK_SEQUENCE_STYLE))
+        goto document_error;
 
     /* Loop through the input events. */
 
@@ -115,7 +117,7 @@ main(int argc, char *argv[])
 
         /* Get the next event. */
 
-        if (!yaml_parser_parse(&parser, &input_event))
+        if (!yaml_parser_parse_event(parser, &input_event))
             goto parser_error;
 
         /* Check if this is the stream end. */
@@ -126,9 +128,9 @@ main(int argc, char *argv[])
 
         /* Create a mapping node and attach it to the root sequence. */
 
-        properties = yaml_document_add_mapping(&output_document, NULL,
-                YAML_BLOCK_MAPPING_STYLE);
-        if (!properties) goto document_error;
+        if (!yaml_document_add_mapping(&output_document, &properties,
+                    NULL, YAML_MAP_TAG, YAML_BLOCK_MAPPING_STYLE))
+            goto document_error;
         if (!yaml_document_append_sequence_item(&output_document,
                     root, properties)) goto document_error;
 
@@ -140,12 +142,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'STREAM-START'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "STREAM-START", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"STREAM-START", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -156,15 +162,20 @@ main(int argc, char *argv[])
                     yaml_encoding_t encoding
                         = input_event.data.stream_start.encoding;
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "encoding", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            (encoding == YAML_UTF8_ENCODING ? "utf-8" :
-                             encoding == YAML_UTF16LE_ENCODING ? "utf-16-le" :
-                             encoding == YAML_UTF16BE_ENCODING ? "utf-16-be" :
-                             "unknown"), -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"encoding", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
+                                (encoding == YAML_UTF8_ENCODING ? "utf-8" :
+                                 encoding == YAML_UTF16LE_ENCODING ? "utf-16-le" :
+                                 encoding == YAML_UTF16BE_ENCODING ? "utf-16-be" :
+                                 "unknown"),
+                                -1, YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -175,12 +186,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'STREAM-END'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "STREAM-END", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"STREAM-END", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -190,12 +205,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'DOCUMENT-START'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "DOCUMENT-START", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"DOCUMENT-START", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -209,89 +228,109 @@ main(int argc, char *argv[])
 
                     /* Add 'version': {}. */
                     
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "version", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    map = yaml_document_add_mapping(&output_document, NULL,
-                            YAML_FLOW_MAPPING_STYLE);
-                    if (!map) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"version", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_mapping(&output_document, &map,
+                                NULL, YAML_MAP_TAG, YAML_FLOW_MAPPING_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, map)) goto document_error;
 
                     /* Add 'major': <number>. */
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "major", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"major", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     sprintf(number, "%d", version->major);
-                    value = yaml_document_add_scalar(&output_document, YAML_INT_TAG,
-                        number, -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_INT_TAG,
+                                (yaml_char_t *)number, -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 map, key, value)) goto document_error;
 
                     /* Add 'minor': <number>. */
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "minor", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"minor", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     sprintf(number, "%d", version->minor);
-                    value = yaml_document_add_scalar(&output_document, YAML_INT_TAG,
-                        number, -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_INT_TAG,
+                                (yaml_char_t *)number, -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 map, key, value)) goto document_error;
                 }
 
                 /* Display the output_document tag directives. */
 
-                if (input_event.data.document_start.tag_directives.start
-                        != input_event.data.document_start.tag_directives.end)
+                if (input_event.data.document_start.tag_directives.length)
                 {
                     yaml_tag_directive_t *tag;
 
                     /* Add 'tags': []. */
                     
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "tags", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    seq = yaml_document_add_sequence(&output_document, NULL,
-                            YAML_BLOCK_SEQUENCE_STYLE);
-                    if (!seq) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tags", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_sequence(&output_document, &seq,
+                                NULL, YAML_SEQ_TAG, YAML_BLOCK_SEQUENCE_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, seq)) goto document_error;
 
-                    for (tag = input_event.data.document_start.tag_directives.start;
-                            tag != input_event.data.document_start.tag_directives.end;
+                    for (tag = input_event.data.document_start.tag_directives.list;
+                            tag != input_event.data.document_start.tag_directives.list
+                                + input_event.data.document_start.tag_directives.length;
                             tag ++)
                     {
                         /* Add {}. */
 
-                        map = yaml_document_add_mapping(&output_document, NULL,
-                                YAML_FLOW_MAPPING_STYLE);
-                        if (!map) goto document_error;
+                        if (!yaml_document_add_mapping(&output_document, &map,
+                                    NULL, YAML_MAP_TAG, YAML_FLOW_MAPPING_STYLE))
+                            goto document_error;
                         if (!yaml_document_append_sequence_item(&output_document,
                                     seq, map)) goto document_error;
 
                         /* Add 'handle': <handle>. */
 
-                        key = yaml_document_add_scalar(&output_document, NULL,
-                            "handle", -1, YAML_PLAIN_SCALAR_STYLE);
-                        if (!key) goto document_error;
-                        value = yaml_document_add_scalar(&output_document, NULL,
-                            tag->handle, -1, YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                        if (!value) goto document_error;
+                        if (!yaml_document_add_scalar(&output_document, &key,
+                                    NULL, YAML_STR_TAG,
+                                    (const yaml_char_t *)"handle", -1,
+                                    YAML_PLAIN_SCALAR_STYLE))
+                            goto document_error;
+                        if (!yaml_document_add_scalar(&output_document, &value,
+                                    NULL, YAML_STR_TAG,
+                                    tag->handle, -1,
+                                    YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                            goto document_error;
                         if (!yaml_document_append_mapping_pair(&output_document,
                                     map, key, value)) goto document_error;
 
                         /* Add 'prefix': <prefix>. */
 
-                        key = yaml_document_add_scalar(&output_document, NULL,
-                            "prefix", -1, YAML_PLAIN_SCALAR_STYLE);
-                        if (!key) goto document_error;
-                        value = yaml_document_add_scalar(&output_document, NULL,
-                            tag->prefix, -1, YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                        if (!value) goto document_error;
+                        if (!yaml_document_add_scalar(&output_document, &key,
+                                    NULL, YAML_STR_TAG,
+                                    (const yaml_char_t *)"prefix", -1,
+                                    YAML_PLAIN_SCALAR_STYLE))
+                            goto document_error;
+                        if (!yaml_document_add_scalar(&output_document, &value,
+                                    NULL, YAML_STR_TAG,
+                                    tag->prefix, -1,
+                                    YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                            goto document_error;
                         if (!yaml_document_append_mapping_pair(&output_document,
                                     map, key, value)) goto document_error;
                     }
@@ -299,13 +338,18 @@ main(int argc, char *argv[])
 
                 /* Add 'implicit': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "implicit", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.document_start.implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.document_start.is_implicit ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -315,24 +359,33 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'DOCUMENT-END'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "DOCUMENT-END", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"DOCUMENT-END", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
                 /* Add 'implicit': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "implicit", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.document_end.implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.document_end.is_implicit ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -342,24 +395,31 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'ALIAS'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "ALIAS", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"ALIAS", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
                 /* Add 'anchor': <anchor>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "anchor", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                        input_event.data.alias.anchor, -1,
-                        YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"anchor", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            input_event.data.alias.anchor, -1,
+                            YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -369,12 +429,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'SCALAR'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "SCALAR", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SCALAR", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -382,13 +446,16 @@ main(int argc, char *argv[])
 
                 if (input_event.data.scalar.anchor)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "anchor", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.scalar.anchor, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.scalar.anchor, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -397,27 +464,33 @@ main(int argc, char *argv[])
 
                 if (input_event.data.scalar.tag)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "tag", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.scalar.tag, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.scalar.tag, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
 
                 /* Add 'value': <value>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "value", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                        input_event.data.scalar.value,
-                        input_event.data.scalar.length,
-                        YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"value", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            input_event.data.scalar.value,
+                            input_event.data.scalar.length,
+                            YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -425,36 +498,48 @@ main(int argc, char *argv[])
 
                 /* Add 'implicit': {} */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "version", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                map = yaml_document_add_mapping(&output_document, NULL,
-                        YAML_FLOW_MAPPING_STYLE);
-                if (!map) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_mapping(&output_document, &map,
+                            NULL, YAML_MAP_TAG, YAML_FLOW_MAPPING_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, map)) goto document_error;
 
                 /* Add 'plain': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "plain", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.scalar.plain_implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"plain", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.scalar.is_plain_nonspecific ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             map, key, value)) goto document_error;
 
                 /* Add 'quoted': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "quoted", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.scalar.quoted_implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"quoted", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.scalar.is_quoted_nonspecific ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             map, key, value)) goto document_error;
 
@@ -466,19 +551,24 @@ main(int argc, char *argv[])
 
                     /* Add 'style': <style>. */
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "style", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            (style == YAML_PLAIN_SCALAR_STYLE ? "plain" :
-                             style == YAML_SINGLE_QUOTED_SCALAR_STYLE ?
-                                    "single-quoted" :
-                             style == YAML_DOUBLE_QUOTED_SCALAR_STYLE ?
-                                    "double-quoted" :
-                             style == YAML_LITERAL_SCALAR_STYLE ? "literal" :
-                             style == YAML_FOLDED_SCALAR_STYLE ? "folded" :
-                             "unknown"), -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
+                                (style == YAML_PLAIN_SCALAR_STYLE ? "plain" :
+                                 style == YAML_SINGLE_QUOTED_SCALAR_STYLE ?
+                                        "single-quoted" :
+                                 style == YAML_DOUBLE_QUOTED_SCALAR_STYLE ?
+                                        "double-quoted" :
+                                 style == YAML_LITERAL_SCALAR_STYLE ? "literal" :
+                                 style == YAML_FOLDED_SCALAR_STYLE ? "folded" :
+                                 "unknown"),
+                                -1, YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -489,12 +579,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'SEQUENCE-START'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "SEQUENCE-START", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SEQUENCE-START", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -502,13 +596,16 @@ main(int argc, char *argv[])
 
                 if (input_event.data.sequence_start.anchor)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "anchor", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.sequence_start.anchor, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.sequence_start.anchor, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -517,26 +614,34 @@ main(int argc, char *argv[])
 
                 if (input_event.data.sequence_start.tag)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "tag", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.sequence_start.tag, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.sequence_start.tag, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
 
                 /* Add 'implicit': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "implicit", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.sequence_start.implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.sequence_start.is_nonspecific ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -549,14 +654,19 @@ main(int argc, char *argv[])
 
                     /* Add 'style': <style>. */
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "style", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            (style == YAML_BLOCK_SEQUENCE_STYLE ? "block" :
-                             style == YAML_FLOW_SEQUENCE_STYLE ? "flow" :
-                             "unknown"), -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
+                                (style == YAML_BLOCK_SEQUENCE_STYLE ? "block" :
+                                 style == YAML_FLOW_SEQUENCE_STYLE ? "flow" :
+                                 "unknown"),
+                                -1, YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -567,12 +677,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'SEQUENCE-END'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "SEQUENCE-END", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SEQUENCE-END", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -582,12 +696,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'MAPPING-START'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "MAPPING-START", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"MAPPING-START", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -595,13 +713,16 @@ main(int argc, char *argv[])
 
                 if (input_event.data.mapping_start.anchor)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "anchor", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.mapping_start.anchor, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.mapping_start.anchor, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -610,46 +731,59 @@ main(int argc, char *argv[])
 
                 if (input_event.data.mapping_start.tag)
                 {
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "tag", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            input_event.data.mapping_start.tag, -1,
-                            YAML_DOUBLE_QUOTED_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                input_event.data.mapping_start.tag, -1,
+                                YAML_DOUBLE_QUOTED_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
 
                 /* Add 'implicit': <flag>. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "implicit", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, YAML_BOOL_TAG,
-                        (input_event.data.mapping_start.implicit ?
-                         "true" : "false"), -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.mapping_start.is_nonspecific ?
+                             "true" : "false"),
+                            -1, YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
                 /* Display the style information. */
 
-                if (input_event.data.sequence_start.style)
+                if (input_event.data.mapping_start.style)
                 {
-                    yaml_sequence_style_t style
+                    yaml_mapping_style_t style
                         = input_event.data.mapping_start.style;
 
                     /* Add 'style': <style>. */
 
-                    key = yaml_document_add_scalar(&output_document, NULL,
-                        "style", -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!key) goto document_error;
-                    value = yaml_document_add_scalar(&output_document, NULL,
-                            (style == YAML_BLOCK_MAPPING_STYLE ? "block" :
-                             style == YAML_FLOW_MAPPING_STYLE ? "flow" :
-                             "unknown"), -1, YAML_PLAIN_SCALAR_STYLE);
-                    if (!value) goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &key,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
+                                YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
+                    if (!yaml_document_add_scalar(&output_document, &value,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
+                                (style == YAML_BLOCK_MAPPING_STYLE ? "block" :
+                                 style == YAML_FLOW_MAPPING_STYLE ? "flow" :
+                                 "unknown"),
+                                -1, YAML_PLAIN_SCALAR_STYLE))
+                        goto document_error;
                     if (!yaml_document_append_mapping_pair(&output_document,
                                 properties, key, value)) goto document_error;
                 }
@@ -660,12 +794,16 @@ main(int argc, char *argv[])
 
                 /* Add 'type': 'MAPPING-END'. */
 
-                key = yaml_document_add_scalar(&output_document, NULL,
-                    "type", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!key) goto document_error;
-                value = yaml_document_add_scalar(&output_document, NULL,
-                    "MAPPING-END", -1, YAML_PLAIN_SCALAR_STYLE);
-                if (!value) goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &key,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
+                if (!yaml_document_add_scalar(&output_document, &value,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"MAPPING-END", -1,
+                            YAML_PLAIN_SCALAR_STYLE))
+                    goto document_error;
                 if (!yaml_document_append_mapping_pair(&output_document,
                             properties, key, value)) goto document_error;
 
@@ -678,16 +816,18 @@ main(int argc, char *argv[])
 
         /* Delete the event object. */
 
-        yaml_event_delete(&input_event);
+        yaml_event_clear(&input_event);
     }
 
-    if (!yaml_emitter_dump(&emitter, &output_document))
+    /* Emit the document and end the stream. */
+
+    if (!yaml_emitter_emit_document(emitter, &output_document))
         goto emitter_error;
-    if (!yaml_emitter_close(&emitter))
+    if (!yaml_emitter_end(emitter) || !yaml_emitter_flush(emitter))
         goto emitter_error;
 
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 0;
 
@@ -695,63 +835,13 @@ parser_error:
 
     /* Display a parser error message. */
 
-    switch (parser.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for parsing\n");
-            break;
-
-        case YAML_READER_ERROR:
-            if (parser.problem_value != -1) {
-                fprintf(stderr, "Reader error: %s: #%X at %d\n", parser.problem,
-                        parser.problem_value, parser.problem_offset);
-            }
-            else {
-                fprintf(stderr, "Reader error: %s at %d\n", parser.problem,
-                        parser.problem_offset);
-            }
-            break;
-
-        case YAML_SCANNER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        case YAML_PARSER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_parser_get_error(parser), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_event_delete(&input_event);
-    yaml_document_delete(&output_document);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_document_clear(&output_document);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 
@@ -759,30 +849,13 @@ emitter_error:
 
     /* Display an emitter error message. */
 
-    switch (emitter.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for emitting\n");
-            break;
-
-        case YAML_WRITER_ERROR:
-            fprintf(stderr, "Writer error: %s\n", emitter.problem);
-            break;
-
-        case YAML_EMITTER_ERROR:
-            fprintf(stderr, "Emitter error: %s\n", emitter.problem);
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_emitter_get_error(emitter), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_event_delete(&input_event);
-    yaml_document_delete(&output_document);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_document_clear(&output_document);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 
@@ -790,11 +863,10 @@ document_error:
 
     fprintf(stderr, "Memory error: Not enough memory for creating a document\n");
 
-    yaml_event_delete(&input_event);
-    yaml_document_delete(&output_document);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_document_clear(&output_document);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 }
-
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 int
 main(int argc, char *argv[])
@@ -12,16 +13,15 @@ main(int argc, char *argv[])
     int unicode = 0;
     int k;
     int done = 0;
+    char message[256];
 
-    yaml_parser_t parser;
-    yaml_emitter_t emitter;
+    yaml_parser_t *parser = NULL;
+    yaml_emitter_t *emitter = NULL;
     yaml_event_t input_event;
     yaml_event_t output_event;
 
     /* Clear the objects. */
 
-    memset(&parser, 0, sizeof(parser));
-    memset(&emitter, 0, sizeof(emitter));
     memset(&input_event, 0, sizeof(input_event));
     memset(&output_event, 0, sizeof(output_event));
 
@@ -65,52 +65,54 @@ main(int argc, char *argv[])
         return 0;
     }
 
-    /* Initialize the parser and emitter objects. */
+    /* Create the parser and emitter objects. */
 
-    if (!yaml_parser_initialize(&parser)) {
-        fprintf(stderr, "Could not initialize the parser object\n");
+    parser = yaml_parser_new();
+    if (!parser) {
+        fprintf(stderr, "Memory error: Not enough memory for parsing\n");
         return 1;
     }
 
-    if (!yaml_emitter_initialize(&emitter)) {
-        yaml_parser_delete(&parser);
-        fprintf(stderr, "Could not inialize the emitter object\n");
+    emitter = yaml_emitter_new();
+    if (!emitter) {
+        fprintf(stderr, "Memory error: Not enough memory for emitting\n");
+        yaml_parser_delete(parser);
         return 1;
     }
 
     /* Set the parser parameters. */
 
-    yaml_parser_set_input_file(&parser, stdin);
+    yaml_parser_set_file_reader(parser, stdin);
 
     /* Set the emitter parameters. */
 
-    yaml_emitter_set_output_file(&emitter, stdout);
+    yaml_emitter_set_file_writer(emitter, stdout);
 
-    yaml_emitter_set_canonical(&emitter, canonical);
-    yaml_emitter_set_unicode(&emitter, unicode);
+    yaml_emitter_set_canonical(emitter, canonical);
+    yaml_emitter_set_unicode(emitter, unicode);
 
     /* Create and emit the STREAM-START event. */
 
-    if (!yaml_stream_start_event_initialize(&output_event, YAML_UTF8_ENCODING))
+    if (!yaml_event_create_stream_start(&output_event, YAML_UTF8_ENCODING))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
     /* Create and emit the DOCUMENT-START event. */
 
-    if (!yaml_document_start_event_initialize(&output_event,
-                NULL, NULL, NULL, 0))
+    if (!yaml_event_create_document_start(&output_event,
+                NULL, NULL, 0, 0))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
     /* Create and emit the SEQUENCE-START event. */
 
-    if (!yaml_sequence_start_event_initialize(&output_event,
-                NULL, "tag:yaml.org,2002:seq", 1,
+    if (!yaml_event_create_sequence_start(&output_event,
+                NULL, YAML_SEQ_TAG, 1,
                 YAML_BLOCK_SEQUENCE_STYLE))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
     /* Loop through the input events. */
@@ -119,7 +121,7 @@ main(int argc, char *argv[])
     {
         /* Get the next event. */
 
-        if (!yaml_parser_parse(&parser, &input_event))
+        if (!yaml_parser_parse_event(parser, &input_event))
             goto parser_error;
 
         /* Check if this is the stream end. */
@@ -130,11 +132,11 @@ main(int argc, char *argv[])
 
         /* Create and emit a MAPPING-START event. */
 
-        if (!yaml_mapping_start_event_initialize(&output_event,
-                    NULL, "tag:yaml.org,2002:map", 1,
+        if (!yaml_event_create_mapping_start(&output_event,
+                    NULL, YAML_MAP_TAG, 1,
                     YAML_BLOCK_MAPPING_STYLE))
             goto event_error;
-        if (!yaml_emitter_emit(&emitter, &output_event))
+        if (!yaml_emitter_emit_event(emitter, &output_event))
             goto emitter_error;
 
         /* Analyze the event. */
@@ -145,20 +147,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'STREAM-START'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "STREAM-START", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"STREAM-START", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display encoding information. */
@@ -170,24 +174,26 @@ main(int argc, char *argv[])
 
                     /* Write 'encoding'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "encoding", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"encoding", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the stream encoding. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
                                 (encoding == YAML_UTF8_ENCODING ? "utf-8" :
                                  encoding == YAML_UTF16LE_ENCODING ? "utf-16-le" :
                                  encoding == YAML_UTF16BE_ENCODING ? "utf-16-be" :
                                  "unknown"), -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -197,20 +203,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'STREAM-END'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "STREAM-END", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"STREAM-END", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -219,20 +227,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'DOCUMENT-START'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "DOCUMENT-START", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"DOCUMENT-START", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the document version numbers. */
@@ -245,178 +255,186 @@ main(int argc, char *argv[])
 
                     /* Write 'version'. */
                     
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "version", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"version", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write '{'. */
 
-                    if (!yaml_mapping_start_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:map", 1,
+                    if (!yaml_event_create_mapping_start(&output_event,
+                                NULL, YAML_MAP_TAG, 1,
                                 YAML_FLOW_MAPPING_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write 'major'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "major", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"major", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write a number. */
 
                     sprintf(number, "%d", version->major);
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:int", number, -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_INT_TAG, (yaml_char_t *)number, -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write 'minor'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "minor", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"minor", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write a number. */
 
                     sprintf(number, "%d", version->minor);
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:int", number, -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_INT_TAG, (yaml_char_t *)number, -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write '}'. */
 
-                    if (!yaml_mapping_end_event_initialize(&output_event))
+                    if (!yaml_event_create_mapping_end(&output_event))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
                 /* Display the document tag directives. */
 
-                if (input_event.data.document_start.tag_directives.start
-                        != input_event.data.document_start.tag_directives.end)
+                if (input_event.data.document_start.tag_directives.length)
                 {
                     yaml_tag_directive_t *tag;
 
                     /* Write 'tags'. */
                     
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "tags", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tags", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Start a block sequence. */
 
-                    if (!yaml_sequence_start_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:seq", 1,
+                    if (!yaml_event_create_sequence_start(&output_event,
+                                NULL, YAML_SEQ_TAG, 1,
                                 YAML_BLOCK_SEQUENCE_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
-                    for (tag = input_event.data.document_start.tag_directives.start;
-                            tag != input_event.data.document_start.tag_directives.end;
+                    for (tag = input_event.data.document_start.tag_directives.list;
+                            tag != input_event.data.document_start.tag_directives.list
+                                + input_event.data.document_start.tag_directives.length;
                             tag ++)
                     {
                         /* Write '{'. */
 
-                        if (!yaml_mapping_start_event_initialize(&output_event,
-                                    NULL, "tag:yaml.org,2002:map", 1,
+                        if (!yaml_event_create_mapping_start(&output_event,
+                                    NULL, YAML_MAP_TAG, 1,
                                     YAML_FLOW_MAPPING_STYLE))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
 
                         /* Write 'handle'. */
 
-                        if (!yaml_scalar_event_initialize(&output_event,
-                                    NULL, "tag:yaml.org,2002:str", "handle", -1,
+                        if (!yaml_event_create_scalar(&output_event,
+                                    NULL, YAML_STR_TAG,
+                                    (const yaml_char_t *)"handle", -1,
                                     1, 1, YAML_PLAIN_SCALAR_STYLE))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
 
                         /* Write the tag directive handle. */
 
-                        if (!yaml_scalar_event_initialize(&output_event,
-                                    NULL, "tag:yaml.org,2002:str",
+                        if (!yaml_event_create_scalar(&output_event,
+                                    NULL, YAML_STR_TAG,
                                     tag->handle, -1,
                                     0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
 
                         /* Write 'prefix'. */
 
-                        if (!yaml_scalar_event_initialize(&output_event,
-                                    NULL, "tag:yaml.org,2002:str", "prefix", -1,
+                        if (!yaml_event_create_scalar(&output_event,
+                                    NULL, YAML_STR_TAG,
+                                    (const yaml_char_t *)"prefix", -1,
                                     1, 1, YAML_PLAIN_SCALAR_STYLE))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
 
                         /* Write the tag directive prefix. */
 
-                        if (!yaml_scalar_event_initialize(&output_event,
-                                    NULL, "tag:yaml.org,2002:str",
+                        if (!yaml_event_create_scalar(&output_event,
+                                    NULL, YAML_STR_TAG,
                                     tag->prefix, -1,
                                     0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
 
                         /* Write '}'. */
 
-                        if (!yaml_mapping_end_event_initialize(&output_event))
+                        if (!yaml_event_create_mapping_end(&output_event))
                             goto event_error;
-                        if (!yaml_emitter_emit(&emitter, &output_event))
+                        if (!yaml_emitter_emit_event(emitter, &output_event))
                             goto emitter_error;
                     }
 
                     /* End a block sequence. */
 
-                    if (!yaml_sequence_end_event_initialize(&output_event))
+                    if (!yaml_event_create_sequence_end(&output_event))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
                 /* Write 'implicit'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "implicit", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the document is implicit. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.document_start.implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.document_start.is_implicit ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -425,40 +443,44 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'DOCUMENT-END'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "DOCUMENT-END", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"DOCUMENT-END", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'implicit'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "implicit", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the document is implicit. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.document_end.implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.document_end.is_implicit ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -467,39 +489,42 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'ALIAS'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "ALIAS", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"ALIAS", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'anchor'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "anchor", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"anchor", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write the alias anchor. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str",
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
                             input_event.data.alias.anchor, -1,
                             0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -508,20 +533,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'SCALAR'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "SCALAR", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SCALAR", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the scalar anchor. */
@@ -530,21 +557,22 @@ main(int argc, char *argv[])
                 {
                     /* Write 'anchor'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "anchor", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the scalar anchor. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.scalar.anchor, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -554,21 +582,22 @@ main(int argc, char *argv[])
                 {
                     /* Write 'tag'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "tag", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the scalar tag. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.scalar.tag, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -576,89 +605,95 @@ main(int argc, char *argv[])
 
                 /* Write 'value'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "value", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"value", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write the scalar value. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str",
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
                             input_event.data.scalar.value,
                             input_event.data.scalar.length,
                             0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display if the scalar tag is implicit. */
 
                 /* Write 'implicit'. */
                 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "implicit", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write '{'. */
 
-                if (!yaml_mapping_start_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:map", 1,
+                if (!yaml_event_create_mapping_start(&output_event,
+                            NULL, YAML_MAP_TAG, 1,
                             YAML_FLOW_MAPPING_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'plain'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "plain", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"plain", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the scalar is implicit in the plain style. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.scalar.plain_implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.scalar.is_plain_nonspecific ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'quoted'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "non-plain", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"non-plain", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the scalar is implicit in a non-plain style. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.scalar.quoted_implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.scalar.is_quoted_nonspecific ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write '}'. */
 
-                if (!yaml_mapping_end_event_initialize(&output_event))
+                if (!yaml_event_create_mapping_end(&output_event))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the style information. */
@@ -669,17 +704,19 @@ main(int argc, char *argv[])
 
                     /* Write 'style'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "style", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the scalar style. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
                                 (style == YAML_PLAIN_SCALAR_STYLE ? "plain" :
                                  style == YAML_SINGLE_QUOTED_SCALAR_STYLE ?
                                         "single-quoted" :
@@ -690,7 +727,7 @@ main(int argc, char *argv[])
                                  "unknown"), -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -700,20 +737,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'SEQUENCE-START'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "SEQUENCE-START", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SEQUENCE-START", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the sequence anchor. */
@@ -722,21 +761,22 @@ main(int argc, char *argv[])
                 {
                     /* Write 'anchor'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "anchor", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the sequence anchor. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.sequence_start.anchor, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -746,42 +786,45 @@ main(int argc, char *argv[])
                 {
                     /* Write 'tag'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "tag", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the sequence tag. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.sequence_start.tag, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
                 /* Write 'implicit'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "implicit", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the sequence tag is implicit. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.sequence_start.implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.sequence_start.is_nonspecific ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the style information. */
@@ -793,23 +836,25 @@ main(int argc, char *argv[])
 
                     /* Write 'style'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "style", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the scalar style. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
                                 (style == YAML_BLOCK_SEQUENCE_STYLE ? "block" :
                                  style == YAML_FLOW_SEQUENCE_STYLE ? "flow" :
                                  "unknown"), -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -819,20 +864,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'SEQUENCE-END'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "SEQUENCE-END", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"SEQUENCE-END", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -841,20 +888,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'MAPPING-START'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "MAPPING-START", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"MAPPING-START", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the mapping anchor. */
@@ -863,21 +912,22 @@ main(int argc, char *argv[])
                 {
                     /* Write 'anchor'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "anchor", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"anchor", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the mapping anchor. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.mapping_start.anchor, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -887,42 +937,45 @@ main(int argc, char *argv[])
                 {
                     /* Write 'tag'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "tag", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"tag", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the mapping tag. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
                                 input_event.data.mapping_start.tag, -1,
                                 0, 1, YAML_DOUBLE_QUOTED_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
                 /* Write 'implicit'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "implicit", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"implicit", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write if the mapping tag is implicit. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:bool",
-                            (input_event.data.mapping_start.implicit ?
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_BOOL_TAG,
+                            (const yaml_char_t *)
+                            (input_event.data.mapping_start.is_nonspecific ?
                              "true" : "false"), -1,
                             1, 0, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Display the style information. */
@@ -934,23 +987,25 @@ main(int argc, char *argv[])
 
                     /* Write 'style'. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str", "style", -1,
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)"style", -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
 
                     /* Write the scalar style. */
 
-                    if (!yaml_scalar_event_initialize(&output_event,
-                                NULL, "tag:yaml.org,2002:str",
+                    if (!yaml_event_create_scalar(&output_event,
+                                NULL, YAML_STR_TAG,
+                                (const yaml_char_t *)
                                 (style == YAML_BLOCK_MAPPING_STYLE ? "block" :
                                  style == YAML_FLOW_MAPPING_STYLE ? "flow" :
                                  "unknown"), -1,
                                 1, 1, YAML_PLAIN_SCALAR_STYLE))
                         goto event_error;
-                    if (!yaml_emitter_emit(&emitter, &output_event))
+                    if (!yaml_emitter_emit_event(emitter, &output_event))
                         goto emitter_error;
                 }
 
@@ -960,20 +1015,22 @@ main(int argc, char *argv[])
 
                 /* Write 'type'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "type", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"type", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 /* Write 'MAPPING-END'. */
 
-                if (!yaml_scalar_event_initialize(&output_event,
-                            NULL, "tag:yaml.org,2002:str", "MAPPING-END", -1,
+                if (!yaml_event_create_scalar(&output_event,
+                            NULL, YAML_STR_TAG,
+                            (const yaml_char_t *)"MAPPING-END", -1,
                             1, 1, YAML_PLAIN_SCALAR_STYLE))
                     goto event_error;
-                if (!yaml_emitter_emit(&emitter, &output_event))
+                if (!yaml_emitter_emit_event(emitter, &output_event))
                     goto emitter_error;
 
                 break;
@@ -985,39 +1042,42 @@ main(int argc, char *argv[])
 
         /* Delete the event object. */
 
-        yaml_event_delete(&input_event);
+        yaml_event_clear(&input_event);
 
         /* Create and emit a MAPPING-END event. */
 
-        if (!yaml_mapping_end_event_initialize(&output_event))
+        if (!yaml_event_create_mapping_end(&output_event))
             goto event_error;
-        if (!yaml_emitter_emit(&emitter, &output_event))
+        if (!yaml_emitter_emit_event(emitter, &output_event))
             goto emitter_error;
     }
 
     /* Create and emit the SEQUENCE-END event. */
 
-    if (!yaml_sequence_end_event_initialize(&output_event))
+    if (!yaml_event_create_sequence_end(&output_event))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
     /* Create and emit the DOCUMENT-END event. */
 
-    if (!yaml_document_end_event_initialize(&output_event, 0))
+    if (!yaml_event_create_document_end(&output_event, 0))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
     /* Create and emit the STREAM-END event. */
 
-    if (!yaml_stream_end_event_initialize(&output_event))
+    if (!yaml_event_create_stream_end(&output_event))
         goto event_error;
-    if (!yaml_emitter_emit(&emitter, &output_event))
+    if (!yaml_emitter_emit_event(emitter, &output_event))
         goto emitter_error;
 
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    if (!yaml_emitter_flush(emitter))
+        goto emitter_error;
+
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 0;
 
@@ -1025,63 +1085,13 @@ parser_error:
 
     /* Display a parser error message. */
 
-    switch (parser.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for parsing\n");
-            break;
-
-        case YAML_READER_ERROR:
-            if (parser.problem_value != -1) {
-                fprintf(stderr, "Reader error: %s: #%X at %d\n", parser.problem,
-                        parser.problem_value, parser.problem_offset);
-            }
-            else {
-                fprintf(stderr, "Reader error: %s at %d\n", parser.problem,
-                        parser.problem_offset);
-            }
-            break;
-
-        case YAML_SCANNER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        case YAML_PARSER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_parser_get_error(parser), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_event_delete(&input_event);
-    yaml_event_delete(&output_event);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_event_clear(&output_event);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 
@@ -1089,30 +1099,13 @@ emitter_error:
 
     /* Display an emitter error message. */
 
-    switch (emitter.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for emitting\n");
-            break;
-
-        case YAML_WRITER_ERROR:
-            fprintf(stderr, "Writer error: %s\n", emitter.problem);
-            break;
-
-        case YAML_EMITTER_ERROR:
-            fprintf(stderr, "Emitter error: %s\n", emitter.problem);
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_emitter_get_error(emitter), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_event_delete(&input_event);
-    yaml_event_delete(&output_event);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_event_clear(&output_event);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 
@@ -1120,11 +1113,10 @@ event_error:
 
     fprintf(stderr, "Memory error: Not enough memory for creating an event\n");
 
-    yaml_event_delete(&input_event);
-    yaml_event_delete(&output_event);
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_event_clear(&input_event);
+    yaml_event_clear(&output_event);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 }
-
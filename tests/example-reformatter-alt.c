@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 int
 main(int argc, char *argv[])
@@ -12,15 +13,14 @@ main(int argc, char *argv[])
     int unicode = 0;
     int k;
     int done = 0;
+    char message[256];
 
-    yaml_parser_t parser;
-    yaml_emitter_t emitter;
+    yaml_parser_t *parser = NULL;
+    yaml_emitter_t *emitter = NULL;
     yaml_document_t document;
 
     /* Clear the objects. */
 
-    memset(&parser, 0, sizeof(parser));
-    memset(&emitter, 0, sizeof(emitter));
     memset(&document, 0, sizeof(document));
 
     /* Analyze command line options. */
@@ -63,48 +63,65 @@ main(int argc, char *argv[])
         return 0;
     }
 
-    /* Initialize the parser and emitter objects. */
+    /* Create the parser and emitter objects. */
 
-    if (!yaml_parser_initialize(&parser))
-        goto parser_error;
+    parser = yaml_parser_new();
+    if (!parser) {
+        fprintf(stderr, "Memory error: Not enough memory for parsing\n");
+        return 1;
+    }
 
-    if (!yaml_emitter_initialize(&emitter))
-        goto emitter_error;
+    emitter = yaml_emitter_new();
+    if (!emitter) {
+        fprintf(stderr, "Memory error: Not enough memory for emitting\n");
+        yaml_parser_delete(parser);
+        return 1;
+    }
 
     /* Set the parser parameters. */
 
-    yaml_parser_set_input_file(&parser, stdin);
+    yaml_parser_set_file_reader(parser, stdin);
 
     /* Set the emitter parameters. */
 
-    yaml_emitter_set_output_file(&emitter, stdout);
+    yaml_emitter_set_file_writer(emitter, stdout);
+
+    yaml_emitter_set_canonical(emitter, canonical);
+    yaml_emitter_set_unicode(emitter, unicode);
 
-    yaml_emitter_set_canonical(&emitter, canonical);
-    yaml_emitter_set_unicode(&emitter, unicode);
+    /* Start the stream. */
+
+    if (!yaml_emitter_start(emitter))
+        goto emitter_error;
 
     /* The main loop. */
 
     while (!done)
     {
-        /* Get the next event. */
+        /* Get the next document. */
 
-        if (!yaml_parser_load(&parser, &document))
+        if (!yaml_parser_parse_document(parser, &document))
             goto parser_error;
 
         /* Check if this is the stream end. */
 
-        if (!yaml_document_get_root_node(&document)) {
+        if (!document.type) {
             done = 1;
         }
 
-        /* Emit the event. */
+        /* Emit the document. */
 
-        if (!yaml_emitter_dump(&emitter, &document))
+        else if (!yaml_emitter_emit_document(emitter, &document))
             goto emitter_error;
     }
 
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    /* End the stream. */
+
+    if (!yaml_emitter_end(emitter) || !yaml_emitter_flush(emitter))
+        goto emitter_error;
+
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 0;
 
@@ -112,76 +129,11 @@ parser_error:
 
     /* Display a parser error message. */
 
-    switch (parser.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for parsing\n");
-            break;
-
-        case YAML_READER_ERROR:
-            if (parser.problem_value != -1) {
-                fprintf(stderr, "Reader error: %s: #%X at %d\n", parser.problem,
-                        parser.problem_value, parser.problem_offset);
-            }
-            else {
-                fprintf(stderr, "Reader error: %s at %d\n", parser.problem,
-                        parser.problem_offset);
-            }
-            break;
-
-        case YAML_SCANNER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Scanner error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        case YAML_PARSER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Parser error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        case YAML_COMPOSER_ERROR:
-            if (parser.context) {
-                fprintf(stderr, "Composer error: %s at line %d, column %d\n"
-                        "%s at line %d, column %d\n", parser.context,
-                        parser.context_mark.line+1, parser.context_mark.column+1,
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            else {
-                fprintf(stderr, "Composer error: %s at line %d, column %d\n",
-                        parser.problem, parser.problem_mark.line+1,
-                        parser.problem_mark.column+1);
-            }
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_parser_get_error(parser), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 
@@ -189,29 +141,11 @@ emitter_error:
 
     /* Display an emitter error message. */
 
-    switch (emitter.error)
-    {
-        case YAML_MEMORY_ERROR:
-            fprintf(stderr, "Memory error: Not enough memory for emitting\n");
-            break;
-
-        case YAML_WRITER_ERROR:
-            fprintf(stderr, "Writer error: %s\n", emitter.problem);
-            break;
-
-        case YAML_EMITTER_ERROR:
-            fprintf(stderr, "Emitter error: %s\n", emitter.problem);
-            break;
-
-        default:
-            /* Couldn't happen. */
-            fprintf(stderr, "Internal error\n");
-            break;
-    }
+    yaml_error_message(yaml_emitter_get_error(emitter), message, sizeof(message));
+    fprintf(stderr, "%s\n", message);
 
-    yaml_parser_delete(&parser);
-    yaml_emitter_delete(&emitter);
+    yaml_parser_delete(parser);
+    yaml_emitter_delete(emitter);
 
     return 1;
 }
-
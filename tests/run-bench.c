@@ -0,0 +1,865 @@
+#include <yaml.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define HAVE_GETRUSAGE  1
+#define HAVE_FORK       1
+#endif
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+/*
+ * A benchmark of the pipeline stages on a generated corpus.
+ *
+ * The corpus is generated from a fixed seed, so that the numbers of different
+ * builds and releases could be compared.  The results are printed as
+ * tab-separated lines, one per corpus and stage, after a header line.  Each
+ * stage runs in a child process if the platform has `fork()`, so the peak RSS
+ * is the peak of the stage plus the corpus.  Otherwise it is the peak of the
+ * whole process so far; run a single corpus and stage with `-c` and `-S` to
+ * get the peak of one stage.
+ */
+
+typedef struct buffer_s {
+    unsigned char *start;
+    size_t length;
+    size_t capacity;
+} buffer_t;
+
+typedef int generator_t(buffer_t *buffer, size_t size);
+
+typedef int stage_t(const unsigned char *input, size_t length,
+        double *seconds, size_t *items);
+
+typedef struct result_s {
+    int is_done;
+    int repeats;
+    double seconds;
+    size_t items;
+    long peak_rss;
+} result_t;
+
+static unsigned long seed;
+
+static yaml_json_mode_t json_mode = YAML_AUTO_JSON_MODE;
+
+static unsigned long
+next_random(unsigned long range)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return ((seed >> 16) & 0x7FFF) % range;
+}
+
+static double
+get_clock(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static long
+get_peak_rss(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Corpus generators.
+ */
+
+static void
+reserve(buffer_t *buffer, size_t length)
+{
+    if (buffer->length + length < buffer->capacity)
+        return;
+
+    buffer->capacity = buffer->capacity*2 + length + 1;
+    buffer->start = realloc(buffer->start, buffer->capacity);
+    assert(buffer->start);
+}
+
+static void
+append(buffer_t *buffer, const char *format, ...)
+{
+    va_list args;
+    int length;
+
+    while (1) {
+        va_start(args, format);
+        length = vsnprintf((char *)buffer->start + buffer->length,
+                buffer->capacity - buffer->length, format, args);
+        va_end(args);
+        assert(length >= 0);
+        if (buffer->length + length < buffer->capacity)
+            break;
+        reserve(buffer, length);
+    }
+
+    buffer->length += length;
+}
+
+static void
+append_utf16(buffer_t *buffer, unsigned long value)
+{
+    reserve(buffer, 4);
+
+    if (value >= 0x10000) {
+        unsigned long high = 0xD800 + ((value - 0x10000) >> 10);
+        buffer->start[buffer->length ++] = (unsigned char)(high & 0xFF);
+        buffer->start[buffer->length ++] = (unsigned char)(high >> 8);
+        value = 0xDC00 + ((value - 0x10000) & 0x3FF);
+    }
+
+    buffer->start[buffer->length ++] = (unsigned char)(value & 0xFF);
+    buffer->start[buffer->length ++] = (unsigned char)(value >> 8);
+}
+
+static void
+append_indent(buffer_t *buffer, int indent)
+{
+    append(buffer, "%*s", indent, "");
+}
+
+static int
+generate_flat(buffer_t *buffer, size_t size)
+{
+    int idx = 0;
+
+    while (buffer->length < size) {
+        append(buffer, "key_%d: value %lu\n", idx ++, next_random(1000000));
+    }
+
+    return 1;
+}
+
+static int
+generate_deep(buffer_t *buffer, size_t size)
+{
+    int depth = 64;
+
+    int idx = 0;
+
+    while (buffer->length < size) {
+        int level;
+        for (level = 0; level < depth; level ++) {
+            append_indent(buffer, level*2);
+            append(buffer, "%s_%d_%d:\n", (level % 2 ? "outer" : "inner"),
+                    level, idx);
+        }
+        append_indent(buffer, depth*2);
+        append(buffer, "- [leaf, %lu, {a: b}]\n", next_random(100));
+        append_indent(buffer, depth*2);
+        append(buffer, "- last\n");
+        idx ++;
+    }
+
+    return 1;
+}
+
+static int
+generate_deepflow(buffer_t *buffer, size_t size)
+{
+    int depth = 512;
+
+    while (buffer->length < size) {
+        int level;
+        append(buffer, "- ");
+        for (level = 0; level < depth; level ++) {
+            append(buffer, "%s", (level % 2 ? "[\n" : "{\"level\": "));
+        }
+        append(buffer, "%lu\n", next_random(100));
+        for (level = depth-1; level >= 0; level --) {
+            append(buffer, "%s", (level % 2 ? "]\n" : "}"));
+        }
+        append(buffer, "\n");
+    }
+
+    return 1;
+}
+
+static int
+generate_json(buffer_t *buffer, size_t size)
+{
+    static const char *names[] = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot",
+        "golf", "hotel", "india", "juliett", "kilo", "lima"
+    };
+    int idx = 0;
+
+    append(buffer, "[\n");
+    while (buffer->length < size) {
+        append(buffer, "  {\"id\": %d, \"name\": \"%s %s\", \"active\": %s, "
+                "\"score\": %lu.%02lu, \"note\": %s,\n",
+                idx, names[next_random(12)], names[next_random(12)],
+                (next_random(2) ? "true" : "false"),
+                next_random(1000), next_random(100),
+                (next_random(4) ? "null" : "\"caf\\u00e9\\n\""));
+        append(buffer, "   \"tags\": [\"%s\", \"%s\"], "
+                "\"location\": {\"lat\": -%lu.%04lu, \"lon\": %lue-3}}",
+                names[next_random(12)], names[next_random(12)],
+                next_random(90), next_random(10000), next_random(180000));
+        append(buffer, "%s\n", (buffer->length < size ? "," : ""));
+        idx ++;
+    }
+    append(buffer, "]\n");
+
+    return 1;
+}
+
+static int
+generate_long(buffer_t *buffer, size_t size)
+{
+    static const char *words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+        "adipiscing", "elit", "sed", "do", "eiusmod", "tempor"
+    };
+    int idx = 0;
+
+    while (buffer->length < size) {
+        size_t end = buffer->length + 65536;
+        switch (idx % 3) {
+            case 0:
+                append(buffer, "literal_%d: |\n", idx);
+                while (buffer->length < end) {
+                    int column = 0;
+                    append(buffer, "  ");
+                    while (column < 70) {
+                        const char *word = words[next_random(12)];
+                        append(buffer, "%s ", word);
+                        column += strlen(word) + 1;
+                    }
+                    append(buffer, "\n");
+                }
+                break;
+            case 1:
+                append(buffer, "quoted_%d: \"", idx);
+                while (buffer->length < end) {
+                    append(buffer, "%s%s", words[next_random(12)],
+                            (next_random(8) ? " " : "\\t\\u00e9 "));
+                }
+                append(buffer, "\"\n");
+                break;
+            case 2:
+                append(buffer, "plain_%d:\n  ", idx);
+                while (buffer->length < end) {
+                    append(buffer, "%s%s", words[next_random(12)],
+                            (next_random(10) ? " " : "\n  "));
+                }
+                append(buffer, "end\n");
+                break;
+        }
+        idx ++;
+    }
+
+    return 1;
+}
+
+static int
+generate_anchors(buffer_t *buffer, size_t size)
+{
+    int idx = 0;
+
+    while (buffer->length < size) {
+        append(buffer, "- &node_%d {name: item %d, tags: [x, y, z]}\n",
+                idx, idx);
+        append(buffer, "- *node_%lu\n", next_random(idx+1));
+        append(buffer, "- {first: *node_%lu, second: *node_%lu}\n",
+                next_random(idx+1), next_random(idx+1));
+        idx ++;
+    }
+
+    return 1;
+}
+
+static int
+generate_multi(buffer_t *buffer, size_t size)
+{
+    int idx = 0;
+
+    while (buffer->length < size) {
+        append(buffer, "--- # document %d\n", idx);
+        append(buffer, "id: %d\nname: doc-%lu\nvalues: [%lu, %lu, %lu]\n",
+                idx, next_random(10000), next_random(100),
+                next_random(100), next_random(100));
+        append(buffer, "nested:\n  enabled: %s\n  ratio: 0.%lu\n",
+                (next_random(2) ? "true" : "false"), next_random(1000));
+        if (idx % 4 == 3) {
+            append(buffer, "...\n");
+        }
+        idx ++;
+    }
+
+    return 1;
+}
+
+static int
+generate_utf16(buffer_t *buffer, size_t size)
+{
+    buffer_t text = { NULL, 0, 0 };
+    size_t idx;
+    int key = 0;
+
+    /* Generate UTF-8 lines and convert them to UTF-16LE after a BOM. */
+
+    append_utf16(buffer, 0xFEFF);
+
+    while (buffer->length < size)
+    {
+        text.length = 0;
+        append(&text, "\xd0\xba\xd0\xbb\xd1\x8e\xd1\x87_%d: "
+                "\xe5\x80\xa4 %lu \xc3\xa9t\xc3\xa9 \xf0\x9f\x98\x80\n",
+                key ++, next_random(1000000));
+
+        for (idx = 0; idx < text.length; )
+        {
+            unsigned char octet = text.start[idx];
+            int width = (octet & 0x80) == 0x00 ? 1 :
+                        (octet & 0xE0) == 0xC0 ? 2 :
+                        (octet & 0xF0) == 0xE0 ? 3 : 4;
+            unsigned long value = (width == 1 ? octet :
+                    width == 2 ? octet & 0x1F :
+                    width == 3 ? octet & 0x0F : octet & 0x07);
+            int k;
+
+            for (k = 1; k < width; k ++) {
+                value = (value << 6) + (text.start[idx+k] & 0x3F);
+            }
+            idx += width;
+
+            append_utf16(buffer, value);
+        }
+    }
+
+    free(text.start);
+
+    return 1;
+}
+
+/*
+ * Pipeline stages.
+ */
+
+static void
+print_error(const char *stage, yaml_error_t *error)
+{
+    char message[256];
+
+    yaml_error_message(error, message, 256);
+    fprintf(stderr, "%s: %s\n", stage, message);
+}
+
+static int
+write_nothing(void *data, const unsigned char *buffer, size_t length)
+{
+    *(size_t *)data += length;
+
+    return 1;
+}
+
+static void
+forget_event(void *data, yaml_event_t *event)
+{
+    memset(event, 0, sizeof(yaml_event_t));
+}
+
+static int
+run_scanner(const unsigned char *input, size_t length,
+        double *seconds, size_t *items)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_token_t token;
+    double start = get_clock();
+
+    assert(parser);
+
+    yaml_parser_set_string_reader(parser, input, length);
+    yaml_parser_set_json_mode(parser, json_mode);
+
+    while (1) {
+        if (!yaml_parser_parse_token(parser, &token)) {
+            print_error("scanner", yaml_parser_get_error(parser));
+            yaml_parser_delete(parser);
+            return 0;
+        }
+        if (token.type == YAML_NO_TOKEN)
+            break;
+        yaml_parser_recycle_token(parser, &token);
+        (*items) ++;
+    }
+
+    *seconds += get_clock() - start;
+
+    yaml_parser_delete(parser);
+
+    return 1;
+}
+
+static int
+run_parser(const unsigned char *input, size_t length,
+        double *seconds, size_t *items)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_event_t event;
+    double start = get_clock();
+
+    assert(parser);
+
+    yaml_parser_set_string_reader(parser, input, length);
+    yaml_parser_set_json_mode(parser, json_mode);
+
+    while (1) {
+        if (!yaml_parser_parse_event(parser, &event)) {
+            print_error("parser", yaml_parser_get_error(parser));
+            yaml_parser_delete(parser);
+            return 0;
+        }
+        if (event.type == YAML_NO_EVENT)
+            break;
+        yaml_parser_recycle_event(parser, &event);
+        (*items) ++;
+    }
+
+    *seconds += get_clock() - start;
+
+    yaml_parser_delete(parser);
+
+    return 1;
+}
+
+static int
+run_loader(const unsigned char *input, size_t length,
+        double *seconds, size_t *items)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_document_t document;
+    double start = get_clock();
+
+    assert(parser);
+
+    memset(&document, 0, sizeof(yaml_document_t));
+    yaml_parser_set_string_reader(parser, input, length);
+    yaml_parser_set_json_mode(parser, json_mode);
+
+    while (1) {
+        if (!yaml_parser_parse_document(parser, &document)) {
+            print_error("loader", yaml_parser_get_error(parser));
+            yaml_parser_delete(parser);
+            return 0;
+        }
+        if (!document.type)
+            break;
+        *items += document.nodes.length;
+        yaml_document_clear(&document);
+    }
+
+    *seconds += get_clock() - start;
+
+    yaml_parser_delete(parser);
+
+    return 1;
+}
+
+static int
+run_emitter(const unsigned char *input, size_t length,
+        double *seconds, size_t *items)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_emitter_t *emitter = yaml_emitter_new();
+    struct {
+        yaml_event_t *list;
+        size_t length;
+        size_t capacity;
+    } events = { NULL, 0, 0 };
+    size_t written = 0;
+    size_t idx;
+    double start;
+    int failed = 0;
+
+    assert(parser);
+    assert(emitter);
+
+    /* Parse the events first, the emitter gets copies of them. */
+
+    yaml_parser_set_string_reader(parser, input, length);
+    yaml_parser_set_json_mode(parser, json_mode);
+
+    while (1) {
+        if (events.length == events.capacity) {
+            events.capacity = events.capacity*2 + 1024;
+            events.list = realloc(events.list,
+                    events.capacity*sizeof(yaml_event_t));
+            assert(events.list);
+        }
+        if (!yaml_parser_parse_event(parser, events.list + events.length)) {
+            print_error("emitter", yaml_parser_get_error(parser));
+            failed = 1;
+            break;
+        }
+        if (events.list[events.length].type == YAML_NO_EVENT)
+            break;
+        events.length ++;
+    }
+
+    yaml_emitter_set_writer(emitter, write_nothing, &written);
+    yaml_emitter_set_recycler(emitter, forget_event, NULL);
+
+    start = get_clock();
+
+    for (idx = 0; idx < events.length && !failed; idx ++) {
+        yaml_event_t event = events.list[idx];
+        if (!yaml_emitter_emit_event(emitter, &event)) {
+            print_error("emitter", yaml_emitter_get_error(emitter));
+            failed = 1;
+        }
+    }
+
+    if (!failed && !yaml_emitter_flush(emitter)) {
+        print_error("emitter", yaml_emitter_get_error(emitter));
+        failed = 1;
+    }
+
+    *seconds += get_clock() - start;
+    *items += events.length;
+
+    for (idx = 0; idx < events.length; idx ++) {
+        yaml_parser_recycle_event(parser, events.list + idx);
+    }
+    free(events.list);
+
+    yaml_emitter_delete(emitter);
+    yaml_parser_delete(parser);
+
+    return !failed;
+}
+
+static int
+run_dumper(const unsigned char *input, size_t length,
+        double *seconds, size_t *items)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_emitter_t *emitter = yaml_emitter_new();
+    struct {
+        yaml_document_t *list;
+        size_t length;
+        size_t capacity;
+    } documents = { NULL, 0, 0 };
+    size_t written = 0;
+    size_t idx;
+    double start;
+    int failed = 0;
+
+    assert(parser);
+    assert(emitter);
+
+    /* Load the documents first, the emitter clears them. */
+
+    yaml_parser_set_string_reader(parser, input, length);
+    yaml_parser_set_json_mode(parser, json_mode);
+
+    while (1) {
+        if (documents.length == documents.capacity) {
+            documents.capacity = documents.capacity*2 + 16;
+            documents.list = realloc(documents.list,
+                    documents.capacity*sizeof(yaml_document_t));
+            assert(documents.list);
+        }
+        memset(documents.list + documents.length, 0, sizeof(yaml_document_t));
+        if (!yaml_parser_parse_document(parser,
+                    documents.list + documents.length)) {
+            print_error("dumper", yaml_parser_get_error(parser));
+            failed = 1;
+            break;
+        }
+        if (!documents.list[documents.length].type)
+            break;
+        *items += documents.list[documents.length].nodes.length;
+        documents.length ++;
+    }
+
+    yaml_emitter_set_writer(emitter, write_nothing, &written);
+
+    start = get_clock();
+
+    if (!failed && !yaml_emitter_start(emitter))
+        failed = 1;
+
+    for (idx = 0; idx < documents.length && !failed; idx ++) {
+        if (!yaml_emitter_emit_document(emitter, documents.list + idx))
+            failed = 1;
+    }
+
+    if (!failed && (!yaml_emitter_end(emitter) || !yaml_emitter_flush(emitter)))
+        failed = 1;
+
+    *seconds += get_clock() - start;
+
+    if (failed && yaml_emitter_get_error(emitter)->type) {
+        print_error("dumper", yaml_emitter_get_error(emitter));
+    }
+
+    for (idx = 0; idx < documents.length; idx ++) {
+        yaml_document_clear(documents.list + idx);
+    }
+    free(documents.list);
+
+    yaml_emitter_delete(emitter);
+    yaml_parser_delete(parser);
+
+    return !failed;
+}
+
+/*
+ * The corpus and the stage tables.
+ */
+
+static struct {
+    const char *name;
+    generator_t *generator;
+} corpora[] = {
+    { "flat", generate_flat },
+    { "deep", generate_deep },
+    { "deepflow", generate_deepflow },
+    { "json", generate_json },
+    { "long", generate_long },
+    { "anchors", generate_anchors },
+    { "multi", generate_multi },
+    { "utf16", generate_utf16 },
+    { NULL, NULL }
+};
+
+static struct {
+    const char *name;
+    const char *unit;
+    stage_t *stage;
+} stages[] = {
+    { "scanner", "tokens", run_scanner },
+    { "parser", "events", run_parser },
+    { "loader", "nodes", run_loader },
+    { "emitter", "events", run_emitter },
+    { "dumper", "nodes", run_dumper },
+    { NULL, NULL, NULL }
+};
+
+/*
+ * Run a stage until it takes `min_time` seconds.
+ */
+
+static void
+run_repeats(int stage, const buffer_t *buffer, double min_time,
+        result_t *result)
+{
+    memset(result, 0, sizeof(result_t));
+
+    do {
+        if (!stages[stage].stage(buffer->start, buffer->length,
+                    &result->seconds, &result->items))
+            return;
+        result->repeats ++;
+    } while (result->seconds < min_time);
+
+    result->is_done = 1;
+    result->peak_rss = get_peak_rss();
+}
+
+/*
+ * Run a stage in a child process, so that its peak RSS is its own.
+ */
+
+static void
+run_stage(int stage, const buffer_t *buffer, double min_time,
+        result_t *result)
+{
+#if HAVE_FORK
+    int fds[2];
+    pid_t pid;
+    int status;
+
+    memset(result, 0, sizeof(result_t));
+
+    fflush(stdout);
+    if (pipe(fds))
+        return;
+
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        run_repeats(stage, buffer, min_time, result);
+        return;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        run_repeats(stage, buffer, min_time, result);
+        fflush(stdout);
+        _exit(write(fds[1], result, sizeof(result_t)) != sizeof(result_t));
+    }
+
+    close(fds[1]);
+    if (read(fds[0], result, sizeof(result_t)) != sizeof(result_t)) {
+        memset(result, 0, sizeof(result_t));
+    }
+    close(fds[0]);
+
+    if (waitpid(pid, &status, 0) != pid
+            || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        result->is_done = 0;
+    }
+#else
+    run_repeats(stage, buffer, min_time, result);
+#endif
+}
+
+static int
+generate(int corpus, size_t size, buffer_t *buffer)
+{
+    buffer->length = 0;
+    seed = 20061231UL + corpus;
+
+    return corpora[corpus].generator(buffer, size);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *corpus_name = NULL;
+    const char *stage_name = NULL;
+    const char *dump_name = NULL;
+    double min_time = 1.0;
+    size_t size = 4*1024*1024;
+    buffer_t buffer = { NULL, 0, 0 };
+    int failed = 0;
+    int corpus;
+    int idx;
+
+    for (idx = 1; idx < argc; idx ++)
+    {
+        if (strcmp(argv[idx], "-c") == 0 && idx+1 < argc) {
+            corpus_name = argv[++ idx];
+        }
+        else if (strcmp(argv[idx], "-S") == 0 && idx+1 < argc) {
+            stage_name = argv[++ idx];
+        }
+        else if (strcmp(argv[idx], "-s") == 0 && idx+1 < argc) {
+            size = (size_t)(atof(argv[++ idx])*1024*1024);
+        }
+        else if (strcmp(argv[idx], "-t") == 0 && idx+1 < argc) {
+            min_time = atof(argv[++ idx]);
+        }
+        else if (strcmp(argv[idx], "-g") == 0 && idx+1 < argc) {
+            dump_name = argv[++ idx];
+        }
+        else if (strcmp(argv[idx], "-j") == 0 && idx+1 < argc
+                && (strcmp(argv[idx+1], "auto") == 0
+                    || strcmp(argv[idx+1], "never") == 0
+                    || strcmp(argv[idx+1], "always") == 0)) {
+            idx ++;
+            json_mode = strcmp(argv[idx], "auto") == 0 ? YAML_AUTO_JSON_MODE
+                : strcmp(argv[idx], "never") == 0 ? YAML_NEVER_JSON_MODE
+                : YAML_ALWAYS_JSON_MODE;
+        }
+        else {
+            printf("Usage: %s [-c corpus] [-S stage] [-s megabytes] "
+                    "[-t seconds] [-g corpus]\n"
+                    "       [-j auto|never|always]\n\n", argv[0]);
+            printf("Runs the stages on the "
+                    "generated corpora and prints tab-separated results.\n");
+            printf("With -g, writes the corpus to the standard output.\n");
+            printf("With -j, sets the JSON mode of the parser.\n\n");
+            printf("Corpora:");
+            for (corpus = 0; corpora[corpus].name; corpus ++) {
+                printf(" %s", corpora[corpus].name);
+            }
+            printf("\nStages:");
+            for (corpus = 0; stages[corpus].name; corpus ++) {
+                printf(" %s", stages[corpus].name);
+            }
+            printf("\n");
+            return 0;
+        }
+    }
+
+    if (dump_name) {
+        for (corpus = 0; corpora[corpus].name; corpus ++) {
+            if (strcmp(corpora[corpus].name, dump_name) == 0)
+                break;
+        }
+        if (!corpora[corpus].name) {
+            fprintf(stderr, "unknown corpus: %s\n", dump_name);
+            return 1;
+        }
+        generate(corpus, size, &buffer);
+        fwrite(buffer.start, 1, buffer.length, stdout);
+        free(buffer.start);
+        return 0;
+    }
+
+    printf("corpus\tstage\tbytes\trepeats\tseconds\tMB/s"
+            "\titems\tunit\titems/s\tpeak_rss_kb\n");
+
+    for (corpus = 0; corpora[corpus].name; corpus ++)
+    {
+        int stage;
+
+        if (corpus_name && strcmp(corpora[corpus].name, corpus_name) != 0)
+            continue;
+
+        generate(corpus, size, &buffer);
+
+        for (stage = 0; stages[stage].name; stage ++)
+        {
+            result_t result;
+
+            if (stage_name && strcmp(stages[stage].name, stage_name) != 0)
+                continue;
+
+            run_stage(stage, &buffer, min_time, &result);
+
+            if (!result.is_done || !result.repeats) {
+                failed = 1;
+                continue;
+            }
+
+            if (result.seconds <= 0.0) {
+                result.seconds = 1e-9;
+            }
+
+            printf("%s\t%s\t%lu\t%d\t%.3f\t%.2f\t%lu\t%s\t%.0f\t%ld\n",
+                    corpora[corpus].name, stages[stage].name,
+                    (unsigned long)buffer.length, result.repeats,
+                    result.seconds, (double)buffer.length*result.repeats
+                    / (1024*1024) / result.seconds,
+                    (unsigned long)(result.items/result.repeats),
+                    stages[stage].unit, result.items / result.seconds,
+                    result.peak_rss);
+            fflush(stdout);
+        }
+    }
+
+    free(buffer.start);
+
+    return failed;
+}
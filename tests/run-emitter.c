@@ -73,11 +73,11 @@ int compare_events(const yaml_event_t *event, const yaml_event_t *model)
             model_value = model->data.scalar.value;
             event_length = event->data.scalar.length;
             model_length = model->data.scalar.length;
-            if (event->data.scalar.is_plain_implicit !=
-                    model->data.scalar.is_plain_implicit)
+            if (event->data.scalar.is_plain_nonspecific !=
+                    model->data.scalar.is_plain_nonspecific)
                 return 0;
-            if (event->data.scalar.is_quoted_implicit !=
-                    model->data.scalar.is_quoted_implicit)
+            if (event->data.scalar.is_quoted_nonspecific !=
+                    model->data.scalar.is_quoted_nonspecific)
                 return 0;
             break;
 
@@ -86,8 +86,8 @@ int compare_events(const yaml_event_t *event, const yaml_event_t *model)
             model_anchor = model->data.sequence_start.anchor;
             event_tag = event->data.sequence_start.tag;
             model_tag = model->data.sequence_start.tag;
-            if (event->data.sequence_start.is_implicit !=
-                    model->data.sequence_start.is_implicit)
+            if (event->data.sequence_start.is_nonspecific !=
+                    model->data.sequence_start.is_nonspecific)
                 return 0;
             break;
 
@@ -96,8 +96,8 @@ int compare_events(const yaml_event_t *event, const yaml_event_t *model)
             model_anchor = model->data.mapping_start.anchor;
             event_tag = event->data.mapping_start.tag;
             model_tag = model->data.mapping_start.tag;
-            if (event->data.mapping_start.is_implicit !=
-                    model->data.mapping_start.is_implicit)
+            if (event->data.mapping_start.is_nonspecific !=
+                    model->data.mapping_start.is_nonspecific)
                 return 0;
             break;
 
@@ -259,14 +259,14 @@ main(int argc, char *argv[])
                     break;
                 assert(compare_events(events+count, &event) ||
                         print_output(argv[idx], buffer, written, count));
-                yaml_event_destroy(&event);
+                yaml_event_clear(&event);
                 count ++;
             }
             yaml_parser_delete(parser);
         }
 
         while(event_number) {
-            yaml_event_destroy(events+(--event_number));
+            yaml_event_clear(events+(--event_number));
         }
 
         printf("PASSED (length: %d)\n", written);
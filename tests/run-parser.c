@@ -47,7 +47,7 @@ main(int argc, char *argv[])
             if (event.type == YAML_NO_EVENT)
                 break;
 
-            yaml_event_destroy(&event);
+            yaml_event_clear(&event);
 
             count ++;
         }
@@ -56,10 +56,8 @@ main(int argc, char *argv[])
             printf("SUCCESS (%d tokens)\n", count);
         }
         else {
-            yaml_error_t error;
             char message[256];
-            yaml_parser_get_error(parser, &error);
-            yaml_error_message(&error, message, 256);
+            yaml_error_message(yaml_parser_get_error(parser), message, 256);
             printf("FAILURE (%d events)\n -> %s\n", count, message);
         }
 
@@ -47,7 +47,7 @@ main(int argc, char *argv[])
             if (token.type == YAML_NO_TOKEN)
                 break;
 
-            yaml_token_destroy(&token);
+            yaml_token_clear(&token);
 
             count ++;
         }
@@ -56,10 +56,8 @@ main(int argc, char *argv[])
             printf("SUCCESS (%d tokens)\n", count);
         }
         else {
-            yaml_error_t error;
             char message[256];
-            yaml_parser_get_error(parser, &error);
-            yaml_error_message(&error, message, 256);
+            yaml_error_message(yaml_parser_get_error(parser), message, 256);
             printf("FAILURE (%d tokens)\n -> %s\n", count, message);
         }
 
@@ -0,0 +1,735 @@
+#include <yaml.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+/*
+ * The emitter is checked by emitting the events of a few documents with all
+ * kinds of writers, which should produce the same bytes, and by parsing the
+ * produced streams back.
+ */
+
+char *documents[] = {
+    "",
+    "scalar",
+    "- 'single'\n- \"double\\tquoted\"\n- |\n  literal\n  text\n- >\n  folded\n  text\n",
+    "%YAML 1.1\n%TAG !e! tag:example.com,2000:\n--- !e!foo bar\n...\n--- second\n",
+    "- a\n- &x b\n- *x\n- !!str c\n- ? complex\n  : key\n",
+    "key: value\nseq:\n- 1\n- 2\nmap: {a: b, c: [d, e]}\nempty:\nflow: []\n",
+    "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\\nf\"}}",
+    "{\"a\": -}",
+    "[-, ':', '#', 'a: b', ' lead', 'trail ', '', \"\\u00e9\\u2028\"]",
+    "'a very long scalar that is long enough to be folded by the emitter at the"
+        " default width of eighty characters, more or less'\n",
+    NULL
+};
+
+/*
+ * A growing output buffer.
+ */
+
+typedef struct {
+    unsigned char text[65536];
+    size_t length;
+} output_t;
+
+static void
+output_append(output_t *output, const void *text, size_t length)
+{
+    assert(output->length + length < sizeof(output->text));
+    memcpy(output->text + output->length, text, length);
+    output->length += length;
+    output->text[output->length] = '\0';
+}
+
+static void
+output_string(output_t *output, const char *text)
+{
+    output_append(output, text, strlen(text));
+}
+
+static int
+output_writer(void *data, const unsigned char *buffer, size_t length)
+{
+    output_append(data, buffer, length);
+    return 1;
+}
+
+static int
+output_vector_writer(void *data, const yaml_iovec_t *vectors, size_t count)
+{
+    size_t idx;
+
+    for (idx = 0; idx < count; idx ++) {
+        output_append(data, vectors[idx].buffer, vectors[idx].length);
+    }
+    return 1;
+}
+
+static int
+failing_writer(void *data, const unsigned char *buffer, size_t length)
+{
+    (void)data;
+    (void)buffer;
+    (void)length;
+    return 0;
+}
+
+/*
+ * Dump the events of a stream, ignoring the styles, which the emitter may
+ * change.  A plain scalar that cannot be written plain is emitted as
+ * `! 'value'`, so the `!` tag is dumped as plain.  A loose dump also ignores
+ * the anchor names and the scalar tags, which a document does not keep as is.
+ */
+
+static int
+dump_events(const unsigned char *text, size_t length, output_t *dump,
+        int is_loose)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    int done = 0;
+
+    assert(parser);
+    yaml_parser_set_string_reader(parser, text, length);
+    dump->length = 0;
+    dump->text[0] = '\0';
+
+    while (!done)
+    {
+        yaml_event_t event;
+        yaml_char_t *anchor = NULL;
+        yaml_char_t *tag = NULL;
+
+        if (!yaml_parser_parse_event(parser, &event)) {
+            yaml_parser_delete(parser);
+            return 0;
+        }
+
+        switch (event.type)
+        {
+            case YAML_STREAM_START_EVENT:
+                output_string(dump, "+STR");
+                break;
+            case YAML_STREAM_END_EVENT:
+                output_string(dump, "-STR");
+                done = 1;
+                break;
+            case YAML_DOCUMENT_START_EVENT:
+                output_string(dump, "+DOC");
+                if (event.data.document_start.version_directive)
+                    output_string(dump, " %YAML");
+                break;
+            case YAML_DOCUMENT_END_EVENT:
+                output_string(dump, "-DOC");
+                break;
+            case YAML_ALIAS_EVENT:
+                output_string(dump, "=ALI");
+                anchor = event.data.alias.anchor;
+                break;
+            case YAML_SCALAR_EVENT:
+                output_string(dump, "=VAL");
+                anchor = event.data.scalar.anchor;
+                tag = event.data.scalar.tag;
+                if ((event.data.scalar.is_plain_nonspecific
+                            && event.data.scalar.style
+                            == YAML_PLAIN_SCALAR_STYLE)
+                        || (tag && !strcmp((const char *)tag, "!"))) {
+                    if (!is_loose)
+                        output_string(dump, " plain");
+                    tag = NULL;
+                }
+                if (is_loose)
+                    tag = NULL;
+                output_string(dump, " '");
+                output_append(dump, event.data.scalar.value,
+                        event.data.scalar.length);
+                output_string(dump, "'");
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                output_string(dump, "+SEQ");
+                anchor = event.data.sequence_start.anchor;
+                tag = event.data.sequence_start.tag;
+                break;
+            case YAML_SEQUENCE_END_EVENT:
+                output_string(dump, "-SEQ");
+                break;
+            case YAML_MAPPING_START_EVENT:
+                output_string(dump, "+MAP");
+                anchor = event.data.mapping_start.anchor;
+                tag = event.data.mapping_start.tag;
+                break;
+            case YAML_MAPPING_END_EVENT:
+                output_string(dump, "-MAP");
+                break;
+            default:
+                assert(0);
+        }
+
+        if (anchor) {
+            output_string(dump, " &");
+            if (!is_loose)
+                output_string(dump, (const char *)anchor);
+        }
+        if (tag) {
+            output_string(dump, " <");
+            output_string(dump, (const char *)tag);
+            output_string(dump, ">");
+        }
+        output_string(dump, "\n");
+
+        yaml_event_clear(&event);
+    }
+
+    yaml_parser_delete(parser);
+    return 1;
+}
+
+/*
+ * Emitting modes.
+ */
+
+typedef enum {
+    STRING_WRITER,
+    WRITER,
+    VECTOR_WRITER,
+    FILE_WRITER,
+    FD_WRITER
+} writer_type_t;
+
+typedef struct {
+    char *title;
+    writer_type_t writer;
+    size_t buffer_size;
+    int is_recycled;
+    int is_zero_copy;
+} emit_mode_t;
+
+emit_mode_t modes[] = {
+    { "string writer", STRING_WRITER, 0, 0, 0 },
+    { "writer", WRITER, 0, 0, 0 },
+    { "writer, tiny buffer", WRITER, 1, 0, 0 },
+    { "vector writer", VECTOR_WRITER, 0, 0, 0 },
+    { "vector writer, tiny buffer", VECTOR_WRITER, 64, 1, 0 },
+    { "file writer", FILE_WRITER, 0, 1, 0 },
+    { "fd writer", FD_WRITER, 100, 0, 0 },
+    { "parser recycler", STRING_WRITER, 0, 1, 0 },
+    { "zero-copy", STRING_WRITER, 0, 0, 1 },
+    { "zero-copy, vector writer", VECTOR_WRITER, 64, 1, 1 },
+    { NULL, 0, 0, 0, 0 }
+};
+
+/*
+ * Emit the events of a stream in the given mode.
+ */
+
+static int
+emit_events(emit_mode_t *mode, const char *text, size_t length,
+        output_t *output, yaml_error_type_t *error)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_emitter_t *emitter = yaml_emitter_new();
+    FILE *file = NULL;
+    int done = 0;
+    int result = 1;
+
+    assert(parser && emitter);
+
+    yaml_parser_set_string_reader(parser,
+            (const unsigned char *)text, length);
+    yaml_parser_set_zero_copy(parser, mode->is_zero_copy);
+
+    output->length = 0;
+    output->text[0] = '\0';
+
+    if (mode->buffer_size)
+        assert(yaml_emitter_set_buffer_size(emitter, mode->buffer_size));
+
+    switch (mode->writer)
+    {
+        case STRING_WRITER:
+            yaml_emitter_set_string_writer(emitter, output->text,
+                    sizeof(output->text)-1, &output->length);
+            break;
+        case WRITER:
+            yaml_emitter_set_writer(emitter, output_writer, output);
+            break;
+        case VECTOR_WRITER:
+            yaml_emitter_set_vector_writer(emitter,
+                    output_vector_writer, output);
+            break;
+        case FILE_WRITER:
+        case FD_WRITER:
+            file = tmpfile();
+            assert(file);
+            if (mode->writer == FILE_WRITER)
+                yaml_emitter_set_file_writer(emitter, file);
+            else
+                yaml_emitter_set_fd_writer(emitter, fileno(file));
+            break;
+    }
+
+    if (mode->is_recycled)
+        yaml_emitter_set_parser_recycler(emitter, parser);
+
+    while (!done)
+    {
+        yaml_event_t event;
+
+        if (!yaml_parser_parse_event(parser, &event)) {
+            *error = yaml_parser_get_error(parser)->type;
+            result = 0;
+            break;
+        }
+        done = (event.type == YAML_STREAM_END_EVENT);
+        if (!yaml_emitter_emit_event(emitter, &event)) {
+            *error = yaml_emitter_get_error(emitter)->type;
+            result = 0;
+            break;
+        }
+    }
+
+    if (result && !yaml_emitter_flush(emitter)) {
+        *error = yaml_emitter_get_error(emitter)->type;
+        result = 0;
+    }
+
+    yaml_emitter_delete(emitter);
+    yaml_parser_delete(parser);
+
+    if (file) {
+        rewind(file);
+        output->length = fread(output->text, 1, sizeof(output->text)-1, file);
+        fclose(file);
+    }
+    output->text[output->length] = '\0';
+
+    if (result)
+        *error = YAML_NO_ERROR;
+    return result;
+}
+
+int check_writers(void)
+{
+    static output_t expected, produced, expected_dump, produced_dump;
+    int failed = 0;
+    int k, j;
+
+    printf("checking writers...\n");
+
+    for (k = 0; documents[k]; k++)
+    {
+        yaml_error_type_t error;
+
+        assert(emit_events(modes, documents[k], strlen(documents[k]),
+                    &expected, &error));
+
+        for (j = 0; modes[j].title; j++)
+        {
+            if (!emit_events(modes+j, documents[k], strlen(documents[k]),
+                        &produced, &error)
+                    || produced.length != expected.length
+                    || memcmp(expected.text, produced.text, expected.length)) {
+                printf("\t%s on document #%d: FAILED\n%s%s", modes[j].title,
+                        k, expected.text, produced.text);
+                failed ++;
+            }
+        }
+
+        /* The output is parsed back to the same events. */
+
+        assert(dump_events((const unsigned char *)documents[k],
+                    strlen(documents[k]), &expected_dump, 0));
+        if (!dump_events(expected.text, expected.length, &produced_dump, 0)
+                || strcmp((char *)expected_dump.text,
+                    (char *)produced_dump.text)) {
+            printf("\tparsing back document #%d: FAILED\n%s%s", k,
+                    expected_dump.text, produced_dump.text);
+            failed ++;
+        }
+    }
+
+    printf("checking writers: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check that the borrowed scalar values are not read past their end: the
+ * input below continues after the given length, and the last value of the
+ * second one is followed by `}`.
+ */
+
+typedef struct {
+    char *text;
+    size_t length;
+    char *output;
+} zero_copy_case;
+
+zero_copy_case zero_copy_cases[] = {
+    { "k: v----", 4, "k: v\n" },
+    { "[a, b]  - c", 6, "[a, b]\n" },
+    { "{\"a\": -}", 8, "{\"a\": ! '-'}\n" },
+    { NULL, 0, NULL }
+};
+
+int check_zero_copy(void)
+{
+    static output_t produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking zero-copy values...\n");
+
+    for (k = 0; zero_copy_cases[k].text; k++)
+    {
+        for (j = 0; modes[j].title; j++)
+        {
+            yaml_error_type_t error;
+
+            if (!emit_events(modes+j, zero_copy_cases[k].text,
+                        zero_copy_cases[k].length, &produced, &error)
+                    || strcmp((char *)produced.text,
+                        zero_copy_cases[k].output)) {
+                printf("\t%s on '%s': FAILED\n%s", modes[j].title,
+                        zero_copy_cases[k].text, produced.text);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking zero-copy values: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check a filtering proxy, which drops the scalars inside a sequence.  The
+ * parser hints the block sequence as non-empty, and the emitter should write
+ * the sequence as empty after all.
+ */
+
+int check_filter(void)
+{
+    static output_t output;
+    const char *text = "keep: 1\ndrop:\n  - x\n  - y\n";
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_emitter_t *emitter = yaml_emitter_new();
+    int failed = 0;
+    int depth = 0;
+    int done = 0;
+    size_t length;
+
+    printf("checking a filtering proxy...\n");
+
+    assert(parser);
+    assert(emitter);
+    yaml_parser_set_string_reader(parser, (const unsigned char *)text,
+            strlen(text));
+    yaml_emitter_set_string_writer(emitter, output.text,
+            sizeof(output.text), &length);
+
+    while (!done)
+    {
+        yaml_event_t event;
+
+        if (!yaml_parser_parse_event(parser, &event)) {
+            failed ++;
+            break;
+        }
+        done = (event.type == YAML_STREAM_END_EVENT);
+        if (event.type == YAML_SEQUENCE_END_EVENT)
+            depth --;
+        if (event.type == YAML_SCALAR_EVENT && depth) {
+            yaml_event_clear(&event);
+            continue;
+        }
+        if (event.type == YAML_SEQUENCE_START_EVENT)
+            depth ++;
+        if (!yaml_emitter_emit_event(emitter, &event)) {
+            failed ++;
+            break;
+        }
+    }
+
+    if (failed || !yaml_emitter_flush(emitter)
+            || length != strlen("keep: 1\ndrop: []\n")
+            || memcmp(output.text, "keep: 1\ndrop: []\n", length)) {
+        printf("\tfiltered sequence: FAILED\n%.*s", (int)length,
+                output.text);
+        failed = 1;
+    }
+
+    yaml_emitter_delete(emitter);
+    yaml_parser_delete(parser);
+
+    printf("checking a filtering proxy: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the emitter errors.
+ */
+
+int check_errors(void)
+{
+    static output_t output;
+    int failed = 0;
+    yaml_emitter_t *emitter;
+    yaml_event_t event;
+    size_t length;
+
+    printf("checking emitter errors...\n");
+
+    /* A string buffer that is too small. */
+
+    emitter = yaml_emitter_new();
+    assert(emitter);
+    yaml_emitter_set_string_writer(emitter, output.text, 8, &length);
+    assert(yaml_emitter_start(emitter));
+    assert(yaml_emitter_start_document(emitter, NULL, NULL, 0, 1));
+    if (!yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"a scalar longer than the buffer", -1,
+                YAML_ANY_SCALAR_STYLE)
+            || yaml_emitter_end_document(emitter, 1)
+            || yaml_emitter_get_error(emitter)->type != YAML_WRITER_ERROR) {
+        printf("\tsmall string buffer: FAILED\n");
+        failed ++;
+    }
+    yaml_emitter_delete(emitter);
+
+    /* A failing writer. */
+
+    emitter = yaml_emitter_new();
+    assert(emitter);
+    yaml_emitter_set_writer(emitter, failing_writer, NULL);
+    if (yaml_emitter_start(emitter)
+            && yaml_emitter_start_document(emitter, NULL, NULL, 0, 1)
+            && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"scalar", -1, YAML_ANY_SCALAR_STYLE)
+            && yaml_emitter_end_document(emitter, 1)
+            && yaml_emitter_end(emitter) && yaml_emitter_flush(emitter)) {
+        printf("\tfailing writer: FAILED\n");
+        failed ++;
+    }
+    else if (yaml_emitter_get_error(emitter)->type != YAML_WRITER_ERROR) {
+        printf("\tfailing writer (error type): FAILED\n");
+        failed ++;
+    }
+    yaml_emitter_delete(emitter);
+
+    /* A document without nodes. */
+
+    emitter = yaml_emitter_new();
+    assert(emitter);
+    yaml_emitter_set_string_writer(emitter, output.text,
+            sizeof(output.text), &length);
+    assert(yaml_emitter_start(emitter));
+    {
+        yaml_document_t document;
+        memset(&document, 0, sizeof(document));
+        assert(yaml_document_create(&document, NULL, NULL, 0, 1, 1));
+        if (yaml_emitter_emit_document(emitter, &document)
+                || yaml_emitter_get_error(emitter)->type
+                != YAML_SERIALIZER_ERROR) {
+            printf("\tempty document: FAILED\n");
+            failed ++;
+        }
+        yaml_document_clear(&document);
+    }
+    yaml_emitter_delete(emitter);
+
+    printf("checking emitter errors: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check that the documents are dumped the way they are loaded.
+ */
+
+int check_documents(void)
+{
+    static output_t output, expected_dump, produced_dump;
+    int failed = 0;
+    int k;
+
+    printf("checking documents...\n");
+
+    for (k = 0; documents[k]; k++)
+    {
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_emitter_t *emitter = yaml_emitter_new();
+        yaml_document_t document;
+        size_t length = 0;
+        int result = 1;
+
+        memset(&document, 0, sizeof(document));
+
+        assert(parser && emitter);
+        yaml_parser_set_string_reader(parser,
+                (const unsigned char *)documents[k], strlen(documents[k]));
+        yaml_emitter_set_string_writer(emitter, output.text,
+                sizeof(output.text)-1, &length);
+
+        result = yaml_emitter_start(emitter);
+        while (result) {
+            result = yaml_parser_parse_document(parser, &document);
+            if (!result || !document.type)
+                break;
+            result = yaml_emitter_emit_document(emitter, &document);
+        }
+        result = result && yaml_emitter_end(emitter)
+            && yaml_emitter_flush(emitter);
+        output.length = length;
+
+        assert(dump_events((const unsigned char *)documents[k],
+                    strlen(documents[k]), &expected_dump, 1));
+        if (!result || !dump_events(output.text, output.length,
+                    &produced_dump, 1)
+                || strcmp((char *)expected_dump.text,
+                    (char *)produced_dump.text)) {
+            printf("\tdocument #%d: FAILED\n%s%s", k,
+                    expected_dump.text, produced_dump.text);
+            failed ++;
+        }
+
+        yaml_document_clear(&document);
+        yaml_emitter_delete(emitter);
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking documents: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check building a document node by node.  The scalar values given with a
+ * length are slices of longer strings.
+ */
+
+static const char *built_text =
+    "%YAML 1.1\n"
+    "---\n"
+    "key: value\n"
+    "list: &_001\n"
+    "- 1\n"
+    "- 'two'\n"
+    "- !local 3\n"
+    "again: *_001\n"
+    "dash: '-'\n"
+    "empty: {}\n"
+    "...\n";
+
+static int
+build_document(yaml_emitter_t *emitter)
+{
+    yaml_version_directive_t version = { 1, 1 };
+    int list_id;
+
+    return yaml_emitter_start(emitter)
+        && yaml_emitter_start_document(emitter, &version, NULL, 0, 0)
+        && yaml_emitter_start_mapping(emitter, NULL,
+                (const yaml_char_t *)YAML_MAP_TAG, YAML_BLOCK_MAPPING_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"key", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"value and more", 5,
+                YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"list", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_start_sequence(emitter, &list_id, NULL,
+                YAML_BLOCK_SEQUENCE_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"1", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"two", -1,
+                YAML_SINGLE_QUOTED_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL,
+                (const yaml_char_t *)"!local", (const yaml_char_t *)"3", -1,
+                YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_end_sequence(emitter)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"again", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_alias(emitter, list_id)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"dash", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"-x", 1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_add_scalar(emitter, NULL, NULL,
+                (const yaml_char_t *)"empty", -1, YAML_ANY_SCALAR_STYLE)
+        && yaml_emitter_start_mapping(emitter, NULL, NULL,
+                YAML_FLOW_MAPPING_STYLE)
+        && yaml_emitter_end_mapping(emitter)
+        && yaml_emitter_end_mapping(emitter)
+        && yaml_emitter_end_document(emitter, 0)
+        && yaml_emitter_end(emitter)
+        && yaml_emitter_flush(emitter);
+}
+
+int check_builder(void)
+{
+    static output_t output;
+    int failed = 0;
+    int j;
+
+    printf("checking the document builder...\n");
+
+    for (j = 0; modes[j].title; j++)
+    {
+        yaml_emitter_t *emitter = yaml_emitter_new();
+        size_t length = 0;
+
+        assert(emitter);
+        output.length = 0;
+        output.text[0] = '\0';
+
+        if (modes[j].buffer_size)
+            assert(yaml_emitter_set_buffer_size(emitter,
+                        modes[j].buffer_size));
+
+        switch (modes[j].writer) {
+            case VECTOR_WRITER:
+                yaml_emitter_set_vector_writer(emitter,
+                        output_vector_writer, &output);
+                break;
+            case STRING_WRITER:
+                yaml_emitter_set_string_writer(emitter, output.text,
+                        sizeof(output.text)-1, &length);
+                break;
+            default:
+                yaml_emitter_set_writer(emitter, output_writer, &output);
+                break;
+        }
+
+        if (!build_document(emitter)) {
+            printf("\t%s: FAILED\n", modes[j].title);
+            failed ++;
+        }
+        else {
+            if (modes[j].writer == STRING_WRITER) {
+                output.length = length;
+                output.text[length] = '\0';
+            }
+            if (strcmp((char *)output.text, built_text)) {
+                printf("\t%s: FAILED\n%s", modes[j].title, output.text);
+                failed ++;
+            }
+        }
+
+        yaml_emitter_delete(emitter);
+    }
+
+    printf("checking the document builder: %d fail(s)\n", failed);
+    return failed;
+}
+
+int
+main(void)
+{
+    return check_writers() + check_zero_copy() + check_filter() + check_errors() + check_documents()
+        + check_builder();
+}
@@ -0,0 +1,1039 @@
+#include <yaml.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+/*
+ * The loader is checked by comparing the documents produced in all loading
+ * modes (regular and compact, with and without an arena or an allocator, in
+ * parallel and from binary images) with the documents of the plain loader.
+ * The documents are dumped with the accessors that work for both layouts.
+ */
+
+char *streams[] = {
+    "",
+    "scalar",
+    "--- a\n--- b\n...\n--- [c]\n",
+    "- a\n- &x b\n- *x\n- !!str c\n- ? complex\n  : key\n",
+    "key: value\nseq:\n- 1\n- 2\nmap: {a: b, c: [d, e]}\nempty:\n",
+    "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\\nf\"}}",
+    "- &a [1, 2]\n- &b [*a, *a]\n- [*b, *b]\n",
+    "a: |\n  literal\n  text\nb: >\n  folded\n  text\n'c': \"d\\te\"\n",
+    "--- one\n---\ntwo: 2\n---\n- three\n--- !!map\nfour: 4\n",
+    NULL
+};
+
+/*
+ * A growing dump of documents.
+ */
+
+typedef struct {
+    char text[65536];
+    size_t length;
+} dump_t;
+
+static void
+dump_printf(dump_t *dump, const char *text, size_t length)
+{
+    assert(dump->length + length < sizeof(dump->text));
+    memcpy(dump->text + dump->length, text, length);
+    dump->length += length;
+    dump->text[dump->length] = '\0';
+}
+
+static void
+dump_string(dump_t *dump, const char *text)
+{
+    dump_printf(dump, text, strlen(text));
+}
+
+static void
+dump_node(dump_t *dump, yaml_document_t *document, int node_id, int depth)
+{
+    yaml_char_t *tag;
+    yaml_char_t *value;
+    yaml_node_item_t *items;
+    yaml_node_pair_t *pairs;
+    size_t length;
+    size_t idx;
+
+    assert(depth < 32);
+
+    if (yaml_document_get_scalar(document, node_id, &tag, &value, &length)) {
+        dump_string(dump, (const char *)tag);
+        dump_string(dump, " '");
+        dump_printf(dump, (const char *)value, length);
+        dump_string(dump, "'");
+        assert(!value[length]);
+    }
+    else if (yaml_document_get_sequence(document, node_id,
+                &tag, &items, &length)) {
+        dump_string(dump, (const char *)tag);
+        dump_string(dump, " [");
+        for (idx = 0; idx < length; idx ++) {
+            if (idx) dump_string(dump, ", ");
+            dump_node(dump, document, items[idx], depth+1);
+        }
+        dump_string(dump, "]");
+    }
+    else if (yaml_document_get_mapping(document, node_id,
+                &tag, &pairs, &length)) {
+        dump_string(dump, (const char *)tag);
+        dump_string(dump, " {");
+        for (idx = 0; idx < length; idx ++) {
+            if (idx) dump_string(dump, ", ");
+            dump_node(dump, document, pairs[idx].key, depth+1);
+            dump_string(dump, ": ");
+            dump_node(dump, document, pairs[idx].value, depth+1);
+        }
+        dump_string(dump, "}");
+    }
+    else {
+        assert(0);
+    }
+}
+
+static void
+dump_document(dump_t *dump, yaml_document_t *document)
+{
+    char buffer[64];
+
+    sprintf(buffer, "--- (%d nodes) ", (int)document->nodes.length);
+    dump_string(dump, buffer);
+    if (document->nodes.length)
+        dump_node(dump, document, 0, 0);
+    dump_string(dump, "\n");
+}
+
+/*
+ * A counting allocator.
+ */
+
+typedef struct {
+    size_t allocated;
+    size_t live;
+} counter_t;
+
+static void *
+counting_allocate(void *data, size_t size)
+{
+    counter_t *counter = data;
+    void *ptr = malloc(size);
+    if (ptr) {
+        counter->allocated ++;
+        counter->live ++;
+    }
+    return ptr;
+}
+
+static void *
+counting_reallocate(void *data, void *ptr, size_t size)
+{
+    counter_t *counter = data;
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr && !ptr) {
+        counter->allocated ++;
+        counter->live ++;
+    }
+    return new_ptr;
+}
+
+static void
+counting_deallocate(void *data, void *ptr)
+{
+    counter_t *counter = data;
+    if (ptr) {
+        assert(counter->live);
+        counter->live --;
+    }
+    free(ptr);
+}
+
+/*
+ * Loading modes.
+ */
+
+typedef struct {
+    char *title;
+    int is_arena;
+    int is_allocator;
+    int is_compact;
+    int is_zero_copy;
+    int is_unique;
+    int is_untracked;
+    int threads;
+} load_mode_t;
+
+load_mode_t modes[] = {
+    { "plain", 0, 0, 0, 0, 0, 0, 0 },
+    { "arena", 1, 0, 0, 0, 0, 0, 0 },
+    { "allocator", 0, 1, 0, 0, 0, 0, 0 },
+    { "arena, allocator", 1, 1, 0, 0, 0, 0, 0 },
+    { "compact", 0, 0, 1, 0, 0, 0, 0 },
+    { "compact, allocator", 0, 1, 1, 0, 0, 0, 0 },
+    { "zero-copy", 0, 0, 0, 1, 0, 0, 0 },
+    { "unique keys", 0, 0, 0, 0, 1, 0, 0 },
+    { "untracked marks", 0, 0, 0, 0, 0, 1, 0 },
+    { "1 thread", 0, 0, 0, 0, 0, 0, 1 },
+    { "4 threads", 0, 0, 0, 0, 0, 0, 4 },
+    { "4 threads, arena, zero-copy", 1, 0, 0, 1, 0, 0, 4 },
+    { NULL, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+static yaml_parser_t *
+start_parser(load_mode_t *mode, const char *text, counter_t *counter)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    assert(parser);
+
+    yaml_parser_set_string_reader(parser,
+            (const unsigned char *)text, strlen(text));
+    yaml_parser_set_arena(parser, mode->is_arena);
+    yaml_parser_set_compact(parser, mode->is_compact);
+    yaml_parser_set_zero_copy(parser, mode->is_zero_copy);
+    yaml_parser_set_unique_keys(parser, mode->is_unique);
+    yaml_parser_set_mark_tracking(parser, !mode->is_untracked);
+    if (mode->is_allocator) {
+        yaml_allocator_t allocator = { counting_allocate, counting_reallocate,
+            counting_deallocate, NULL };
+        allocator.data = counter;
+        yaml_parser_set_allocator(parser, &allocator);
+    }
+
+    return parser;
+}
+
+/*
+ * Load a stream in the given mode.
+ */
+
+static int
+load_stream(load_mode_t *mode, const char *text, dump_t *dump,
+        yaml_error_type_t *error)
+{
+    counter_t counter = { 0, 0 };
+    yaml_parser_t *parser = start_parser(mode, text, &counter);
+
+    dump->length = 0;
+    dump->text[0] = '\0';
+
+    if (mode->threads)
+    {
+        yaml_document_t *documents;
+        size_t count, idx;
+
+        if (!yaml_parser_parse_all_documents(parser, &documents, &count,
+                    mode->threads)) {
+            *error = yaml_parser_get_error(parser)->type;
+            yaml_parser_delete(parser);
+            return 0;
+        }
+        for (idx = 0; idx < count; idx ++) {
+            assert(documents[idx].type == YAML_DOCUMENT);
+            dump_document(dump, documents+idx);
+        }
+        yaml_document_list_delete(documents, count);
+    }
+    else
+    {
+        while (1)
+        {
+            yaml_document_t document;
+
+            memset(&document, 0, sizeof(document));
+
+            if (!yaml_parser_parse_document(parser, &document)) {
+                *error = yaml_parser_get_error(parser)->type;
+                yaml_parser_delete(parser);
+                assert(!counter.live);
+                return 0;
+            }
+            if (!document.type)
+                break;
+
+            assert(yaml_document_is_compact(&document) == mode->is_compact);
+            if (mode->is_compact)
+                assert(!yaml_document_get_node(&document, 0));
+            if (mode->is_untracked && document.nodes.length
+                    && !mode->is_compact)
+                assert(!yaml_document_get_node(&document, -1)->end_mark.line);
+
+            dump_document(dump, &document);
+            yaml_document_clear(&document);
+
+            assert(!counter.live);
+        }
+    }
+
+    yaml_parser_delete(parser);
+    if (mode->is_allocator && strlen(text))
+        assert(counter.allocated);
+    assert(!counter.live);
+
+    *error = YAML_NO_ERROR;
+    return 1;
+}
+
+int check_modes(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking loading modes...\n");
+
+    for (k = 0; streams[k]; k++)
+    {
+        yaml_error_type_t error;
+
+        assert(load_stream(modes, streams[k], &expected, &error));
+
+        for (j = 0; modes[j].title; j++)
+        {
+            if (!load_stream(modes+j, streams[k], &produced, &error)
+                    || strcmp(expected.text, produced.text)) {
+                printf("\t%s on stream #%d: FAILED\n%s%s", modes[j].title, k,
+                        expected.text, produced.text);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking loading modes: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the loader errors.
+ */
+
+typedef struct {
+    char *title;
+    yaml_error_type_t type;
+    char *text;
+    int is_unique;
+    size_t max_nodes;
+    size_t max_depth;
+} error_case;
+
+error_case errors[] = {
+    { "undefined alias", YAML_COMPOSER_ERROR, "- *x\n", 0, 0, 0 },
+    { "malformed document", YAML_PARSER_ERROR, "a: 1\n---\n[\n---\nb\n", 0, 0, 0 },
+    { "duplicate key", YAML_COMPOSER_ERROR, "a: 1\nb: 2\na: 3\n", 1, 0, 0 },
+    { "duplicate nested key", YAML_COMPOSER_ERROR, "- {x: 1, y: 2, x: 3}\n", 1, 0, 0 },
+    { "too many nodes", YAML_COMPOSER_ERROR,
+        "- &a [1, 2, 3]\n- &b [*a, *a, *a]\n- &c [*b, *b, *b]\n- [*c, *c, *c]\n",
+        0, 100, 0 },
+    { "too deep", YAML_COMPOSER_ERROR,
+        "- &a [[1]]\n- &b [*a]\n- [*b]\n", 0, 0, 5 },
+    { NULL, YAML_NO_ERROR, NULL, 0, 0, 0 }
+};
+
+int check_errors(void)
+{
+    static dump_t produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking loader errors...\n");
+
+    for (k = 0; errors[k].title; k++)
+    {
+        for (j = 0; modes[j].title; j++)
+        {
+            load_mode_t mode = modes[j];
+            counter_t counter = { 0, 0 };
+            yaml_parser_t *parser;
+            yaml_document_t document;
+            int result = 1;
+
+            memset(&document, 0, sizeof(document));
+
+            mode.is_unique = errors[k].is_unique;
+
+            /* Check that the stream loads without the limits. */
+
+            if (errors[k].is_unique || errors[k].max_nodes
+                    || errors[k].max_depth) {
+                yaml_error_type_t error;
+                mode.is_unique = 0;
+                assert(load_stream(&mode, errors[k].text, &produced, &error));
+                mode.is_unique = errors[k].is_unique;
+            }
+
+            parser = start_parser(&mode, errors[k].text, &counter);
+            yaml_parser_set_expansion_limits(parser,
+                    errors[k].max_nodes, errors[k].max_depth);
+
+            if (mode.threads) {
+                yaml_document_t *documents = NULL;
+                size_t count = 0;
+                result = yaml_parser_parse_all_documents(parser,
+                        &documents, &count, mode.threads);
+                assert(result || (!documents && !count));
+                if (result)
+                    yaml_document_list_delete(documents, count);
+            }
+            else {
+                while ((result = yaml_parser_parse_document(parser, &document))
+                        && document.type) {
+                    yaml_document_clear(&document);
+                }
+                if (!result)
+                    assert(!document.type);
+            }
+
+            if (result || yaml_parser_get_error(parser)->type
+                    != errors[k].type) {
+                printf("\t%s (%s): FAILED\n", errors[k].title, mode.title);
+                failed ++;
+            }
+
+            yaml_parser_delete(parser);
+            assert(!counter.live);
+        }
+    }
+
+    printf("checking loader errors: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the expansion counts.
+ */
+
+int check_expansion(void)
+{
+    int failed = 0;
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_document_t document;
+    const char *text = "a: &x [1, 2]\nb: *x\nc: [[[*x]]]\n";
+
+    memset(&document, 0, sizeof(document));
+
+    printf("checking expansion counts...\n");
+
+    assert(parser);
+    yaml_parser_set_string_reader(parser,
+            (const unsigned char *)text, strlen(text));
+    yaml_parser_set_expansion_limits(parser, 16, 6);
+    assert(yaml_parser_parse_document(parser, &document));
+
+    /* {a: [1, 2], b: [1, 2], c: [[[[1, 2]]]]}: 16 nodes, 6 levels. */
+
+    if (document.expanded_nodes != 16 || document.expanded_depth != 6) {
+        printf("\texpanded %d nodes, %d levels: FAILED\n",
+                (int)document.expanded_nodes, (int)document.expanded_depth);
+        failed ++;
+    }
+
+    yaml_document_clear(&document);
+    yaml_parser_delete(parser);
+
+    printf("checking expansion counts: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the typed accessors and the key lookup.
+ */
+
+int check_accessors(void)
+{
+    int failed = 0;
+    int is_compact;
+    const char *text = "int: -12\nfloat: 1.5\nbool: yes\nnull: ~\n"
+        "str: text\nseq: [1]\nmap: {}\nint: 13\n";
+
+    printf("checking accessors...\n");
+
+    for (is_compact = 0; is_compact <= 1; is_compact ++)
+    {
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_document_t document;
+        int value_id, bool_value;
+        long int_value;
+        double float_value;
+        char *str_value;
+        yaml_node_item_t *items;
+        yaml_node_pair_t *pairs;
+        size_t length;
+        int pass;
+
+        memset(&document, 0, sizeof(document));
+
+        assert(parser);
+        yaml_parser_set_string_reader(parser,
+                (const unsigned char *)text, strlen(text));
+        yaml_parser_set_standard_resolver(parser);
+        yaml_parser_set_compact(parser, is_compact);
+        assert(yaml_parser_parse_document(parser, &document));
+
+        for (pass = 0; pass < 2; pass ++)
+        {
+            /* The second pass reads a frozen document. */
+
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"int", 3, &value_id)
+                    || !yaml_document_get_int_node(&document, value_id,
+                        &int_value) || int_value != -12) {
+                printf("\tint (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"float", 5, &value_id)
+                    || !yaml_document_get_float_node(&document, value_id,
+                        &float_value) || float_value != 1.5
+                    || yaml_document_get_int_node(&document, value_id, NULL)) {
+                printf("\tfloat (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"bool", 4, &value_id)
+                    || !yaml_document_get_bool_node(&document, value_id,
+                        &bool_value) || !bool_value) {
+                printf("\tbool (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"null", 4, &value_id)
+                    || !yaml_document_get_null_node(&document, value_id)) {
+                printf("\tnull (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"str", 3, &value_id)
+                    || !yaml_document_get_str_node(&document, value_id,
+                        &str_value) || strcmp(str_value, "text")
+                    || yaml_document_get_seq_node(&document, value_id,
+                        NULL, NULL)) {
+                printf("\tstr (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"seq", 3, &value_id)
+                    || !yaml_document_get_seq_node(&document, value_id,
+                        &items, &length) || length != 1
+                    || !yaml_document_get_int_node(&document, items[0],
+                        &int_value) || int_value != 1) {
+                printf("\tseq (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (!yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"map", 3, &value_id)
+                    || !yaml_document_get_map_node(&document, value_id,
+                        &pairs, &length) || length != 0) {
+                printf("\tmap (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+            if (yaml_document_find_mapping_value(&document, 0,
+                        (const yaml_char_t *)"missing", 7, &value_id)
+                    || yaml_document_find_mapping_value(&document, value_id,
+                        (const yaml_char_t *)"int", 3, NULL)) {
+                printf("\tmissing key (%s, pass %d): FAILED\n",
+                        is_compact ? "compact" : "regular", pass);
+                failed ++;
+            }
+
+            assert(yaml_document_freeze(&document));
+        }
+
+        yaml_document_clear(&document);
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking accessors: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the shared documents and the document slots.
+ */
+
+int check_shared(void)
+{
+    int failed = 0;
+    yaml_parser_t *parser = yaml_parser_new();
+    yaml_document_t document;
+    yaml_shared_document_t *shared, *current;
+    yaml_document_slot_t *slot;
+    const char *text = "--- first\n--- second\n";
+    yaml_char_t *value;
+
+    memset(&document, 0, sizeof(document));
+
+    printf("checking shared documents...\n");
+
+    assert(parser);
+    slot = yaml_document_slot_new();
+    assert(slot);
+    assert(!yaml_document_slot_acquire(slot));
+
+    yaml_parser_set_string_reader(parser,
+            (const unsigned char *)text, strlen(text));
+
+    assert(yaml_parser_parse_document(parser, &document));
+    shared = yaml_shared_document_new(&document);
+    assert(shared && !document.type);
+    yaml_document_slot_swap(slot, shared);
+
+    current = yaml_document_slot_acquire(slot);
+    assert(current == shared);
+
+    assert(yaml_parser_parse_document(parser, &document));
+    shared = yaml_shared_document_new(&document);
+    assert(shared);
+    yaml_document_slot_swap(slot, shared);
+
+    /* The old reference keeps the old document. */
+
+    if (!yaml_document_get_scalar(yaml_shared_document_get(current), 0,
+                NULL, &value, NULL) || strcmp((char *)value, "first")) {
+        printf("\told document: FAILED\n");
+        failed ++;
+    }
+    yaml_shared_document_release(current);
+
+    current = yaml_document_slot_acquire(slot);
+    if (!yaml_document_get_scalar(yaml_shared_document_get(current), 0,
+                NULL, &value, NULL) || strcmp((char *)value, "second")
+            || !yaml_shared_document_get(current)->is_frozen) {
+        printf("\tnew document: FAILED\n");
+        failed ++;
+    }
+    assert(yaml_shared_document_acquire(current) == current);
+    yaml_shared_document_release(current);
+    yaml_shared_document_release(current);
+
+    yaml_document_slot_swap(slot, NULL);
+    assert(!yaml_document_slot_acquire(slot));
+    yaml_document_slot_delete(slot);
+    yaml_parser_delete(parser);
+
+    printf("checking shared documents: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the selectors.
+ */
+
+typedef struct {
+    char *path;
+    char *values;
+} selector_case;
+
+selector_case selections[] = {
+    { "", NULL },
+    { "$", NULL },
+    { "spec.containers[*].image", "a.img b.img" },
+    { "spec.containers[1].name", "b" },
+    { "spec.containers[5].name", "" },
+    { "..name", "top a b a" },
+    { "[\"spec\"].replicas", "3" },
+    { "spec.containers[*].*", "a a.img b b.img" },
+    { "..[0].name", "a" },
+    { "alias.name", "a" },
+    { NULL, NULL }
+};
+
+static const char *selector_text =
+    "name: top\n"
+    "spec:\n"
+    "  replicas: 3\n"
+    "  containers:\n"
+    "  - &a {name: a, image: a.img}\n"
+    "  - {name: b, image: b.img}\n"
+    "alias: *a\n";
+
+static void
+dump_values(dump_t *dump, yaml_document_t *document, int *node_ids,
+        size_t count)
+{
+    size_t idx;
+
+    dump->length = 0;
+    dump->text[0] = '\0';
+
+    for (idx = 0; idx < count; idx ++) {
+        yaml_char_t *value;
+        size_t length;
+        if (idx) dump_string(dump, " ");
+        assert(yaml_document_get_scalar(document, node_ids[idx],
+                    NULL, &value, &length));
+        dump_printf(dump, (const char *)value, length);
+    }
+}
+
+int check_selectors(void)
+{
+    static dump_t produced;
+    int failed = 0;
+    int is_compact;
+    int k;
+
+    printf("checking selectors...\n");
+
+    for (is_compact = 0; is_compact <= 1; is_compact ++)
+    {
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_selector_t *selector = yaml_selector_new();
+        yaml_document_t document;
+
+        memset(&document, 0, sizeof(document));
+
+        assert(parser && selector);
+        yaml_parser_set_string_reader(parser,
+                (const unsigned char *)selector_text, strlen(selector_text));
+        yaml_parser_set_compact(parser, is_compact);
+        assert(yaml_parser_parse_document(parser, &document));
+
+        for (k = 0; selections[k].path; k++)
+        {
+            int *node_ids;
+            size_t count;
+
+            if (!yaml_selector_compile(selector, selections[k].path)
+                    || !yaml_selector_select(selector, &document, 0,
+                        &node_ids, &count)) {
+                printf("\t'%s': FAILED\n", selections[k].path);
+                failed ++;
+                continue;
+            }
+
+            if (!selections[k].values) {
+                if (count != 1 || node_ids[0] != 0) {
+                    printf("\t'%s' (root): FAILED\n", selections[k].path);
+                    failed ++;
+                }
+                continue;
+            }
+
+            dump_values(&produced, &document, node_ids, count);
+            if (strcmp(produced.text, selections[k].values)) {
+                printf("\t'%s': FAILED ('%s')\n", selections[k].path,
+                        produced.text);
+                failed ++;
+            }
+        }
+
+        yaml_document_clear(&document);
+        yaml_parser_delete(parser);
+
+        /* Load only the selected nodes. */
+
+        for (k = 0; selections[k].path; k++)
+        {
+            yaml_node_item_t *items;
+            size_t length;
+
+            if (!selections[k].values)
+                continue;
+
+            parser = yaml_parser_new();
+            assert(parser);
+            yaml_parser_set_string_reader(parser,
+                    (const unsigned char *)selector_text,
+                    strlen(selector_text));
+            yaml_parser_set_compact(parser, is_compact);
+            assert(yaml_selector_compile(selector, selections[k].path));
+
+            if (!yaml_parser_parse_selection(parser, selector, &document)
+                    || !yaml_document_get_sequence(&document, 0,
+                        NULL, &items, &length)) {
+                printf("\t'%s' (selection): FAILED\n", selections[k].path);
+                failed ++;
+                yaml_parser_delete(parser);
+                continue;
+            }
+
+            dump_values(&produced, &document, items, length);
+            if (strcmp(produced.text, selections[k].values)) {
+                printf("\t'%s' (selection): FAILED ('%s')\n",
+                        selections[k].path, produced.text);
+                failed ++;
+            }
+            yaml_document_clear(&document);
+
+            assert(yaml_parser_parse_selection(parser, selector, &document));
+            assert(!document.type);
+            yaml_parser_delete(parser);
+        }
+
+        yaml_selector_delete(selector);
+    }
+
+    printf("checking selectors: %d fail(s)\n", failed);
+    return failed;
+}
+
+char *bad_paths[] = {
+    "[", "a[", "a[x]", "a.", "[\"a]", "a..", "[1", "a[1", "a[-1]", NULL
+};
+
+int check_selector_errors(void)
+{
+    int failed = 0;
+    yaml_selector_t *selector = yaml_selector_new();
+    char path[128];
+    int k;
+
+    printf("checking selector errors...\n");
+
+    assert(selector);
+
+    for (k = 0; bad_paths[k]; k++) {
+        if (yaml_selector_compile(selector, bad_paths[k])
+                || yaml_selector_get_error(selector)->type
+                != YAML_SELECTOR_ERROR) {
+            printf("\t'%s': FAILED\n", bad_paths[k]);
+            failed ++;
+        }
+    }
+
+    /* Too many steps. */
+
+    strcpy(path, "a");
+    for (k = 0; k < 32; k++)
+        strcat(path, ".a");
+    if (yaml_selector_compile(selector, path)) {
+        printf("\ttoo many steps: FAILED\n");
+        failed ++;
+    }
+
+    /* A good path makes the selector usable again. */
+
+    if (!yaml_selector_compile(selector, "a.b")) {
+        printf("\trecompiling: FAILED\n");
+        failed ++;
+    }
+
+    yaml_selector_delete(selector);
+
+    printf("checking selector errors: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the binary images.
+ */
+
+typedef struct {
+    unsigned char *buffer;
+    size_t length;
+    size_t capacity;
+} image_t;
+
+static int
+image_writer(void *data, const unsigned char *buffer, size_t length)
+{
+    image_t *image = data;
+    if (image->length + length > image->capacity) {
+        image->capacity = (image->length + length) * 2;
+        image->buffer = realloc(image->buffer, image->capacity);
+        assert(image->buffer);
+    }
+    memcpy(image->buffer + image->length, buffer, length);
+    image->length += length;
+    return 1;
+}
+
+static int
+failing_writer(void *data, const unsigned char *buffer, size_t length)
+{
+    (void)data;
+    (void)buffer;
+    (void)length;
+    return 0;
+}
+
+int check_binary(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k;
+
+    printf("checking binary images...\n");
+
+    for (k = 0; streams[k]; k++)
+    {
+        const unsigned char *source = (const unsigned char *)streams[k];
+        size_t source_length = strlen(streams[k]);
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_document_t document, loaded;
+        int is_compact;
+
+        memset(&document, 0, sizeof(document));
+        memset(&loaded, 0, sizeof(loaded));
+
+        assert(parser);
+        yaml_parser_set_string_reader(parser, source, source_length);
+        expected.length = 0;
+        expected.text[0] = '\0';
+        produced.length = 0;
+        produced.text[0] = '\0';
+
+        for (is_compact = 0; 1; is_compact = !is_compact)
+        {
+            image_t image = { NULL, 0, 0 };
+            size_t size;
+
+            yaml_parser_set_compact(parser, is_compact);
+            assert(yaml_parser_parse_document(parser, &document));
+            if (!document.type)
+                break;
+            dump_document(&expected, &document);
+
+            assert(yaml_document_save_binary(&document, source, source_length,
+                        image_writer, &image));
+            assert(!yaml_document_save_binary(&document, source, source_length,
+                        failing_writer, NULL));
+
+            if (!yaml_document_load_binary(&loaded, image.buffer, image.length,
+                        source, source_length)) {
+                printf("\tstream #%d: FAILED\n", k);
+                failed ++;
+                free(image.buffer);
+                yaml_document_clear(&document);
+                continue;
+            }
+            assert(yaml_document_is_compact(&loaded));
+            dump_document(&produced, &loaded);
+            if (loaded.expanded_nodes != document.expanded_nodes
+                    || loaded.expanded_depth != document.expanded_depth) {
+                printf("\tstream #%d (expansion): FAILED\n", k);
+                failed ++;
+            }
+            yaml_document_clear(&loaded);
+
+            /* The staleness check could be skipped. */
+
+            assert(yaml_document_load_binary(&loaded, image.buffer,
+                        image.length, NULL, 0));
+            yaml_document_clear(&loaded);
+
+            /* Stale and truncated images are rejected. */
+
+            if (yaml_document_load_binary(&loaded, image.buffer, image.length,
+                        (const unsigned char *)"changed", 7)) {
+                printf("\tstream #%d (stale): FAILED\n", k);
+                failed ++;
+                yaml_document_clear(&loaded);
+            }
+            for (size = 0; size < image.length; size += 1 + size/2) {
+                if (yaml_document_load_binary(&loaded, image.buffer, size,
+                            NULL, 0)) {
+                    printf("\tstream #%d (truncated to %d): FAILED\n",
+                            k, (int)size);
+                    failed ++;
+                    yaml_document_clear(&loaded);
+                }
+            }
+            image.buffer[0] ^= 0xFF;
+            if (yaml_document_load_binary(&loaded, image.buffer, image.length,
+                        NULL, 0)) {
+                printf("\tstream #%d (bad magic): FAILED\n", k);
+                failed ++;
+                yaml_document_clear(&loaded);
+            }
+
+            free(image.buffer);
+            yaml_document_clear(&document);
+        }
+
+        if (strcmp(expected.text, produced.text)) {
+            printf("\tstream #%d: FAILED\n%s%s", k, expected.text,
+                    produced.text);
+            failed ++;
+        }
+
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking binary images: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the memory-mapped reader.
+ */
+
+int check_mmap_reader(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k;
+
+    printf("checking the mmap reader...\n");
+
+    for (k = 0; streams[k]; k++)
+    {
+        char name[] = "/tmp/test-loader-XXXXXX";
+        int fd = mkstemp(name);
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_error_type_t error;
+        int is_zero_copy = k % 2;
+
+        assert(fd >= 0 && parser);
+        assert(write(fd, streams[k], strlen(streams[k]))
+                == (ssize_t)strlen(streams[k]));
+        assert(lseek(fd, 0, SEEK_SET) == 0);
+
+        assert(load_stream(modes, streams[k], &expected, &error));
+
+        yaml_parser_set_mmap_reader(parser, fd);
+        yaml_parser_set_zero_copy(parser, is_zero_copy);
+        close(fd);
+        unlink(name);
+
+        produced.length = 0;
+        produced.text[0] = '\0';
+
+        while (1) {
+            yaml_document_t document;
+
+            memset(&document, 0, sizeof(document));
+
+            if (!yaml_parser_parse_document(parser, &document)) {
+                produced.length = 0;
+                break;
+            }
+            if (!document.type)
+                break;
+            dump_document(&produced, &document);
+            yaml_document_clear(&document);
+        }
+
+        if (strcmp(expected.text, produced.text)) {
+            printf("\tstream #%d: FAILED\n", k);
+            failed ++;
+        }
+
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking the mmap reader: %d fail(s)\n", failed);
+    return failed;
+}
+
+int
+main(void)
+{
+    return check_modes() + check_errors() + check_expansion()
+        + check_accessors() + check_shared() + check_selectors()
+        + check_selector_errors() + check_binary() + check_mmap_reader();
+}
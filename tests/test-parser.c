@@ -0,0 +1,688 @@
+#include <yaml.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <assert.h>
+
+/*
+ * The parser is checked by comparing the events produced in all parsing modes
+ * (pull and push, copying and zero-copy, YAML and JSON scanners) with the
+ * events of the plain pull parser.  The events are dumped
+ * in the notation of the YAML test suite.
+ */
+
+char *documents[] = {
+    "",
+    "scalar",
+    "- 'single'\n- \"double\"\n",
+    "--- |\n  literal\n  text\n--- >\n  folded\n  text\n...\n",
+    "%YAML 1.1\n%TAG !e! tag:example.com,2000:\n--- !e!foo bar\n",
+    "- a\n- &x b\n- *x\n- !!str c\n- ? complex\n  : key\n",
+    "key: value\nseq:\n- 1\n- 2\nmap: {a: b, c: [d, e]}\nempty:\n",
+    "[a, b: c, {d: e}, [], {}]",
+    "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\\nf\"}}",
+    "[\"\\u00e9\", \"\\\"\", 1.5e3, -2, \"\"]",
+    "{\"a\": -}",
+    "[\"a\", b, 'c', *x]",
+    "{\"long key\": \"a value long enough to span more than one chunk of input\"}\n",
+    "a:\n  b:\n    c:\n      d: [1, {2: 3}]\n  e: f\ng: h\n",
+    "[[[[a, [b]], [[c]]], d], {e: [f, {g: h}]}, i]\n",
+    "a:\n  - b:\n      - c\n      - d: e\n    f: g\n  - h\ni: [[j], {k: [l]}]\n",
+    "[[[[a, b], [c]], {d: e}]]: f\n[[g]]: {h: [i]}\n",
+    NULL
+};
+
+/*
+ * Malformed documents; the first column is the expected error type.
+ */
+
+typedef struct {
+    yaml_error_type_t type;
+    char *text;
+} error_case;
+
+error_case errors[] = {
+    { YAML_PARSER_ERROR, "[a, b" },
+    { YAML_PARSER_ERROR, "{\"a\": 1" },
+    { YAML_PARSER_ERROR, "key: value\n- item\n" },
+    { YAML_SCANNER_ERROR, "\"unterminated" },
+    { YAML_SCANNER_ERROR, "a: *\n" },
+    { YAML_SCANNER_ERROR, "[\"a\\q\"]" },
+    { YAML_PARSER_ERROR, "--- !x!y z\n" },
+    { YAML_SCANNER_ERROR, "a:\n  - x\nb\nc: d\n" },
+    { YAML_SCANNER_ERROR, "- ?\nxx\n," },
+    { YAML_SCANNER_ERROR, "? \n  ? ? |\n  t\n]" },
+    { YAML_NO_ERROR, NULL }
+};
+
+/*
+ * A growing dump of events.
+ */
+
+typedef struct {
+    char text[65536];
+    size_t length;
+} dump_t;
+
+static void
+dump_printf(dump_t *dump, const char *text, size_t length)
+{
+    assert(dump->length + length < sizeof(dump->text));
+    memcpy(dump->text + dump->length, text, length);
+    dump->length += length;
+    dump->text[dump->length] = '\0';
+}
+
+static void
+dump_string(dump_t *dump, const char *text)
+{
+    dump_printf(dump, text, strlen(text));
+}
+
+static void
+dump_properties(dump_t *dump, const yaml_char_t *anchor, const yaml_char_t *tag)
+{
+    if (anchor) {
+        dump_string(dump, " &");
+        dump_string(dump, (const char *)anchor);
+    }
+    if (tag) {
+        dump_string(dump, " <");
+        dump_string(dump, (const char *)tag);
+        dump_string(dump, ">");
+    }
+}
+
+static void
+dump_event(dump_t *dump, yaml_event_t *event)
+{
+    static const char *indicators = "?:'\"|>";
+    char indicator[3] = " ?";
+    size_t idx;
+
+    switch (event->type)
+    {
+        case YAML_STREAM_START_EVENT:
+            dump_string(dump, "+STR\n");
+            break;
+
+        case YAML_STREAM_END_EVENT:
+            dump_string(dump, "-STR\n");
+            break;
+
+        case YAML_DOCUMENT_START_EVENT:
+            dump_string(dump, event->data.document_start.is_implicit ?
+                    "+DOC" : "+DOC ---");
+            if (event->data.document_start.version_directive) {
+                char buffer[64];
+                sprintf(buffer, " %%YAML %d.%d",
+                        event->data.document_start.version_directive->major,
+                        event->data.document_start.version_directive->minor);
+                dump_string(dump, buffer);
+            }
+            for (idx = 0;
+                    idx < event->data.document_start.tag_directives.length;
+                    idx ++) {
+                yaml_tag_directive_t *tag_directive =
+                    event->data.document_start.tag_directives.list + idx;
+                dump_string(dump, " %TAG ");
+                dump_string(dump, (const char *)tag_directive->handle);
+                dump_string(dump, " ");
+                dump_string(dump, (const char *)tag_directive->prefix);
+            }
+            dump_string(dump, "\n");
+            break;
+
+        case YAML_DOCUMENT_END_EVENT:
+            dump_string(dump, event->data.document_end.is_implicit ?
+                    "-DOC\n" : "-DOC ...\n");
+            break;
+
+        case YAML_ALIAS_EVENT:
+            dump_string(dump, "=ALI *");
+            dump_string(dump, (const char *)event->data.alias.anchor);
+            dump_string(dump, "\n");
+            break;
+
+        case YAML_SCALAR_EVENT:
+            dump_string(dump, "=VAL");
+            dump_properties(dump, event->data.scalar.anchor,
+                    event->data.scalar.tag);
+            indicator[1] = indicators[event->data.scalar.style];
+            dump_printf(dump, indicator, 2);
+            for (idx = 0; idx < event->data.scalar.length; idx ++) {
+                const yaml_char_t *value = event->data.scalar.value + idx;
+                if (*value == '\n')
+                    dump_string(dump, "\\n");
+                else if (*value == '\\')
+                    dump_string(dump, "\\\\");
+                else
+                    dump_printf(dump, (const char *)value, 1);
+            }
+            dump_string(dump, "\n");
+            break;
+
+        case YAML_SEQUENCE_START_EVENT:
+            dump_string(dump, event->data.sequence_start.style
+                    == YAML_FLOW_SEQUENCE_STYLE ? "+SEQ []" : "+SEQ");
+            dump_properties(dump, event->data.sequence_start.anchor,
+                    event->data.sequence_start.tag);
+            dump_string(dump, "\n");
+            break;
+
+        case YAML_SEQUENCE_END_EVENT:
+            dump_string(dump, "-SEQ\n");
+            break;
+
+        case YAML_MAPPING_START_EVENT:
+            dump_string(dump, event->data.mapping_start.style
+                    == YAML_FLOW_MAPPING_STYLE ? "+MAP {}" : "+MAP");
+            dump_properties(dump, event->data.mapping_start.anchor,
+                    event->data.mapping_start.tag);
+            dump_string(dump, "\n");
+            break;
+
+        case YAML_MAPPING_END_EVENT:
+            dump_string(dump, "-MAP\n");
+            break;
+
+        default:
+            assert(0);
+    }
+}
+
+/*
+ * Parsing modes.
+ */
+
+typedef struct {
+    char *title;
+    int is_zero_copy;
+    yaml_json_mode_t json_mode;
+    size_t chunk;
+    int is_recycled;
+} parse_mode_t;
+
+parse_mode_t modes[] = {
+    { "pull", 0, YAML_AUTO_JSON_MODE, 0, 0 },
+    { "pull, recycled", 0, YAML_AUTO_JSON_MODE, 0, 1 },
+    { "pull, no JSON", 0, YAML_NEVER_JSON_MODE, 0, 0 },
+    { "pull, JSON always", 0, YAML_ALWAYS_JSON_MODE, 0, 0 },
+    { "zero-copy", 1, YAML_AUTO_JSON_MODE, 0, 0 },
+    { "zero-copy, no JSON", 1, YAML_NEVER_JSON_MODE, 0, 1 },
+    { "push by 1", 0, YAML_AUTO_JSON_MODE, 1, 0 },
+    { "push by 3", 0, YAML_AUTO_JSON_MODE, 3, 1 },
+    { "push by 7, no JSON", 0, YAML_NEVER_JSON_MODE, 7, 0 },
+    { "push by 64", 0, YAML_AUTO_JSON_MODE, 64, 0 },
+    { NULL, 0, 0, 0, 0 }
+};
+
+/*
+ * Create a parser for the given mode and feed the next chunk in the push mode.
+ */
+
+static int
+feed_parser(yaml_parser_t *parser, parse_mode_t *mode, const char *text,
+        size_t *offset)
+{
+    size_t length = strlen(text);
+    size_t chunk = length - *offset;
+    if (chunk > mode->chunk)
+        chunk = mode->chunk;
+    if (!yaml_parser_feed(parser, (const unsigned char *)text + *offset,
+                chunk, *offset + chunk == length))
+        return 0;
+    *offset += chunk;
+    return 1;
+}
+
+static yaml_parser_t *
+start_parser(parse_mode_t *mode, const char *text, size_t *offset)
+{
+    yaml_parser_t *parser = yaml_parser_new();
+    assert(parser);
+
+    yaml_parser_set_json_mode(parser, mode->json_mode);
+    if (!mode->chunk) {
+        yaml_parser_set_string_reader(parser,
+                (const unsigned char *)text, strlen(text));
+        yaml_parser_set_zero_copy(parser, mode->is_zero_copy);
+    }
+    *offset = 0;
+    if (mode->chunk)
+        assert(feed_parser(parser, mode, text, offset));
+
+    return parser;
+}
+
+static int
+parse_events(parse_mode_t *mode, const char *text, dump_t *dump,
+        yaml_error_type_t *error)
+{
+    size_t offset;
+    yaml_parser_t *parser = start_parser(mode, text, &offset);
+    int is_borrowed = 0;
+    int done = 0;
+
+    dump->length = 0;
+    dump->text[0] = '\0';
+
+    while (!done)
+    {
+        yaml_event_t event;
+
+        if (!yaml_parser_parse_event(parser, &event)) {
+            *error = yaml_parser_get_error(parser)->type;
+            yaml_parser_delete(parser);
+            return 0;
+        }
+
+        if (event.type == YAML_NO_EVENT) {
+            assert(mode->chunk && yaml_parser_is_input_needed(parser));
+            assert(feed_parser(parser, mode, text, &offset));
+            continue;
+        }
+
+        dump_event(dump, &event);
+
+        if (event.type == YAML_SCALAR_EVENT && event.data.scalar.is_borrowed) {
+            assert(mode->is_zero_copy);
+            assert(event.data.scalar.value >= (yaml_char_t *)text
+                    && event.data.scalar.value + event.data.scalar.length
+                    <= (yaml_char_t *)text + strlen(text));
+            is_borrowed = 1;
+        }
+
+        done = (event.type == YAML_STREAM_END_EVENT);
+
+        if (mode->is_recycled)
+            yaml_parser_recycle_event(parser, &event);
+        else
+            yaml_event_clear(&event);
+    }
+
+    if (mode->chunk)
+        assert(offset == strlen(text));
+    if (!mode->is_zero_copy)
+        assert(!is_borrowed);
+
+    yaml_parser_delete(parser);
+    *error = YAML_NO_ERROR;
+    return 1;
+}
+
+int check_modes(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking parsing modes...\n");
+
+    for (k = 0; documents[k]; k++)
+    {
+        yaml_error_type_t error;
+
+        assert(parse_events(modes, documents[k], &expected, &error));
+
+        for (j = 0; modes[j].title; j++)
+        {
+            int result;
+
+            result = parse_events(modes+j, documents[k], &produced, &error)
+                && !strcmp(expected.text, produced.text);
+            if (!result) {
+                printf("\t%s on document #%d: FAILED\n",
+                        modes[j].title, k);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking parsing modes: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the events of a few documents against the expected dumps.
+ */
+
+typedef struct {
+    char *text;
+    char *events;
+} events_case;
+
+events_case expected_events[] = {
+    { "k: v",
+      "+STR\n+DOC\n+MAP\n=VAL :k\n=VAL :v\n-MAP\n-DOC\n-STR\n" },
+    { "{\"a\": -}",
+      "+STR\n+DOC\n+MAP {}\n=VAL \"a\n=VAL :-\n-MAP\n-DOC\n-STR\n" },
+    { "[\"a\\tb\", 1, {\"c\": []}]",
+      "+STR\n+DOC\n+SEQ []\n=VAL \"a\tb\n=VAL :1\n+MAP {}\n=VAL \"c\n"
+      "+SEQ []\n-SEQ\n-MAP\n-SEQ\n-DOC\n-STR\n" },
+    { "--- &a !t x\n...\n",
+      "+STR\n+DOC ---\n=VAL &a <!t> :x\n-DOC ...\n-STR\n" },
+    { NULL, NULL }
+};
+
+int check_events(void)
+{
+    static dump_t produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking events...\n");
+
+    for (k = 0; expected_events[k].text; k++)
+    {
+        for (j = 0; modes[j].title; j++)
+        {
+            yaml_error_type_t error;
+
+            if (!parse_events(modes+j, expected_events[k].text,
+                        &produced, &error)
+                    || strcmp(expected_events[k].events, produced.text)) {
+                printf("\t%s on '%s': FAILED\n%s", modes[j].title,
+                        expected_events[k].text, produced.text);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking events: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check that malformed documents fail in all modes with the same error and
+ * after the same events.
+ */
+
+int check_errors(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k, j;
+
+    printf("checking errors...\n");
+
+    for (k = 0; errors[k].text; k++)
+    {
+        yaml_error_type_t error;
+
+        assert(!parse_events(modes, errors[k].text, &expected, &error));
+
+        for (j = 0; modes[j].title; j++)
+        {
+            error = YAML_NO_ERROR;
+
+            if (parse_events(modes+j, errors[k].text, &produced, &error)
+                    || error != errors[k].type
+                    || strcmp(expected.text, produced.text)) {
+                printf("\t%s on '%s': FAILED (error %d)\n",
+                        modes[j].title, errors[k].text, (int)error);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking errors: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check skipping nodes.
+ */
+
+int check_skip_node(void)
+{
+    static dump_t produced;
+    int failed = 0;
+    int j;
+    const char *text = "a: [1, 2, {b: c}]\nd: {e: [f]}\ng: h\n";
+
+    printf("checking skipping nodes...\n");
+
+    for (j = 0; modes[j].title; j++)
+    {
+        size_t offset;
+        yaml_parser_t *parser = start_parser(modes+j, text, &offset);
+        int done = 0;
+
+        produced.length = 0;
+        produced.text[0] = '\0';
+
+        while (!done)
+        {
+            yaml_event_t event;
+
+            if (!yaml_parser_parse_event(parser, &event))
+                break;
+            if (event.type == YAML_NO_EVENT) {
+                assert(feed_parser(parser, modes+j, text, &offset));
+                continue;
+            }
+            dump_event(&produced, &event);
+            done = (event.type == YAML_STREAM_END_EVENT);
+
+            /* Skip the values of the keys other than 'g'. */
+
+            if (event.type == YAML_SCALAR_EVENT
+                    && event.data.scalar.value[0] != 'g'
+                    && event.data.scalar.value[0] != 'h') {
+                while (!yaml_parser_skip_node(parser)
+                        || yaml_parser_is_input_needed(parser)) {
+                    if (yaml_parser_get_error(parser)->type)
+                        break;
+                    assert(feed_parser(parser, modes+j, text, &offset));
+                }
+            }
+
+            yaml_event_clear(&event);
+        }
+
+        if (!done || strcmp(produced.text,
+                    "+STR\n+DOC\n+MAP\n=VAL :a\n=VAL :d\n=VAL :g\n=VAL :h\n"
+                    "-MAP\n-DOC\n-STR\n")) {
+            printf("\t%s: FAILED\n%s", modes[j].title, produced.text);
+            failed ++;
+        }
+
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking skipping nodes: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check that skipping a large node copies none of its values, anchors and
+ * tags: they are dropped as soon as they are scanned, so the parser pool
+ * allocates a buffer about as large as one value rather than one per value.
+ * The allocations are counted only if the library collects the statistics
+ * (see `--enable-stats`).
+ */
+
+#define SKIPPED_VALUES  1000
+#define SKIPPED_LENGTH  1000
+
+int check_skip_large_node(void)
+{
+    static char text[SKIPPED_VALUES*(SKIPPED_LENGTH+32)+64];
+    yaml_parser_t *parser = yaml_parser_new();
+    const yaml_parser_stats_t *stats;
+    yaml_event_t event;
+    size_t length = 0;
+    int failed = 0;
+    int k;
+
+    printf("checking skipping a large node...\n");
+
+    length += sprintf(text+length, "skipped:\n");
+    for (k = 0; k < SKIPPED_VALUES; k++) {
+        length += sprintf(text+length, "- &a%d !t \"%d", k, k);
+        memset(text+length, 'x', SKIPPED_LENGTH);
+        length += SKIPPED_LENGTH;
+        length += sprintf(text+length, "\"\n");
+    }
+    length += sprintf(text+length, "kept: value\n");
+
+    assert(parser);
+    yaml_parser_set_string_reader(parser, (const unsigned char *)text, length);
+
+    for (k = 0; k < 4; k++) {
+        assert(yaml_parser_parse_event(parser, &event));
+        yaml_event_clear(&event);
+    }
+
+    if (!yaml_parser_skip_node(parser)) {
+        printf("\tskipping: FAILED\n");
+        failed ++;
+    }
+    else {
+        assert(yaml_parser_parse_event(parser, &event));
+        if (event.type != YAML_SCALAR_EVENT
+                || strcmp((char *)event.data.scalar.value, "kept")) {
+            printf("\tthe next key: FAILED\n");
+            failed ++;
+        }
+        yaml_event_clear(&event);
+    }
+
+    stats = yaml_parser_get_stats(parser);
+    if (stats->allocated_bytes > 16*SKIPPED_LENGTH) {
+        printf("\tallocated bytes: FAILED (%lu)\n",
+                (unsigned long)stats->allocated_bytes);
+        failed ++;
+    }
+
+    yaml_parser_delete(parser);
+
+    printf("checking skipping a large node: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check that the tokens are the same in the pull and the push modes.
+ */
+
+static int
+count_tokens(parse_mode_t *mode, const char *text, int *types)
+{
+    size_t offset;
+    yaml_parser_t *parser = start_parser(mode, text, &offset);
+    int count = 0;
+
+    while (1)
+    {
+        yaml_token_t token;
+
+        if (!yaml_parser_parse_token(parser, &token))
+            break;
+        if (token.type == YAML_NO_TOKEN) {
+            if (!yaml_parser_is_input_needed(parser))
+                break;
+            assert(feed_parser(parser, mode, text, &offset));
+            continue;
+        }
+        types[count++] = token.type;
+        assert(count < 256);
+        if (mode->is_recycled)
+            yaml_parser_recycle_token(parser, &token);
+        else
+            yaml_token_clear(&token);
+    }
+
+    assert(!yaml_parser_get_error(parser)->type);
+    yaml_parser_delete(parser);
+    return count;
+}
+
+int check_tokens(void)
+{
+    int failed = 0;
+    int k, j;
+
+    printf("checking tokens...\n");
+
+    for (k = 0; documents[k]; k++)
+    {
+        int expected[256], produced[256];
+        int count = count_tokens(modes, documents[k], expected);
+
+        for (j = 0; modes[j].title; j++)
+        {
+            if (modes[j].json_mode != YAML_AUTO_JSON_MODE)
+                continue;
+            if (count_tokens(modes+j, documents[k], produced) != count
+                    || memcmp(expected, produced, count*sizeof(int))) {
+                printf("\t%s on document #%d: FAILED\n", modes[j].title, k);
+                failed ++;
+            }
+        }
+    }
+
+    printf("checking tokens: %d fail(s)\n", failed);
+    return failed;
+}
+
+/*
+ * Check the parser with tiny input buffers.
+ */
+
+int check_buffer_size(void)
+{
+    static dump_t expected, produced;
+    int failed = 0;
+    int k;
+
+    printf("checking buffer sizes...\n");
+
+    for (k = 0; documents[k]; k++)
+    {
+        yaml_parser_t *parser = yaml_parser_new();
+        yaml_error_type_t error;
+        int done = 0;
+
+        assert(parser);
+        assert(parse_events(modes, documents[k], &expected, &error));
+        assert(yaml_parser_set_buffer_size(parser, 1, 256));
+        yaml_parser_set_string_reader(parser,
+                (const unsigned char *)documents[k], strlen(documents[k]));
+
+        produced.length = 0;
+        produced.text[0] = '\0';
+
+        while (!done) {
+            yaml_event_t event;
+            if (!yaml_parser_parse_event(parser, &event))
+                break;
+            dump_event(&produced, &event);
+            done = (event.type == YAML_STREAM_END_EVENT);
+            yaml_event_clear(&event);
+        }
+
+        if (!done || strcmp(expected.text, produced.text)) {
+            printf("\tdocument #%d: FAILED\n", k);
+            failed ++;
+        }
+
+        yaml_parser_delete(parser);
+    }
+
+    printf("checking buffer sizes: %d fail(s)\n", failed);
+    return failed;
+}
+
+int
+main(void)
+{
+    return check_modes() + check_events() + check_errors()
+        + check_skip_node() + check_skip_large_node() + check_tokens()
+        + check_buffer_size();
+}
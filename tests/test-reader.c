@@ -1,4 +1,4 @@
-#include <yaml.h>
+#include "../src/yaml_private.h"
 
 YAML_DECLARE(int)
 yaml_parser_update_buffer(yaml_parser_t *parser, size_t length);
@@ -116,7 +116,7 @@ char *bom_original = "Hi is \xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82";
 
 int check_utf8_sequences(void)
 {
-    yaml_parser_t parser;
+    yaml_parser_t *parser;
     int failed = 0;
     int k;
     printf("checking utf-8 sequences...\n");
@@ -129,9 +129,10 @@ int check_utf8_sequences(void)
         printf("\t%s:\n", title);
         while(1) {
             while (*end != '|' && *end != '!') end++;
-            yaml_parser_initialize(&parser);
-            yaml_parser_set_input_string(&parser, (unsigned char *)start, end-start);
-            result = yaml_parser_update_buffer(&parser, end-start);
+            parser = yaml_parser_new();
+            assert(parser);
+            yaml_parser_set_string_reader(parser, (unsigned char *)start, end-start);
+            result = yaml_parser_update_buffer(parser, end-start);
             if (result != check) {
                 printf("\t\t- ");
                 failed ++;
@@ -139,22 +140,26 @@ int check_utf8_sequences(void)
             else {
                 printf("\t\t+ ");
             }
-            if (!parser.error) {
+            if (!parser->error.type) {
                 printf("(no error)\n");
             }
-            else if (parser.error == YAML_READER_ERROR) {
-                if (parser.problem_value != -1) {
+            else if (parser->error.type == YAML_READER_ERROR
+                    || parser->error.type == YAML_DECODER_ERROR) {
+                if (parser->error.data.reading.value != -1) {
                     printf("(reader error: %s: #%X at %d)\n",
-                            parser.problem, parser.problem_value, parser.problem_offset);
+                            parser->error.data.reading.problem,
+                            parser->error.data.reading.value,
+                            (int)parser->error.data.reading.offset);
                 }
                 else {
                     printf("(reader error: %s at %d)\n",
-                            parser.problem, parser.problem_offset);
+                            parser->error.data.reading.problem,
+                            (int)parser->error.data.reading.offset);
                 }
             }
             if (*end == '!') break;
             start = ++end;
-            yaml_parser_delete(&parser);
+            yaml_parser_delete(parser);
         };
         printf("\n");
     }
@@ -164,7 +169,7 @@ int check_utf8_sequences(void)
 
 int check_boms(void)
 {
-    yaml_parser_t parser;
+    yaml_parser_t *parser;
     int failed = 0;
     int k;
     printf("checking boms...\n");
@@ -176,27 +181,29 @@ int check_boms(void)
         char *end = start;
         while (*end != '!') end++;
         printf("\t%s: ", title);
-        yaml_parser_initialize(&parser);
-        yaml_parser_set_input_string(&parser, (unsigned char *)start, end-start);
-        result = yaml_parser_update_buffer(&parser, end-start);
+        parser = yaml_parser_new();
+        assert(parser);
+        yaml_parser_set_string_reader(parser, (unsigned char *)start, end-start);
+        result = yaml_parser_update_buffer(parser, end-start);
         if (!result) {
-            printf("- (reader error: %s at %d)\n", parser.problem, parser.problem_offset);
+            printf("- (reader error: %s at %d)\n", parser->error.data.reading.problem,
+                    (int)parser->error.data.reading.offset);
             failed++;
         }
         else {
-            if (parser.unread != check) {
-                printf("- (length=%d while expected length=%d)\n", parser.unread, check);
+            if (parser->unread != check) {
+                printf("- (length=%d while expected length=%d)\n", (int)parser->unread, check);
                 failed++;
             }
-            else if (memcmp(parser.buffer.start, bom_original, check) != 0) {
-                printf("- (value '%s' does not equal to the original value '%s')\n", parser.buffer.start, bom_original);
+            else if (memcmp(parser->input.buffer, bom_original, check) != 0) {
+                printf("- (value '%s' does not equal to the original value '%s')\n", parser->input.buffer, bom_original);
                 failed++;
             }
             else {
                 printf("+\n");
             }
         }
-        yaml_parser_delete(&parser);
+        yaml_parser_delete(parser);
     }
     printf("checking boms: %d fail(s)\n", failed);
     return failed;
@@ -206,7 +213,7 @@ int check_boms(void)
 
 int check_long_utf8(void)
 {
-    yaml_parser_t parser;
+    yaml_parser_t *parser;
     int k = 0;
     int j;
     int failed = 0;
@@ -227,17 +234,19 @@ int check_long_utf8(void)
             buffer[k++] = '\xaf';
         }
     }
-    yaml_parser_initialize(&parser);
-    yaml_parser_set_input_string(&parser, buffer, 3+LONG*2);
+    parser = yaml_parser_new();
+    assert(parser);
+    yaml_parser_set_string_reader(parser, buffer, 3+LONG*2);
     for (k = 0; k < LONG; k++) {
-        if (!parser.unread) {
-            if (!yaml_parser_update_buffer(&parser, 1)) {
-                printf("\treader error: %s at %d\n", parser.problem, parser.problem_offset);
+        if (!parser->unread) {
+            if (!yaml_parser_update_buffer(parser, 1)) {
+                printf("\treader error: %s at %d\n", parser->error.data.reading.problem,
+                    (int)parser->error.data.reading.offset);
                 failed = 1;
                 break;
             }
         }
-        if (!parser.unread) {
+        if (!parser->unread) {
             printf("\tnot enough characters at %d\n", k);
             failed = 1;
             break;
@@ -250,27 +259,28 @@ int check_long_utf8(void)
             ch0 = '\xd0';
             ch1 = '\xaf';
         }
-        if (parser.buffer.pointer[0] != ch0 || parser.buffer.pointer[1] != ch1) {
+        if (parser->input.buffer[parser->input.pointer] != ch0 || parser->input.buffer[parser->input.pointer+1] != ch1) {
             printf("\tincorrect UTF-8 sequence: %X %X instead of %X %X\n",
-                    (int)parser.buffer.pointer[0], (int)parser.buffer.pointer[1],
+                    (int)parser->input.buffer[parser->input.pointer], (int)parser->input.buffer[parser->input.pointer+1],
                     (int)ch0, (int)ch1);
             failed = 1;
             break;
         }
-        parser.buffer.pointer += 2;
-        parser.unread -= 1;
+        parser->input.pointer += 2;
+        parser->unread -= 1;
     }
     if (!failed) {
-        if (!yaml_parser_update_buffer(&parser, 1)) {
-            printf("\treader error: %s at %d\n", parser.problem, parser.problem_offset);
+        if (!yaml_parser_update_buffer(parser, 1)) {
+            printf("\treader error: %s at %d\n", parser->error.data.reading.problem,
+                    (int)parser->error.data.reading.offset);
             failed = 1;
         }
-        else if (parser.buffer.pointer[0] != '\0') {
-            printf("\texpected NUL, found %X (eof=%d, unread=%d)\n", (int)parser.buffer.pointer[0], parser.eof, parser.unread);
+        else if (parser->input.buffer[parser->input.pointer] != '\0') {
+            printf("\texpected NUL, found %X (eof=%d, unread=%d)\n", (int)parser->input.buffer[parser->input.pointer], parser->is_eof, (int)parser->unread);
             failed = 1;
         }
     }
-    yaml_parser_delete(&parser);
+    yaml_parser_delete(parser);
     free(buffer);
     printf("checking a long utf8 sequence: %d fail(s)\n", failed);
     return failed;
@@ -278,7 +288,7 @@ int check_long_utf8(void)
 
 int check_long_utf16(void)
 {
-    yaml_parser_t parser;
+    yaml_parser_t *parser;
     int k = 0;
     int j;
     int failed = 0;
@@ -298,17 +308,19 @@ int check_long_utf16(void)
             buffer[k++] = '\x04';
         }
     }
-    yaml_parser_initialize(&parser);
-    yaml_parser_set_input_string(&parser, buffer, 2+LONG*2);
+    parser = yaml_parser_new();
+    assert(parser);
+    yaml_parser_set_string_reader(parser, buffer, 2+LONG*2);
     for (k = 0; k < LONG; k++) {
-        if (!parser.unread) {
-            if (!yaml_parser_update_buffer(&parser, 1)) {
-                printf("\treader error: %s at %d\n", parser.problem, parser.problem_offset);
+        if (!parser->unread) {
+            if (!yaml_parser_update_buffer(parser, 1)) {
+                printf("\treader error: %s at %d\n", parser->error.data.reading.problem,
+                    (int)parser->error.data.reading.offset);
                 failed = 1;
                 break;
             }
         }
-        if (!parser.unread) {
+        if (!parser->unread) {
             printf("\tnot enough characters at %d\n", k);
             failed = 1;
             break;
@@ -321,27 +333,28 @@ int check_long_utf16(void)
             ch0 = '\xd0';
             ch1 = '\xaf';
         }
-        if (parser.buffer.pointer[0] != ch0 || parser.buffer.pointer[1] != ch1) {
+        if (parser->input.buffer[parser->input.pointer] != ch0 || parser->input.buffer[parser->input.pointer+1] != ch1) {
             printf("\tincorrect UTF-8 sequence: %X %X instead of %X %X\n",
-                    (int)parser.buffer.pointer[0], (int)parser.buffer.pointer[1],
+                    (int)parser->input.buffer[parser->input.pointer], (int)parser->input.buffer[parser->input.pointer+1],
                     (int)ch0, (int)ch1);
             failed = 1;
             break;
         }
-        parser.buffer.pointer += 2;
-        parser.unread -= 1;
+        parser->input.pointer += 2;
+        parser->unread -= 1;
     }
     if (!failed) {
-        if (!yaml_parser_update_buffer(&parser, 1)) {
-            printf("\treader error: %s at %d\n", parser.problem, parser.problem_offset);
+        if (!yaml_parser_update_buffer(parser, 1)) {
+            printf("\treader error: %s at %d\n", parser->error.data.reading.problem,
+                    (int)parser->error.data.reading.offset);
             failed = 1;
         }
-        else if (parser.buffer.pointer[0] != '\0') {
-            printf("\texpected NUL, found %X (eof=%d, unread=%d)\n", (int)parser.buffer.pointer[0], parser.eof, parser.unread);
+        else if (parser->input.buffer[parser->input.pointer] != '\0') {
+            printf("\texpected NUL, found %X (eof=%d, unread=%d)\n", (int)parser->input.buffer[parser->input.pointer], parser->is_eof, (int)parser->unread);
             failed = 1;
         }
     }
-    yaml_parser_delete(&parser);
+    yaml_parser_delete(parser);
     free(buffer);
     printf("checking a long utf16 sequence: %d fail(s)\n", failed);
     return failed;
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef NDEBUG
 #undef NDEBUG
@@ -21,9 +22,9 @@ main(void)
     assert(strcmp(buf, yaml_get_version_string()) == 0);
 
     /* Print structure sizes. */
-    printf("sizeof(token) = %d\n", sizeof(yaml_token_t));
-    printf("sizeof(event) = %d\n", sizeof(yaml_event_t));
-    printf("sizeof(parser) = %d\n", sizeof(yaml_parser_t));
+    printf("sizeof(token) = %d\n", (int)sizeof(yaml_token_t));
+    printf("sizeof(event) = %d\n", (int)sizeof(yaml_event_t));
+    printf("sizeof(document) = %d\n", (int)sizeof(yaml_document_t));
 
     return 0;
 }